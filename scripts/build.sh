@@ -0,0 +1,121 @@
+#!/bin/bash
+
+# path to the ODGI executable
+OG=$1
+# path to the ODGI test folder
+TEST=$2
+
+# GFA that refers to segments it doesn't declare must be rejected with a parse error, on any number of threads
+OUT=$(mktemp)
+
+echo " [binary_tester::build] INFO: Testing edge_to_missing_node with 1 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_to_missing_node.gfa -o "$OUT" -t 1 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"edge to a missing node"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_to_missing_node with 1 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_to_missing_node with 1 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing edge_to_missing_node with 4 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_to_missing_node.gfa -o "$OUT" -t 4 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"edge to a missing node"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_to_missing_node with 4 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_to_missing_node with 4 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing edge_beyond_last_node with 1 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_beyond_last_node.gfa -o "$OUT" -t 1 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"edge to a missing node"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_beyond_last_node with 1 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_beyond_last_node with 1 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing edge_beyond_last_node with 4 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_beyond_last_node.gfa -o "$OUT" -t 4 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"edge to a missing node"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_beyond_last_node with 4 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_beyond_last_node with 4 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing step_on_missing_node with 1 threads."
+err=$("$OG" build -g "$TEST"/binary/build/step_on_missing_node.gfa -o "$OUT" -t 1 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"step on a missing node in path x"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing step_on_missing_node with 1 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing step_on_missing_node with 1 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing step_on_missing_node with 4 threads."
+err=$("$OG" build -g "$TEST"/binary/build/step_on_missing_node.gfa -o "$OUT" -t 4 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"step on a missing node in path x"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing step_on_missing_node with 4 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing step_on_missing_node with 4 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing walk_on_node_zero with 1 threads."
+err=$("$OG" build -g "$TEST"/binary/build/walk_on_node_zero.gfa -o "$OUT" -t 1 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"step on a missing node in path s#1#c:0-2"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing walk_on_node_zero with 1 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing walk_on_node_zero with 1 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing walk_on_node_zero with 4 threads."
+err=$("$OG" build -g "$TEST"/binary/build/walk_on_node_zero.gfa -o "$OUT" -t 4 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"step on a missing node in path s#1#c:0-2"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing walk_on_node_zero with 4 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing walk_on_node_zero with 4 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing edge_id_not_a_number with 1 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_id_not_a_number.gfa -o "$OUT" -t 1 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"id parsing failure"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_id_not_a_number with 1 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_id_not_a_number with 1 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+echo " [binary_tester::build] INFO: Testing edge_id_not_a_number with 4 threads."
+err=$("$OG" build -g "$TEST"/binary/build/edge_id_not_a_number.gfa -o "$OUT" -t 4 2>&1)
+ret=$?
+if [[ $ret -ne 0 && "$err" == *"id parsing failure"* ]]; then
+    echo " [binary_tester::build] SUCCESS: Testing edge_id_not_a_number with 4 threads."
+else
+    echo " [binary_tester::build] FAILED: Testing edge_id_not_a_number with 4 threads."
+    rm -f "$OUT"
+    exit 1
+fi
+
+rm -f "$OUT"
@@ -113,4 +113,184 @@ if [[ $ret -eq 0 ]]; then
 else
     echo " [binary_tester::position] FAILED: Testing GFF lifting for Bandage."
     exit 1
-fi
\ No newline at end of file
+fi
+
+echo " [binary_tester::position] INFO: Testing graph positions from a file, across threads."
+diff -u "$TEST"/binary/position/graph_pos_file_ <("$OG" position -i "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file -r x -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing graph positions from a file, across threads."
+else
+    echo " [binary_tester::position] FAILED: Testing graph positions from a file, across threads."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing graph positions from a file as graph positions."
+diff -u "$TEST"/binary/position/graph_pos_file_graph_pos <("$OG" position -i "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing graph positions from a file as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing graph positions from a file as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting graph positions."
+diff -u "$TEST"/binary/position/graph_pos_file_lift <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting graph positions as graph positions."
+diff -u "$TEST"/binary/position/graph_pos_file_lift_graph_pos <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting graph positions as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting graph positions as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing all immediate path positions."
+diff -u "$TEST"/binary/position/graph_pos_file_immediate_ <("$OG" position -i "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file_immediate -I)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing all immediate path positions."
+else
+    echo " [binary_tester::position] FAILED: Testing all immediate path positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing all immediate path positions, falling back to the search."
+diff -u "$TEST"/binary/position/graph_pos_file_immediate_ref_ <("$OG" position -i "$TEST"/k.gfa -G "$TEST"/binary/position/graph_pos_file_immediate_ref -I -r x)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing all immediate path positions, falling back to the search."
+else
+    echo " [binary_tester::position] FAILED: Testing all immediate path positions, falling back to the search."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting all immediate path positions."
+diff -u "$TEST"/binary/position/node_node_mapping_immediate_lift <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -g 6,1 -I)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting all immediate path positions."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting all immediate path positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing path positions from a file, with one beyond the path end."
+diff -u "$TEST"/binary/position/path_pos_file_ <("$OG" position -i "$TEST"/k.gfa -F "$TEST"/binary/position/path_pos_file -r x -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing path positions from a file, with one beyond the path end."
+else
+    echo " [binary_tester::position] FAILED: Testing path positions from a file, with one beyond the path end."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing path positions from a file as graph positions."
+diff -u "$TEST"/binary/position/path_pos_file_graph_pos <("$OG" position -i "$TEST"/k.gfa -F "$TEST"/binary/position/path_pos_file -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing path positions from a file as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing path positions from a file as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting path positions, with one beyond the path end."
+diff -u "$TEST"/binary/position/path_pos_file_lift_ <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -F "$TEST"/binary/position/path_pos_file_lift -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting path positions, with one beyond the path end."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting path positions, with one beyond the path end."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting path positions as graph positions."
+diff -u "$TEST"/binary/position/path_pos_file_lift_graph_pos <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -F "$TEST"/binary/position/path_pos_file_lift -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting path positions as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting path positions as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing a path position beyond the path end."
+diff -u /dev/null <("$OG" position -i "$TEST"/k.gfa -p x,1000)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing a path position beyond the path end."
+else
+    echo " [binary_tester::position] FAILED: Testing a path position beyond the path end."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing BED ranges, with one ending beyond the path end."
+diff -u "$TEST"/binary/position/bed_input_ <("$OG" position -i "$TEST"/k.gfa -b "$TEST"/binary/position/bed_input -r x -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing BED ranges, with one ending beyond the path end."
+else
+    echo " [binary_tester::position] FAILED: Testing BED ranges, with one ending beyond the path end."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing BED ranges as graph positions."
+diff -u "$TEST"/binary/position/bed_input_graph_pos <("$OG" position -i "$TEST"/k.gfa -b "$TEST"/binary/position/bed_input -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing BED ranges as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing BED ranges as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting BED ranges, with one ending beyond the path end."
+diff -u "$TEST"/binary/position/bed_input_lift_ <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -b "$TEST"/binary/position/bed_input_lift)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting BED ranges, with one ending beyond the path end."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting BED ranges, with one ending beyond the path end."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing lifting BED ranges as graph positions."
+diff -u "$TEST"/binary/position/bed_input_lift_graph_pos <("$OG" position -i "$TEST"/k.x.rechop.gfa -x "$TEST"/k.gfa -b "$TEST"/binary/position/bed_input_lift -v)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing lifting BED ranges as graph positions."
+else
+    echo " [binary_tester::position] FAILED: Testing lifting BED ranges as graph positions."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing GFF lifting for Bandage across threads."
+diff -u "$TEST"/binary/position/gff <("$OG" position -i "$TEST"/overlap.gfa -E "$TEST"/overlap.gtf -t 4)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing GFF lifting for Bandage across threads."
+else
+    echo " [binary_tester::position] FAILED: Testing GFF lifting for Bandage across threads."
+    exit 1
+fi
+
+echo " [binary_tester::position] INFO: Testing GFF lifting for Bandage with a source graph."
+diff -u "$TEST"/binary/position/gff <("$OG" position -i "$TEST"/overlap.gfa -x "$TEST"/overlap.gfa -E "$TEST"/overlap.gtf)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::position] SUCCESS: Testing GFF lifting for Bandage with a source graph."
+else
+    echo " [binary_tester::position] FAILED: Testing GFF lifting for Bandage with a source graph."
+    exit 1
+fi
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# path to the ODGI executable
+OG=$1
+# path to the ODGI test folder
+TEST=$2
+
+# The paths of similarity.gfa step on nodes 1 and 2 more than once, so that groups stepping c and d times on a node
+# of length l share min(c, d) * l of it.
+
+echo " [binary_tester::similarity] INFO: Testing with default settings."
+diff -u "$TEST"/binary/similarity/default <("$OG" similarity -i "$TEST"/similarity.gfa)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::similarity] SUCCESS: Testing with default settings."
+else
+    echo " [binary_tester::similarity] FAILED: Testing with default settings."
+    exit 1
+fi
+
+echo " [binary_tester::similarity] INFO: Testing distances."
+diff -u "$TEST"/binary/similarity/distances <("$OG" similarity -i "$TEST"/similarity.gfa -d)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::similarity] SUCCESS: Testing distances."
+else
+    echo " [binary_tester::similarity] FAILED: Testing distances."
+    exit 1
+fi
+
+echo " [binary_tester::similarity] INFO: Testing groups of paths."
+diff -u "$TEST"/binary/similarity/groups <("$OG" similarity -i "$TEST"/similarity.gfa -D '#')
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::similarity] SUCCESS: Testing groups of paths."
+else
+    echo " [binary_tester::similarity] FAILED: Testing groups of paths."
+    exit 1
+fi
+
+echo " [binary_tester::similarity] INFO: Testing distances between groups of paths."
+diff -u "$TEST"/binary/similarity/groups_distances <("$OG" similarity -i "$TEST"/similarity.gfa -D '#' -d)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::similarity] SUCCESS: Testing distances between groups of paths."
+else
+    echo " [binary_tester::similarity] FAILED: Testing distances between groups of paths."
+    exit 1
+fi
+
+echo " [binary_tester::similarity] INFO: Testing with several threads."
+diff -u "$TEST"/binary/similarity/groups <("$OG" similarity -i "$TEST"/similarity.gfa -D '#' -t 3)
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo " [binary_tester::similarity] SUCCESS: Testing with several threads."
+else
+    echo " [binary_tester::similarity] FAILED: Testing with several threads."
+    exit 1
+fi
@@ -45,3 +45,23 @@ else
     echo "[binary_tester] FAILED: At least one binary test for odgi untangle failed."
     exit 1
 fi
+
+echo "[binary_tester] INFO: Running binary tests of odgi similarity."
+bash "$SC"/similarity.sh "$OG" "$TEST"
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo "[binary_tester] SUCCESS: All binary tests for odgi similarity passed."
+else
+    echo "[binary_tester] FAILED: At least one binary test for odgi similarity failed."
+    exit 1
+fi
+
+echo "[binary_tester] INFO: Running binary tests of odgi build."
+bash "$SC"/build.sh "$OG" "$TEST"
+ret=$?
+if [[ $ret -eq 0 ]]; then
+    echo "[binary_tester] SUCCESS: All binary tests for odgi build passed."
+else
+    echo "[binary_tester] FAILED: At least one binary test for odgi build failed."
+    exit 1
+fi
@@ -97,14 +97,22 @@ double u_rfpart(double x) { return 1.0 - u_fpart(x); }
 void wu_draw_line(const bool steep, const double_t gradient, double intery,
                   const xy_d_t pxl1, const xy_d_t pxl2, const color_t& color,
                   atomic_image_buf_t& image, bool top, bool bottom) {
+    // step over the part of the line before the window along its major axis, adding up the same steps,
+    // and stop at its end, so a window draws exactly the pixels the whole picture would have there
+    const double window_begin = steep ? image.window_y : image.window_x;
+    const double window_end = window_begin + (steep ? image.window_height : image.window_width);
+    double i = pxl1.x + 1;
+    for ( ; i < pxl2.x && i < window_begin; ++i) {
+        intery += gradient;
+    }
     if (steep) {
-        for (double i = pxl1.x + 1; i < pxl2.x; ++i) {
+        for ( ; i < pxl2.x && i < window_end; ++i) {
             image.layer_pixel(u_ipart(intery), i, lighten(color, (!bottom ? 1.0 : 1.0-u_rfpart(intery))));
             image.layer_pixel(u_ipart(intery) + 1, i, lighten(color, (!top ? 1.0 : 1.0-u_fpart(intery))));
             intery += gradient;
         }
     } else {
-        for (double i = pxl1.x + 1; i < pxl2.x; ++i) {
+        for ( ; i < pxl2.x && i < window_end; ++i) {
             image.layer_pixel(i, u_ipart(intery), lighten(color, (!bottom ? 1.0 : 1.0-u_rfpart(intery))));
             image.layer_pixel(i, u_ipart(intery) + 1, lighten(color, (!top ? 1.0 : 1.0-u_fpart(intery))));
             intery += gradient;
@@ -254,9 +262,13 @@ void wu_rekt(xy_d_t xy0, xy_d_t xy1,
     
     xy_d_t l = { u_ipart(min_x), u_ipart(min_y) };
     xy_d_t h = { u_ipart(max_x), u_ipart(max_y) };
-    // search the bounding box +/- 1 for pixels inside our bounds
-    for (double i = l.y-1; i < h.y+1; ++i) {
-        for (double j = l.x-1; j < h.x+1; ++j) {
+    // search the bounding box +/- 1 for pixels inside our bounds, as far as it overlaps the window
+    const double first_y = std::max(l.y - 1, (double)image.window_y);
+    const double end_y = std::min(h.y + 1, (double)(image.window_y + image.window_height));
+    const double first_x = std::max(l.x - 1, (double)image.window_x);
+    const double end_x = std::min(h.x + 1, (double)(image.window_x + image.window_width));
+    for (double i = first_y; i < end_y; ++i) {
+        for (double j = first_x; j < end_x; ++j) {
             // draw if it's in bounds
             if (inside({j, i})) {
                 image.set_pixel(j, i, color);
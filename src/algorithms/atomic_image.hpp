@@ -115,30 +115,51 @@ struct atomic_image_buf_t {
     double source_per_px_y = 0;
     double source_min_x = 0;
     double source_min_y = 0;
+    // the part of the width×height picture that the buffer holds, pixels drawn outside of it are dropped
+    uint64_t window_x = 0;
+    uint64_t window_y = 0;
+    uint64_t window_width = 0;
+    uint64_t window_height = 0;
     atomic_image_buf_t(const uint64_t& w,
                        const uint64_t& h,
                        const double& s_w,
                        const double& s_h,
                        const double& s_m_x,
                        const double& s_m_y)
+        : atomic_image_buf_t(w, h, s_w, s_h, s_m_x, s_m_y, 0, 0, w, h) { }
+    atomic_image_buf_t(const uint64_t& w,
+                       const uint64_t& h,
+                       const double& s_w,
+                       const double& s_h,
+                       const double& s_m_x,
+                       const double& s_m_y,
+                       const uint64_t& win_x,
+                       const uint64_t& win_y,
+                       const uint64_t& win_w,
+                       const uint64_t& win_h)
         : width(w)
         , height(h)
         , source_width(s_w)
         , source_height(s_h)
         , source_min_x(s_m_x)
         , source_min_y(s_m_y)
+        , window_x(win_x)
+        , window_y(win_y)
+        , window_width(win_w)
+        , window_height(win_h)
         {
         //std::cerr << "width x height " << w << "x" << h << std::endl;
-        image = std::make_unique<std::vector<std::atomic<uint32_t>>>(height * width);
+        image = std::make_unique<std::vector<std::atomic<uint32_t>>>(window_height * window_width);
         for (uint64_t i = 0; i < image->size(); ++i) {
             //std::cerr << "coloring " << COLOR_WHITE.hex << std::endl;
-            (*image)[i] = COLOR_WHITE.hex; // atomic assignment
+            // nobody else sees the buffer yet, so there is no need to fence every pixel
+            (*image)[i].store(COLOR_WHITE.hex, std::memory_order_relaxed);
         }
         source_per_px_x = source_width / width;
         source_per_px_y = source_height / height;
     }
     std::vector<uint8_t> to_bytes() {
-        std::vector<uint8_t> bytes(4 * height * width);
+        std::vector<uint8_t> bytes(4 * window_height * window_width);
         for (uint64_t i = 0; i < image->size(); ++i) {
             color_t c = {(*image)[i].load()};
             uint64_t j = i * 4;
@@ -149,22 +170,31 @@ struct atomic_image_buf_t {
         }
         return bytes;
     }
+    // true if the pixel is in the picture and in the window, written so that NaN coordinates are not
+    bool holds(const double& x, const double& y) const {
+        return x >= window_x && y >= window_y
+            && x < window_x + window_width && y < window_y + window_height
+            && x < width && y < height;
+    }
     // ablative
-    void set_pixel(const uint64_t& x,
-                   const uint64_t& y,
+    void set_pixel(const double& x,
+                   const double& y,
                    const color_t& c) {
+        if (!holds(x, y)) {
+            return; // bail out
+        }
         //size_t i = width * y + x;
         //std::cerr << "setting color with intensity " << f << std::endl;
-        (*image)[width * y + x] = c.hex;
+        (*image)[window_width * ((uint64_t)y - window_y) + ((uint64_t)x - window_x)] = c.hex;
     }
     // layering
-    void layer_pixel(const uint64_t& x,
-                     const uint64_t& y,
+    void layer_pixel(const double& x,
+                     const double& y,
                      const color_t& c) {
-        if (x >= width || y >= height) {
+        if (!holds(x, y)) {
             return; // bail out
         }
-        size_t i = width * y + x;
+        size_t i = window_width * ((uint64_t)y - window_y) + ((uint64_t)x - window_x);
         //std::cerr << "getting i=" << i << " " << y << " " << x << " " << " in image " << height << "x" << width << std::endl;
         color_t v;
         v.hex = (*image)[i].load();
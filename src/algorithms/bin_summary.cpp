@@ -0,0 +1,424 @@
+#include "bin_summary.hpp"
+#include "stepindex.hpp"
+#include "progress.hpp"
+#include <handlegraph/util.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+
+namespace odgi {
+    namespace algorithms {
+
+        /// Starts every summary file, followed by its version
+        const static std::string BIN_SUMMARY_MAGIC = "ODGIBSUM";
+        const static uint64_t BIN_SUMMARY_VERSION = 1;
+
+        void bin_summary_entry_t::merge(const bin_summary_entry_t &other) {
+            depth += other.depth;
+            inverted += other.inverted;
+            uncalled += other.uncalled;
+            first = std::min(first, other.first);
+            last = std::max(last, other.last);
+            position_sum += other.position_sum;
+        }
+
+        bin_summary_means_t bin_summary_entry_t::means(const uint64_t &width, const uint64_t &path_length) const {
+            bin_summary_means_t means;
+            means.depth = (double) depth / width;
+            means.inverted = depth ? (double) inverted / depth : 0;
+            means.position = depth ? position_sum / ((double) width * path_length * means.depth) : 0;
+            return means;
+        }
+
+        /// merge the entries of equal bins of entries sorted by bin, in place
+        static void merge_equal_bins(std::vector<bin_summary_entry_t> &entries) {
+            uint64_t fill = 0;
+            for (uint64_t i = 0; i < entries.size(); ++i) {
+                if (fill > 0 && entries[fill - 1].bin == entries[i].bin) {
+                    entries[fill - 1].merge(entries[i]);
+                } else {
+                    entries[fill++] = entries[i];
+                }
+            }
+            entries.resize(fill);
+            entries.shrink_to_fit();
+        }
+
+        void bin_summary_t::build(const PathHandleGraph &graph,
+                                  const uint64_t &base_width,
+                                  const uint64_t &nthreads,
+                                  const bool &progress) {
+            if (base_width == 0) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: the base bin width must be greater than 0.");
+            }
+            this->base_width = base_width;
+            // lay out the nodes in the order of the handles, and count their Ns
+            const uint64_t shift = number_bool_packing::unpack_number(graph.get_handle(graph.min_node_id()));
+            std::vector<uint64_t> position_map(graph.get_node_count() + 1);
+            std::vector<uint64_t> node_uncalled(graph.get_node_count() + 1);
+            uint64_t len = 0;
+            graph.for_each_handle([&](const handle_t &h) {
+                const uint64_t rank = number_bool_packing::unpack_number(h) - shift;
+                position_map[rank] = len;
+                const std::string seq = graph.get_sequence(h);
+                node_uncalled[rank] = std::count_if(seq.begin(), seq.end(), [](const char &c) {
+                    return c == 'N' || c == 'n';
+                });
+                len += seq.size();
+            });
+            pangenome_length = len;
+
+            std::vector<path_handle_t> paths;
+            paths.reserve(graph.get_path_count());
+            graph.for_each_path_handle([&](const path_handle_t &path) {
+                paths.push_back(path);
+            });
+            path_names.clear();
+            path_rank.clear();
+            for (auto &path : paths) {
+                path_rank[graph.get_path_name(path)] = path_names.size();
+                path_names.push_back(graph.get_path_name(path));
+            }
+            path_lengths.assign(paths.size(), 0);
+
+            // the last level holds the whole pangenome in one bin
+            uint64_t level_count = 1;
+            while ((base_width << (level_count - 1)) < len) {
+                ++level_count;
+            }
+            levels.assign(level_count, std::vector<std::vector<bin_summary_entry_t>>(paths.size()));
+
+            std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+            if (progress) {
+                progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                        paths.size(), "[odgi::algorithms::bin_summary] summarizing paths:");
+            }
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                // one entry for each piece of a node that falls into a bin
+                std::vector<bin_summary_entry_t> &entries = levels[0][i];
+                uint64_t path_pos = 0;
+                graph.for_each_step_in_path(paths[i], [&](const step_handle_t &step) {
+                    const handle_t h = graph.get_handle_of_step(step);
+                    const uint64_t rank = number_bool_packing::unpack_number(h) - shift;
+                    const uint64_t p = position_map[rank];
+                    const uint64_t hl = graph.get_length(h);
+                    const bool is_rev = graph.get_is_reverse(h);
+                    const uint64_t uncalled = node_uncalled[rank];
+                    // as in bin_path_info, the bases of the node follow each other in the path in the order of the
+                    // pangenome sequence, whatever the strand of the step
+                    std::string seq;
+                    for (uint64_t k = 0; k < hl;) {
+                        const uint64_t bin = (p + k) / base_width;
+                        const uint64_t k_end = std::min(hl, (bin + 1) * base_width - p);
+                        const uint64_t n = k_end - k;
+                        bin_summary_entry_t entry;
+                        entry.bin = bin;
+                        entry.depth = n;
+                        entry.inverted = is_rev ? n : 0;
+                        if (uncalled == 0 || uncalled == hl) {
+                            entry.uncalled = uncalled ? n : 0;
+                        } else if (n == hl) {
+                            entry.uncalled = uncalled;
+                        } else {
+                            if (seq.empty()) {
+                                seq = graph.get_sequence(graph.forward(h));
+                            }
+                            entry.uncalled = std::count_if(seq.begin() + k, seq.begin() + k_end, [](const char &c) {
+                                return c == 'N' || c == 'n';
+                            });
+                        }
+                        entry.first = path_pos + k + 1;
+                        entry.last = path_pos + k_end;
+                        entry.position_sum = (double) n * ((double) (path_pos + k) + (double) (n - 1) / 2);
+                        if (!entries.empty() && entries.back().bin == bin) {
+                            entries.back().merge(entry);
+                        } else {
+                            entries.push_back(entry);
+                        }
+                        k = k_end;
+                    }
+                    path_pos += hl;
+                });
+                path_lengths[i] = path_pos;
+                std::sort(entries.begin(), entries.end(),
+                          [](const bin_summary_entry_t &a, const bin_summary_entry_t &b) {
+                              return a.bin < b.bin;
+                          });
+                merge_equal_bins(entries);
+                // each coarser level merges pairs of bins of the level below
+                for (uint64_t l = 1; l < level_count; ++l) {
+                    std::vector<bin_summary_entry_t> &coarser = levels[l][i];
+                    coarser = levels[l - 1][i];
+                    for (auto &entry : coarser) {
+                        entry.bin >>= 1;
+                    }
+                    merge_equal_bins(coarser);
+                }
+                if (progress) {
+                    progress_meter->increment(1);
+                }
+            }
+            if (progress) {
+                progress_meter->finish();
+            }
+        }
+
+        template<typename T>
+        static void write_value(std::ostream &out, const T &value) {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        static T read_value(std::istream &in) {
+            T value;
+            in.read(reinterpret_cast<char *>(&value), sizeof(T));
+            return value;
+        }
+
+        void bin_summary_t::save(const std::string &file) const {
+            const std::string tmp_file = file + ".tmp";
+            {
+                std::ofstream out(tmp_file, std::ios::binary);
+                out.write(BIN_SUMMARY_MAGIC.data(), BIN_SUMMARY_MAGIC.size());
+                write_value(out, BIN_SUMMARY_VERSION);
+                write_value(out, graph_hash);
+                write_value(out, pangenome_length);
+                write_value(out, base_width);
+                write_value(out, (uint64_t) path_names.size());
+                for (uint64_t i = 0; i < path_names.size(); ++i) {
+                    write_value(out, (uint64_t) path_names[i].size());
+                    out.write(path_names[i].data(), path_names[i].size());
+                    write_value(out, path_lengths[i]);
+                }
+                write_value(out, (uint64_t) levels.size());
+                for (auto &level : levels) {
+                    for (auto &entries : level) {
+                        write_value(out, (uint64_t) entries.size());
+                        for (auto &entry : entries) {
+                            write_value(out, entry.bin);
+                            write_value(out, entry.depth);
+                            write_value(out, entry.inverted);
+                            write_value(out, entry.uncalled);
+                            write_value(out, entry.first);
+                            write_value(out, entry.last);
+                            write_value(out, entry.position_sum);
+                        }
+                    }
+                }
+                if (!out) {
+                    throw std::runtime_error("[odgi::algorithms::bin_summary] error: could not write bin summary " + tmp_file + ".");
+                }
+            }
+            if (std::rename(tmp_file.c_str(), file.c_str()) != 0) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: could not move bin summary " + tmp_file + " to " + file + ".");
+            }
+        }
+
+        void bin_summary_t::load(const std::string &file) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: could not open bin summary " + file + ".");
+            }
+            std::string magic(BIN_SUMMARY_MAGIC.size(), ' ');
+            in.read(&magic[0], magic.size());
+            if (magic != BIN_SUMMARY_MAGIC) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: " + file + " is not a bin summary.");
+            }
+            const uint64_t version = read_value<uint64_t>(in);
+            if (version != BIN_SUMMARY_VERSION) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: bin summary " + file + " has unknown version "
+                                         + std::to_string(version) + ".");
+            }
+            graph_hash = read_value<uint64_t>(in);
+            pangenome_length = read_value<uint64_t>(in);
+            base_width = read_value<uint64_t>(in);
+            // the counts in the file size what is read next, so they must fit in what is left of it
+            const uint64_t file_size = std::filesystem::file_size(file);
+            auto check_fits = [&](const uint64_t &count, const uint64_t &bytes_each) {
+                const int64_t pos = in.tellg();
+                if (!in || pos < 0 || (uint64_t) pos > file_size || count > (file_size - pos) / bytes_each) {
+                    throw std::runtime_error("[odgi::algorithms::bin_summary] error: bin summary " + file + " is truncated.");
+                }
+            };
+            const uint64_t path_count = read_value<uint64_t>(in);
+            // each path has at least its name length and its length
+            check_fits(path_count, 2 * sizeof(uint64_t));
+            path_names.assign(path_count, "");
+            path_lengths.assign(path_count, 0);
+            path_rank.clear();
+            for (uint64_t i = 0; i < path_count; ++i) {
+                const uint64_t name_length = read_value<uint64_t>(in);
+                check_fits(name_length, 1);
+                path_names[i].resize(name_length);
+                in.read(&path_names[i][0], path_names[i].size());
+                path_lengths[i] = read_value<uint64_t>(in);
+                path_rank[path_names[i]] = i;
+            }
+            const uint64_t level_count = read_value<uint64_t>(in);
+            // a level per power of two up to the pangenome length, and an entry count per path in each
+            if (!in || level_count == 0 || level_count > 64) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: bin summary " + file + " is truncated.");
+            }
+            check_fits(level_count * path_count, sizeof(uint64_t));
+            levels.assign(level_count, std::vector<std::vector<bin_summary_entry_t>>(path_count));
+            for (auto &level : levels) {
+                for (auto &entries : level) {
+                    const uint64_t entry_count = read_value<uint64_t>(in);
+                    check_fits(entry_count, 6 * sizeof(uint64_t) + sizeof(double));
+                    entries.resize(entry_count);
+                    for (auto &entry : entries) {
+                        entry.bin = read_value<uint64_t>(in);
+                        entry.depth = read_value<uint64_t>(in);
+                        entry.inverted = read_value<uint64_t>(in);
+                        entry.uncalled = read_value<uint64_t>(in);
+                        entry.first = read_value<uint64_t>(in);
+                        entry.last = read_value<uint64_t>(in);
+                        entry.position_sum = read_value<double>(in);
+                    }
+                }
+            }
+            if (!in || base_width == 0) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: bin summary " + file + " is truncated.");
+            }
+        }
+
+        int64_t bin_summary_t::get_path_rank(const std::string &path_name) const {
+            auto f = path_rank.find(path_name);
+            return f == path_rank.end() ? -1 : (int64_t) f->second;
+        }
+
+        uint64_t bin_summary_t::level_for_width(const uint64_t &width) const {
+            const uint64_t level = __builtin_ctzll(width / base_width);
+            return std::min(level, (uint64_t) levels.size() - 1);
+        }
+
+        /// the first entry of a level whose bin is not below the given one
+        static std::vector<bin_summary_entry_t>::const_iterator
+        first_entry_from(const std::vector<bin_summary_entry_t> &entries, const uint64_t &bin) {
+            return std::lower_bound(entries.begin(), entries.end(), bin,
+                                    [](const bin_summary_entry_t &entry, const uint64_t &b) {
+                                        return entry.bin < b;
+                                    });
+        }
+
+        void bin_summary_t::for_each_bin(const uint64_t &path_rank,
+                                         const uint64_t &width,
+                                         const std::function<void(const bin_summary_entry_t &)> &fn,
+                                         const uint64_t &start,
+                                         const uint64_t &end) const {
+            if (width == 0 || width % base_width != 0) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: the bin width " + std::to_string(width)
+                                         + " is not a multiple of the base bin width " + std::to_string(base_width)
+                                         + " of the summary.");
+            }
+            const uint64_t level = level_for_width(width);
+            const uint64_t factor = width / (base_width << level);
+            const auto &entries = levels[level][path_rank];
+            bin_summary_entry_t bin;
+            bool open = false;
+            for (auto it = first_entry_from(entries, start / width * factor);
+                 it != entries.end() && it->bin / factor * width < end; ++it) {
+                const uint64_t b = it->bin / factor;
+                if (open && bin.bin == b) {
+                    bin.merge(*it);
+                } else {
+                    if (open) {
+                        fn(bin);
+                    }
+                    bin = *it;
+                    bin.bin = b;
+                    open = true;
+                }
+            }
+            if (open) {
+                fn(bin);
+            }
+        }
+
+        void bin_summary_t::for_each_scaled_bin(const uint64_t &path_rank,
+                                                const double &width,
+                                                const std::function<void(const uint64_t &, const bin_summary_stats_t &)> &fn,
+                                                const uint64_t &start,
+                                                const uint64_t &end) const {
+            if (width < base_width) {
+                throw std::runtime_error("[odgi::algorithms::bin_summary] error: the bin width " + std::to_string(width)
+                                         + " is below the base bin width " + std::to_string(base_width)
+                                         + " of the summary.");
+            }
+            if (width == std::floor(width) && (uint64_t) width % base_width == 0) {
+                for_each_bin(path_rank, (uint64_t) width, [&](const bin_summary_entry_t &entry) {
+                    bin_summary_stats_t stats;
+                    stats.depth = entry.depth;
+                    stats.inverted = entry.inverted;
+                    stats.uncalled = entry.uncalled;
+                    fn(entry.bin, stats);
+                }, start, end);
+                return;
+            }
+            // the coarsest level whose bins are at most a sixteenth as wide as the asked ones, or else the finest
+            uint64_t level = 0;
+            while (level + 1 < levels.size() && (double) (base_width << (level + 1)) * 16 <= width) {
+                ++level;
+            }
+            const uint64_t level_width = base_width << level;
+            const auto &entries = levels[level][path_rank];
+            const uint64_t first_bin = std::floor((double) start / width);
+            // bins that still get content from the level bins to come
+            std::map<uint64_t, bin_summary_stats_t> pending;
+            for (auto it = first_entry_from(entries, (uint64_t) std::floor(first_bin * width) / level_width);
+                 it != entries.end(); ++it) {
+                const uint64_t begin_bp = it->bin * level_width;
+                const uint64_t end_bp = std::min((it->bin + 1) * level_width, pangenome_length);
+                const uint64_t begin_bin = std::floor((double) begin_bp / width);
+                if (begin_bin * width >= end) {
+                    break;
+                }
+                // every bin before this one is complete
+                while (!pending.empty() && pending.begin()->first < begin_bin) {
+                    fn(pending.begin()->first, pending.begin()->second);
+                    pending.erase(pending.begin());
+                }
+                const double span = end_bp - begin_bp;
+                for (uint64_t b = std::max(begin_bin, first_bin); b * width < end_bp && b * width < end; ++b) {
+                    const double overlap = std::min((double) end_bp, (b + 1) * width) - std::max((double) begin_bp, b * width);
+                    if (overlap <= 0) {
+                        continue;
+                    }
+                    auto &stats = pending[b];
+                    stats.depth += it->depth * overlap / span;
+                    stats.inverted += it->inverted * overlap / span;
+                    stats.uncalled += it->uncalled * overlap / span;
+                }
+            }
+            for (auto &bin : pending) {
+                fn(bin.first, bin.second);
+            }
+        }
+
+        bool load_bin_summary(bin_summary_t &summary,
+                              const std::string &file,
+                              const std::string &graph_file,
+                              const bool &progress) {
+            if (graph_file == "-" || !std::filesystem::exists(file)) {
+                return false;
+            }
+            summary.load(file);
+            if (summary.graph_hash == 0 || summary.graph_hash != graph_file_hash(graph_file)) {
+                if (progress) {
+                    std::cerr << "[odgi::algorithms::bin_summary] warning: ignoring " << file
+                              << " as it was not built from the current contents of " << graph_file << "." << std::endl;
+                }
+                return false;
+            }
+            return true;
+        }
+
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * \file bin_summary.hpp
+ *
+ * A persistent, multi-resolution summary of how the paths cover the pangenome sequence: for each path and each bin
+ * of the sorted graph, the bases the path has there, how many of them are inverted or N, and which part of the path
+ * they come from. It is built once with a walk along all paths, at a base bin width and at every power-of-two multiple
+ * of it, so that odgi bin and odgi viz can answer any range at any bin width that is a multiple of the base width by
+ * adding up the few bins of the coarsest level that fits, instead of walking the paths base by base again.
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <functional>
+#include <unordered_map>
+#include <handlegraph/path_handle_graph.hpp>
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// What odgi bin reports for a path in a bin, computed as bin_path_info computes it: the bases of the path in the bin
+/// over the bin width, the share of them that is inverted, and their mean position in the path over the path length
+/// and the mean depth
+struct bin_summary_means_t {
+    double depth = 0;
+    double inverted = 0;
+    double position = 0;
+};
+
+/// What one path has in one bin
+struct bin_summary_entry_t {
+    /// 0-based bin at the width of its level
+    uint64_t bin = 0;
+    /// bases of the path in the bin, and how many of them are on the reverse strand or N
+    uint64_t depth = 0;
+    uint64_t inverted = 0;
+    uint64_t uncalled = 0;
+    /// lowest and highest 1-based nucleotide of the path in the bin
+    uint64_t first = std::numeric_limits<uint64_t>::max();
+    uint64_t last = 0;
+    /// sum of the 0-based positions in the path of its bases in the bin
+    double position_sum = 0;
+
+    /// add the content of another bin
+    void merge(const bin_summary_entry_t& other);
+
+    /// the means of a bin of the given width of a path of the given length
+    bin_summary_means_t means(const uint64_t& width, const uint64_t& path_length) const;
+};
+
+/// Depth, inversions and uncalled bases of a path in a bin whose width isn't a multiple of the widths of the levels,
+/// split out of the level bins in proportion to how much of them lies in the bin
+struct bin_summary_stats_t {
+    double depth = 0;
+    double inverted = 0;
+    double uncalled = 0;
+};
+
+class bin_summary_t {
+public:
+    /// hash of the graph file the summary was built from (0 if unknown), see graph_file_hash()
+    uint64_t graph_hash = 0;
+    /// length of the pangenome sequence, and the bin width of the finest level
+    uint64_t pangenome_length = 0;
+    uint64_t base_width = 0;
+    /// the paths in the order of the graph, and their lengths in bp
+    std::vector<std::string> path_names;
+    std::vector<uint64_t> path_lengths;
+    /// levels[l][p]: the bins of path p at width base_width << l, sorted by bin; the last level has one bin
+    std::vector<std::vector<std::vector<bin_summary_entry_t>>> levels;
+
+    /// Walk all paths in parallel and summarize them at base_width and all coarser levels.
+    /// The graph must be compacted, with its nodes laid out in the order of the handles.
+    void build(const PathHandleGraph& graph,
+               const uint64_t& base_width,
+               const uint64_t& nthreads,
+               const bool& progress);
+
+    /// Write the summary to a file, throwing std::runtime_error if it can't be written
+    void save(const std::string& file) const;
+
+    /// Read a summary written by save(), throwing std::runtime_error if the file isn't one
+    void load(const std::string& file);
+
+    /// The rank of a path by its name, or -1 if the summary doesn't have it
+    int64_t get_path_rank(const std::string& path_name) const;
+
+    /// Call fn for each bin of the given width, a multiple of base_width, in which the path has bases, in the order
+    /// of the bins, restricted to the bins that overlap the pangenome range [start, end). Bins are 0-based.
+    void for_each_bin(const uint64_t& path_rank,
+                      const uint64_t& width,
+                      const std::function<void(const bin_summary_entry_t&)>& fn,
+                      const uint64_t& start = 0,
+                      const uint64_t& end = std::numeric_limits<uint64_t>::max()) const;
+
+    /// Call fn for each bin of the given width, at least base_width but not necessarily a whole number of bp, in
+    /// which the path has bases, restricted to the bins that overlap [start, end). Bins are 0-based.
+    /// Exact where the bins line up with the bins of a level. Elsewhere the level bins that straddle two bins are split
+    /// between them in proportion, which is close as long as the asked width is many times the base width.
+    void for_each_scaled_bin(const uint64_t& path_rank,
+                             const double& width,
+                             const std::function<void(const uint64_t&, const bin_summary_stats_t&)>& fn,
+                             const uint64_t& start = 0,
+                             const uint64_t& end = std::numeric_limits<uint64_t>::max()) const;
+
+private:
+    std::unordered_map<std::string, uint64_t> path_rank;
+
+    /// the coarsest level whose bins line up with bins of the given width
+    uint64_t level_for_width(const uint64_t& width) const;
+};
+
+/// Load the summary from file if it exists and was built from this exact graph file. Returns true if it was loaded.
+bool load_bin_summary(bin_summary_t& summary,
+                      const std::string& file,
+                      const std::string& graph_file,
+                      const bool& progress);
+
+}
+}
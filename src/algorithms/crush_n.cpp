@@ -5,13 +5,20 @@ namespace algorithms {
 
 void crush_n(odgi::graph_t& graph) {
     graph.for_each_handle([&](const handle_t& handle) {
+        // without at least two Ns there is no run to crush
+        uint64_t counts[256] = {0};
+        graph.count_bases(handle, counts);
+        if (counts['N'] < 2) {
+            return;
+        }
         // strip Ns from start
         std::string seq;
+        seq.reserve(graph.get_length(handle));
         bool in_n = false;
-        for (auto c : graph.get_sequence(handle)) {
+        graph.for_each_base(handle, [&](const char& c) {
             if (c == 'N') {
                 if (in_n) {
-                    continue;
+                    return true;
                 } else {
                     in_n = true;
                 }
@@ -19,7 +26,8 @@ void crush_n(odgi::graph_t& graph) {
                 in_n = false;
             }
             seq.push_back(c);
-        }
+            return true;
+        });
         graph.set_handle_sequence(handle, seq);
     }, true); // in parallel
 }
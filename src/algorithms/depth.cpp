@@ -215,5 +215,94 @@ void for_each_path_range_depth(const PathHandleGraph& graph,
     }
 }
 
+void for_each_path_depth_run(const graph_t& graph,
+                             const std::vector<path_handle_t>& paths,
+                             const std::vector<bool>& paths_to_consider,
+                             const uint64_t& window_size,
+                             const uint64_t& nthreads,
+                             const std::function<void(const path_handle_t&, const uint64_t&, const uint64_t&, const double&)>& func,
+                             const std::function<void(const path_handle_t&)>& path_done) {
+    const bool subset_paths = !paths_to_consider.empty();
+    // the depth of each node by its rank, so node ids don't have to be compacted
+    uint64_t rank_count = 0;
+    graph.for_each_handle([&](const handle_t& h) {
+        rank_count = std::max(rank_count, (uint64_t)number_bool_packing::unpack_number(h) + 1);
+    });
+    std::vector<uint64_t> depths(rank_count, 0);
+    graph.for_each_handle(
+        [&](const handle_t& h) {
+            auto& d = depths[number_bool_packing::unpack_number(h)];
+            if (subset_paths) {
+                graph.for_each_step_on_handle(
+                    h,
+                    [&](const step_handle_t &s) {
+                        if (paths_to_consider[as_integer(graph.get_path_handle_of_step(s))]) {
+                            ++d;
+                        }
+                    });
+            } else {
+                d = graph.get_step_count(h);
+            }
+        }, true);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        const path_handle_t& path = paths[i];
+        // the run we are extending, which is only reported once a different depth comes along
+        bool in_run = false;
+        uint64_t run_start = 0;
+        uint64_t run_end = 0;
+        double run_depth = 0;
+        auto add_run = [&](const uint64_t& start, const uint64_t& end, const double& depth) {
+            if (in_run && depth == run_depth) {
+                run_end = end;
+            } else {
+                if (in_run) {
+                    func(path, run_start, run_end, run_depth);
+                }
+                in_run = true;
+                run_start = start;
+                run_end = end;
+                run_depth = depth;
+            }
+        };
+        uint64_t pos = 0;
+        // the start of the current window, and the sum of the depths of its bases
+        uint64_t window_start = 0;
+        uint64_t window_sum = 0;
+        graph.for_each_step_in_path(
+            path,
+            [&](const step_handle_t& step) {
+                const handle_t h = graph.get_handle_of_step(step);
+                const uint64_t d = depths[number_bool_packing::unpack_number(h)];
+                const uint64_t node_end = pos + graph.get_length(h);
+                if (window_size == 0) {
+                    add_run(pos, node_end, (double)d);
+                    pos = node_end;
+                    return;
+                }
+                while (pos < node_end) {
+                    const uint64_t end = std::min(node_end, window_start + window_size);
+                    window_sum += d * (end - pos);
+                    pos = end;
+                    if (pos == window_start + window_size) {
+                        add_run(window_start, pos, (double)window_sum / (double)window_size);
+                        window_start = pos;
+                        window_sum = 0;
+                    }
+                }
+            });
+        if (window_size && pos > window_start) {
+            add_run(window_start, pos, (double)window_sum / (double)(pos - window_start));
+        }
+        if (in_run) {
+            func(path, run_start, run_end, run_depth);
+        }
+        if (path_done) {
+            path_done(path);
+        }
+    }
+}
+
 }
 }
@@ -17,6 +17,7 @@
 #include <handlegraph/mutable_path_mutable_handle_graph.hpp>
 #include <handlegraph/deletable_handle_graph.hpp>
 #include <handlegraph/mutable_path_deletable_handle_graph.hpp>
+#include "odgi.hpp"
 
 namespace odgi {
 
@@ -39,6 +40,19 @@ void for_each_path_range_depth(const PathHandleGraph& graph,
                                const std::vector<bool>& paths_to_consider,
                                const std::function<void(const path_range_t&, const double&)>& func);
 
+/// Stream the depth along each of the given paths in one pass, in parallel over the paths, calling func from the thread
+/// of a path with each run of the same depth in order (0-based, half-open). With a window_size, the depths are the mean
+/// depths of the windows of window_size bp along the path, the last one maybe shorter, and equal windows are merged.
+/// Only the steps of paths_to_consider count towards the depth of a node, if it isn't empty. If given, path_done is
+/// called from the thread of a path after its last run.
+void for_each_path_depth_run(const graph_t& graph,
+                             const std::vector<path_handle_t>& paths,
+                             const std::vector<bool>& paths_to_consider,
+                             const uint64_t& window_size,
+                             const uint64_t& nthreads,
+                             const std::function<void(const path_handle_t&, const uint64_t&, const uint64_t&, const double&)>& func,
+                             const std::function<void(const path_handle_t&)>& path_done = nullptr);
+
 /// Destroy handles with more or less than the given path depth limits
 //void bound_depth(MutablePathDeletableHandleGraph& graph, uint64_t min_depth, uint64_t max_depth);
 
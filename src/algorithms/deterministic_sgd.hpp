@@ -0,0 +1,178 @@
+#pragma once
+
+/**
+ * \file deterministic_sgd.hpp
+ *
+ * Reproducible multi-threaded SGD: the terms of an iteration are drawn from random streams keyed by
+ * the iteration and the chunk of terms, and applied in blocks of nodes that no two threads hold at
+ * the same time, in an order that doesn't depend on the number of threads
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include "XoshiroCpp.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+/// Splits the node ranks into ranges and orders all pairs of ranges into rounds in which
+/// every range occurs at most once, so that the terms of one round can be applied in parallel
+/// without two threads touching the same node
+class sgd_block_schedule_t {
+public:
+    /// most ranges we split the nodes into
+    const static uint64_t MAX_BLOCKS = 1024;
+    /// fewest nodes in a range, below which the rounds would hold too few terms to be worth the split
+    const static uint64_t MIN_BLOCK_NODES = 64;
+
+    sgd_block_schedule_t(const uint64_t& num_nodes) : num_nodes(std::max(num_nodes, (uint64_t)1)) {
+        // a power of two, and so even, which lets the circle method pair up all ranges in each round after the first
+        n_blocks = 2;
+        while (n_blocks < MAX_BLOCKS && n_blocks * 2 * MIN_BLOCK_NODES <= num_nodes) {
+            n_blocks *= 2;
+        }
+    }
+
+    inline uint64_t blocks(void) const { return n_blocks; }
+    /// the first round holds the terms within one range, the others the terms between two
+    inline uint64_t rounds(void) const { return n_blocks; }
+    inline uint64_t units(void) const { return n_blocks * n_blocks; }
+
+    inline uint64_t block(const uint64_t& node) const {
+        return node * n_blocks / num_nodes;
+    }
+
+    /// The unit of a term between two nodes, as round * blocks() + the lower of their ranges.
+    /// The units of one round share no range.
+    inline uint64_t unit(const uint64_t& node_i, const uint64_t& node_j) const {
+        uint64_t a = block(node_i);
+        uint64_t b = block(node_j);
+        if (a > b) {
+            std::swap(a, b);
+        }
+        uint64_t round;
+        if (a == b) {
+            round = 0;
+        } else if (b == n_blocks - 1) {
+            // the fixed point of the circle method meets range k in round k
+            round = 1 + a;
+        } else {
+            // otherwise ranges k + i and k - i (mod blocks - 1) meet in round k, and blocks / 2 is the inverse of 2
+            round = 1 + (a + b) * (n_blocks / 2) % (n_blocks - 1);
+        }
+        return round * n_blocks + a;
+    }
+
+private:
+    uint64_t num_nodes;
+    uint64_t n_blocks;
+};
+
+/// A 64-bit seed from a seeding string, the same on every platform
+inline uint64_t sgd_seed(const std::string& seeding_string) {
+    std::seed_seq seq(seeding_string.begin(), seeding_string.end());
+    uint32_t words[2];
+    seq.generate(words, words + 2);
+    return (uint64_t)words[0] << 32 | words[1];
+}
+
+/// The seed of the random stream for one chunk of the terms of an iteration
+inline uint64_t sgd_stream_seed(const uint64_t& seed, const uint64_t& iteration, const uint64_t& chunk) {
+    uint64_t h = seed ^ (iteration * 0x9e3779b97f4a7c15ULL) ^ (chunk * 0xc2b2ae3d27d4eb4fULL);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/// Draw n_terms terms for the given iteration and apply them, returning the largest value returned by apply.
+/// sample(gen, term) draws a term of type term_t, which must hold the node ranks i and j it updates,
+/// and returns false if the draw should be repeated. apply(term) updates the positions of the term's nodes.
+/// The result depends only on the seed, the iteration and the samples, not on the number of threads.
+template<typename term_t, typename Sample, typename Apply>
+double deterministic_sgd_iteration(const sgd_block_schedule_t& schedule,
+                                   const uint64_t& seed,
+                                   const uint64_t& iteration,
+                                   const uint64_t& n_terms,
+                                   const uint64_t& nthreads,
+                                   const Sample& sample,
+                                   const Apply& apply) {
+    // terms drawn from one random stream
+    const uint64_t chunk_size = 1 << 14;
+    // terms held in memory at once, a multiple of the chunk size
+    const uint64_t batch_size = 1 << 21;
+    const uint64_t n_blocks = schedule.blocks();
+    const uint64_t n_rounds = schedule.rounds();
+    const uint64_t n_units = schedule.units();
+    // the rounds are applied in a random order of their own, as every node would otherwise meet
+    // the other ranges in the same sequence in each iteration, which ruins the layout
+    std::vector<uint64_t> round_rank(n_rounds);
+    for (uint64_t r = 0; r < n_rounds; ++r) {
+        round_rank[r] = r;
+    }
+    XoshiroCpp::Xoshiro256Plus round_gen(sgd_stream_seed(seed, iteration, ~(uint64_t)0));
+    for (uint64_t r = n_rounds - 1; r > 0; --r) {
+        // nb: not std::shuffle, whose result differs between standard libraries
+        std::swap(round_rank[r], round_rank[round_gen() % (r + 1)]);
+    }
+    std::vector<term_t> terms;
+    // the position of each term's unit in the order of application
+    std::vector<uint64_t> term_unit;
+    // the terms bucketed by unit, each bucket in the order the terms were drawn
+    std::vector<term_t> order;
+    std::vector<uint64_t> unit_begin(n_units + 1);
+    std::vector<uint64_t> unit_end(n_units);
+    double Delta_max = 0;
+    for (uint64_t batch_begin = 0; batch_begin < n_terms; batch_begin += batch_size) {
+        const uint64_t count = std::min(batch_size, n_terms - batch_begin);
+        const uint64_t n_chunks = (count + chunk_size - 1) / chunk_size;
+        terms.resize(count);
+        term_unit.resize(count);
+        order.resize(count);
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+        for (uint64_t c = 0; c < n_chunks; ++c) {
+            XoshiroCpp::Xoshiro256Plus gen(sgd_stream_seed(seed, iteration, batch_begin / chunk_size + c));
+            const uint64_t end = std::min(count, (c + 1) * chunk_size);
+            for (uint64_t t = c * chunk_size; t < end; ++t) {
+                while (!sample(gen, terms[t])) { }
+                const uint64_t unit = schedule.unit(terms[t].i, terms[t].j);
+                term_unit[t] = round_rank[unit / n_blocks] * n_blocks + unit % n_blocks;
+            }
+        }
+        // a counting sort by unit, which keeps the terms of a unit in the order they were drawn
+        std::fill(unit_begin.begin(), unit_begin.end(), 0);
+        for (uint64_t t = 0; t < count; ++t) {
+            ++unit_begin[term_unit[t] + 1];
+        }
+        for (uint64_t u = 0; u < n_units; ++u) {
+            unit_begin[u + 1] += unit_begin[u];
+        }
+        std::copy(unit_begin.begin(), unit_begin.end() - 1, unit_end.begin());
+        for (uint64_t t = 0; t < count; ++t) {
+            order[unit_end[term_unit[t]]++] = terms[t];
+        }
+        for (uint64_t r = 0; r < n_rounds; ++r) {
+            const uint64_t round_begin = r * n_blocks;
+            if (unit_begin[round_begin] == unit_begin[round_begin + n_blocks]) {
+                continue;
+            }
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads) reduction(max:Delta_max)
+            for (uint64_t b = 0; b < n_blocks; ++b) {
+                const uint64_t u = round_begin + b;
+                for (uint64_t l = unit_begin[u]; l < unit_begin[u + 1]; ++l) {
+                    Delta_max = std::max(Delta_max, apply(order[l]));
+                }
+            }
+        }
+    }
+    return Delta_max;
+}
+}
+}
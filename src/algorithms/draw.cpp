@@ -1,4 +1,9 @@
 #include "draw.hpp"
+#include "progress.hpp"
+#include <deps/ips4o/ips4o.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 
 namespace odgi {
 
@@ -155,6 +160,53 @@ void draw_svg(std::ostream &out,
     out << "</svg>" << std::endl;
 }
 
+/// the color of each path, by path rank
+static std::vector<color_t> get_path_colors(const PathHandleGraph &graph) {
+    std::vector<color_t> all_path_colors;
+    graph.for_each_path_handle(
+        [&](const path_handle_t& p) {
+            all_path_colors.push_back(
+                hash_color(graph.get_path_name(p)));
+            //std::cerr << graph.get_path_name(p) << " color " << all_path_colors.back() << std::endl;
+        });
+    return all_path_colors;
+}
+
+/// draw a node from xy0 to xy1 in the image, as one line per path step on it or as a line in the node's color
+static void draw_node(const handle_t& handle,
+                      const xy_d_t& xy0,
+                      const xy_d_t& xy1,
+                      atomic_image_buf_t& image,
+                      const PathHandleGraph &graph,
+                      const double& line_width,
+                      const double& path_line_spacing,
+                      bool color_paths,
+                      const std::vector<color_t>& all_path_colors,
+                      const std::vector<algorithms::color_t>& node_id_to_color) {
+    if (color_paths) {
+        std::vector<color_t> path_colors;
+        graph.for_each_step_on_handle(
+            handle,
+            [&](const step_handle_t& s) {
+                path_colors.push_back(
+                    all_path_colors[as_integer(graph.get_path_handle_of_step(s))-1]);
+            });
+        // for step on handle
+        // get the path color
+        wu_calc_rainbow(xy0, xy1, image, path_colors, path_line_spacing, line_width);
+    } else {
+        /*
+        aaline(xy0, xy1,
+               COLOR_BLACK,
+               image,
+               line_width);
+        */
+        const algorithms::color_t node_color = !node_id_to_color.empty() ? node_id_to_color[graph.get_id(handle)] : COLOR_BLACK;
+
+        wu_calc_wide_line(xy0, xy1, node_color, image, line_width);
+    }
+}
+
 std::vector<uint8_t> rasterize(const std::vector<double> &X,
                                const std::vector<double> &Y,
                                const PathHandleGraph &graph,
@@ -179,12 +231,7 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
 
     std::vector<color_t> all_path_colors;
     if (color_paths) {
-        graph.for_each_path_handle(
-            [&](const path_handle_t& p) {
-                all_path_colors.push_back(
-                    hash_color(graph.get_path_name(p)));
-                //std::cerr << graph.get_path_name(p) << " color " << all_path_colors.back() << std::endl;
-            });
+        all_path_colors = get_path_colors(graph);
     }
 
     // determine height and width based on the width, if width = 0
@@ -225,28 +272,8 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
                      source_width, source_height,
                      2, 2,
                      width-4, height-4);
-            if (color_paths) {
-                std::vector<color_t> path_colors;
-                graph.for_each_step_on_handle(
-                    handle,
-                    [&](const step_handle_t& s) {
-                        path_colors.push_back(
-                            all_path_colors[as_integer(graph.get_path_handle_of_step(s))-1]);
-                    });
-                // for step on handle
-                // get the path color
-                wu_calc_rainbow(xy0, xy1, image, path_colors, path_line_spacing, line_width);
-            } else {
-                /*
-                aaline(xy0, xy1,
-                       COLOR_BLACK,
-                       image,
-                       line_width);
-                */
-                const algorithms::color_t node_color = !node_id_to_color.empty() ? node_id_to_color[graph.get_id(handle)] : COLOR_BLACK;
-
-                wu_calc_wide_line(xy0, xy1, node_color, image, line_width);
-            }
+            draw_node(handle, xy0, xy1, image, graph, line_width, path_line_spacing,
+                      color_paths, all_path_colors, node_id_to_color);
         }
     }
 
@@ -280,5 +307,224 @@ void draw_png(const std::string& filename,
     png::encodeOneStep(filename.c_str(), bytes, width, height);
 }
 
+/// cut the line from xy0 to xy1 down to the part in the given box, returning false if it misses the box
+static bool clip_line(xy_d_t& xy0,
+                      xy_d_t& xy1,
+                      const double& min_x,
+                      const double& min_y,
+                      const double& max_x,
+                      const double& max_y) {
+    // Liang-Barsky: walk the line from xy0 (t = 0) to xy1 (t = 1), narrowing [t0, t1] to the part inside each edge
+    const xy_d_t d = { xy1.x - xy0.x, xy1.y - xy0.y };
+    const double p[4] = { -d.x, d.x, -d.y, d.y };
+    const double q[4] = { xy0.x - min_x, max_x - xy0.x, xy0.y - min_y, max_y - xy0.y };
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (uint8_t i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) {
+                return false; // parallel to this edge, and outside of it
+            }
+        } else {
+            const double t = q[i] / p[i];
+            if (p[i] < 0.0) {
+                t0 = std::max(t0, t);
+            } else {
+                t1 = std::min(t1, t);
+            }
+        }
+    }
+    if (t0 > t1) {
+        return false;
+    }
+    xy1 = { xy0.x + t1 * d.x, xy0.y + t1 * d.y };
+    xy0 = { xy0.x + t0 * d.x, xy0.y + t0 * d.y };
+    return true;
+}
+
+void draw_png_tiles(const std::string& dir,
+                    const std::vector<double> &X,
+                    const std::vector<double> &Y,
+                    const PathHandleGraph &graph,
+                    const double& scale,
+                    const double& border,
+                    const uint64_t& tile_size,
+                    const uint64_t& max_zoom,
+                    const double& line_width,
+                    const double& path_line_spacing,
+                    bool color_paths,
+                    std::vector<algorithms::color_t>& node_id_to_color,
+                    const uint64_t& nthreads,
+                    const bool& progress) {
+
+    std::vector<std::vector<handle_t>> weak_components;
+    coord_range_2d_t rendered_range;
+    std::vector<coord_range_2d_t> component_ranges;
+    get_layout(X, Y, graph, scale, border, weak_components, rendered_range, component_ranges);
+
+    const double source_min_x = rendered_range.min_x;
+    const double source_min_y = rendered_range.min_y;
+    const double source_width = rendered_range.width();
+    const double source_height = rendered_range.height();
+    const double source_size = std::max(source_width, source_height);
+    std::filesystem::create_directories(dir);
+
+    std::vector<color_t> all_path_colors;
+    if (color_paths) {
+        all_path_colors = get_path_colors(graph);
+    }
+
+    // each node as a line in the layout, its component moved into place as in rasterize, with how far its drawing
+    // can reach beyond the line itself in layout units, the rainbow of its paths or the half width of its line
+    struct node_line_t {
+        handle_t handle;
+        xy_d_t xy0;
+        xy_d_t xy1;
+        double reach;
+    };
+    std::vector<node_line_t> node_lines;
+    node_lines.reserve(graph.get_node_count());
+    auto range_itr = component_ranges.begin();
+    for (auto& component : weak_components) {
+        auto& range = *range_itr++;
+        for (auto& handle : component) {
+            uint64_t a = 2 * number_bool_packing::unpack_number(handle);
+            node_lines.push_back({handle,
+                                  {(X[a] * scale) - range.x_offset, (Y[a] * scale) + range.y_offset},
+                                  {(X[a + 1] * scale) - range.x_offset, (Y[a + 1] * scale) + range.y_offset},
+                                  color_paths
+                                  ? graph.get_step_count(handle) * (line_width + path_line_spacing)
+                                  : line_width / 2});
+        }
+    }
+
+    // at the deepest level that makes sense, a pixel covers one layout unit
+    uint64_t zoom_levels = 1;
+    while (zoom_levels <= max_zoom && tile_size * std::pow(2.0, zoom_levels - 1) < source_size) {
+        ++zoom_levels;
+    }
+
+    for (uint64_t zoom = 0; zoom < zoom_levels; ++zoom) {
+        // the level is the picture rasterize draws at this size, which the tiles cut into pieces, with the longer
+        // side of the layout and rasterize's border of 2 pixels on each side filling 2^zoom tiles
+        const double px_per_unit = (tile_size * std::pow(2.0, zoom) - 4) / source_size;
+        const uint64_t width = (uint64_t)std::ceil(source_width * px_per_unit) + 4;
+        const uint64_t height = (uint64_t)std::ceil(source_height * px_per_unit) + 4;
+        const uint64_t tiles_x = (width + tile_size - 1) / tile_size;
+        const uint64_t tiles_y = (height + tile_size - 1) / tile_size;
+        // line widths are scaled by the height of the picture, as in atomic_image_buf_t
+        const double px_per_width = height / source_height;
+
+        // the node lines in pixels of this level, mapped as in rasterize
+        auto to_px = [&](xy_d_t xy) {
+            xy.into(source_min_x, source_min_y,
+                    source_width, source_height,
+                    2, 2,
+                    width-4, height-4);
+            return xy;
+        };
+
+        // bin the nodes into the tiles they can reach, as (tile, node line) pairs grouped by tile
+        std::vector<std::pair<uint64_t, uint64_t>> tile_lines;
+#pragma omp parallel num_threads(nthreads)
+        {
+            std::vector<std::pair<uint64_t, uint64_t>> thread_tile_lines;
+#pragma omp for
+            for (uint64_t i = 0; i < node_lines.size(); ++i) {
+                const xy_d_t xy0 = to_px(node_lines[i].xy0);
+                const xy_d_t xy1 = to_px(node_lines[i].xy1);
+                // and the end points and the antialiasing around the line
+                const double reach_in_px = node_lines[i].reach * px_per_width + 3;
+                const int64_t first_x = std::floor((std::min(xy0.x, xy1.x) - reach_in_px) / tile_size);
+                const int64_t last_x = std::floor((std::max(xy0.x, xy1.x) + reach_in_px) / tile_size);
+                const int64_t first_y = std::floor((std::min(xy0.y, xy1.y) - reach_in_px) / tile_size);
+                const int64_t last_y = std::floor((std::max(xy0.y, xy1.y) + reach_in_px) / tile_size);
+                for (int64_t y = std::max(first_y, (int64_t)0); y <= std::min(last_y, (int64_t)tiles_y - 1); ++y) {
+                    for (int64_t x = std::max(first_x, (int64_t)0); x <= std::min(last_x, (int64_t)tiles_x - 1); ++x) {
+                        // a long diagonal line passes by most of the tiles of its bounding box
+                        xy_d_t a = xy0;
+                        xy_d_t b = xy1;
+                        if (clip_line(a, b,
+                                      x * tile_size - reach_in_px, y * tile_size - reach_in_px,
+                                      (x + 1) * tile_size + reach_in_px, (y + 1) * tile_size + reach_in_px)) {
+                            thread_tile_lines.push_back({y * tiles_x + x, i});
+                        }
+                    }
+                }
+            }
+#pragma omp critical (tile_lines)
+            tile_lines.insert(tile_lines.end(), thread_tile_lines.begin(), thread_tile_lines.end());
+        }
+        // sorting by node line too draws the nodes of each tile in the order rasterize draws them
+        ips4o::parallel::sort(tile_lines.begin(), tile_lines.end(), std::less<>(), nthreads);
+
+        // where the lines of each non-empty tile begin in tile_lines
+        std::vector<uint64_t> tile_begin;
+        for (uint64_t i = 0; i < tile_lines.size(); ++i) {
+            if (i == 0 || tile_lines[i].first != tile_lines[i - 1].first) {
+                tile_begin.push_back(i);
+                const uint64_t x = tile_lines[i].first % tiles_x;
+                std::filesystem::create_directories(
+                        std::filesystem::path(dir) / std::to_string(zoom) / std::to_string(x));
+            }
+        }
+        tile_begin.push_back(tile_lines.size());
+
+        std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                    tile_begin.size() - 1, "[odgi::draw] rendering tiles of zoom level " + std::to_string(zoom) + ":");
+        }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t t = 0; t < tile_begin.size() - 1; ++t) {
+            const uint64_t tile = tile_lines[tile_begin[t]].first;
+            const uint64_t x = tile % tiles_x;
+            const uint64_t y = tile / tiles_x;
+            // a buffer of just the tile, which drops whatever the lines draw outside of it
+            atomic_image_buf_t image(width, height,
+                                     source_width, source_height,
+                                     source_min_x, source_min_y,
+                                     x * tile_size, y * tile_size,
+                                     tile_size, tile_size);
+            for (uint64_t i = tile_begin[t]; i < tile_begin[t + 1]; ++i) {
+                const node_line_t& node_line = node_lines[tile_lines[i].second];
+                draw_node(node_line.handle, to_px(node_line.xy0), to_px(node_line.xy1), image, graph,
+                          line_width, path_line_spacing, color_paths, all_path_colors, node_id_to_color);
+            }
+            std::vector<uint8_t> tile_bytes = image.to_bytes();
+            const std::string filename = (std::filesystem::path(dir) / std::to_string(zoom)
+                                          / std::to_string(x) / (std::to_string(y) + ".png")).string();
+            png::encodeOneStep(filename.c_str(), tile_bytes, tile_size, tile_size);
+            if (progress) {
+                progress_meter->increment(1);
+            }
+        }
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
+
+    // what a viewer needs to know to put the tiles in place, and to map them back onto the layout
+    const double max_px_per_unit = (tile_size * std::pow(2.0, zoom_levels - 1) - 4) / source_size;
+    const uint64_t max_width = (uint64_t)std::ceil(source_width * max_px_per_unit) + 4;
+    const uint64_t max_height = (uint64_t)std::ceil(source_height * max_px_per_unit) + 4;
+    std::ofstream meta((std::filesystem::path(dir) / "tiles.json").string());
+    meta << std::setprecision(std::numeric_limits<double>::digits10 + 1);
+    meta << "{" << std::endl
+         << "  \"tiles\": \"{z}/{x}/{y}.png\"," << std::endl
+         << "  \"tile_size\": " << tile_size << "," << std::endl
+         << "  \"min_zoom\": 0," << std::endl
+         << "  \"max_zoom\": " << zoom_levels - 1 << "," << std::endl
+         << "  \"width\": " << max_width << "," << std::endl
+         << "  \"height\": " << max_height << "," << std::endl
+         << "  \"border_px\": 2," << std::endl
+         << "  \"layout_min_x\": " << source_min_x << "," << std::endl
+         << "  \"layout_min_y\": " << source_min_y << "," << std::endl
+         << "  \"layout_width\": " << source_width << "," << std::endl
+         << "  \"layout_height\": " << source_height << std::endl
+         << "}" << std::endl;
+}
+
 }
 }
@@ -96,7 +96,26 @@ void draw_png(const std::string& filename,
               bool color_paths,
               std::vector<algorithms::color_t>& node_id_to_color);
 
-
+/// Render the layout as a pyramid of tile_size×tile_size PNG tiles written to dir/z/x/y.png, for the XYZ tile scheme
+/// of map viewers. Zoom level 0 fits the whole layout into a single tile and each level doubles the resolution of the
+/// one above it, down to max_zoom or to the level at which a pixel covers one layout unit, whichever comes first.
+/// Each level is the picture rasterize draws at that size, so the tiles of a level stitch into it. The node segments
+/// are binned into the tiles their drawing reaches, so that each tile is rasterized on its own into a buffer of just
+/// the tile from only those nodes, and tiles without any node aren't written. A tiles.json in dir describes the pyramid.
+void draw_png_tiles(const std::string& dir,
+                    const std::vector<double> &X,
+                    const std::vector<double> &Y,
+                    const PathHandleGraph &graph,
+                    const double& scale,
+                    const double& border,
+                    const uint64_t& tile_size,
+                    const uint64_t& max_zoom,
+                    const double& line_width,
+                    const double& path_line_spacing,
+                    bool color_paths,
+                    std::vector<algorithms::color_t>& node_id_to_color,
+                    const uint64_t& nthreads,
+                    const bool& progress);
 
 }
 
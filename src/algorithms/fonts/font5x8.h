@@ -3,6 +3,8 @@
 //
 
 #include <cstdint>
+#include <limits>
+#include <vector>
 #include "field8.h"
 
 #define INCLUDE_UNPRINTABLES true
@@ -13,11 +15,13 @@
 #define CHECK_BIT(var,pos) (((var)>>(pos)) & 1)
 
 
+// the matrix holds the rows [first_y, end_y) of the image, and the rest of the character is left out
 void write_character_in_matrix(
         std::vector<uint8_t> &matrix, uint64_t const width_matrix, const uint8_t character[8],
         const uint8_t char_size,
         const uint64_t &base_x, const uint64_t &base_y,
-        const uint8_t &_r, const uint8_t &_g, const uint8_t &_b
+        const uint8_t &_r, const uint8_t &_g, const uint8_t &_b,
+        const uint64_t &first_y = 0, const uint64_t &end_y = std::numeric_limits<uint64_t>::max()
         ){
     uint8_t ratio = char_size / 8;
 
@@ -32,10 +36,14 @@ void write_character_in_matrix(
 
                 for (uint8_t rx = 0; rx < ratio; rx++){
                     for (uint8_t ry = 0; ry < ratio; ry++){
-                        matrix[4 * width_matrix * (y + ry) + 4 * (x + rx) + 0] = _r;
-                        matrix[4 * width_matrix * (y + ry) + 4 * (x + rx) + 1] = _g;
-                        matrix[4 * width_matrix * (y + ry) + 4 * (x + rx) + 2] = _b;
-                        matrix[4 * width_matrix * (y + ry) + 4 * (x + rx) + 3] = 255;
+                        if (y + ry < first_y || y + ry >= end_y) {
+                            continue;
+                        }
+                        const uint64_t my = y + ry - first_y;
+                        matrix[4 * width_matrix * my + 4 * (x + rx) + 0] = _r;
+                        matrix[4 * width_matrix * my + 4 * (x + rx) + 1] = _g;
+                        matrix[4 * width_matrix * my + 4 * (x + rx) + 2] = _b;
+                        matrix[4 * width_matrix * my + 4 * (x + rx) + 3] = 255;
                     }
                 }
             }
@@ -4,17 +4,21 @@ namespace odgi {
 
 namespace algorithms {
 
-void for_each_heap_permutation(const PathHandleGraph& graph,
+void for_each_heap_permutation(const graph_t& graph,
                                const std::vector<std::vector<path_handle_t>>& path_groups,
                                const ska::flat_hash_map<path_handle_t, std::vector<interval_t>>& path_intervals,
                                uint64_t n_permutations,
                                uint64_t min_node_depth,
-                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func) {
+                               uint64_t nthreads,
+                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func,
+                               uint64_t seed,
+                               uint64_t max_group_bitset_bytes) {
     //const std::function<bool(const path_handle_t&, _t)>& in_range) {
     //std::vector<std::vector<path_handle_t>>
-    auto get_permutation = [&](void) {
+    auto get_permutation = [&](const uint64_t& n) {
         std::random_device rd;
-        std::default_random_engine rng(rd());
+        // seeded per permutation, so that it doesn't depend on the thread that draws it
+        std::default_random_engine rng(seed ? seed + n : rd());
         std::vector<uint64_t> order; order.reserve(path_groups.size());
         for (uint64_t i = 0; i < path_groups.size(); ++i) {
             order.push_back(i);
@@ -23,34 +27,52 @@ void for_each_heap_permutation(const PathHandleGraph& graph,
         return order;
     };
 
-    uint64_t graph_total_bp = 0;
-    uint64_t idx = 0;
-    graph.for_each_handle([&](const handle_t& h) {
-        graph_total_bp += graph.get_length(h);
-        if (graph.get_id(h) != ++idx) {
-            std::cerr << "[odgi::algorithms::heaps] error: the node IDs are not compacted. Please run 'odgi sort' using -O, --optimize to optimize the graph." << std::endl;
-            std::abort();
+    // The groups as a node x class matrix, so that no permutation has to walk the paths again. A class holds the
+    // paths that are in the same set of groups, so that a path listed in several groups counts in each of them.
+    // Unless there are such paths, there is one class per group.
+    std::vector<std::vector<uint64_t>> groups_of_path;
+    for (uint64_t i = 0; i < path_groups.size(); ++i) {
+        for (auto& path : path_groups[i]) {
+            const uint64_t p = as_integer(path);
+            if (p >= groups_of_path.size()) {
+                groups_of_path.resize(p + 1);
+            }
+            auto& groups = groups_of_path[p];
+            if (groups.empty() || groups.back() != i) {
+                groups.push_back(i);
+            }
+        }
+    }
+    std::map<std::vector<uint64_t>, uint64_t> class_of_groups;
+    std::vector<std::vector<uint64_t>> class_groups;
+    std::vector<uint64_t> path_class(groups_of_path.size(), path_membership_t::no_group);
+    for (uint64_t p = 0; p < groups_of_path.size(); ++p) {
+        if (groups_of_path[p].empty()) continue;
+        auto f = class_of_groups.insert(std::make_pair(groups_of_path[p], class_groups.size()));
+        if (f.second) {
+            class_groups.push_back(groups_of_path[p]);
         }
-    });
+        path_class[p] = f.first->second;
+    }
+    const path_membership_t membership(graph, path_class, class_groups.size(), nthreads);
 
     // which nodes are traversed by our target paths?
-    atomicbitvector::atomic_bv_t target_nodes(graph.get_node_count() + 1);
+    atomicbitvector::atomic_bv_t target_nodes(membership.row_count());
 
     if (path_intervals.size() == 0) {
         // keep everything if we aren't given intervals to guide subset
-        for (uint64_t i = 0; i < graph.get_node_count(); ++i) {
+        graph.for_each_handle([&](const handle_t& h) {
             if (min_node_depth == 0
-                || (graph.get_step_count(graph.get_handle(i+1))
-                    >= min_node_depth)) {
-                target_nodes.set(i, true);
+                || graph.get_step_count(h) >= min_node_depth) {
+                target_nodes.set(path_membership_t::rank_of(h), true);
             }
-        }
+        });
     } else {
         std::vector<path_handle_t> paths;
         graph.for_each_path_handle([&](const path_handle_t& path) {
             paths.push_back(path);
         });
-#pragma omp parallel for
+#pragma omp parallel for num_threads(nthreads)
         for (auto& path : paths) {
             if (path_intervals.find(path) != path_intervals.end()) {
                 auto& intervals = path_intervals.find(path)->second;
@@ -74,40 +96,114 @@ void for_each_heap_permutation(const PathHandleGraph& graph,
                             interval_ends.insert(ival->second);
                             ++ival;
                         }
-                        uint64_t rank = graph.get_id(h)-1; // assumes compaction!
                         if (interval_ends.size()
                             && (min_node_depth == 0
                                 || graph.get_step_count(h) >= min_node_depth)) {
-                            target_nodes.set(rank, true);
+                            target_nodes.set(path_membership_t::rank_of(h), true);
                         }
                         pos += len;
                     });
             }
         }
     }
+    // the target nodes that any group steps on, as they are the only ones that can be seen
+    std::vector<uint64_t> target_rows;
+    for (uint64_t row = 0; row < membership.row_count(); ++row) {
+        if (target_nodes[row] && membership.word_count(row)) {
+            target_rows.push_back(row);
+        }
+    }
+
+    const uint64_t group_count = path_groups.size();
+    const uint64_t word_count = (target_rows.size() + 63) / 64;
+    if (group_count * word_count * sizeof(uint64_t) > max_group_bitset_bytes) {
+        // too many groups and nodes for a bitset per group:
+        // a node is first seen with the earliest group of the permutation on it
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t i = 0; i < n_permutations; ++i) {
+            auto permutation = get_permutation(i);
+            std::vector<uint64_t> rank_of_group(group_count);
+            for (uint64_t j = 0; j < permutation.size(); ++j) {
+                rank_of_group[permutation[j]] = j;
+            }
+            // a class is first seen with the earliest of its groups
+            std::vector<uint64_t> rank_of_class(class_groups.size(), path_membership_t::no_group);
+            for (uint64_t c = 0; c < class_groups.size(); ++c) {
+                for (auto& g : class_groups[c]) {
+                    rank_of_class[c] = std::min(rank_of_class[c], rank_of_group[g]);
+                }
+            }
+            std::vector<uint64_t> vals(permutation.size(), 0);
+            for (auto& row : target_rows) {
+                const uint64_t first_rank = membership.min_group_rank(row, rank_of_class);
+                if (first_rank != path_membership_t::no_group) {
+                    vals[first_rank] += membership.length(row);
+                }
+            }
+            for (uint64_t j = 1; j < vals.size(); ++j) {
+                vals[j] += vals[j - 1];
+            }
+            func(vals, i);
+        }
+        return;
+    }
+
+    // The nodes of each group as a bitset over the target nodes, transposed from the matrix a word of target nodes at
+    // a time so that no two threads write the same word. Each permutation is then a running OR of the bitsets of its
+    // groups, where the newly set bits of each word add up the lengths of their nodes.
+    std::vector<uint64_t> group_bits(group_count * word_count, 0);
+    // bit b of the lengths of the target nodes, so that the length of the nodes of a word is a sum of popcounts
+    uint64_t max_length = 0;
+    for (auto& row : target_rows) {
+        max_length = std::max(max_length, membership.length(row));
+    }
+    const uint64_t plane_count = 64 - __builtin_clzll(max_length | 1);
+    std::vector<uint64_t> length_planes(plane_count * word_count, 0);
+    std::vector<uint64_t> lengths(target_rows.size());
+#pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+    for (uint64_t w = 0; w < word_count; ++w) {
+        const uint64_t end = std::min((w + 1) * 64, (uint64_t)target_rows.size());
+        for (uint64_t t = w * 64; t < end; ++t) {
+            const uint64_t bit = (uint64_t)1 << (t % 64);
+            const uint64_t length = membership.length(target_rows[t]);
+            lengths[t] = length;
+            membership.for_each_group(target_rows[t], [&](const uint64_t& c) {
+                for (auto& g : class_groups[c]) {
+                    group_bits[g * word_count + w] |= bit;
+                }
+            });
+            for (uint64_t b = 0; b < plane_count; ++b) {
+                if ((length >> b) & 1) {
+                    length_planes[b * word_count + w] |= bit;
+                }
+            }
+        }
+    }
 
-#pragma omp parallel for
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
     for (uint64_t i = 0; i < n_permutations; ++i) {
-        auto permutation = get_permutation();
-        // XXX the graph must be node-id compacted for this trick!
-        std::vector<bool> seen_nodes(graph.get_node_count(), 0);
+        auto permutation = get_permutation(i);
+        std::vector<uint64_t> seen(word_count, 0);
         uint64_t seen_bp = 0;
         std::vector<uint64_t> vals;
+        vals.reserve(permutation.size());
         for (auto& j : permutation) {
-            auto& paths = path_groups[j];
-            for (auto& path : paths) {
-                uint64_t pos = 0;
-                graph.for_each_step_in_path(
-                    path,
-                    [&](const step_handle_t& step) {
-                        auto h = graph.get_handle_of_step(step);
-                        uint64_t rank = graph.get_id(h)-1; // assumes compaction!
-                        if (target_nodes[rank] && !seen_nodes[rank]) {
-                            seen_nodes[rank] = 1;
-                            seen_bp += graph.get_length(h);
-                        }
-                        pos += graph.get_length(h);
-                    });
+            const uint64_t* bits = group_bits.data() + j * word_count;
+            for (uint64_t w = 0; w < word_count; ++w) {
+                uint64_t added = bits[w] & ~seen[w];
+                if (!added) continue;
+                seen[w] |= added;
+                if ((uint64_t)__builtin_popcountll(added) <= plane_count) {
+                    // few new nodes, add their lengths one by one
+                    do {
+                        seen_bp += lengths[w * 64 + __builtin_ctzll(added)];
+                        added &= added - 1;
+                    } while (added);
+                } else {
+                    for (uint64_t b = 0; b < plane_count; ++b) {
+                        seen_bp += (uint64_t)__builtin_popcountll(added & length_planes[b * word_count + w]) << b;
+                    }
+                }
             }
             vals.push_back(seen_bp);
         }
@@ -15,6 +15,8 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/path_handle_graph.hpp>
 #include <atomic_bitvector.hpp>
+#include "odgi.hpp"
+#include "path_membership.hpp"
 
 namespace odgi {
 
@@ -24,12 +26,21 @@ namespace algorithms {
 
 /// For each permutation of the path groups
 /// we call func with a vector that is the fraction of the pangenome covered when we've considered N groups in the permutation
-void for_each_heap_permutation(const PathHandleGraph& graph,
+/// A path listed in several groups counts in each of them.
+/// The nodes of each group are collected once, from a node x group matrix, into a bitset weighted by node length, and
+/// each permutation is a running OR of the bitsets of its groups; permutations are spread over nthreads threads.
+/// If the bitsets would take more than max_group_bitset_bytes, each node is instead counted for the earliest group of
+/// the permutation on it. Permutations are random, unless seed is given, in which case permutation i is the same in
+/// every run.
+void for_each_heap_permutation(const graph_t& graph,
                                const std::vector<std::vector<path_handle_t>>& path_groups,
                                const ska::flat_hash_map<path_handle_t, std::vector<interval_t>>& path_intervals,
                                uint64_t n_permutations,
                                uint64_t min_node_depth,
-                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func);
+                               uint64_t nthreads,
+                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func,
+                               uint64_t seed = 0,
+                               uint64_t max_group_bitset_bytes = (uint64_t)1 << 32);
 
 }
 
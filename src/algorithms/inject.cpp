@@ -6,7 +6,7 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-void inject_ranges(MutablePathDeletableHandleGraph& graph,
+void inject_ranges(odgi::graph_t& graph,
                    const ska::flat_hash_map<path_handle_t, std::vector<std::pair<interval_t, std::string>>>& path_intervals,
                    const std::vector<std::string>& ordered_intervals, const bool show_progress) {
 
@@ -195,10 +195,12 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                         }
                         auto& c = open_intervals_by_end.begin()->second;
                         auto end = step;
+                        std::vector<handle_t> handles;
                         do {
-                            graph.append_step(p, graph.get_handle_of_step(c));
+                            handles.push_back(graph.get_handle_of_step(c));
                             c = graph.get_next_step(c);
                         } while (c != end);
+                        graph.append_steps(p, handles);
                         // clean up
                         open_intervals_by_end.erase(open_intervals_by_end.begin());
                     }
@@ -234,10 +236,12 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                 }
                 auto& c = open_intervals_by_end.begin()->second;
                 auto end = graph.path_end(path);
+                std::vector<handle_t> handles;
                 do {
-                    graph.append_step(p, graph.get_handle_of_step(c));
+                    handles.push_back(graph.get_handle_of_step(c));
                     c = graph.get_next_step(c);
                 } while (c != end);
+                graph.append_steps(p, handles);
                 // clean up
                 open_intervals_by_end.erase(open_intervals_by_end.begin());
             }
@@ -16,6 +16,7 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/mutable_path_deletable_handle_graph.hpp>
+#include "odgi.hpp"
 
 namespace odgi {
 
@@ -25,7 +26,7 @@ using namespace handlegraph;
 
 /// Modify the graph to include the named intervals as paths
 /// This will cut nodes at interval start/ends and then embed them in the graph
-void inject_ranges(MutablePathDeletableHandleGraph& graph,
+void inject_ranges(odgi::graph_t& graph,
                    const ska::flat_hash_map<path_handle_t, std::vector<std::pair<interval_t, std::string>>>& path_intervals,
                    const std::vector<std::string>& ordered_intervals, const bool show_progress);
 
@@ -1,4 +1,5 @@
 #include "kmer.hpp"
+#include "odgi.hpp"
 
 namespace odgi {
 
@@ -6,7 +7,17 @@ namespace algorithms {
 
 void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                    const std::function<void(const kmer_t&)>& lambda) {
+    // an odgi graph can decode node sequences straight into our buffers
+    const graph_t* odgi_graph = dynamic_cast<const graph_t*>(&graph);
+    auto append_bases = [&](const handle_t& handle, size_t index, size_t size, std::string& seq) {
+        if (odgi_graph) {
+            odgi_graph->append_subsequence(handle, index, size, seq);
+        } else {
+            seq.append(graph.get_subsequence(handle, index, size));
+        }
+    };
     graph.for_each_handle([&](const handle_t& h) {
+            std::string handle_seq;
             // for the forward and reverse of this handle
             // walk k bases from the end, so that any kmer starting on the node will be represented in the tree we build
             for (auto handle_is_rev : { false, true }) {
@@ -16,11 +27,15 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                 // determine next positions
                 nid_t handle_id = graph.get_id(handle);
                 size_t handle_length = graph.get_length(handle);
-                std::string handle_seq = graph.get_sequence(handle);
+                handle_seq.clear();
+                append_bases(handle, 0, handle_length, handle_seq);
                 for (size_t i = 0; i < handle_length;  ++i) {
                     pos_t begin = make_pos_t(handle_id, handle_is_rev, i);
                     pos_t end = make_pos_t(handle_id, handle_is_rev, std::min(handle_length, i+k));
-                    kmer_t kmer = kmer_t(handle_seq.substr(offset(begin), offset(end)-offset(begin)), begin, end, handle);
+                    kmer_t kmer = kmer_t(std::string(), begin, end, handle);
+                    // sized for the whole kmer so that extending it does not reallocate
+                    kmer.seq.reserve(k);
+                    kmer.seq.assign(handle_seq, offset(begin), offset(end)-offset(begin));
                     if (kmer.seq.size() < k) {
                         size_t next_count = 0;
                         if (edge_max) graph.follow_edges(kmer.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
@@ -51,9 +66,6 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                         // did we reach our target length?
                         if (kmer.seq.size() == k) {
                             // TODO here check if we are at the beginning of the reverse head or the beginning of the forward tail and would need special handling
-                            // establish the context
-                            handle_t end_handle = graph.get_handle(id(kmer.end), is_rev(kmer.end));
-                            size_t end_length = graph.get_length(end_handle);
                             // now pass the kmer to our callback
                             lambda(kmer);
                             q = kmers.erase(q);
@@ -62,10 +74,9 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                             nid_t curr_id = graph.get_id(kmer.curr);
                             size_t curr_length = graph.get_length(kmer.curr);
                             bool curr_is_rev = graph.get_is_reverse(kmer.curr);
-                            std::string curr_seq = graph.get_sequence(kmer.curr);
                             size_t take = std::min(curr_length, k-kmer.seq.size());
                             kmer.end = make_pos_t(curr_id, curr_is_rev, take);
-                            kmer.seq.append(curr_seq.substr(0,take));
+                            append_bases(kmer.curr, 0, take, kmer.seq);
                             if (kmer.seq.size() < k) {
                                 size_t next_count = 0;
                                 if (edge_max) graph.follow_edges(kmer.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
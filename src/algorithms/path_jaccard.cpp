@@ -1,10 +1,61 @@
 #include "path_jaccard.hpp"
+#include <cmath>
 
 namespace odgi {
 	namespace algorithms {
 
 		using namespace handlegraph;
 
+		/// sort the jaccard indices from best to worst, and move the step with the median rank among the best ones to the front
+		static void order_jaccard_indices(std::vector<step_jaccard_t>& target_jaccard_indices) {
+			if (target_jaccard_indices.empty()) {
+				return;
+			}
+			std::sort(target_jaccard_indices.begin(), target_jaccard_indices.end(),
+					  [&] (const step_jaccard_t & sjt_a,
+						   const step_jaccard_t & sjt_b) {
+						  return sjt_a.jaccard > sjt_b.jaccard;
+					  });
+
+			/// this ensures a deterministic selection of the best jaccard index and therefore step
+			// collect all the step_jaccard_t with the same jaccard
+			std::vector<step_jaccard_t> target_same_jaccard;
+			bool first_pos = false;
+			for (auto s_j_t : target_jaccard_indices) {
+				if (first_pos) {
+					if (s_j_t.jaccard == target_same_jaccard[target_same_jaccard.size() - 1].jaccard) {
+						target_same_jaccard.push_back(s_j_t);
+					} else {
+						break;
+					}
+				} else {
+					first_pos = true;
+					target_same_jaccard.push_back(s_j_t);
+				}
+			}
+			// sort by rank
+			std::sort(target_same_jaccard.begin(), target_same_jaccard.end(),
+					  [&] (const step_jaccard_t & sjt_a,
+						   const step_jaccard_t & sjt_b) {
+						  return as_integers(sjt_a.step)[1] < as_integers(sjt_b.step)[1];
+					  });
+			// take the one with array position arr_len/2; if arr_len%%2 !=0 then take the floor of the resulting value
+			uint64_t final_jaccard_position_in_same = target_same_jaccard.size() / 2;
+			step_jaccard_t final_jaccard = target_same_jaccard[final_jaccard_position_in_same];
+			uint64_t final_jaccard_position;
+			for (uint64_t i = 0; i < target_jaccard_indices.size(); i++) {
+				step_jaccard_t s_j_t = target_jaccard_indices[i];
+				if (s_j_t.jaccard == final_jaccard.jaccard
+					&& as_integers(s_j_t.step)[0] == as_integers(final_jaccard.step)[0]
+					&& as_integers(s_j_t.step)[1] == as_integers(final_jaccard.step)[1]) {
+					final_jaccard_position = i;
+					break;
+				}
+			}
+			// use std::swap to switch the found array position with the first position
+			std::swap(target_jaccard_indices[0], target_jaccard_indices[final_jaccard_position]);
+		}
+
 		/// calculate all jaccard indices from a given target_step_handles and a current query step
 		std::vector<step_jaccard_t> jaccard_indices_from_step_handles(const graph_t& graph,
 																	  const uint64_t& walking_dist,
@@ -118,49 +169,117 @@ namespace odgi {
 					target_jaccard_indices.push_back({target_step, *max_element(candidate_jaccards.begin(), candidate_jaccards.end())});
 				}
 			}
-			std::sort(target_jaccard_indices.begin(), target_jaccard_indices.end(),
-					  [&] (const step_jaccard_t & sjt_a,
-						   const step_jaccard_t & sjt_b) {
-						  return sjt_a.jaccard > sjt_b.jaccard;
-					  });
+			order_jaccard_indices(target_jaccard_indices);
+			return target_jaccard_indices;
+		}
 
-			/// this ensures a deterministic selection of the best jaccard index and therefore step
-			// collect all the step_jaccard_t with the same jaccard
-			std::vector<step_jaccard_t> target_same_jaccard;
-			bool first_pos = false;
-			for (auto s_j_t : target_jaccard_indices) {
-				if (first_pos) {
-					if (s_j_t.jaccard == target_same_jaccard[target_same_jaccard.size() - 1].jaccard) {
-						target_same_jaccard.push_back(s_j_t);
-					} else {
-						break;
-					}
+		/// mix the bits of a 64-bit integer (splitmix64)
+		static inline uint64_t mix_bits(uint64_t x) {
+			x += 0x9e3779b97f4a7c15ULL;
+			x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+			return x ^ (x >> 31);
+		}
+
+		walk_sketch_t sketch_walk_window(const graph_t& graph,
+										 const uint64_t& walking_dist,
+										 const step_handle_t& step,
+										 const uint64_t& sketch_size) {
+			walk_sketch_t sketch;
+			const ska::flat_hash_map<nid_t, uint64_t> node_count_set = collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, step);
+			if (node_count_set.empty()) {
+				return sketch;
+			}
+			sketch.full = true;
+			for (auto& node_count : node_count_set) {
+				const double length = (double) graph.get_length(graph.get_handle(node_count.first));
+				for (uint64_t i = 0; i < node_count.second; ++i) {
+					// a uniform value in (0, 1] for the i-th visit of the node
+					const double u = ((double) (mix_bits(mix_bits(node_count.first) + i) >> 11) + 1.0) / 9007199254740992.0;
+					sketch.ranks.push_back(-std::log(u) / length);
+				}
+			}
+			if (sketch.ranks.size() > sketch_size) {
+				std::nth_element(sketch.ranks.begin(), sketch.ranks.begin() + sketch_size, sketch.ranks.end());
+				sketch.ranks.resize(sketch_size);
+			}
+			std::sort(sketch.ranks.begin(), sketch.ranks.end());
+			return sketch;
+		}
+
+		double estimate_jaccard(const walk_sketch_t& a, const walk_sketch_t& b, const uint64_t& sketch_size) {
+			// the smallest ranks of the union, and how many of them are in both
+			uint64_t i = 0, j = 0, taken = 0, shared = 0;
+			while (taken < sketch_size && (i < a.ranks.size() || j < b.ranks.size())) {
+				if (j == b.ranks.size() || (i < a.ranks.size() && a.ranks[i] < b.ranks[j])) {
+					++i;
+				} else if (i == a.ranks.size() || b.ranks[j] < a.ranks[i]) {
+					++j;
 				} else {
-					first_pos = true;
-					target_same_jaccard.push_back(s_j_t);
+					++shared;
+					++i;
+					++j;
 				}
+				++taken;
 			}
-			// sort by rank
-			std::sort(target_same_jaccard.begin(), target_same_jaccard.end(),
+			return taken == 0 ? 0.0 : (double) shared / (double) taken;
+		}
+
+		std::vector<step_jaccard_t> jaccard_indices_from_sketches(const graph_t& graph,
+																  const uint64_t& walking_dist,
+																  const step_handle_t& cur_step,
+																  const walk_sketch_t& query_sketch,
+																  std::vector<step_handle_t>& target_step_handles,
+																  const std::vector<const walk_sketch_t*>& target_sketches,
+																  const uint64_t& sketch_size,
+																  const uint64_t& n_verify) {
+			bool all_full = query_sketch.full;
+			for (auto& target_sketch : target_sketches) {
+				all_full &= target_sketch->full;
+			}
+			if (!all_full) {
+				return jaccard_indices_from_step_handles(graph, walking_dist, cur_step, target_step_handles);
+			}
+			std::vector<step_jaccard_t> target_jaccard_indices;
+			target_jaccard_indices.reserve(target_step_handles.size());
+			for (uint64_t i = 0; i < target_step_handles.size(); ++i) {
+				target_jaccard_indices.push_back({target_step_handles[i], estimate_jaccard(query_sketch, *target_sketches[i], sketch_size)});
+			}
+			// the best estimates, the lower rank first among equal ones, are the ones we verify
+			std::sort(target_jaccard_indices.begin(), target_jaccard_indices.end(),
 					  [&] (const step_jaccard_t & sjt_a,
 						   const step_jaccard_t & sjt_b) {
-						  return as_integers(sjt_a.step)[1] < as_integers(sjt_b.step)[1];
+						  return sjt_a.jaccard > sjt_b.jaccard
+								 || (sjt_a.jaccard == sjt_b.jaccard && as_integers(sjt_a.step)[1] < as_integers(sjt_b.step)[1]);
 					  });
-			// take the one with array position arr_len/2; if arr_len%%2 !=0 then take the floor of the resulting value
-			uint64_t final_jaccard_position_in_same = target_same_jaccard.size() / 2;
-			step_jaccard_t final_jaccard = target_same_jaccard[final_jaccard_position_in_same];
-			uint64_t final_jaccard_position;
-			for (uint64_t i = 0; i < target_jaccard_indices.size(); i++) {
-				step_jaccard_t s_j_t = target_jaccard_indices[i];
-				if (s_j_t.jaccard == final_jaccard.jaccard
-					&& as_integers(s_j_t.step)[0] == as_integers(final_jaccard.step)[0]
-					&& as_integers(s_j_t.step)[1] == as_integers(final_jaccard.step)[1]) {
-					final_jaccard_position = i;
+			ska::flat_hash_map<nid_t, uint64_t> query_set = collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, cur_step);
+			uint64_t verified = 0;
+			double best_exact = 0.0;
+			auto verify_next = [&]() {
+				ska::flat_hash_map<nid_t, uint64_t> target_set = collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, target_jaccard_indices[verified].step);
+				target_jaccard_indices[verified].jaccard = get_jaccard_index(graph, query_set, target_set);
+				best_exact = std::max(best_exact, target_jaccard_indices[verified].jaccard);
+				++verified;
+			};
+			while (verified < std::min(n_verify, (uint64_t) target_jaccard_indices.size())) {
+				verify_next();
+			}
+			// then every target whose estimate could still tie the best exact value, going by the error of the estimates,
+			// and every target whose estimate ties the last one verified, as targets with the same window have the same
+			// estimate. The ties are then broken among all of them, as jaccard_indices_from_step_handles breaks them.
+			double last_estimate = verified > 0 ? target_jaccard_indices[verified - 1].jaccard : 0.0;
+			while (verified < target_jaccard_indices.size()) {
+				const double estimate = target_jaccard_indices[verified].jaccard;
+				const double margin = 3.0 * std::sqrt(best_exact * (1.0 - best_exact) / sketch_size) + 1.0 / sketch_size;
+				if (estimate != last_estimate && estimate < best_exact - margin) {
 					break;
 				}
+				last_estimate = estimate;
+				verify_next();
 			}
-			// use std::swap to switch the found array position with the first position
-			std::swap(target_jaccard_indices[0], target_jaccard_indices[final_jaccard_position]);
+			std::vector<step_jaccard_t> exact_jaccard_indices(target_jaccard_indices.begin(), target_jaccard_indices.begin() + verified);
+			order_jaccard_indices(exact_jaccard_indices);
+			std::copy(exact_jaccard_indices.begin(), exact_jaccard_indices.end(), target_jaccard_indices.begin());
 			return target_jaccard_indices;
 		}
 
@@ -29,6 +29,39 @@ namespace odgi {
 																	  const step_handle_t& cur_step,
 																	  std::vector<step_handle_t>& target_step_handles);
 
+		/// a bottom-k sketch of the node visits in the window of a step, see sketch_walk_window
+		struct walk_sketch_t {
+			/// the smallest ranks of the elements of the window, ascending. Each visit of a node is an element, with an
+			/// exponentially distributed rank divided by the node length, so that the sketch samples sequence, not nodes.
+			std::vector<double> ranks;
+			/// false if we could not walk the full distance in both directions
+			bool full = false;
+		};
+
+		/// sketch the nodes and visits that collect_nodes_in_walking_dist collects walking walking_dist in both directions,
+		/// keeping the sketch_size smallest ranks
+		walk_sketch_t sketch_walk_window(const graph_t& graph,
+										 const uint64_t& walking_dist,
+										 const step_handle_t& step,
+										 const uint64_t& sketch_size);
+
+		/// estimate the jaccard index that get_jaccard_index gives for the windows of two full sketches
+		double estimate_jaccard(const walk_sketch_t& a, const walk_sketch_t& b, const uint64_t& sketch_size);
+
+		/// as jaccard_indices_from_step_handles, but estimating the jaccard indices by comparing the sketch of the query with
+		/// the sketches of the targets, given in the order of target_step_handles. The n_verify best estimates are computed
+		/// exactly, and so are all further ones that could tie the best exact value or that tie the last estimate verified.
+		/// They come first, ordered as jaccard_indices_from_step_handles orders them, followed by the estimates.
+		/// If a window can't be walked in full, all jaccard indices are computed exactly.
+		std::vector<step_jaccard_t> jaccard_indices_from_sketches(const graph_t& graph,
+																  const uint64_t& walking_dist,
+																  const step_handle_t& cur_step,
+																  const walk_sketch_t& query_sketch,
+																  std::vector<step_handle_t>& target_step_handles,
+																  const std::vector<const walk_sketch_t*>& target_sketches,
+																  const uint64_t& sketch_size,
+																  const uint64_t& n_verify);
+
 		/// from the given start step we walk the given distance in nucleotides left and right following the steps in the given graph graph, collecting all nodes that we cross <key>
 		/// we also record, how many times we visited a node <value>
 		ska::flat_hash_map<nid_t , uint64_t> collect_nodes_in_walking_dist(const graph_t& graph,
@@ -0,0 +1,158 @@
+#include "path_membership.hpp"
+#include <omp.h>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+path_membership_t::path_membership_t(const graph_t& graph,
+                                     const std::vector<uint64_t>& path_group,
+                                     const uint64_t& group_count,
+                                     const uint64_t& nthreads) : groups(group_count) {
+    std::vector<handle_t> handles;
+    handles.reserve(graph.get_node_count());
+    uint64_t rows = 0;
+    graph.for_each_handle([&](const handle_t& h) {
+        handles.push_back(h);
+        rows = std::max(rows, rank_of(h) + 1);
+    });
+    node_length.resize(rows, 0);
+    row_first_word.resize(rows, 0);
+    // first the number of words and repeats of each row, which become where they start after the prefix sum
+    row_start.resize(rows + 1, 0);
+    repeat_start.resize(rows + 1, 0);
+
+    auto get_groups = [&](const handle_t& h, std::vector<uint64_t>& node_groups) {
+        node_groups.clear();
+        graph.for_each_step_on_handle(h, [&](const step_handle_t& step) {
+            const uint64_t p = as_integer(graph.get_path_handle_of_step(step));
+            if (p < path_group.size() && path_group[p] != no_group) {
+                node_groups.push_back(path_group[p]);
+            }
+        });
+        std::sort(node_groups.begin(), node_groups.end());
+    };
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        std::vector<uint64_t> node_groups;
+#pragma omp for schedule(dynamic, 1024)
+        for (uint64_t i = 0; i < handles.size(); ++i) {
+            const handle_t& h = handles[i];
+            const uint64_t row = rank_of(h);
+            node_length[row] = graph.get_length(h);
+            get_groups(h, node_groups);
+            if (node_groups.empty()) continue;
+            row_first_word[row] = node_groups.front() / 64;
+            row_start[row + 1] = node_groups.back() / 64 - node_groups.front() / 64 + 1;
+            uint64_t repeated = 0;
+            for (uint64_t j = 1; j < node_groups.size(); ++j) {
+                if (node_groups[j] == node_groups[j - 1]
+                    && (j == 1 || node_groups[j - 1] != node_groups[j - 2])) {
+                    ++repeated;
+                }
+            }
+            repeat_start[row + 1] = repeated;
+        }
+    }
+    for (uint64_t row = 0; row < rows; ++row) {
+        row_start[row + 1] += row_start[row];
+        repeat_start[row + 1] += repeat_start[row];
+    }
+    bits.resize(row_start.back(), 0);
+    repeats.resize(repeat_start.back());
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        std::vector<uint64_t> node_groups;
+#pragma omp for schedule(dynamic, 1024)
+        for (uint64_t i = 0; i < handles.size(); ++i) {
+            const handle_t& h = handles[i];
+            const uint64_t row = rank_of(h);
+            if (word_count(row) == 0) continue;
+            get_groups(h, node_groups);
+            uint64_t* row_bits = bits.data() + row_start[row];
+            const uint64_t offset = 64 * (uint64_t)row_first_word[row];
+            auto repeat = repeats.begin() + repeat_start[row];
+            for (uint64_t j = 0; j < node_groups.size(); ++j) {
+                const uint64_t g = node_groups[j] - offset;
+                row_bits[g / 64] |= (uint64_t)1 << (g % 64);
+                if (j > 0 && node_groups[j] == node_groups[j - 1]) {
+                    if (j == 1 || node_groups[j - 1] != node_groups[j - 2]) {
+                        *repeat++ = std::make_pair(node_groups[j], 1);
+                    } else {
+                        ++(repeat - 1)->second;
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<uint64_t> path_membership_t::one_group_per_path(const graph_t& graph) {
+    std::vector<uint64_t> path_group;
+    graph.for_each_path_handle([&](const path_handle_t& p) {
+        const uint64_t i = as_integer(p);
+        if (i >= path_group.size()) {
+            path_group.resize(i + 1, no_group);
+        }
+        path_group[i] = i - 1;
+    });
+    return path_group;
+}
+
+bool path_membership_t::contains(const uint64_t& row, const uint64_t& group) const {
+    const uint64_t word = group / 64;
+    if (word < row_first_word[row] || word >= row_first_word[row] + word_count(row)) {
+        return false;
+    }
+    return (words(row)[word - row_first_word[row]] >> (group % 64)) & 1;
+}
+
+uint64_t path_membership_t::popcount(const uint64_t& row) const {
+    const uint64_t* w = words(row);
+    const uint64_t n = word_count(row);
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        count += __builtin_popcountll(w[i]);
+    }
+    return count;
+}
+
+void path_membership_t::for_each_group(const uint64_t& row, const std::function<void(const uint64_t&)>& func) const {
+    const uint64_t* w = words(row);
+    const uint64_t n = word_count(row);
+    const uint64_t offset = 64 * (uint64_t)row_first_word[row];
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t word = w[i];
+        while (word) {
+            func(offset + 64 * i + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+}
+
+void path_membership_t::for_each_repeat(const uint64_t& row,
+                                        const std::function<void(const uint64_t&, const uint64_t&)>& func) const {
+    for (uint64_t i = repeat_start[row]; i < repeat_start[row + 1]; ++i) {
+        func(repeats[i].first, repeats[i].second);
+    }
+}
+
+uint64_t path_membership_t::min_group_rank(const uint64_t& row, const std::vector<uint64_t>& rank_of_group) const {
+    const uint64_t* w = words(row);
+    const uint64_t n = word_count(row);
+    const uint64_t offset = 64 * (uint64_t)row_first_word[row];
+    uint64_t min_rank = no_group;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t word = w[i];
+        while (word) {
+            min_rank = std::min(min_rank, rank_of_group[offset + 64 * i + __builtin_ctzll(word)]);
+            word &= word - 1;
+        }
+    }
+    return min_rank;
+}
+
+}
+}
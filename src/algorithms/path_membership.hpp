@@ -0,0 +1,88 @@
+#pragma once
+
+/**
+ * \file path_membership.hpp
+ *
+ * Which groups of paths step on which nodes, as a node x group matrix of bits. It is built once, in parallel over the
+ * nodes, from the steps on each node, and answers for odgi pav, odgi heaps and odgi similarity what they used to find
+ * out by walking all paths: each row holds the groups on a node as words of 64 bits, so that whole rows can be
+ * combined with bitwise operations and counted with popcounts. A row only stores the words between the first and the
+ * last group on it, and the groups that step on a node more than once are listed apart with the number of their
+ * extra steps.
+ *
+ */
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <functional>
+#include "odgi.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+class path_membership_t {
+public:
+    /// the group of a path that belongs to none
+    static const uint64_t no_group = std::numeric_limits<uint64_t>::max();
+
+    /// Build the matrix of the graph, given the group of each path indexed by as_integer(path), where paths beyond
+    /// the end of path_group or with no_group are left out. Rows are indexed by the rank of the nodes in the graph.
+    path_membership_t(const graph_t& graph,
+                      const std::vector<uint64_t>& path_group,
+                      const uint64_t& group_count,
+                      const uint64_t& nthreads);
+
+    /// one group per path, numbered by as_integer(path) - 1
+    static std::vector<uint64_t> one_group_per_path(const graph_t& graph);
+
+    /// the rank of a node, which is its row
+    static inline uint64_t rank_of(const handle_t& handle) {
+        return number_bool_packing::unpack_number(handle);
+    }
+
+    uint64_t row_count() const { return node_length.size(); }
+    uint64_t group_count() const { return groups; }
+
+    /// the length of the node of a row, 0 for deleted nodes
+    uint64_t length(const uint64_t& row) const { return node_length[row]; }
+
+    /// the words of a row, starting with the bits of groups 64 * first_word(row) to 64 * first_word(row) + 63
+    uint64_t first_word(const uint64_t& row) const { return row_first_word[row]; }
+    uint64_t word_count(const uint64_t& row) const { return row_start[row + 1] - row_start[row]; }
+    const uint64_t* words(const uint64_t& row) const { return bits.data() + row_start[row]; }
+
+    /// true if the group steps on the node of the row
+    bool contains(const uint64_t& row, const uint64_t& group) const;
+
+    /// the number of groups stepping on the node of the row
+    uint64_t popcount(const uint64_t& row) const;
+
+    /// call func with each group on the node of the row, in ascending order
+    void for_each_group(const uint64_t& row, const std::function<void(const uint64_t&)>& func) const;
+
+    /// call func with each group that steps on the node of the row more than once, and the number of its extra steps
+    void for_each_repeat(const uint64_t& row, const std::function<void(const uint64_t&, const uint64_t&)>& func) const;
+
+    /// true if a group steps on the node of the row more than once
+    bool has_repeats(const uint64_t& row) const { return repeat_start[row + 1] > repeat_start[row]; }
+
+    /// the smallest value of rank_of_group over the groups on the node of the row, or no_group if it has none
+    uint64_t min_group_rank(const uint64_t& row, const std::vector<uint64_t>& rank_of_group) const;
+
+private:
+    uint64_t groups = 0;
+    std::vector<uint64_t> node_length;
+    /// where each row starts in bits, with an extra entry for the end of the last one
+    std::vector<uint64_t> row_start;
+    std::vector<uint32_t> row_first_word;
+    std::vector<uint64_t> bits;
+    /// where the repeats of each row start in repeats, and the groups stepping more than once with their extra steps
+    std::vector<uint64_t> repeat_start;
+    std::vector<std::pair<uint64_t, uint64_t>> repeats;
+};
+
+}
+}
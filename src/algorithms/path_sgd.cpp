@@ -1,6 +1,7 @@
 #include "path_sgd.hpp"
 #include "dirty_zipfian_int_distribution.h"
 #include "layout.hpp"
+#include "path_sgd_multilevel.hpp"
 
 //#define debug_path_sgd
 // #define eval_path_sgd
@@ -9,26 +10,124 @@
 namespace odgi {
     namespace algorithms {
 
-        std::vector<double> path_linear_sgd(const graph_t &graph,
-                                            const xp::XP &path_index,
-                                            const std::vector<path_handle_t> &path_sgd_use_paths,
-                                            const uint64_t &iter_max,
-                                            const uint64_t &iter_with_max_learning_rate,
-                                            const uint64_t &min_term_updates,
-                                            const double &delta,
-                                            const double &eps,
-                                            const double &eta_max,
-                                            const double &theta,
-                                            const uint64_t &space,
-                                            const uint64_t &space_max,
-                                            const uint64_t &space_quantization_step,
-                                            const double &cooling_start,
-                                            const uint64_t &nthreads,
-                                            const bool &progress,
-                                            const bool &snapshot,
-                                            std::vector<std::string> &snapshots,
-											const bool &target_sorting,
-											std::vector<bool>& target_nodes) {
+        /// terms a worker samples before applying them, so that the positions they touch can be prefetched
+        const static uint64_t PATH_SGD_TERM_BATCH = 64;
+
+        path_sgd_steps_t path_sgd_steps(const PathHandleGraph &graph, const uint64_t &nthreads) {
+            path_sgd_steps_t steps;
+            std::vector<path_handle_t> paths;
+            graph.for_each_path_handle([&](const path_handle_t &path) {
+                paths.push_back(path);
+            });
+            steps.path_begin.resize(paths.size() + 1);
+            uint64_t step_count = 0;
+            for (uint64_t p = 0; p < paths.size(); ++p) {
+                steps.path_begin[p] = step_count;
+                step_count += graph.get_step_count(paths[p]);
+            }
+            steps.path_begin[paths.size()] = step_count;
+            steps.step.resize(step_count);
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+            for (uint64_t p = 0; p < paths.size(); ++p) {
+                uint64_t s = steps.path_begin[p];
+                uint64_t pos = 0;
+                graph.for_each_step_in_path(paths[p], [&](const step_handle_t &step) {
+                    handle_t h = graph.get_handle_of_step(step);
+                    steps.step[s++] = {h, pos};
+                    pos += graph.get_length(h);
+                });
+            }
+            return steps;
+        }
+
+        std::vector<double> path_sgd_zetas(const uint64_t &space,
+                                           const uint64_t &space_max,
+                                           const uint64_t &space_quantization_step,
+                                           const double &theta) {
+            std::vector<double> zetas((space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1)+1);
+            double zeta_tmp = 0.0;
+            for (uint64_t i = 1; i < space + 1; i++) {
+                zeta_tmp += dirtyzipf::fast_precise_pow(1.0 / i, theta);
+                if (i <= space_max) {
+                    zetas[i] = zeta_tmp;
+                }
+                // nb: the quantized zetas are only there if the space goes beyond space_max
+                if (space > space_max && i >= space_max && (i - space_max) % space_quantization_step == 0) {
+                    zetas[space_max + 1 + (i - space_max) / space_quantization_step] = zeta_tmp;
+                }
+            }
+            return zetas;
+        }
+
+        path_sgd_stress_t::path_sgd_stress_t(const path_sgd_steps_t &steps,
+                                             const double &theta,
+                                             const std::vector<double> &zetas,
+                                             const uint64_t &space,
+                                             const uint64_t &space_max,
+                                             const uint64_t &space_quantization_step) {
+            if (steps.step_count() == 0) {
+                return;
+            }
+            // a fixed seed, so that the stress of a run can be compared across iterations and restarts
+            XoshiroCpp::Xoshiro256Plus gen(sgd_seed("path_sgd_stress"));
+            std::uniform_int_distribution<uint64_t> dis_step(0, steps.step_count() - 1);
+            pairs.reserve(PAIRS);
+            // nb: bounded, as paths of single steps or empty nodes give no pairs
+            for (uint64_t draw = 0; draw < 4 * PAIRS && pairs.size() < PAIRS; ++draw) {
+                const uint64_t step_a = dis_step(gen);
+                const uint64_t path_i = steps.path_of(step_a);
+                if (steps.path_step_count(path_i) == 1) {
+                    continue;
+                }
+                const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, false, theta, zetas,
+                                                         space, space_max, space_quantization_step, gen);
+                const path_sgd_step_t &a = steps.step[step_a];
+                const path_sgd_step_t &b = steps.step[step_b];
+                const double d = std::abs(static_cast<double>(a.pos) - static_cast<double>(b.pos));
+                if (d != 0) {
+                    pairs.push_back({a.handle, b.handle, d});
+                }
+            }
+        }
+
+        double path_sgd_stress_t::operator()(const std::vector<std::atomic<double>> &X,
+                                             const std::vector<std::atomic<double>> &Y) const {
+            double stress = 0;
+            for (auto &pair : pairs) {
+                const uint64_t a = 2 * number_bool_packing::unpack_number(pair.a) + number_bool_packing::unpack_bit(pair.a);
+                const uint64_t b = 2 * number_bool_packing::unpack_number(pair.b) + number_bool_packing::unpack_bit(pair.b);
+                const double dx = X[a].load(std::memory_order_relaxed) - X[b].load(std::memory_order_relaxed);
+                const double dy = Y[a].load(std::memory_order_relaxed) - Y[b].load(std::memory_order_relaxed);
+                const double dist = std::sqrt(dx * dx + dy * dy);
+                stress += (dist - pair.d) * (dist - pair.d) / (pair.d * pair.d);
+            }
+            return pairs.empty() ? 0 : stress / (double)pairs.size();
+        }
+
+        /// the PG-SGD workers, with positions of type pos_t updated without locks (Hogwild!)
+        template<typename pos_t>
+        static std::vector<double> path_linear_sgd_hogwild(const graph_t &graph,
+                                                           const xp::XP &path_index,
+                                                           const std::vector<path_handle_t> &path_sgd_use_paths,
+                                                           const uint64_t &iter_max,
+                                                           const uint64_t &iter_with_max_learning_rate,
+                                                           const uint64_t &min_term_updates,
+                                                           const double &delta,
+                                                           const double &eps,
+                                                           const double &eta_max,
+                                                           const double &theta,
+                                                           const uint64_t &space,
+                                                           const uint64_t &space_max,
+                                                           const uint64_t &space_quantization_step,
+                                                           const double &cooling_start,
+                                                           const uint64_t &nthreads,
+                                                           const bool &progress,
+                                                           const bool &snapshot,
+                                                           std::vector<std::string> &snapshots,
+                                                           const bool &target_sorting,
+                                                           std::vector<bool>& target_nodes,
+                                                           const std::vector<double> &X_init,
+                                                           const path_sgd_convergence_t &convergence) {
 #ifdef debug_path_sgd
             std::cerr << "iter_max: " << iter_max << std::endl;
             std::cerr << "min_term_updates: " << min_term_updates << std::endl;
@@ -53,30 +152,28 @@ namespace odgi {
             using namespace std::chrono_literals; // for timing stuff
             uint64_t num_nodes = graph.get_node_count();
             // our positions in 1D
-            std::vector<std::atomic<double>> X(num_nodes);
+            // nb: the workers read and write them with relaxed ordering, which is a plain load or store on x86,
+            // accepting that concurrent updates of the same node may overwrite each other
+            std::vector<std::atomic<pos_t>> X(num_nodes);
             atomic<bool> snapshot_in_progress;
             snapshot_in_progress.store(false);
             std::vector<atomic<bool>> snapshot_progress(iter_max);
             // we will produce one less snapshot compared to iterations
             snapshot_progress[0].store(true);
-            // seed them with the graph order
-            uint64_t len = 0;
-            graph.for_each_handle(
-                    [&X, &graph, &len](const handle_t &handle) {
-                        // nb: we assume that the graph provides a compact handle set
-                        X[number_bool_packing::unpack_number(handle)].store(len);
-                        len += graph.get_length(handle);
-                    });
-            // the longest path length measured in nucleotides
-            //size_t longest_path_in_nucleotides = 0;
-            // the total path length in nucleotides
-            //size_t total_path_len_in_nucleotides = 0;
-            // here we store all path nucleotides lengths so we know later from which path we sampled our random position from
-            //IITree<uint64_t, path_handle_t> path_nucleotide_tree;
-            // iterate over all relevant path_handles:
-            //  1. build the interval tree
-            //  2. find out the longest path in nucleotides and store this number size_t
-            //  3. add the current path length to the total length
+            // seed them with the given layout, or else the graph order
+            if (!X_init.empty()) {
+                for (uint64_t i = 0; i < num_nodes; ++i) {
+                    X[i].store(X_init[i]);
+                }
+            } else {
+                uint64_t len = 0;
+                graph.for_each_handle(
+                        [&X, &graph, &len](const handle_t &handle) {
+                            // nb: we assume that the graph provides a compact handle set
+                            X[number_bool_packing::unpack_number(handle)].store(len);
+                            len += graph.get_length(handle);
+                        });
+            }
             bool at_least_one_path_with_more_than_one_step = false;
 
             for (auto &path : path_sgd_use_paths) {
@@ -84,24 +181,14 @@ namespace odgi {
                 std::string path_name = graph.get_path_name(path);
                 std::cerr << path_name << std::endl;
                 std::cerr << as_integer(path) << std::endl;
-#endif
-#ifdef debug_path_sgd
                 size_t path_len = path_index.get_path_length(path);
                 std::cerr << path_name << " has length: " << path_len << std::endl;
 #endif
-                //path_nucleotide_tree.add(total_path_len_in_nucleotides, total_path_len_in_nucleotides + path_len, path);
-
-                //if (path_len > longest_path_in_nucleotides) {
-                //    longest_path_in_nucleotides = path_len;
-                //}
-                //total_path_len_in_nucleotides += path_len;
-
                 if (path_index.get_path_step_count(path) > 1){
                     at_least_one_path_with_more_than_one_step = true;
                     break;
                 }
             }
-            //path_nucleotide_tree.index();
 
             if (at_least_one_path_with_more_than_one_step){
                 double w_min = (double) 1.0 / (double) (eta_max);
@@ -125,17 +212,16 @@ namespace odgi {
                 if (progress) {
                     std::cerr << "[odgi::path_linear_sgd] calculating zetas for " << (space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1) << " zipf distributions" << std::endl;
                 }
-                std::vector<double> zetas((space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1)+1);
-                double zeta_tmp = 0.0;
-                for (uint64_t i = 1; i < space + 1; i++) {
-                    zeta_tmp += dirtyzipf::fast_precise_pow(1.0 / i, theta);
-                    if (i <= space_max) {
-                        zetas[i] = zeta_tmp;
-                    }
-                    if (i >= space_max && (i - space_max) % space_quantization_step == 0) {
-                        zetas[space_max + 1 + (i - space_max) / space_quantization_step] = zeta_tmp;
-                    }
+                std::vector<double> zetas = path_sgd_zetas(space, space_max, space_quantization_step, theta);
+
+                // flat copies of the path steps, so that sampling a term doesn't decode the path index
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] collecting path steps" << std::endl;
                 }
+                const path_sgd_steps_t steps = path_sgd_steps(graph, nthreads);
+                // the stress, for the plateau test
+                const path_sgd_stress_t stress(steps, theta, zetas, space, space_max, space_quantization_step);
+                path_sgd_schedule_state_t state;
 
                 // how many term updates we make
                 std::atomic<uint64_t> term_updates;
@@ -178,6 +264,20 @@ namespace odgi {
                                         iteration++;
                                         snapshot_in_progress.store(false);
                                     }
+                                    if (iteration <= iter_max && convergence.plateau_iterations > 0
+                                        && path_sgd_plateaued(state, stress(X), convergence)) {
+                                        // the schedule goes on at a lower learning rate, or ends
+                                        const uint64_t end = iter_max + 1;
+                                        const uint64_t next = path_sgd_after_plateau(etas, iteration - 1, end);
+                                        if (progress) {
+                                            std::cerr << "[odgi::path_linear_sgd] stress: " << state.best_stress
+                                                      << " hasn't improved in " << convergence.plateau_iterations << " iterations. Plateau reached, therefore "
+                                                      << (next < end ? "continuing at iteration " + std::to_string(next) : std::string("ending iterations"))
+                                                      << "." << std::endl;
+                                        }
+                                        iteration = next;
+                                        state.since_best = 0;
+                                    }
                                     if (iteration > iter_max) {
                                         work_todo.store(false);
                                     } else if (Delta_max.load() <= delta) { // nb: this will also break at 0
@@ -207,201 +307,90 @@ namespace odgi {
                             // everyone tries to seed with their own random data
                             const std::uint64_t seed = 9399220 + tid;
                             XoshiroCpp::Xoshiro256Plus gen(seed); // a nice, fast PRNG
-                            // some references to literal bitvectors in the path index hmmm
-                            const sdsl::bit_vector &np_bv = path_index.get_np_bv();
-                            const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
-                            const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
                             // we'll sample from all path steps
-                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, np_bv.size() - 1);
-                            std::uniform_int_distribution<uint64_t> flip(0, 1);
+                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, steps.step_count() - 1);
+                            std::vector<uint64_t> batch_a(PATH_SGD_TERM_BATCH);
+                            std::vector<uint64_t> batch_b(PATH_SGD_TERM_BATCH);
+                            std::vector<path_sgd_term_t> batch;
+                            batch.reserve(PATH_SGD_TERM_BATCH);
                             uint64_t term_updates_local = 0;
                             while (work_todo.load()) {
-                                if (!snapshot_in_progress.load()) {
-                                    // sample the first node from all the nodes in the graph
-                                    // pick a random position from all paths
-                                    uint64_t step_index = dis_step(gen);
-#ifdef debug_sample_from_nodes
-                                    std::cerr << "step_index: " << step_index << std::endl;
-#endif
-                                    uint64_t path_i = npi_iv[step_index];
-                                    path_handle_t path = as_path_handle(path_i);
-
-                                    size_t path_step_count = path_index.get_path_step_count(path);
-                                    if (path_step_count == 1){
+                                if (snapshot_in_progress.load()) {
+                                    continue;
+                                }
+                                // the schedule only moves between iterations, so it is read once per batch
+                                const double batch_eta = eta.load();
+                                const bool batch_cooling = cooling.load();
+                                const double batch_theta = adj_theta.load();
+                                // terms are drawn in stages over the whole batch, each prefetching what the next one reads,
+                                // so that the cache misses of different terms overlap
+                                // 1. pick random steps from all paths
+                                for (auto &step_a : batch_a) {
+                                    step_a = dis_step(gen);
+                                    __builtin_prefetch(&steps.step[step_a]);
+                                }
+                                // 2. pick their partners in the same path
+                                uint64_t n_terms = 0;
+                                for (uint64_t k = 0; k < PATH_SGD_TERM_BATCH; ++k) {
+                                    const uint64_t step_a = batch_a[k];
+                                    const uint64_t path_i = steps.path_of(step_a);
+                                    const uint64_t path_step_count = steps.path_step_count(path_i);
+                                    if (path_step_count == 1) {
                                         continue;
                                     }
-
-#ifdef debug_sample_from_nodes
-                                    std::cerr << "path integer: " << path_i << std::endl;
-#endif
-                                    step_handle_t step_a, step_b;
-                                    as_integers(step_a)[0] = path_i; // path index
-                                    size_t s_rank = nr_iv[step_index] - 1; // step rank in path
-                                    as_integers(step_a)[1] = s_rank;
-#ifdef debug_sample_from_nodes
-                                    std::cerr << "step rank in path: " << nr_iv[step_index]  << std::endl;
-#endif
-
-                                    if (cooling.load() || flip(gen)) {
-                                        auto _theta = adj_theta.load();
-                                        if (s_rank > 0 && flip(gen) || s_rank == path_step_count-1) {
-                                            // go backward
-                                            uint64_t jump_space = std::min(space, (uint64_t) s_rank);
-                                            uint64_t space = jump_space;
-                                            if (jump_space > space_max){
-                                                space = space_max + (jump_space - space_max) / space_quantization_step + 1;
-                                            }
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
-                                            uint64_t z_i = z(gen);
-                                            //assert(z_i <= path_space);
-                                            as_integers(step_b)[0] = as_integer(path);
-                                            as_integers(step_b)[1] = s_rank - z_i;
-                                        } else {
-                                            // go forward
-                                            uint64_t jump_space = std::min(space, (uint64_t) (path_step_count - s_rank - 1));
-                                            uint64_t space = jump_space;
-                                            if (jump_space > space_max){
-                                                space = space_max + (jump_space - space_max) / space_quantization_step + 1;
-                                            }
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
-                                            uint64_t z_i = z(gen);
-                                            //assert(z_i <= path_space);
-                                            as_integers(step_b)[0] = as_integer(path);
-                                            as_integers(step_b)[1] = s_rank + z_i;
+                                    const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, batch_cooling, batch_theta, zetas,
+                                                                             space, space_max, space_quantization_step, gen);
+                                    __builtin_prefetch(&steps.step[step_b]);
+                                    batch_a[n_terms] = step_a;
+                                    batch_b[n_terms] = step_b;
+                                    ++n_terms;
+                                }
+                                // 3. resolve the nodes and distances of the terms
+                                batch.clear();
+                                for (uint64_t k = 0; k < n_terms; ++k) {
+                                    const path_sgd_step_t &a = steps.step[batch_a[k]];
+                                    const path_sgd_step_t &b = steps.step[batch_b[k]];
+                                    path_sgd_term_t term = {a.node(), b.node(), 0, true, true};
+                                    // Check which terms we actually have to update
+                                    // nb: as for X, we assume a compact node id space starting at 1
+                                    if (target_sorting) {
+                                        if (target_nodes[term.i]) {
+                                            term.update_i = false;
+                                        }
+                                        if (target_nodes[term.j]) {
+                                            term.update_j = false;
                                         }
-                                    } else {
-                                        // sample randomly across the path
-                                        graph.get_step_count(path);
-                                        std::uniform_int_distribution<uint64_t> rando(0, graph.get_step_count(path)-1);
-                                        as_integers(step_b)[0] = as_integer(path);
-                                        as_integers(step_b)[1] = rando(gen);
                                     }
-
-                                    // and the graph handles, which we need to record the update
-                                    handle_t term_i = path_index.get_handle_of_step(step_a);
-                                    handle_t term_j = path_index.get_handle_of_step(step_b);
-
-									bool update_term_i = true;
-									bool update_term_j = true;
-
-
-									// Check which terms we actually have to update
-									if (target_sorting) {
-										if (target_nodes[graph.get_id(term_i) - 1]) {
-											update_term_i = false;
-										}
-										if (target_nodes[graph.get_id(term_j) - 1]) {
-											update_term_j = false;
-										}
-									}
-									if (!update_term_j && !update_term_i) {
-										// we also have to update the number of terms here, because else we will over sample and the sorting will take much longer
-										term_updates_local++;
-										continue;
-									}
-
-                                    // adjust the positions to the node starts
-                                    size_t pos_in_path_a = path_index.get_position_of_step(step_a);
-                                    size_t pos_in_path_b = path_index.get_position_of_step(step_b);
-#ifdef debug_path_sgd
-                                    std::cerr << "1. pos in path " << pos_in_path_a << " " << pos_in_path_b << std::endl;
-#endif
-                                    // assert(pos_in_path_a < path_index.get_path_length(path));
-                                    // assert(pos_in_path_b < path_index.get_path_length(path));
-
-#ifdef debug_path_sgd
-                                    std::cerr << "2. pos in path " << pos_in_path_a << " " << pos_in_path_b << std::endl;
-#endif
-                                    // establish the term distance
-                                    double term_dist = std::abs(
-                                            static_cast<double>(pos_in_path_a) - static_cast<double>(pos_in_path_b));
-
-                                    if (term_dist == 0) {
+                                    if (!term.update_i && !term.update_j) {
+                                        // we also have to update the number of terms here, because else we will over sample and the sorting will take much longer
+                                        term_updates_local++;
                                         continue;
-                                        // term_dist = 1e-9;
-                                    }
-#ifdef eval_path_sgd
-                                    std::string path_name = path_index.get_path_name(path);
-                                std::cerr << path_name << "\t" << pos_in_path_a << "\t" << pos_in_path_b << "\t" << term_dist << std::endl;
-#endif
-                                    // assert(term_dist == zipf_int);
-#ifdef debug_path_sgd
-                                    std::cerr << "term_dist: " << term_dist << std::endl;
-#endif
-                                    double term_weight = 1.0 / term_dist;
-
-                                    double w_ij = term_weight;
-#ifdef debug_path_sgd
-                                    std::cerr << "w_ij = " << w_ij << std::endl;
-#endif
-                                    double mu = eta.load() * w_ij;
-                                    if (mu > 1) {
-                                        mu = 1;
                                     }
-                                    // actual distance in graph
-                                    double d_ij = term_dist;
-                                    // identities
-                                    uint64_t i = number_bool_packing::unpack_number(term_i);
-                                    uint64_t j = number_bool_packing::unpack_number(term_j);
-#ifdef debug_path_sgd
-                                    #pragma omp critical (cerr)
-                                std::cerr << "nodes are " << graph.get_id(term_i) << " and " << graph.get_id(term_j) << std::endl;
-#endif
-                                    // distance == magnitude in our 1D situation
-                                    double dx = X[i].load() - X[j].load();
-                                    if (dx == 0) {
-                                        dx = 1e-9; // avoid nan
-                                    }
-#ifdef debug_path_sgd
-                                    #pragma omp critical (cerr)
-                                std::cerr << "distance is " << dx << " but should be " << d_ij << std::endl;
-#endif
-                                    //double mag = dx; //sqrt(dx*dx + dy*dy);
-                                    double mag = std::abs(dx);
-#ifdef debug_path_sgd
-                                    std::cerr << "mu " << mu << " mag " << mag << " d_ij " << d_ij << std::endl;
-#endif
-                                    // check distances for early stopping
-                                    double Delta = mu * (mag - d_ij) / 2;
-                                    // try until we succeed. risky.
-                                    double Delta_abs = std::abs(Delta);
-#ifdef debug_path_sgd
-                                    #pragma omp critical (cerr)
-                                std::cerr << "Delta_abs " << Delta_abs << std::endl;
-#endif
-                                    while (Delta_abs > Delta_max.load()) {
-                                        Delta_max.store(Delta_abs);
+                                    // establish the term distance
+                                    term.d_ij = std::abs(static_cast<double>(a.pos) - static_cast<double>(b.pos));
+                                    if (term.d_ij == 0) {
+                                        continue;
                                     }
-                                    // calculate update
-                                    double r = Delta / mag;
-                                    double r_x = r * dx;
-#ifdef debug_path_sgd
-                                    #pragma omp critical (cerr)
-                                std::cerr << "r_x is " << r_x << std::endl;
-#endif
-                                    // update our positions (atomically)
-#ifdef debug_path_sgd
-                                    std::cerr << "before X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
-#endif
-									if (update_term_i) {
-										X[i].store(X[i].load() - r_x);
-									}
-									if (update_term_j) {
-										X[j].store(X[j].load() + r_x);
-									}
-#ifdef debug_path_sgd
-                                    std::cerr << "after X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
-#endif
-                                    term_updates_local++;
-                                    if (term_updates_local >= 1000) {
-                                        term_updates += term_updates_local;
-                                        if (progress) {
-                                            progress_meter->increment(term_updates_local);
-                                        }
-                                        term_updates_local = 0;
+                                    __builtin_prefetch(&X[term.i], 1);
+                                    __builtin_prefetch(&X[term.j], 1);
+                                    batch.push_back(term);
+                                }
+                                // 4. apply them
+                                double batch_Delta_max = 0;
+                                for (auto &term : batch) {
+                                    batch_Delta_max = std::max(batch_Delta_max, path_sgd_update(X, term, batch_eta));
+                                }
+                                // try until we succeed. risky.
+                                while (batch_Delta_max > Delta_max.load()) {
+                                    Delta_max.store(batch_Delta_max);
+                                }
+                                term_updates_local += batch.size();
+                                if (term_updates_local >= 1000) {
+                                    term_updates += term_updates_local;
+                                    if (progress) {
+                                        progress_meter->increment(term_updates_local);
                                     }
+                                    term_updates_local = 0;
                                 }
                             }
                         };
@@ -419,7 +408,7 @@ namespace odgi {
                                     ofstream snapshot_stream;
                                     snapshot_stream.open(snapshot_tmp_file);
                                     for (auto &x : X) {
-                                        snapshot_stream << x << std::endl;
+                                        snapshot_stream << (double)x.load() << std::endl;
                                     }
                                     // push back the name of the temp file
                                     snapshots.push_back(snapshot_tmp_file);
@@ -464,6 +453,256 @@ namespace odgi {
             return X_final;
         }
 
+        /// the PG-SGD iterations run one after the other, each drawing its terms from random streams of the seed
+        /// and applying them in conflict-free blocks of nodes, which gives the same layout with any number of threads
+        template<typename pos_t>
+        static std::vector<double> path_linear_sgd_deterministic(const graph_t &graph,
+                                                                 const xp::XP &path_index,
+                                                                 const std::vector<path_handle_t> &path_sgd_use_paths,
+                                                                 const uint64_t &iter_max,
+                                                                 const uint64_t &iter_with_max_learning_rate,
+                                                                 const uint64_t &min_term_updates,
+                                                                 const double &delta,
+                                                                 const double &eps,
+                                                                 const double &eta_max,
+                                                                 const double &theta,
+                                                                 const uint64_t &space,
+                                                                 const uint64_t &space_max,
+                                                                 const uint64_t &space_quantization_step,
+                                                                 const double &cooling_start,
+                                                                 const uint64_t &nthreads,
+                                                                 const bool &progress,
+                                                                 const bool &snapshot,
+                                                                 std::vector<std::string> &snapshots,
+                                                                 const bool &target_sorting,
+                                                                 std::vector<bool>& target_nodes,
+                                                                 const std::string &seeding_string,
+                                                                 const std::vector<double> &X_init,
+                                                                 const path_sgd_convergence_t &convergence) {
+            uint64_t first_cooling_iteration = std::floor(cooling_start * (double)iter_max);
+            uint64_t total_term_updates = iter_max * min_term_updates;
+            std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+            if (progress) {
+                progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                    total_term_updates, "[odgi::path_linear_sgd] 1D path-guided SGD (deterministic):");
+            }
+            uint64_t num_nodes = graph.get_node_count();
+            // our positions in 1D
+            // nb: only one thread at a time updates a node, so relaxed ordering is exact here
+            std::vector<std::atomic<pos_t>> X(num_nodes);
+            // seed them with the given layout, or else the graph order
+            if (!X_init.empty()) {
+                for (uint64_t i = 0; i < num_nodes; ++i) {
+                    X[i].store(X_init[i]);
+                }
+            } else {
+                uint64_t len = 0;
+                graph.for_each_handle(
+                        [&X, &graph, &len](const handle_t &handle) {
+                            // nb: we assume that the graph provides a compact handle set
+                            X[number_bool_packing::unpack_number(handle)].store(len);
+                            len += graph.get_length(handle);
+                        });
+            }
+            bool at_least_one_path_with_more_than_one_step = false;
+            for (auto &path : path_sgd_use_paths) {
+                if (path_index.get_path_step_count(path) > 1){
+                    at_least_one_path_with_more_than_one_step = true;
+                    break;
+                }
+            }
+
+            if (at_least_one_path_with_more_than_one_step) {
+                double w_min = (double) 1.0 / (double) (eta_max);
+                double w_max = 1.0;
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] calculating linear SGD schedule (" << w_min << " " << w_max << " "
+                              << iter_max << " " << iter_with_max_learning_rate << " " << eps << ")" << std::endl;
+                }
+                std::vector<double> etas = path_linear_sgd_schedule(w_min,
+                                                                    w_max,
+                                                                    iter_max,
+                                                                    iter_with_max_learning_rate,
+                                                                    eps);
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] calculating zetas for " << (space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1) << " zipf distributions" << std::endl;
+                }
+                std::vector<double> zetas = path_sgd_zetas(space, space_max, space_quantization_step, theta);
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] collecting path steps" << std::endl;
+                }
+                const path_sgd_steps_t steps = path_sgd_steps(graph, nthreads);
+                // the stress, for the plateau test
+                const path_sgd_stress_t stress(steps, theta, zetas, space, space_max, space_quantization_step);
+                path_sgd_schedule_state_t state;
+                const sgd_block_schedule_t schedule(num_nodes);
+                const uint64_t seed = sgd_seed(seeding_string);
+
+                for (uint64_t iteration = 0; iteration <= iter_max; ++iteration) {
+                    const double eta = etas[iteration];
+                    const bool cooling = iteration > first_cooling_iteration;
+                    const double adj_theta = cooling ? 0.001 : theta;
+                    auto sample = [&](XoshiroCpp::Xoshiro256Plus &gen, path_sgd_term_t &term) {
+                        const uint64_t step_a = std::uniform_int_distribution<uint64_t>(0, steps.step_count() - 1)(gen);
+                        const uint64_t path_i = steps.path_of(step_a);
+                        if (steps.path_step_count(path_i) == 1) {
+                            return false;
+                        }
+                        const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, cooling, adj_theta, zetas,
+                                                                 space, space_max, space_quantization_step, gen);
+                        const path_sgd_step_t &a = steps.step[step_a];
+                        const path_sgd_step_t &b = steps.step[step_b];
+                        term = {a.node(), b.node(), 0, true, true};
+                        if (target_sorting) {
+                            term.update_i = !target_nodes[term.i];
+                            term.update_j = !target_nodes[term.j];
+                            if (!term.update_i && !term.update_j) {
+                                // counted as a term update, but it doesn't move anything
+                                return true;
+                            }
+                        }
+                        term.d_ij = std::abs(static_cast<double>(a.pos) - static_cast<double>(b.pos));
+                        return term.d_ij != 0;
+                    };
+                    auto apply = [&](const path_sgd_term_t &term) {
+                        return path_sgd_update(X, term, eta);
+                    };
+                    const double Delta_max = deterministic_sgd_iteration<path_sgd_term_t>(
+                            schedule, seed, iteration, min_term_updates, nthreads, sample, apply);
+                    if (progress) {
+                        progress_meter->increment(min_term_updates);
+                    }
+                    if (iteration == iter_max) {
+                        break;
+                    }
+                    if (Delta_max <= delta) {
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd] delta_max: " << Delta_max
+                                      << " <= delta: "
+                                      << delta << ". Threshold reached, therefore ending iterations."
+                                      << std::endl;
+                        }
+                        break;
+                    }
+                    if (convergence.plateau_iterations > 0 && path_sgd_plateaued(state, stress(X), convergence)) {
+                        // the schedule goes on at a lower learning rate, or ends
+                        const uint64_t end = iter_max + 1;
+                        const uint64_t next = path_sgd_after_plateau(etas, iteration, end);
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd] stress: " << state.best_stress
+                                      << " hasn't improved in " << convergence.plateau_iterations << " iterations. Plateau reached, therefore "
+                                      << (next < end ? "continuing at iteration " + std::to_string(next) : std::string("ending iterations"))
+                                      << "." << std::endl;
+                        }
+                        if (next == end) {
+                            break;
+                        }
+                        iteration = next - 1;
+                        state.since_best = 0;
+                    }
+                    if (snapshot) {
+                        std::cerr << "[odgi::path_linear_sgd] Taking snapshot!" << std::endl;
+                        std::string snapshot_tmp_file = xp::temp_file::create("snapshot");
+                        ofstream snapshot_stream;
+                        snapshot_stream.open(snapshot_tmp_file);
+                        for (auto &x : X) {
+                            snapshot_stream << (double)x.load() << std::endl;
+                        }
+                        snapshots.push_back(snapshot_tmp_file);
+                    }
+                }
+            }
+
+            if (progress) {
+                progress_meter->finish();
+            }
+
+            std::vector<double> X_final(X.size());
+            uint64_t i = 0;
+            for (auto &x : X) {
+                X_final[i++] = x.load();
+            }
+            return X_final;
+        }
+
+        std::vector<double> path_linear_sgd(const graph_t &graph,
+                                            const xp::XP &path_index,
+                                            const std::vector<path_handle_t> &path_sgd_use_paths,
+                                            const uint64_t &iter_max,
+                                            const uint64_t &iter_with_max_learning_rate,
+                                            const uint64_t &min_term_updates,
+                                            const double &delta,
+                                            const double &eps,
+                                            const double &eta_max,
+                                            const double &theta,
+                                            const uint64_t &space,
+                                            const uint64_t &space_max,
+                                            const uint64_t &space_quantization_step,
+                                            const double &cooling_start,
+                                            const uint64_t &nthreads,
+                                            const bool &progress,
+                                            const bool &snapshot,
+                                            std::vector<std::string> &snapshots,
+											const bool &target_sorting,
+											std::vector<bool>& target_nodes,
+											const bool &single_precision,
+											const bool &deterministic,
+											const std::string &seed,
+											const bool &multilevel,
+											const path_sgd_convergence_t &convergence) {
+            // a multilevel layout hands the graph over already laid out at the scale of its merged node pairs,
+            // leaving a short run at a small learning rate to refine it
+            // nb: the merged nodes know nothing of the target nodes, so target sorting always runs flat
+            std::vector<double> X_init;
+            uint64_t refine_iter_max = iter_max;
+            uint64_t refine_iter_with_max_learning_rate = iter_with_max_learning_rate;
+            double refine_eta_max = eta_max;
+            if (multilevel && !target_sorting) {
+                X_init.resize(graph.get_node_count());
+                uint64_t len = 0;
+                graph.for_each_handle([&](const handle_t &handle) {
+                    X_init[number_bool_packing::unpack_number(handle)] = len;
+                    len += graph.get_length(handle);
+                });
+                if (path_linear_sgd_multilevel(graph, iter_max, min_term_updates, eps, eta_max, theta,
+                                               space, space_max, space_quantization_step, cooling_start,
+                                               nthreads, progress, seed, X_init, refine_eta_max)) {
+                    refine_iter_max = path_sgd_refine_iter_max(iter_max);
+                    refine_iter_with_max_learning_rate = 0;
+                } else {
+                    X_init.clear();
+                }
+            }
+            if (deterministic) {
+                if (single_precision) {
+                    return path_linear_sgd_deterministic<float>(graph, path_index, path_sgd_use_paths, refine_iter_max,
+                                                                refine_iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                                                refine_eta_max, theta, space, space_max, space_quantization_step,
+                                                                cooling_start, nthreads, progress, snapshot, snapshots,
+                                                                target_sorting, target_nodes, seed, X_init, convergence);
+                } else {
+                    return path_linear_sgd_deterministic<double>(graph, path_index, path_sgd_use_paths, refine_iter_max,
+                                                                 refine_iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                                                 refine_eta_max, theta, space, space_max, space_quantization_step,
+                                                                 cooling_start, nthreads, progress, snapshot, snapshots,
+                                                                 target_sorting, target_nodes, seed, X_init, convergence);
+                }
+            }
+            if (single_precision) {
+                return path_linear_sgd_hogwild<float>(graph, path_index, path_sgd_use_paths, refine_iter_max,
+                                                      refine_iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                                      refine_eta_max, theta, space, space_max, space_quantization_step,
+                                                      cooling_start, nthreads, progress, snapshot, snapshots,
+                                                      target_sorting, target_nodes, X_init, convergence);
+            } else {
+                return path_linear_sgd_hogwild<double>(graph, path_index, path_sgd_use_paths, refine_iter_max,
+                                                       refine_iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                                       refine_eta_max, theta, space, space_max, space_quantization_step,
+                                                       cooling_start, nthreads, progress, snapshot, snapshots,
+                                                       target_sorting, target_nodes, X_init, convergence);
+            }
+        }
+
         std::vector<double> path_linear_sgd_schedule(const double &w_min,
                                                      const double &w_max,
                                                      const uint64_t &iter_max,
@@ -523,7 +762,11 @@ namespace odgi {
                                                     const bool &write_layout,
                                                     const std::string &layout_out,
 													const bool &target_sorting,
-													std::vector<bool>& target_nodes) {
+													std::vector<bool>& target_nodes,
+													const bool &single_precision,
+													const bool &deterministic,
+													const bool &multilevel,
+													const path_sgd_convergence_t &convergence) {
             std::vector<string> snapshots;
             std::vector<double> layout = path_linear_sgd(graph,
                                                          path_index,
@@ -544,7 +787,12 @@ namespace odgi {
                                                          snapshot,
                                                          snapshots,
 														 target_sorting,
-														 target_nodes);
+														 target_nodes,
+														 single_precision,
+														 deterministic,
+														 seed,
+														 multilevel,
+														 convergence);
             // TODO move the following into its own function that we can reuse
 #ifdef debug_components
             std::cerr << "node count: " << graph.get_node_count() << std::endl;
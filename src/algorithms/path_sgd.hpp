@@ -22,6 +22,8 @@
 #include "XoshiroCpp.hpp"
 #include "progress.hpp"
 #include "utils.hpp"
+#include "deterministic_sgd.hpp"
+#include "path_sgd_convergence.hpp"
 
 #include <fstream>
 
@@ -36,7 +38,152 @@ struct handle_layout_t {
     handle_t handle = as_handle(0);
 };
 
+/// A path step as PG-SGD sees it: its handle and the offset in bp at which it starts in its path
+struct path_sgd_step_t {
+    handle_t handle;
+    uint64_t pos;
+    inline uint64_t node(void) const { return number_bool_packing::unpack_number(handle); }
+};
+
+/// The steps of all paths laid out path after path, so that PG-SGD terms can be drawn and resolved
+/// with a few array reads instead of queries to the succinct path index
+struct path_sgd_steps_t {
+    /// index of the first step of each path in step, with a final entry holding the step total
+    std::vector<uint64_t> path_begin;
+    std::vector<path_sgd_step_t> step;
+    inline uint64_t step_count(void) const { return step.size(); }
+    inline uint64_t path_step_count(const uint64_t& p) const { return path_begin[p + 1] - path_begin[p]; }
+    /// the path, as its rank in path_begin, that holds step s
+    inline uint64_t path_of(const uint64_t& s) const {
+        return std::upper_bound(path_begin.begin(), path_begin.end(), s) - path_begin.begin() - 1;
+    }
+};
+
+/// collect the steps of all paths of the graph
+path_sgd_steps_t path_sgd_steps(const PathHandleGraph &graph, const uint64_t &nthreads);
+
+/// the zetas of the zipf distributions over jumps of up to space steps, quantized beyond space_max
+std::vector<double> path_sgd_zetas(const uint64_t &space,
+                                   const uint64_t &space_max,
+                                   const uint64_t &space_quantization_step,
+                                   const double &theta);
+
+/// Draw the partner of step_a, which is in path path_i, from the same path: while cooling, and in half of the
+/// draws otherwise, a zipf distributed number of steps away from step_a, else anywhere in the path
+template<typename Gen>
+inline uint64_t path_sgd_partner(const path_sgd_steps_t &steps,
+                                 const uint64_t &step_a,
+                                 const uint64_t &path_i,
+                                 const bool &cooling,
+                                 const double &theta,
+                                 const std::vector<double> &zetas,
+                                 const uint64_t &space,
+                                 const uint64_t &space_max,
+                                 const uint64_t &space_quantization_step,
+                                 Gen &gen) {
+    std::uniform_int_distribution<uint64_t> flip(0, 1);
+    const uint64_t path_step_count = steps.path_step_count(path_i);
+    const uint64_t s_rank = step_a - steps.path_begin[path_i]; // step rank in path
+    if (cooling || flip(gen)) {
+        const bool backward = s_rank > 0 && flip(gen) || s_rank == path_step_count - 1;
+        uint64_t jump_space = std::min(space, backward ? s_rank : path_step_count - s_rank - 1);
+        uint64_t zeta_i = jump_space;
+        if (jump_space > space_max) {
+            zeta_i = space_max + (jump_space - space_max) / space_quantization_step + 1;
+        }
+        dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, theta, zetas[zeta_i]);
+        dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
+        const uint64_t z_i = z(gen);
+        return backward ? step_a - z_i : step_a + z_i;
+    } else {
+        // sample randomly across the path
+        std::uniform_int_distribution<uint64_t> rando(0, path_step_count - 1);
+        return steps.path_begin[path_i] + rando(gen);
+    }
+}
+
+/// A fixed sample of pairs of path steps, drawn as the PG-SGD terms are, over which the normalized stress of a layout
+/// is estimated: the mean squared relative difference between the distances of the pairs in the layout and in their path
+class path_sgd_stress_t {
+public:
+    /// pairs in a sample
+    const static uint64_t PAIRS = 10000;
+
+    path_sgd_stress_t(const path_sgd_steps_t &steps,
+                      const double &theta,
+                      const std::vector<double> &zetas,
+                      const uint64_t &space,
+                      const uint64_t &space_max,
+                      const uint64_t &space_quantization_step);
+
+    /// the stress of 1D positions of the nodes
+    template<typename pos_t>
+    double operator()(const std::vector<std::atomic<pos_t>> &X) const {
+        double stress = 0;
+        for (auto &pair : pairs) {
+            const double dist = std::abs((double)X[number_bool_packing::unpack_number(pair.a)].load(std::memory_order_relaxed)
+                                         - (double)X[number_bool_packing::unpack_number(pair.b)].load(std::memory_order_relaxed));
+            stress += (dist - pair.d) * (dist - pair.d) / (pair.d * pair.d);
+        }
+        return pairs.empty() ? 0 : stress / (double)pairs.size();
+    }
+
+    /// the stress of 2D positions of both ends of the nodes, taking the end each step enters its node at
+    double operator()(const std::vector<std::atomic<double>> &X, const std::vector<std::atomic<double>> &Y) const;
+
+private:
+    struct pair_t {
+        handle_t a;
+        handle_t b;
+        double d;
+    };
+    std::vector<pair_t> pairs;
+};
+
+/// a sampled term: the node ranks of its two steps and their distance in the path
+struct path_sgd_term_t {
+    uint64_t i;
+    uint64_t j;
+    double d_ij;
+    bool update_i;
+    bool update_j;
+};
+
+/// move the nodes of a term towards their distance in the path, returning the size of the move
+template<typename pos_t>
+inline double path_sgd_update(std::vector<std::atomic<pos_t>> &X, const path_sgd_term_t &term, const double &eta) {
+    if (!term.update_i && !term.update_j) {
+        return 0;
+    }
+    double mu = eta / term.d_ij;
+    if (mu > 1) {
+        mu = 1;
+    }
+    // distance == magnitude in our 1D situation
+    double dx = (double)X[term.i].load(std::memory_order_relaxed)
+            - (double)X[term.j].load(std::memory_order_relaxed);
+    if (dx == 0) {
+        dx = 1e-9; // avoid nan
+    }
+    double mag = std::abs(dx);
+    // check distances for early stopping
+    double Delta = mu * (mag - term.d_ij) / 2;
+    // calculate update
+    double r_x = Delta / mag * dx;
+    if (term.update_i) {
+        X[term.i].store(X[term.i].load(std::memory_order_relaxed) - r_x, std::memory_order_relaxed);
+    }
+    if (term.update_j) {
+        X[term.j].store(X[term.j].load(std::memory_order_relaxed) + r_x, std::memory_order_relaxed);
+    }
+    return std::abs(Delta);
+}
+
 /// use SGD driven, by path guided, and partly zipfian distribution sampled pairwise distances to obtain a 1D linear layout of the graph that respects its topology
+/// positions are kept in single precision if asked to, halving the memory traffic of the lock-free (Hogwild!) updates
+/// in deterministic mode, the result depends only on the seed and not on the number of threads or their timing
+/// in multilevel mode, the layout starts from that of the graph's nodes merged along the paths (see path_sgd_multilevel.hpp)
+/// the run stops early once the stress of the layout reaches a plateau, if convergence asks for it
 std::vector<double> path_linear_sgd(const graph_t &graph,
                                     const xp::XP &path_index,
                                     const std::vector<path_handle_t>& path_sgd_use_paths,
@@ -54,7 +201,14 @@ std::vector<double> path_linear_sgd(const graph_t &graph,
                                     const uint64_t &nthreads,
                                     const bool &progress,
                                     const bool &snapshot,
-                                    std::vector<std::string> &snapshots);
+                                    std::vector<std::string> &snapshots,
+                                    const bool &target_sorting,
+                                    std::vector<bool>& target_nodes,
+                                    const bool &single_precision,
+                                    const bool &deterministic,
+                                    const std::string &seed,
+                                    const bool &multilevel,
+                                    const path_sgd_convergence_t &convergence);
 
 /// our learning schedule
 std::vector<double> path_linear_sgd_schedule(const double &w_min,
@@ -85,7 +239,11 @@ std::vector<handle_t> path_linear_sgd_order(const graph_t &graph,
                                             const bool &write_layout,
                                             const std::string &layout_out,
 											const bool &target_sorting,
-											std::vector<bool>& target_nodes);
+											std::vector<bool>& target_nodes,
+											const bool &single_precision,
+											const bool &deterministic,
+											const bool &multilevel,
+											const path_sgd_convergence_t &convergence);
 
 }
 
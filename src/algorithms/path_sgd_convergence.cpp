@@ -0,0 +1,134 @@
+#include "path_sgd_convergence.hpp"
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+namespace odgi {
+    namespace algorithms {
+
+        /// Starts every checkpoint file, followed by its version
+        const static std::string PATH_SGD_CHECKPOINT_MAGIC = "ODGISGDC";
+        const static uint64_t PATH_SGD_CHECKPOINT_VERSION = 1;
+
+        bool path_sgd_plateaued(path_sgd_schedule_state_t &state,
+                                const double &stress,
+                                const path_sgd_convergence_t &convergence) {
+            if (stress < state.best_stress * (1.0 - convergence.plateau_tolerance)) {
+                state.best_stress = stress;
+                state.since_best = 0;
+            } else {
+                state.best_stress = std::min(state.best_stress, stress);
+                ++state.since_best;
+            }
+            return convergence.plateau_iterations > 0 && state.since_best >= convergence.plateau_iterations;
+        }
+
+        uint64_t path_sgd_after_plateau(const std::vector<double> &etas,
+                                        const uint64_t &iteration,
+                                        const uint64_t &end) {
+            if (etas[iteration] <= 1) {
+                return end;
+            }
+            uint64_t next = iteration + 1;
+            while (next < end && etas[next] > etas[iteration] / 2) {
+                ++next;
+            }
+            return next;
+        }
+
+        template<typename T>
+        static void write_value(std::ostream &out, const T &value) {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        static T read_value(std::istream &in) {
+            T value;
+            in.read(reinterpret_cast<char *>(&value), sizeof(T));
+            return value;
+        }
+
+        void path_sgd_write_checkpoint(const std::string &file,
+                                       const path_sgd_schedule_state_t &state,
+                                       const bool &deterministic,
+                                       const uint64_t &seed,
+                                       const std::vector<std::atomic<double>> &X,
+                                       const std::vector<std::atomic<double>> &Y) {
+            const std::string tmp_file = file + ".tmp";
+            {
+                std::ofstream out(tmp_file, std::ios::binary);
+                out.write(PATH_SGD_CHECKPOINT_MAGIC.data(), PATH_SGD_CHECKPOINT_MAGIC.size());
+                write_value(out, PATH_SGD_CHECKPOINT_VERSION);
+                write_value(out, (uint64_t)X.size());
+                write_value(out, (uint8_t)deterministic);
+                write_value(out, seed);
+                write_value(out, state.iteration);
+                write_value(out, state.iter_max);
+                write_value(out, state.iter_with_max_learning_rate);
+                write_value(out, state.eta_max);
+                write_value(out, state.best_stress);
+                write_value(out, state.since_best);
+                for (auto &x : X) {
+                    write_value(out, x.load());
+                }
+                for (auto &y : Y) {
+                    write_value(out, y.load());
+                }
+                if (!out) {
+                    throw std::runtime_error("[odgi::algorithms::path_sgd] error: could not write checkpoint " + tmp_file + ".");
+                }
+            }
+            if (std::rename(tmp_file.c_str(), file.c_str()) != 0) {
+                throw std::runtime_error("[odgi::algorithms::path_sgd] error: could not move checkpoint " + tmp_file + " to " + file + ".");
+            }
+        }
+
+        bool path_sgd_read_checkpoint(const std::string &file,
+                                      path_sgd_schedule_state_t &state,
+                                      bool &deterministic,
+                                      uint64_t &seed,
+                                      std::vector<std::atomic<double>> &X,
+                                      std::vector<std::atomic<double>> &Y) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                return false;
+            }
+            std::string magic(PATH_SGD_CHECKPOINT_MAGIC.size(), ' ');
+            in.read(&magic[0], magic.size());
+            if (magic != PATH_SGD_CHECKPOINT_MAGIC) {
+                throw std::runtime_error("[odgi::algorithms::path_sgd] error: " + file + " is not a PG-SGD checkpoint.");
+            }
+            const uint64_t version = read_value<uint64_t>(in);
+            if (version != PATH_SGD_CHECKPOINT_VERSION) {
+                throw std::runtime_error("[odgi::algorithms::path_sgd] error: PG-SGD checkpoint " + file + " has unknown version "
+                                         + std::to_string(version) + ".");
+            }
+            const uint64_t size = read_value<uint64_t>(in);
+            if (size != X.size() || size != Y.size()) {
+                throw std::runtime_error("[odgi::algorithms::path_sgd] error: PG-SGD checkpoint " + file + " holds "
+                                         + std::to_string(size / 2) + " nodes, but the graph has "
+                                         + std::to_string(X.size() / 2) + ".");
+            }
+            deterministic = read_value<uint8_t>(in);
+            seed = read_value<uint64_t>(in);
+            state.iteration = read_value<uint64_t>(in);
+            state.iter_max = read_value<uint64_t>(in);
+            state.iter_with_max_learning_rate = read_value<uint64_t>(in);
+            state.eta_max = read_value<double>(in);
+            state.best_stress = read_value<double>(in);
+            state.since_best = read_value<uint64_t>(in);
+            for (auto &x : X) {
+                x.store(read_value<double>(in));
+            }
+            for (auto &y : Y) {
+                y.store(read_value<double>(in));
+            }
+            if (!in) {
+                throw std::runtime_error("[odgi::algorithms::path_sgd] error: PG-SGD checkpoint " + file + " is truncated.");
+            }
+            return true;
+        }
+
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+ * \file path_sgd_convergence.hpp
+ *
+ * When a PG-SGD run has converged, and how it is resumed: the schedule state of a run, the plateau test on
+ * its estimated stress, and binary checkpoints of the state together with the node positions
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <limits>
+
+namespace odgi {
+namespace algorithms {
+
+/// Where a PG-SGD run is in its learning schedule, and how its stress developed so far
+struct path_sgd_schedule_state_t {
+    /// the next iteration to run
+    uint64_t iteration = 0;
+    /// the schedule the run follows
+    uint64_t iter_max = 0;
+    uint64_t iter_with_max_learning_rate = 0;
+    double eta_max = 0;
+    /// lowest stress seen so far, and iterations since it last improved
+    double best_stress = std::numeric_limits<double>::max();
+    uint64_t since_best = 0;
+};
+
+/// How a PG-SGD run decides that it has converged, and where it keeps checkpoints
+struct path_sgd_convergence_t {
+    /// speed up the schedule, and in the end stop, once the stress hasn't improved by plateau_tolerance,
+    /// relative to its best, in this many iterations (0: never)
+    uint64_t plateau_iterations = 0;
+    double plateau_tolerance = 0.001;
+    /// write a checkpoint to this file every checkpoint_interval iterations (none if empty)
+    /// nb: only the 2D layout takes checkpoints
+    std::string checkpoint;
+    uint64_t checkpoint_interval = 1;
+    /// continue a run from this state, whose positions the caller has already restored
+    bool resume = false;
+    path_sgd_schedule_state_t resume_state;
+};
+
+/// Record the stress after an iteration, returning true if it has stopped improving
+bool path_sgd_plateaued(path_sgd_schedule_state_t &state,
+                        const double &stress,
+                        const path_sgd_convergence_t &convergence);
+
+/// Where a schedule with the given learning rates goes on after its stress reached a plateau in the given iteration:
+/// to the next iteration with at most half the learning rate, since a plateau at a high learning rate only means that
+/// the terms keep undoing each other, or to end, the number of iterations in the schedule, once the learning rate is
+/// down to 1, below which no term is pulled all the way to its distance in the path anymore
+uint64_t path_sgd_after_plateau(const std::vector<double> &etas,
+                                const uint64_t &iteration,
+                                const uint64_t &end);
+
+/// Write the state of a 2D layout run along with the positions of both ends of its nodes, under a temporary name
+/// that then replaces the file, so that a run preempted while writing leaves the last checkpoint intact
+void path_sgd_write_checkpoint(const std::string &file,
+                               const path_sgd_schedule_state_t &state,
+                               const bool &deterministic,
+                               const uint64_t &seed,
+                               const std::vector<std::atomic<double>> &X,
+                               const std::vector<std::atomic<double>> &Y);
+
+/// Read a checkpoint into the state and positions, whose sizes it must match. Returns false if there is no such file,
+/// and throws std::runtime_error if it isn't a checkpoint of a layout of the same size.
+bool path_sgd_read_checkpoint(const std::string &file,
+                              path_sgd_schedule_state_t &state,
+                              bool &deterministic,
+                              uint64_t &seed,
+                              std::vector<std::atomic<double>> &X,
+                              std::vector<std::atomic<double>> &Y);
+
+}
+}
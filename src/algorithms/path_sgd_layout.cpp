@@ -1,9 +1,188 @@
 #include "path_sgd_layout.hpp"
 #include "algorithms/layout.hpp"
+#include "path_sgd_multilevel.hpp"
 
 namespace odgi {
     namespace algorithms {
 
+        /// write a checkpoint, warning instead of giving up the run if it can't be written
+        static void path_sgd_layout_checkpoint(const std::string &file,
+                                               const path_sgd_schedule_state_t &state,
+                                               const bool &deterministic,
+                                               const uint64_t &seed,
+                                               const std::vector<std::atomic<double>> &X,
+                                               const std::vector<std::atomic<double>> &Y) {
+            try {
+                path_sgd_write_checkpoint(file, state, deterministic, seed, X, Y);
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << " Continuing without this checkpoint." << std::endl;
+            }
+        }
+
+        /// the iterations run one after the other, each drawing its terms from random streams of the seed
+        /// and applying them in conflict-free blocks of nodes, which gives the same layout with any number of threads
+        static void path_linear_sgd_layout_deterministic(const PathHandleGraph &graph,
+                                                         const xp::XP &path_index,
+                                                         const std::vector<path_handle_t> &path_sgd_use_paths,
+                                                         const uint64_t &iter_max,
+                                                         const uint64_t &iter_with_max_learning_rate,
+                                                         const uint64_t &min_term_updates,
+                                                         const double &delta,
+                                                         const double &eps,
+                                                         const double &eta_max,
+                                                         const double &theta,
+                                                         const uint64_t &space,
+                                                         const uint64_t &space_max,
+                                                         const uint64_t &space_quantization_step,
+                                                         const double &cooling_start,
+                                                         const uint64_t &nthreads,
+                                                         const bool &progress,
+                                                         const bool &snapshot,
+                                                         const std::string &snapshot_prefix,
+                                                         const std::string &seeding_string,
+                                                         const path_sgd_convergence_t &convergence,
+                                                         std::vector<std::atomic<double>> &X,
+                                                         std::vector<std::atomic<double>> &Y) {
+            uint64_t first_cooling_iteration = std::floor(cooling_start * (double)iter_max);
+            path_sgd_schedule_state_t state = convergence.resume ? convergence.resume_state
+                    : path_sgd_schedule_state_t{0, iter_max, iter_with_max_learning_rate, eta_max};
+            uint64_t total_term_updates = (iter_max - std::min(state.iteration, iter_max)) * min_term_updates;
+            std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+            if (progress) {
+                progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                    total_term_updates, "[odgi::path_linear_sgd_layout] 2D path-guided SGD (deterministic):");
+            }
+            bool at_least_one_path_with_more_than_one_step = false;
+            for (auto &path : path_sgd_use_paths) {
+                if (path_index.get_path_step_count(path) > 1){
+                    at_least_one_path_with_more_than_one_step = true;
+                    break;
+                }
+            }
+
+            if (at_least_one_path_with_more_than_one_step && state.iteration < iter_max) {
+                double w_min = (double) 1.0 / (double) (eta_max);
+                double w_max = 1.0;
+                std::vector<double> etas = path_linear_sgd_layout_schedule(w_min, w_max, iter_max,
+                                                                           iter_with_max_learning_rate,
+                                                                           eps);
+                std::vector<double> zetas = path_sgd_zetas(space, space_max, space_quantization_step, theta);
+                const path_sgd_steps_t steps = path_sgd_steps(graph, nthreads);
+                const sgd_block_schedule_t schedule(graph.get_node_count());
+                const uint64_t seed = sgd_seed(seeding_string);
+                const path_sgd_stress_t stress(steps, theta, zetas, space, space_max, space_quantization_step);
+
+                for (uint64_t iteration = state.iteration; iteration < iter_max; ++iteration) {
+                    const double eta = etas[iteration];
+                    const bool cooling = iteration > first_cooling_iteration;
+                    auto sample = [&](XoshiroCpp::Xoshiro256Plus &gen, path_sgd_layout_term_t &term) {
+                        std::uniform_int_distribution<uint64_t> flip(0, 1);
+                        const uint64_t step_a = std::uniform_int_distribution<uint64_t>(0, steps.step_count() - 1)(gen);
+                        const uint64_t path_i = steps.path_of(step_a);
+                        if (steps.path_step_count(path_i) == 1) {
+                            return false;
+                        }
+                        // nb: the zipf keeps the full theta here, as in the lock-free workers
+                        const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, cooling, theta, zetas,
+                                                                 space, space_max, space_quantization_step, gen);
+                        const path_sgd_step_t &a = steps.step[step_a];
+                        const path_sgd_step_t &b = steps.step[step_b];
+                        // determine which end we're working with for each node
+                        uint64_t pos_in_path_a = a.pos;
+                        uint64_t pos_in_path_b = b.pos;
+                        const bool term_i_is_rev = graph.get_is_reverse(a.handle);
+                        bool use_other_end_a = flip(gen); // 1 == +; 0 == -
+                        if (use_other_end_a) {
+                            pos_in_path_a += graph.get_length(a.handle);
+                            // flip back if we were already reversed
+                            use_other_end_a = !term_i_is_rev;
+                        } else {
+                            use_other_end_a = term_i_is_rev;
+                        }
+                        const bool term_j_is_rev = graph.get_is_reverse(b.handle);
+                        bool use_other_end_b = flip(gen); // 1 == +; 0 == -
+                        if (use_other_end_b) {
+                            pos_in_path_b += graph.get_length(b.handle);
+                            // flip back if we were already reversed
+                            use_other_end_b = !term_j_is_rev;
+                        } else {
+                            use_other_end_b = term_j_is_rev;
+                        }
+                        term.i = a.node();
+                        term.j = b.node();
+                        term.offset_i = use_other_end_a ? 1 : 0;
+                        term.offset_j = use_other_end_b ? 1 : 0;
+                        term.d_ij = std::abs(static_cast<double>(pos_in_path_a) - static_cast<double>(pos_in_path_b));
+                        if (term.d_ij == 0) {
+                            term.d_ij = 1e-9;
+                        }
+                        return true;
+                    };
+                    auto apply = [&](const path_sgd_layout_term_t &term) {
+                        return path_sgd_layout_update(X, Y, term, eta);
+                    };
+                    const double Delta_max = deterministic_sgd_iteration<path_sgd_layout_term_t>(
+                            schedule, seed, iteration, min_term_updates, nthreads, sample, apply);
+                    if (progress) {
+                        progress_meter->increment(min_term_updates);
+                    }
+                    if (iteration + 1 == iter_max) {
+                        break;
+                    }
+                    if (Delta_max <= delta) {
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd_layout] delta_max: " << Delta_max
+                                      << " <= delta: "
+                                      << delta << ". Threshold reached, therefore ending iterations."
+                                      << std::endl;
+                        }
+                        break;
+                    }
+                    if (convergence.plateau_iterations > 0 && path_sgd_plateaued(state, stress(X, Y), convergence)) {
+                        // the schedule goes on at a lower learning rate, or ends
+                        const uint64_t end = iter_max;
+                        const uint64_t next = path_sgd_after_plateau(etas, iteration, end);
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd_layout] stress: " << state.best_stress
+                                      << " hasn't improved in " << convergence.plateau_iterations << " iterations. Plateau reached, therefore "
+                                      << (next < end ? "continuing at iteration " + std::to_string(next) : std::string("ending iterations"))
+                                      << "." << std::endl;
+                        }
+                        if (next == end) {
+                            break;
+                        }
+                        iteration = next - 1;
+                        state.since_best = 0;
+                    }
+                    if (!convergence.checkpoint.empty() && (iteration + 1) % convergence.checkpoint_interval == 0) {
+                        // resuming from here gives the same layout as running on
+                        state.iteration = iteration + 1;
+                        path_sgd_layout_checkpoint(convergence.checkpoint, state, true, seed, X, Y);
+                    }
+                    if (snapshot) {
+                        std::cerr << "[odgi::path_linear_sgd_layout] Taking snapshot!" << std::endl;
+                        std::vector<double> X_iter(X.size());
+                        uint64_t i = 0;
+                        for (auto &x : X) {
+                            X_iter[i++] = x.load();
+                        }
+                        std::vector<double> Y_iter(Y.size());
+                        i = 0;
+                        for (auto &y : Y) {
+                            Y_iter[i++] = y.load();
+                        }
+                        algorithms::layout::Layout layout(X_iter, Y_iter);
+                        ofstream snapshot_out(snapshot_prefix + std::to_string(iteration + 1));
+                        layout.serialize(snapshot_out);
+                    }
+                }
+            }
+
+            if (progress) {
+                progress_meter->finish();
+            }
+        }
+
         void path_linear_sgd_layout(const PathHandleGraph &graph,
                                     const xp::XP &path_index,
                                     const std::vector<path_handle_t> &path_sgd_use_paths,
@@ -22,8 +201,47 @@ namespace odgi {
                                     const bool &progress,
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
+                                    const bool &deterministic,
+                                    const bool &multilevel,
+                                    const std::string &seeding_string,
+                                    const path_sgd_convergence_t &convergence,
                                     std::vector<std::atomic<double>> &X,
                                     std::vector<std::atomic<double>> &Y) {
+            if (convergence.resume) {
+                // a resumed run follows the schedule it was started with, which for a multilevel run is its refinement
+                const path_sgd_schedule_state_t &resume = convergence.resume_state;
+                if (multilevel || iter_max != resume.iter_max || eta_max != resume.eta_max
+                    || iter_with_max_learning_rate != resume.iter_with_max_learning_rate) {
+                    path_linear_sgd_layout(graph, path_index, path_sgd_use_paths, resume.iter_max,
+                                           resume.iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                           resume.eta_max, theta, space, space_max, space_quantization_step,
+                                           cooling_start, nthreads, progress, snapshot, snapshot_prefix,
+                                           deterministic, false, seeding_string, convergence, X, Y);
+                    return;
+                }
+            }
+            if (multilevel) {
+                // lay out the graph's nodes merged along the paths, then refine at a small learning rate
+                double refine_eta_max = eta_max;
+                if (path_linear_sgd_layout_multilevel(graph, iter_max, min_term_updates, eps, eta_max, theta,
+                                                      space, space_max, space_quantization_step, cooling_start,
+                                                      nthreads, progress, seeding_string, X, Y, refine_eta_max)) {
+                    path_linear_sgd_layout(graph, path_index, path_sgd_use_paths, path_sgd_refine_iter_max(iter_max),
+                                           0, min_term_updates, delta, eps, refine_eta_max, theta,
+                                           space, space_max, space_quantization_step, cooling_start, nthreads,
+                                           progress, snapshot, snapshot_prefix, deterministic, false,
+                                           seeding_string, convergence, X, Y);
+                    return;
+                }
+            }
+            if (deterministic) {
+                path_linear_sgd_layout_deterministic(graph, path_index, path_sgd_use_paths, iter_max,
+                                                     iter_with_max_learning_rate, min_term_updates, delta, eps,
+                                                     eta_max, theta, space, space_max, space_quantization_step,
+                                                     cooling_start, nthreads, progress, snapshot, snapshot_prefix,
+                                                     seeding_string, convergence, X, Y);
+                return;
+            }
 #ifdef debug_path_sgd
             std::cerr << "iter_max: " << iter_max << std::endl;
             std::cerr << "min_term_updates: " << min_term_updates << std::endl;
@@ -39,7 +257,9 @@ namespace odgi {
             uint64_t first_cooling_iteration = std::floor(cooling_start * (double)iter_max);
             //std::cerr << "first cooling iteration " << first_cooling_iteration << std::endl;
 
-            uint64_t total_term_updates = iter_max * min_term_updates;
+            path_sgd_schedule_state_t state = convergence.resume ? convergence.resume_state
+                    : path_sgd_schedule_state_t{0, iter_max, iter_with_max_learning_rate, eta_max};
+            uint64_t total_term_updates = (iter_max - std::min(state.iteration, iter_max)) * min_term_updates;
             std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
             if (progress) {
                 progress_meter = std::make_unique<progress_meter::ProgressMeter>(
@@ -53,7 +273,7 @@ namespace odgi {
             // here we record which snapshots were already processed
             std::vector<atomic<bool>> snapshot_progress(iter_max);
             // we will produce one less snapshot compared to iterations
-            snapshot_progress[0].store(true);
+            snapshot_progress[std::min(state.iteration, iter_max - 1)].store(true);
             // seed them with the graph order
             uint64_t len = 0;
             // the longest path length measured in nucleotides
@@ -71,7 +291,7 @@ namespace odgi {
             }
 
 
-            if (at_least_one_path_with_more_than_one_step){
+            if (at_least_one_path_with_more_than_one_step && state.iteration < iter_max){
                 double w_min = (double) 1.0 / (double) (eta_max);
 
 #ifdef debug_path_sgd
@@ -96,18 +316,26 @@ namespace odgi {
                     }
                 }
 
+                // the stress, for the plateau test
+                // nb: these workers read the path index, so the path steps are only collected to draw its pairs
+                std::unique_ptr<path_sgd_stress_t> stress;
+                if (convergence.plateau_iterations > 0) {
+                    stress = std::make_unique<path_sgd_stress_t>(path_sgd_steps(graph, nthreads), theta, zetas,
+                                                                 space, space_max, space_quantization_step);
+                }
+
                 // how many term updates we make
                 std::atomic<uint64_t> term_updates;
                 term_updates.store(0);
                 // learning rate
                 std::atomic<double> eta;
-                eta.store(etas.front());
+                eta.store(etas[state.iteration]);
                 // adaptive zip theta
                 std::atomic<double> adj_theta;
-                adj_theta.store(theta);
+                adj_theta.store(state.iteration > first_cooling_iteration ? 0.001 : theta);
                 // if we're in a final cooling phase (last 10%) of iterations
                 std::atomic<bool> cooling;
-                cooling.store(false);
+                cooling.store(state.iteration > first_cooling_iteration);
                 // our max delta
                 std::atomic<double> Delta_max;
                 Delta_max.store(0);
@@ -115,7 +343,7 @@ namespace odgi {
                 std::atomic<bool> work_todo;
                 work_todo.store(true);
                 // approximately what iteration we're on
-                uint64_t iteration = 0;
+                uint64_t iteration = state.iteration;
                 // launch a thread to update the learning rate, count iterations, and decide when to stop
                 auto checker_lambda =
                         [&]() {
@@ -137,6 +365,20 @@ namespace odgi {
                                         iteration++;
                                         snapshot_in_progress.store(false);
                                     }
+                                    if (iteration < iter_max && convergence.plateau_iterations > 0
+                                        && path_sgd_plateaued(state, (*stress)(X, Y), convergence)) {
+                                        // the schedule goes on at a lower learning rate, or ends
+                                        const uint64_t end = iter_max;
+                                        const uint64_t next = path_sgd_after_plateau(etas, iteration - 1, end);
+                                        if (progress) {
+                                            std::cerr << "[odgi::path_linear_sgd_layout] stress: " << state.best_stress
+                                                      << " hasn't improved in " << convergence.plateau_iterations << " iterations. Plateau reached, therefore "
+                                                      << (next < end ? "continuing at iteration " + std::to_string(next) : std::string("ending iterations"))
+                                                      << "." << std::endl;
+                                        }
+                                        iteration = next;
+                                        state.since_best = 0;
+                                    }
                                     if (iteration >= iter_max) {
                                         work_todo.store(false);
                                     } else if (Delta_max.load() <= delta) { // nb: this will also break at 0
@@ -155,6 +397,11 @@ namespace odgi {
                                             adj_theta.store(0.001);
                                             cooling.store(true);
                                         }
+                                        if (!convergence.checkpoint.empty() && iteration % convergence.checkpoint_interval == 0) {
+                                            // nb: the workers go on meanwhile, so this is as consistent as the layout ever is
+                                            state.iteration = iteration;
+                                            path_sgd_layout_checkpoint(convergence.checkpoint, state, false, 0, X, Y);
+                                        }
                                     }
                                     term_updates.store(0);
                                 }
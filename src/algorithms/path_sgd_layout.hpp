@@ -19,13 +19,53 @@
 #include "dirty_zipfian_int_distribution.h"
 #include "XoshiroCpp.hpp"
 #include "progress.hpp"
+#include "path_sgd.hpp"
 
 namespace odgi {
     namespace algorithms {
 
         using namespace handlegraph;
 
+/// a 2D term: the node ranks, which of their ends are pulled together, and how far apart the ends are in the path
+        struct path_sgd_layout_term_t {
+            uint64_t i;
+            uint64_t j;
+            uint64_t offset_i;
+            uint64_t offset_j;
+            double d_ij;
+        };
+
+/// move the ends of a term towards their distance in the path, returning the size of the move
+        inline double path_sgd_layout_update(std::vector<std::atomic<double>> &X,
+                                             std::vector<std::atomic<double>> &Y,
+                                             const path_sgd_layout_term_t &term,
+                                             const double &eta) {
+            double mu = std::min(eta / term.d_ij, 1.0);
+            auto &x_i = X[2 * term.i + term.offset_i];
+            auto &y_i = Y[2 * term.i + term.offset_i];
+            auto &x_j = X[2 * term.j + term.offset_j];
+            auto &y_j = Y[2 * term.j + term.offset_j];
+            double dx = x_i.load(std::memory_order_relaxed) - x_j.load(std::memory_order_relaxed);
+            double dy = y_i.load(std::memory_order_relaxed) - y_j.load(std::memory_order_relaxed);
+            if (dx == 0) {
+                dx = 1e-9; // avoid nan
+            }
+            double mag = sqrt(dx * dx + dy * dy);
+            double Delta = mu * (mag - term.d_ij) / 2;
+            double r = Delta / mag;
+            double r_x = r * dx;
+            double r_y = r * dy;
+            x_i.store(x_i.load(std::memory_order_relaxed) - r_x, std::memory_order_relaxed);
+            y_i.store(y_i.load(std::memory_order_relaxed) - r_y, std::memory_order_relaxed);
+            x_j.store(x_j.load(std::memory_order_relaxed) + r_x, std::memory_order_relaxed);
+            y_j.store(y_j.load(std::memory_order_relaxed) + r_y, std::memory_order_relaxed);
+            return std::abs(Delta);
+        }
+
 /// use SGD driven, by path guided, and partly zipfian distribution sampled pairwise distances to obtain a 1D linear layout of the graph that respects its topology
+/// in deterministic mode, the result depends only on the seeding string and not on the number of threads or their timing
+/// in multilevel mode, the layout starts from that of the graph's nodes merged along the paths (see path_sgd_multilevel.hpp)
+/// the run stops early once the stress of the layout reaches a plateau, takes checkpoints, and resumes from one, as convergence asks
         void path_linear_sgd_layout(const PathHandleGraph &graph,
                                     const xp::XP &path_index,
                                     const std::vector<path_handle_t> &path_sgd_use_paths,
@@ -44,6 +84,10 @@ namespace odgi {
                                     const bool &progress,
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
+                                    const bool &deterministic,
+                                    const bool &multilevel,
+                                    const std::string &seeding_string,
+                                    const path_sgd_convergence_t &convergence,
                                     std::vector<std::atomic<double>> &X,
                                     std::vector<std::atomic<double>> &Y);
 
@@ -0,0 +1,429 @@
+#include "path_sgd_multilevel.hpp"
+#include <handlegraph/util.hpp>
+#include <limits>
+
+namespace odgi {
+    namespace algorithms {
+
+        /// levels stop being coarsened at this many nodes
+        const static uint64_t PATH_SGD_COARSEST_NODES = 1000;
+        /// a level that keeps more than this share of the nodes of the level below isn't worth its work
+        const static double PATH_SGD_MIN_SHRINK = 0.9;
+        /// the refinement of a level moves its nodes by up to about this many nodes of the level above
+        const static double PATH_SGD_REFINE_SPAN = 4.0;
+
+        /// merge the nodes of the given steps pairwise where they follow each other in a path
+        static path_sgd_level_t path_sgd_coarsen_level(const path_sgd_steps_t &steps,
+                                                       const std::vector<uint64_t> &length,
+                                                       const uint64_t &nthreads) {
+            const uint64_t unmatched = std::numeric_limits<uint64_t>::max();
+            const uint64_t path_count = steps.path_begin.size() - 1;
+            path_sgd_level_t level;
+            level.parent.assign(length.size(), unmatched);
+            level.offset.assign(length.size(), 0);
+            // first come first served along the paths
+            // nb: sequential, so that the levels don't depend on the number of threads
+            for (uint64_t p = 0; p < path_count; ++p) {
+                for (uint64_t s = steps.path_begin[p]; s + 1 < steps.path_begin[p + 1]; ++s) {
+                    const uint64_t u = steps.step[s].node();
+                    const uint64_t v = steps.step[s + 1].node();
+                    if (u != v && level.parent[u] == unmatched && level.parent[v] == unmatched) {
+                        level.parent[u] = level.node_count;
+                        level.parent[v] = level.node_count;
+                        level.offset[v] = length[u];
+                        level.length.push_back(length[u] + length[v]);
+                        ++level.node_count;
+                    }
+                }
+            }
+            for (uint64_t u = 0; u < length.size(); ++u) {
+                if (level.parent[u] == unmatched) {
+                    level.parent[u] = level.node_count++;
+                    level.length.push_back(length[u]);
+                }
+            }
+            // the paths through the merged nodes, where a path entering a node starts it
+            auto is_entry = [&](const uint64_t &p, const uint64_t &s) {
+                return s == steps.path_begin[p]
+                    || level.parent[steps.step[s].node()] != level.parent[steps.step[s - 1].node()];
+            };
+            level.steps.path_begin.resize(path_count + 1);
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+            for (uint64_t p = 0; p < path_count; ++p) {
+                uint64_t count = 0;
+                for (uint64_t s = steps.path_begin[p]; s < steps.path_begin[p + 1]; ++s) {
+                    count += is_entry(p, s);
+                }
+                level.steps.path_begin[p + 1] = count;
+            }
+            level.steps.path_begin[0] = 0;
+            for (uint64_t p = 0; p < path_count; ++p) {
+                level.steps.path_begin[p + 1] += level.steps.path_begin[p];
+            }
+            level.steps.step.resize(level.steps.path_begin[path_count]);
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+            for (uint64_t p = 0; p < path_count; ++p) {
+                uint64_t c = level.steps.path_begin[p];
+                for (uint64_t s = steps.path_begin[p]; s < steps.path_begin[p + 1]; ++s) {
+                    if (is_entry(p, s)) {
+                        level.steps.step[c++] = {number_bool_packing::pack(level.parent[steps.step[s].node()], false),
+                                                 steps.step[s].pos};
+                    }
+                }
+            }
+            return level;
+        }
+
+        std::vector<path_sgd_level_t> path_sgd_coarsen(const path_sgd_steps_t &steps,
+                                                       const std::vector<uint64_t> &length,
+                                                       const uint64_t &min_nodes,
+                                                       const uint64_t &nthreads) {
+            std::vector<path_sgd_level_t> levels;
+            const path_sgd_steps_t *below_steps = &steps;
+            const std::vector<uint64_t> *below_length = &length;
+            while (below_length->size() > min_nodes) {
+                path_sgd_level_t level = path_sgd_coarsen_level(*below_steps, *below_length, nthreads);
+                if (level.node_count > PATH_SGD_MIN_SHRINK * below_length->size()) {
+                    break;
+                }
+                levels.push_back(std::move(level));
+                below_steps = &levels.back().steps;
+                below_length = &levels.back().length;
+            }
+            return levels;
+        }
+
+        uint64_t path_sgd_refine_iter_max(const uint64_t &iter_max) {
+            return std::max(iter_max / 4, std::min(iter_max, (uint64_t)2));
+        }
+
+        /// learning rate of the refinement of the level below the given one, which lets a term pull its nodes
+        /// all the way together only within a few nodes of the given level
+        static double path_sgd_refine_eta_max(const path_sgd_level_t &above) {
+            double total_length = 0;
+            for (auto &l : above.length) {
+                total_length += l;
+            }
+            return std::max(1.0, PATH_SGD_REFINE_SPAN * total_length / (double)above.node_count);
+        }
+
+        static bool path_sgd_has_terms(const path_sgd_steps_t &steps) {
+            for (uint64_t p = 0; p + 1 < steps.path_begin.size(); ++p) {
+                if (steps.path_step_count(p) > 1) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// the nodes of the graph in rank order with their lengths, and the steps of its paths
+        static void path_sgd_graph_level(const PathHandleGraph &graph,
+                                         const uint64_t &nthreads,
+                                         path_sgd_steps_t &steps,
+                                         std::vector<uint64_t> &length) {
+            steps = path_sgd_steps(graph, nthreads);
+            length.resize(graph.get_node_count());
+            graph.for_each_handle([&](const handle_t &h) {
+                // nb: as in PG-SGD, we assume a compact handle set
+                length[number_bool_packing::unpack_number(h)] = graph.get_length(h);
+            });
+        }
+
+        /// lay out the nodes of one level in 1D, starting from X
+        static void path_linear_sgd_level(const path_sgd_level_t &level,
+                                          const uint64_t &level_rank,
+                                          const uint64_t &iter_max,
+                                          const uint64_t &n_terms,
+                                          const double &eps,
+                                          const double &eta_max,
+                                          const double &theta,
+                                          const std::vector<double> &zetas,
+                                          const uint64_t &space,
+                                          const uint64_t &space_max,
+                                          const uint64_t &space_quantization_step,
+                                          const double &cooling_start,
+                                          const uint64_t &nthreads,
+                                          const uint64_t &seed,
+                                          std::vector<std::atomic<double>> &X) {
+            if (!path_sgd_has_terms(level.steps)) {
+                return;
+            }
+            const uint64_t first_cooling_iteration = std::floor(cooling_start * (double)iter_max);
+            const std::vector<double> etas = path_linear_sgd_schedule(1.0 / eta_max, 1.0, iter_max, 0, eps);
+            const sgd_block_schedule_t schedule(level.node_count);
+            const uint64_t level_seed = sgd_stream_seed(seed, level_rank, ~(uint64_t)0 - 1);
+            const path_sgd_steps_t &steps = level.steps;
+            for (uint64_t iteration = 0; iteration < iter_max; ++iteration) {
+                const double eta = etas[iteration];
+                const bool cooling = iteration > first_cooling_iteration;
+                const double adj_theta = cooling ? 0.001 : theta;
+                auto sample = [&](XoshiroCpp::Xoshiro256Plus &gen, path_sgd_term_t &term) {
+                    const uint64_t step_a = std::uniform_int_distribution<uint64_t>(0, steps.step_count() - 1)(gen);
+                    const uint64_t path_i = steps.path_of(step_a);
+                    if (steps.path_step_count(path_i) == 1) {
+                        return false;
+                    }
+                    const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, cooling, adj_theta, zetas,
+                                                             space, space_max, space_quantization_step, gen);
+                    const path_sgd_step_t &a = steps.step[step_a];
+                    const path_sgd_step_t &b = steps.step[step_b];
+                    term = {a.node(), b.node(), std::abs(static_cast<double>(a.pos) - static_cast<double>(b.pos)), true, true};
+                    return term.d_ij != 0;
+                };
+                auto apply = [&](const path_sgd_term_t &term) {
+                    return path_sgd_update(X, term, eta);
+                };
+                deterministic_sgd_iteration<path_sgd_term_t>(schedule, level_seed, iteration, n_terms, nthreads, sample, apply);
+            }
+        }
+
+        /// lay out both ends of the nodes of one level in 2D, starting from X and Y
+        static void path_linear_sgd_layout_level(const path_sgd_level_t &level,
+                                                 const uint64_t &level_rank,
+                                                 const uint64_t &iter_max,
+                                                 const uint64_t &n_terms,
+                                                 const double &eps,
+                                                 const double &eta_max,
+                                                 const double &theta,
+                                                 const std::vector<double> &zetas,
+                                                 const uint64_t &space,
+                                                 const uint64_t &space_max,
+                                                 const uint64_t &space_quantization_step,
+                                                 const double &cooling_start,
+                                                 const uint64_t &nthreads,
+                                                 const uint64_t &seed,
+                                                 std::vector<std::atomic<double>> &X,
+                                                 std::vector<std::atomic<double>> &Y) {
+            if (!path_sgd_has_terms(level.steps)) {
+                return;
+            }
+            const uint64_t first_cooling_iteration = std::floor(cooling_start * (double)iter_max);
+            const std::vector<double> etas = path_linear_sgd_layout_schedule(1.0 / eta_max, 1.0, iter_max, 0, eps);
+            const sgd_block_schedule_t schedule(level.node_count);
+            const uint64_t level_seed = sgd_stream_seed(seed, level_rank, ~(uint64_t)0 - 1);
+            const path_sgd_steps_t &steps = level.steps;
+            for (uint64_t iteration = 0; iteration < iter_max; ++iteration) {
+                const double eta = etas[iteration];
+                const bool cooling = iteration > first_cooling_iteration;
+                auto sample = [&](XoshiroCpp::Xoshiro256Plus &gen, path_sgd_layout_term_t &term) {
+                    std::uniform_int_distribution<uint64_t> flip(0, 1);
+                    const uint64_t step_a = std::uniform_int_distribution<uint64_t>(0, steps.step_count() - 1)(gen);
+                    const uint64_t path_i = steps.path_of(step_a);
+                    if (steps.path_step_count(path_i) == 1) {
+                        return false;
+                    }
+                    const uint64_t step_b = path_sgd_partner(steps, step_a, path_i, cooling, theta, zetas,
+                                                             space, space_max, space_quantization_step, gen);
+                    const path_sgd_step_t &a = steps.step[step_a];
+                    const path_sgd_step_t &b = steps.step[step_b];
+                    term.i = a.node();
+                    term.j = b.node();
+                    // the merged nodes are all forward, so the other end is the one a length further
+                    term.offset_i = flip(gen);
+                    term.offset_j = flip(gen);
+                    const double pos_a = a.pos + term.offset_i * level.length[term.i];
+                    const double pos_b = b.pos + term.offset_j * level.length[term.j];
+                    term.d_ij = std::abs(pos_a - pos_b);
+                    if (term.d_ij == 0) {
+                        term.d_ij = 1e-9;
+                    }
+                    return true;
+                };
+                auto apply = [&](const path_sgd_layout_term_t &term) {
+                    return path_sgd_layout_update(X, Y, term, eta);
+                };
+                deterministic_sgd_iteration<path_sgd_layout_term_t>(schedule, level_seed, iteration, n_terms, nthreads, sample, apply);
+            }
+        }
+
+        /// terms of each iteration on a level, in proportion to its steps
+        static uint64_t path_sgd_level_terms(const uint64_t &min_term_updates,
+                                             const path_sgd_level_t &level,
+                                             const uint64_t &graph_step_count) {
+            return std::max((uint64_t)1, (uint64_t)((double)min_term_updates
+                                                    * (double)level.steps.step_count() / (double)graph_step_count));
+        }
+
+        bool path_linear_sgd_multilevel(const PathHandleGraph &graph,
+                                        const uint64_t &iter_max,
+                                        const uint64_t &min_term_updates,
+                                        const double &eps,
+                                        const double &eta_max,
+                                        const double &theta,
+                                        const uint64_t &space,
+                                        const uint64_t &space_max,
+                                        const uint64_t &space_quantization_step,
+                                        const double &cooling_start,
+                                        const uint64_t &nthreads,
+                                        const bool &progress,
+                                        const std::string &seeding_string,
+                                        std::vector<double> &X,
+                                        double &refine_eta_max) {
+            path_sgd_steps_t steps;
+            std::vector<uint64_t> length;
+            path_sgd_graph_level(graph, nthreads, steps, length);
+            const std::vector<path_sgd_level_t> levels = path_sgd_coarsen(steps, length, PATH_SGD_COARSEST_NODES, nthreads);
+            if (levels.empty()) {
+                return false;
+            }
+            const std::vector<double> zetas = path_sgd_zetas(space, space_max, space_quantization_step, theta);
+            const uint64_t seed = sgd_seed(seeding_string);
+            // the starting positions of each level are those of the first node of each of its merged nodes
+            std::vector<std::vector<double>> starts(levels.size());
+            const std::vector<double> *below = &X;
+            for (uint64_t l = 0; l < levels.size(); ++l) {
+                starts[l].resize(levels[l].node_count);
+                for (uint64_t u = 0; u < below->size(); ++u) {
+                    if (levels[l].offset[u] == 0) {
+                        starts[l][levels[l].parent[u]] = (*below)[u];
+                    }
+                }
+                below = &starts[l];
+            }
+            // lay out the levels top down, each starting from the one above
+            std::vector<std::atomic<double>> X_above;
+            for (uint64_t l = levels.size(); l-- > 0;) {
+                const path_sgd_level_t &level = levels[l];
+                std::vector<std::atomic<double>> X_level(level.node_count);
+                if (l + 1 == levels.size()) {
+                    for (uint64_t c = 0; c < level.node_count; ++c) {
+                        X_level[c].store(starts[l][c]);
+                    }
+                } else {
+                    const path_sgd_level_t &above = levels[l + 1];
+                    for (uint64_t c = 0; c < level.node_count; ++c) {
+                        X_level[c].store(X_above[above.parent[c]].load() + above.offset[c]);
+                    }
+                }
+                const bool coarsest = l + 1 == levels.size();
+                const uint64_t level_iter_max = coarsest ? iter_max : path_sgd_refine_iter_max(iter_max);
+                const double level_eta_max = coarsest ? eta_max : path_sgd_refine_eta_max(levels[l + 1]);
+                const uint64_t level_terms = path_sgd_level_terms(min_term_updates, level, steps.step_count());
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] multilevel: laying out level " << l + 1 << " of " << levels.size()
+                              << " with " << level.node_count << " nodes and " << level.steps.step_count() << " steps" << std::endl;
+                }
+                path_linear_sgd_level(level, l, level_iter_max, level_terms, eps, level_eta_max, theta, zetas,
+                                      space, space_max, space_quantization_step, cooling_start, nthreads, seed, X_level);
+                X_above.swap(X_level);
+            }
+            for (uint64_t u = 0; u < X.size(); ++u) {
+                X[u] = X_above[levels[0].parent[u]].load() + levels[0].offset[u];
+            }
+            refine_eta_max = path_sgd_refine_eta_max(levels[0]);
+            return true;
+        }
+
+        bool path_linear_sgd_layout_multilevel(const PathHandleGraph &graph,
+                                               const uint64_t &iter_max,
+                                               const uint64_t &min_term_updates,
+                                               const double &eps,
+                                               const double &eta_max,
+                                               const double &theta,
+                                               const uint64_t &space,
+                                               const uint64_t &space_max,
+                                               const uint64_t &space_quantization_step,
+                                               const double &cooling_start,
+                                               const uint64_t &nthreads,
+                                               const bool &progress,
+                                               const std::string &seeding_string,
+                                               std::vector<std::atomic<double>> &X,
+                                               std::vector<std::atomic<double>> &Y,
+                                               double &refine_eta_max) {
+            path_sgd_steps_t steps;
+            std::vector<uint64_t> length;
+            path_sgd_graph_level(graph, nthreads, steps, length);
+            const std::vector<path_sgd_level_t> levels = path_sgd_coarsen(steps, length, PATH_SGD_COARSEST_NODES, nthreads);
+            if (levels.empty()) {
+                return false;
+            }
+            const std::vector<double> zetas = path_sgd_zetas(space, space_max, space_quantization_step, theta);
+            const uint64_t seed = sgd_seed(seeding_string);
+            // the starting ends of a merged node are the start of its first and the end of its last node
+            std::vector<std::vector<double>> starts_X(levels.size());
+            std::vector<std::vector<double>> starts_Y(levels.size());
+            std::vector<double> graph_X(X.size());
+            std::vector<double> graph_Y(Y.size());
+            for (uint64_t i = 0; i < X.size(); ++i) {
+                graph_X[i] = X[i].load();
+                graph_Y[i] = Y[i].load();
+            }
+            const std::vector<double> *below_X = &graph_X;
+            const std::vector<double> *below_Y = &graph_Y;
+            const std::vector<uint64_t> *below_length = &length;
+            for (uint64_t l = 0; l < levels.size(); ++l) {
+                const path_sgd_level_t &level = levels[l];
+                starts_X[l].resize(2 * level.node_count);
+                starts_Y[l].resize(2 * level.node_count);
+                for (uint64_t u = 0; u < below_length->size(); ++u) {
+                    const uint64_t c = level.parent[u];
+                    if (level.offset[u] == 0) {
+                        starts_X[l][2 * c] = (*below_X)[2 * u];
+                        starts_Y[l][2 * c] = (*below_Y)[2 * u];
+                    }
+                    if (level.offset[u] + (*below_length)[u] == level.length[c]) {
+                        starts_X[l][2 * c + 1] = (*below_X)[2 * u + 1];
+                        starts_Y[l][2 * c + 1] = (*below_Y)[2 * u + 1];
+                    }
+                }
+                below_X = &starts_X[l];
+                below_Y = &starts_Y[l];
+                below_length = &level.length;
+            }
+            // place the ends of the nodes below a merged node along the line between its ends
+            auto prolong = [](const path_sgd_level_t &above,
+                              const std::vector<uint64_t> &below_length,
+                              const std::vector<std::atomic<double>> &X_above,
+                              const std::vector<std::atomic<double>> &Y_above,
+                              std::vector<std::atomic<double>> &X_below,
+                              std::vector<std::atomic<double>> &Y_below) {
+                for (uint64_t u = 0; u < below_length.size(); ++u) {
+                    const uint64_t c = above.parent[u];
+                    const double x_0 = X_above[2 * c].load();
+                    const double y_0 = Y_above[2 * c].load();
+                    const double x_1 = X_above[2 * c + 1].load();
+                    const double y_1 = Y_above[2 * c + 1].load();
+                    const double f_0 = (double)above.offset[u] / (double)std::max(above.length[c], (uint64_t)1);
+                    const double f_1 = (double)(above.offset[u] + below_length[u]) / (double)std::max(above.length[c], (uint64_t)1);
+                    X_below[2 * u].store(x_0 + f_0 * (x_1 - x_0));
+                    Y_below[2 * u].store(y_0 + f_0 * (y_1 - y_0));
+                    X_below[2 * u + 1].store(x_0 + f_1 * (x_1 - x_0));
+                    Y_below[2 * u + 1].store(y_0 + f_1 * (y_1 - y_0));
+                }
+            };
+            // lay out the levels top down, each starting from the one above
+            std::vector<std::atomic<double>> X_above;
+            std::vector<std::atomic<double>> Y_above;
+            for (uint64_t l = levels.size(); l-- > 0;) {
+                const path_sgd_level_t &level = levels[l];
+                std::vector<std::atomic<double>> X_level(2 * level.node_count);
+                std::vector<std::atomic<double>> Y_level(2 * level.node_count);
+                const bool coarsest = l + 1 == levels.size();
+                if (coarsest) {
+                    for (uint64_t i = 0; i < 2 * level.node_count; ++i) {
+                        X_level[i].store(starts_X[l][i]);
+                        Y_level[i].store(starts_Y[l][i]);
+                    }
+                } else {
+                    prolong(levels[l + 1], level.length, X_above, Y_above, X_level, Y_level);
+                }
+                const uint64_t level_iter_max = coarsest ? iter_max : path_sgd_refine_iter_max(iter_max);
+                const double level_eta_max = coarsest ? eta_max : path_sgd_refine_eta_max(levels[l + 1]);
+                const uint64_t level_terms = path_sgd_level_terms(min_term_updates, level, steps.step_count());
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd_layout] multilevel: laying out level " << l + 1 << " of " << levels.size()
+                              << " with " << level.node_count << " nodes and " << level.steps.step_count() << " steps" << std::endl;
+                }
+                path_linear_sgd_layout_level(level, l, level_iter_max, level_terms, eps, level_eta_max, theta, zetas,
+                                             space, space_max, space_quantization_step, cooling_start, nthreads, seed,
+                                             X_level, Y_level);
+                X_above.swap(X_level);
+                Y_above.swap(Y_level);
+            }
+            prolong(levels[0], length, X_above, Y_above, X, Y);
+            refine_eta_max = path_sgd_refine_eta_max(levels[0]);
+            return true;
+        }
+
+    }
+}
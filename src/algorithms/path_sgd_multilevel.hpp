@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ * \file path_sgd_multilevel.hpp
+ *
+ * Multilevel PG-SGD: the nodes are merged pairwise along the paths, level after level, the coarsest
+ * level is laid out with the full learning schedule, and every finer level starts from the layout of
+ * the level above it, so that it only has to refine it at a short range
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <handlegraph/path_handle_graph.hpp>
+#include "path_sgd.hpp"
+#include "path_sgd_layout.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// One level of a PG-SGD hierarchy, whose nodes each hold one or two nodes of the level below
+struct path_sgd_level_t {
+    uint64_t node_count = 0;
+    /// length in bp of each node
+    std::vector<uint64_t> length;
+    /// for each node of the level below, the node of this level that holds it
+    std::vector<uint64_t> parent;
+    /// for each node of the level below, where it starts in bp in the node that holds it
+    std::vector<uint64_t> offset;
+    /// the paths as walks through the nodes of this level
+    path_sgd_steps_t steps;
+};
+
+/// Merge the nodes of the given steps pairwise along the paths into coarser and coarser levels,
+/// until a level has no more than min_nodes nodes or hardly shrinks anymore
+std::vector<path_sgd_level_t> path_sgd_coarsen(const path_sgd_steps_t &steps,
+                                               const std::vector<uint64_t> &length,
+                                               const uint64_t &min_nodes,
+                                               const uint64_t &nthreads);
+
+/// iterations of each refinement of a multilevel layout
+uint64_t path_sgd_refine_iter_max(const uint64_t &iter_max);
+
+/// 1D multilevel PG-SGD: replace X, the positions of the graph's nodes, by the layout of the coarse levels,
+/// and set the learning rate at which the graph itself should then be refined.
+/// Returns false, leaving X as it is, if the graph is too small to be coarsened.
+bool path_linear_sgd_multilevel(const PathHandleGraph &graph,
+                                const uint64_t &iter_max,
+                                const uint64_t &min_term_updates,
+                                const double &eps,
+                                const double &eta_max,
+                                const double &theta,
+                                const uint64_t &space,
+                                const uint64_t &space_max,
+                                const uint64_t &space_quantization_step,
+                                const double &cooling_start,
+                                const uint64_t &nthreads,
+                                const bool &progress,
+                                const std::string &seeding_string,
+                                std::vector<double> &X,
+                                double &refine_eta_max);
+
+/// 2D multilevel PG-SGD: replace X and Y, the positions of both ends of the graph's nodes, by the layout
+/// of the coarse levels, and set the learning rate at which the graph itself should then be refined.
+/// Returns false, leaving X and Y as they are, if the graph is too small to be coarsened.
+bool path_linear_sgd_layout_multilevel(const PathHandleGraph &graph,
+                                       const uint64_t &iter_max,
+                                       const uint64_t &min_term_updates,
+                                       const double &eps,
+                                       const double &eta_max,
+                                       const double &theta,
+                                       const uint64_t &space,
+                                       const uint64_t &space_max,
+                                       const uint64_t &space_quantization_step,
+                                       const double &cooling_start,
+                                       const uint64_t &nthreads,
+                                       const bool &progress,
+                                       const std::string &seeding_string,
+                                       std::vector<std::atomic<double>> &X,
+                                       std::vector<std::atomic<double>> &Y,
+                                       double &refine_eta_max);
+
+}
+}
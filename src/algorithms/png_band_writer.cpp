@@ -0,0 +1,588 @@
+#include "png_band_writer.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <limits>
+#include <queue>
+
+namespace odgi {
+    namespace png {
+
+        /// Writes bits into bytes starting from their lowest bit, the order deflate packs them in
+        struct bit_writer_t {
+            std::vector<uint8_t> &out;
+            uint64_t buffer = 0;
+            uint8_t count = 0;
+
+            explicit bit_writer_t(std::vector<uint8_t> &_out) : out(_out) {}
+
+            void put(const uint32_t &bits, const uint8_t &n) {
+                buffer |= (uint64_t) bits << count;
+                count += n;
+                while (count >= 8) {
+                    out.push_back(buffer & 0xff);
+                    buffer >>= 8;
+                    count -= 8;
+                }
+            }
+
+            void align() {
+                if (count > 0) {
+                    out.push_back(buffer & 0xff);
+                    buffer = 0;
+                    count = 0;
+                }
+            }
+        };
+
+        /// Huffman codes go into the stream from their highest bit on, so we keep them reversed
+        static uint32_t reverse_bits(uint32_t code, const uint8_t &n) {
+            uint32_t reversed = 0;
+            for (uint8_t i = 0; i < n; ++i) {
+                reversed = (reversed << 1) | (code & 1);
+                code >>= 1;
+            }
+            return reversed;
+        }
+
+        /// Code lengths of a Huffman code for the symbols with the given frequencies, none longer than max_bits. Symbols
+        /// that never occur get no code. While the tree is too deep, the frequencies are halved and it is built again.
+        static void huffman_lengths(const uint64_t *freq, const uint16_t &n, const uint8_t &max_bits, uint8_t *lengths) {
+            std::vector<uint64_t> f(freq, freq + n);
+            while (true) {
+                // leaves are the symbols that occur, and every node that joins two others comes after both
+                std::vector<uint16_t> symbol;
+                std::priority_queue<std::pair<uint64_t, uint32_t>,
+                                    std::vector<std::pair<uint64_t, uint32_t>>,
+                                    std::greater<>> queue;
+                for (uint16_t s = 0; s < n; ++s) {
+                    lengths[s] = 0;
+                    if (f[s] > 0) {
+                        queue.push({f[s], symbol.size()});
+                        symbol.push_back(s);
+                    }
+                }
+                if (symbol.size() == 1) {
+                    lengths[symbol[0]] = 1;
+                    return;
+                }
+                std::vector<uint32_t> parent(symbol.size(), 0);
+                while (queue.size() > 1) {
+                    const auto a = queue.top();
+                    queue.pop();
+                    const auto b = queue.top();
+                    queue.pop();
+                    parent[a.second] = parent[b.second] = parent.size();
+                    parent.push_back(0);
+                    queue.push({a.first + b.first, parent.size() - 1});
+                }
+                // the root is the last node, and the depth of the others follows from their parents
+                std::vector<uint8_t> depth(parent.size(), 0);
+                uint8_t max_depth = 0;
+                for (uint64_t i = parent.size() - 1; i-- > 0; ) {
+                    depth[i] = depth[parent[i]] + 1;
+                    max_depth = std::max(max_depth, depth[i]);
+                }
+                if (max_depth <= max_bits) {
+                    for (uint64_t i = 0; i < symbol.size(); ++i) {
+                        lengths[symbol[i]] = depth[i];
+                    }
+                    return;
+                }
+                for (auto &x : f) {
+                    x = x > 0 ? (x + 1) / 2 : 0;
+                }
+            }
+        }
+
+        /// The canonical Huffman codes for the given code lengths, reversed
+        static void canonical_codes(const uint8_t *lengths, const uint16_t &n, uint32_t *codes) {
+            uint32_t count[16] = {0};
+            for (uint16_t s = 0; s < n; ++s) {
+                ++count[lengths[s]];
+            }
+            count[0] = 0;
+            uint32_t next[16] = {0};
+            uint32_t code = 0;
+            for (uint8_t bits = 1; bits < 16; ++bits) {
+                code = (code + count[bits - 1]) << 1;
+                next[bits] = code;
+            }
+            for (uint16_t s = 0; s < n; ++s) {
+                codes[s] = lengths[s] > 0 ? reverse_bits(next[lengths[s]]++, lengths[s]) : 0;
+            }
+        }
+
+        /// The Huffman codes of a block, reversed, with their lengths
+        struct block_codes_t {
+            std::array<uint32_t, 288> literal;
+            std::array<uint8_t, 288> literal_bits;
+            std::array<uint32_t, 30> distance;
+            std::array<uint8_t, 30> distance_bits;
+
+            void assign() {
+                canonical_codes(literal_bits.data(), 288, literal.data());
+                canonical_codes(distance_bits.data(), 30, distance.data());
+            }
+        };
+
+        /// The fixed Huffman codes of deflate
+        struct fixed_codes_t : public block_codes_t {
+            fixed_codes_t() {
+                for (uint32_t s = 0; s < 288; ++s) {
+                    literal_bits[s] = s < 144 ? 8 : (s < 256 ? 9 : (s < 280 ? 7 : 8));
+                }
+                distance_bits.fill(5);
+                assign();
+            }
+        };
+
+        static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                   8193, 12289, 16385, 24577};
+        static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        /// the order in which the lengths of the code length code are written
+        static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        /// LZ77 parameters: deflate's window and match lengths, and how many earlier positions a match is looked for at
+        const static uint64_t WINDOW_SIZE = 32768;
+        const static uint64_t MIN_MATCH = 3;
+        const static uint64_t MAX_MATCH = 258;
+        const static uint64_t MAX_CHAIN = 32;
+        const static uint8_t HASH_BITS = 15;
+        /// how many literals and matches go into one block, each block getting its own Huffman codes, as zlib does
+        const static uint64_t BLOCK_SYMBOLS = 16384;
+
+        /// A literal, with a distance of 0, or a match
+        struct lz_symbol_t {
+            uint16_t length;
+            uint16_t distance;
+        };
+
+        /// the most bytes a stored block holds
+        const static uint64_t MAX_STORED = 65535;
+
+        /// Write the symbols, which stand for the given bytes, as one block that doesn't end the stream, with Huffman
+        /// codes made for them unless the fixed codes take fewer bits. If the bytes as they are take fewer bits still,
+        /// as they do when they can't be compressed, they go into stored blocks instead, as zlib does.
+        static void write_block(const std::vector<lz_symbol_t> &symbols, const uint8_t *data, const uint64_t &length,
+                                bit_writer_t &bits) {
+            static const fixed_codes_t fixed;
+            // the symbols as codes, and the frequencies of the codes
+            std::vector<std::array<uint16_t, 2>> coded(symbols.size());
+            std::array<uint64_t, 288> literal_freq = {0};
+            std::array<uint64_t, 30> distance_freq = {0};
+            for (uint64_t i = 0; i < symbols.size(); ++i) {
+                const lz_symbol_t &s = symbols[i];
+                if (s.distance == 0) {
+                    coded[i] = {s.length, 0};
+                } else {
+                    const uint16_t l = std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, s.length) - LENGTH_BASE - 1;
+                    const uint16_t d = std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, s.distance) - DISTANCE_BASE - 1;
+                    coded[i] = {(uint16_t) (257 + l), d};
+                    ++distance_freq[d];
+                }
+                ++literal_freq[coded[i][0]];
+            }
+            ++literal_freq[256];
+            // as zlib does, give each tree at least two codes, which some decoders want even if one or none is used
+            auto used = [](const uint64_t *freq, const uint16_t &n) {
+                return std::count_if(freq, freq + n, [](const uint64_t &f) { return f > 0; });
+            };
+            for (uint16_t s = 0; used(literal_freq.data(), 286) < 2; ++s) {
+                literal_freq[s] = std::max(literal_freq[s], (uint64_t) 1);
+            }
+            for (uint16_t s = 0; used(distance_freq.data(), 30) < 2; ++s) {
+                distance_freq[s] = std::max(distance_freq[s], (uint64_t) 1);
+            }
+
+            block_codes_t dynamic;
+            huffman_lengths(literal_freq.data(), 286, 15, dynamic.literal_bits.data());
+            dynamic.literal_bits[286] = dynamic.literal_bits[287] = 0;
+            huffman_lengths(distance_freq.data(), 30, 15, dynamic.distance_bits.data());
+            dynamic.assign();
+
+            // the code lengths of both codes, run length encoded, with the extra bits of the repeats
+            uint16_t literal_count = 286;
+            while (literal_count > 257 && dynamic.literal_bits[literal_count - 1] == 0) {
+                --literal_count;
+            }
+            uint16_t distance_count = 30;
+            while (distance_count > 1 && dynamic.distance_bits[distance_count - 1] == 0) {
+                --distance_count;
+            }
+            std::vector<uint8_t> lengths(dynamic.literal_bits.begin(), dynamic.literal_bits.begin() + literal_count);
+            lengths.insert(lengths.end(), dynamic.distance_bits.begin(), dynamic.distance_bits.begin() + distance_count);
+            std::vector<std::pair<uint8_t, uint8_t>> runs;
+            for (uint64_t i = 0; i < lengths.size(); ) {
+                const uint8_t length = lengths[i];
+                uint64_t run = 1;
+                while (i + run < lengths.size() && lengths[i + run] == length) {
+                    ++run;
+                }
+                i += run;
+                if (length == 0) {
+                    while (run >= 11) {
+                        const uint64_t r = std::min(run, (uint64_t) 138);
+                        runs.push_back({18, r - 11});
+                        run -= r;
+                    }
+                    if (run >= 3) {
+                        runs.push_back({17, run - 3});
+                        run = 0;
+                    }
+                } else {
+                    runs.push_back({length, 0});
+                    --run;
+                    while (run >= 3) {
+                        const uint64_t r = std::min(run, (uint64_t) 6);
+                        runs.push_back({16, r - 3});
+                        run -= r;
+                    }
+                }
+                for (; run > 0; --run) {
+                    runs.push_back({length, 0});
+                }
+            }
+            static const uint8_t RUN_EXTRA[3] = {2, 3, 7};
+            std::array<uint64_t, 19> run_freq = {0};
+            for (auto &r : runs) {
+                ++run_freq[r.first];
+            }
+            std::array<uint8_t, 19> run_bits;
+            std::array<uint32_t, 19> run_codes;
+            huffman_lengths(run_freq.data(), 19, 7, run_bits.data());
+            canonical_codes(run_bits.data(), 19, run_codes.data());
+            uint8_t run_code_count = 19;
+            while (run_code_count > 4 && run_bits[CODE_LENGTH_ORDER[run_code_count - 1]] == 0) {
+                --run_code_count;
+            }
+
+            // the bits either way, leaving out the extra bits of the symbols, which are the same
+            uint64_t fixed_size = 0;
+            uint64_t dynamic_size = 14 + 3 * run_code_count;
+            for (uint16_t s = 0; s < 286; ++s) {
+                fixed_size += literal_freq[s] * fixed.literal_bits[s];
+                dynamic_size += literal_freq[s] * dynamic.literal_bits[s];
+            }
+            for (uint16_t d = 0; d < 30; ++d) {
+                fixed_size += distance_freq[d] * fixed.distance_bits[d];
+                dynamic_size += distance_freq[d] * dynamic.distance_bits[d];
+            }
+            for (auto &r : runs) {
+                dynamic_size += run_bits[r.first] + (r.first >= 16 ? RUN_EXTRA[r.first - 16] : 0);
+            }
+            // stored blocks have no extra bits, but a header each, padding to a byte, and the lengths of the block
+            uint64_t extra_size = 0;
+            for (auto &s : symbols) {
+                if (s.distance > 0) {
+                    const uint16_t l = std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, s.length) - LENGTH_BASE - 1;
+                    const uint16_t d = std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, s.distance) - DISTANCE_BASE - 1;
+                    extra_size += LENGTH_EXTRA[l] + DISTANCE_EXTRA[d];
+                }
+            }
+            const uint64_t stored_size = ((length + MAX_STORED - 1) / MAX_STORED) * (3 + 7 + 32) + 8 * length;
+            if (stored_size < std::min(fixed_size, dynamic_size) + extra_size) {
+                for (uint64_t begin = 0; begin < length; begin += MAX_STORED) {
+                    const uint16_t n = std::min(MAX_STORED, length - begin);
+                    const uint16_t complement = ~n;
+                    bits.put(0, 3);
+                    bits.align();
+                    bits.out.insert(bits.out.end(), {(uint8_t) n, (uint8_t) (n >> 8),
+                                                     (uint8_t) complement, (uint8_t) (complement >> 8)});
+                    bits.out.insert(bits.out.end(), data + begin, data + begin + n);
+                }
+                return;
+            }
+
+            const block_codes_t &codes = dynamic_size < fixed_size ? dynamic : (const block_codes_t &) fixed;
+            bits.put(0, 1);
+            if (dynamic_size < fixed_size) {
+                bits.put(2, 2);
+                bits.put(literal_count - 257, 5);
+                bits.put(distance_count - 1, 5);
+                bits.put(run_code_count - 4, 4);
+                for (uint8_t i = 0; i < run_code_count; ++i) {
+                    bits.put(run_bits[CODE_LENGTH_ORDER[i]], 3);
+                }
+                for (auto &r : runs) {
+                    bits.put(run_codes[r.first], run_bits[r.first]);
+                    if (r.first >= 16) {
+                        bits.put(r.second, RUN_EXTRA[r.first - 16]);
+                    }
+                }
+            } else {
+                bits.put(1, 2);
+            }
+            for (uint64_t i = 0; i < symbols.size(); ++i) {
+                const uint16_t &s = coded[i][0];
+                bits.put(codes.literal[s], codes.literal_bits[s]);
+                if (s > 256) {
+                    const uint16_t l = s - 257;
+                    const uint16_t &d = coded[i][1];
+                    bits.put(symbols[i].length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+                    bits.put(codes.distance[d], codes.distance_bits[d]);
+                    bits.put(symbols[i].distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+                }
+            }
+            bits.put(codes.literal[256], codes.literal_bits[256]);
+        }
+
+        void deflate_sync(const uint8_t *data, const uint64_t &length, std::vector<uint8_t> &out) {
+            bit_writer_t bits(out);
+            std::vector<lz_symbol_t> symbols;
+            symbols.reserve(BLOCK_SYMBOLS);
+
+            std::vector<int64_t> head((uint64_t) 1 << HASH_BITS, -1);
+            std::vector<int64_t> prev(WINDOW_SIZE, -1);
+            auto hash = [&](const uint64_t &i) {
+                return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & (((uint64_t) 1 << HASH_BITS) - 1);
+            };
+            auto insert = [&](const uint64_t &i) {
+                if (i + MIN_MATCH <= length) {
+                    const uint64_t h = hash(i);
+                    prev[i % WINDOW_SIZE] = head[h];
+                    head[h] = i;
+                }
+            };
+
+            uint64_t i = 0;
+            uint64_t block_begin = 0;
+            while (i < length) {
+                // the longest match among the last positions with the same hash
+                uint64_t best_length = 0;
+                uint64_t best_distance = 0;
+                if (i + MIN_MATCH <= length) {
+                    const uint64_t max_length = std::min(MAX_MATCH, length - i);
+                    int64_t candidate = head[hash(i)];
+                    for (uint64_t chain = 0; chain < MAX_CHAIN && candidate >= 0
+                                             && i - candidate <= WINDOW_SIZE; ++chain) {
+                        uint64_t l = 0;
+                        while (l < max_length && data[candidate + l] == data[i + l]) {
+                            ++l;
+                        }
+                        if (l > best_length) {
+                            best_length = l;
+                            best_distance = i - candidate;
+                            if (l == max_length) {
+                                break;
+                            }
+                        }
+                        candidate = prev[candidate % WINDOW_SIZE];
+                    }
+                }
+                if (best_length >= MIN_MATCH) {
+                    symbols.push_back({(uint16_t) best_length, (uint16_t) best_distance});
+                    for (uint64_t j = i; j < i + best_length; ++j) {
+                        insert(j);
+                    }
+                    i += best_length;
+                } else {
+                    symbols.push_back({data[i], 0});
+                    insert(i);
+                    ++i;
+                }
+                if (symbols.size() == BLOCK_SYMBOLS || i == length) {
+                    write_block(symbols, data + block_begin, i - block_begin, bits);
+                    symbols.clear();
+                    block_begin = i;
+                }
+            }
+
+            // an empty stored block brings us to a byte boundary
+            bits.put(0, 1);
+            bits.put(0, 2);
+            bits.align();
+            out.insert(out.end(), {0x00, 0x00, 0xff, 0xff});
+        }
+
+        const static uint32_t ADLER_BASE = 65521;
+
+        uint32_t adler32(uint32_t adler, const uint8_t *data, const uint64_t &length) {
+            uint64_t a = adler & 0xffff;
+            uint64_t b = adler >> 16;
+            uint64_t i = 0;
+            while (i < length) {
+                // sums can't overflow within 5552 bytes, the block zlib takes before reducing them
+                const uint64_t end = std::min(length, i + 5552);
+                for (; i < end; ++i) {
+                    a += data[i];
+                    b += a;
+                }
+                a %= ADLER_BASE;
+                b %= ADLER_BASE;
+            }
+            return (uint32_t) (a | (b << 16));
+        }
+
+        uint32_t adler32_combine(const uint32_t &adler_a, const uint32_t &adler_b, const uint64_t &length_b) {
+            const uint64_t remainder = length_b % ADLER_BASE;
+            uint64_t a = adler_a & 0xffff;
+            uint64_t b = (remainder * a) % ADLER_BASE;
+            a += (adler_b & 0xffff) + ADLER_BASE - 1;
+            b += (adler_a >> 16) + (adler_b >> 16) + ADLER_BASE - remainder;
+            a %= ADLER_BASE;
+            b %= ADLER_BASE;
+            return (uint32_t) (a | (b << 16));
+        }
+
+        static uint32_t crc32(const uint8_t *data, const uint64_t &length, uint32_t crc = 0xffffffff) {
+            static const std::array<uint32_t, 256> table = [] {
+                std::array<uint32_t, 256> t;
+                for (uint32_t n = 0; n < 256; ++n) {
+                    uint32_t c = n;
+                    for (uint8_t k = 0; k < 8; ++k) {
+                        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+                    }
+                    t[n] = c;
+                }
+                return t;
+            }();
+            for (uint64_t i = 0; i < length; ++i) {
+                crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+        static void push_u32(std::vector<uint8_t> &v, const uint32_t &x) {
+            v.push_back(x >> 24);
+            v.push_back(x >> 16);
+            v.push_back(x >> 8);
+            v.push_back(x);
+        }
+
+        /// Filter a row of pixels with whichever of the PNG filters leaves the smallest differences, writing the
+        /// filter type and the filtered bytes to out
+        static void filter_row(const uint8_t *row, const uint8_t *above, const uint64_t &row_bytes, uint8_t *out) {
+            const uint8_t bpp = 3;
+            auto paeth = [](const int16_t &a, const int16_t &b, const int16_t &c) {
+                const int16_t p = a + b - c;
+                const int16_t pa = std::abs(p - a);
+                const int16_t pb = std::abs(p - b);
+                const int16_t pc = std::abs(p - c);
+                return (uint8_t) (pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+            };
+            auto filtered = [&](const uint8_t &type, const uint64_t &i) -> uint8_t {
+                const uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                const uint8_t up = above[i];
+                const uint8_t up_left = i >= bpp ? above[i - bpp] : 0;
+                switch (type) {
+                    case 1: return row[i] - left;
+                    case 2: return row[i] - up;
+                    case 3: return row[i] - (uint8_t) (((uint16_t) left + up) / 2);
+                    case 4: return row[i] - paeth(left, up, up_left);
+                    default: return row[i];
+                }
+            };
+            uint8_t best_type = 0;
+            uint64_t best_sum = std::numeric_limits<uint64_t>::max();
+            for (uint8_t type = 0; type < 5; ++type) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < row_bytes && sum < best_sum; ++i) {
+                    sum += std::abs((int8_t) filtered(type, i));
+                }
+                if (sum < best_sum) {
+                    best_sum = sum;
+                    best_type = type;
+                }
+            }
+            out[0] = best_type;
+            for (uint64_t i = 0; i < row_bytes; ++i) {
+                out[1 + i] = filtered(best_type, i);
+            }
+        }
+
+        band_writer_t::band_writer_t(const std::string &filename,
+                                     const uint64_t &_width,
+                                     const uint64_t &_height,
+                                     const uint64_t &_nthreads)
+                : out(filename, std::ios::binary), width(_width), height(_height), nthreads(std::max(_nthreads, (uint64_t) 1)) {
+            if (!out) {
+                throw std::runtime_error("[odgi::png] error: could not open " + filename + " for writing.");
+            }
+            const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+            out.write((const char *) signature, 8);
+            std::vector<uint8_t> header;
+            push_u32(header, width);
+            push_u32(header, height);
+            // 8 bits per channel, RGB, deflate, adaptive filters, no interlacing
+            header.insert(header.end(), {8, 2, 0, 0, 0});
+            write_chunk("IHDR", header);
+        }
+
+        void band_writer_t::write_chunk(const char *type, const std::vector<uint8_t> &data) {
+            std::vector<uint8_t> length;
+            push_u32(length, data.size());
+            out.write((const char *) length.data(), 4);
+            out.write(type, 4);
+            out.write((const char *) data.data(), data.size());
+            const uint32_t crc = crc32(data.data(), data.size(), crc32((const uint8_t *) type, 4)) ^ 0xffffffff;
+            std::vector<uint8_t> crc_bytes;
+            push_u32(crc_bytes, crc);
+            out.write((const char *) crc_bytes.data(), 4);
+        }
+
+        void band_writer_t::write(const row_fn_t &get_row,
+                                  const uint64_t &rows_per_thread) {
+            const uint64_t row_bytes = 3 * width;
+            // by default, about 4MB of rows for each thread at a time
+            const uint64_t thread_rows = rows_per_thread > 0 ? rows_per_thread
+                                                             : std::max((uint64_t) 1, ((uint64_t) 1 << 22) / (row_bytes + 1));
+            std::vector<std::vector<uint8_t>> compressed(nthreads);
+            std::vector<uint32_t> adlers(nthreads);
+            std::vector<uint64_t> lengths(nthreads);
+
+            // zlib header: deflate with a 32K window, no dictionary
+            std::vector<uint8_t> idat = {0x78, 0x01};
+            uint32_t adler = 1;
+            for (uint64_t band_begin = 0; band_begin < height; band_begin += thread_rows * nthreads) {
+#pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+                for (uint64_t t = 0; t < nthreads; ++t) {
+                    const uint64_t begin = std::min(height, band_begin + t * thread_rows);
+                    const uint64_t end = std::min(height, begin + thread_rows);
+                    compressed[t].clear();
+                    lengths[t] = (end - begin) * (row_bytes + 1);
+                    // each thread also gets the row before its own, which the filters refer to
+                    std::vector<uint8_t> above(row_bytes, 0);
+                    std::vector<uint8_t> row(row_bytes);
+                    std::vector<uint8_t> filtered(lengths[t]);
+                    if (begin > 0 && begin < end) {
+                        get_row(begin - 1, above.data());
+                    }
+                    for (uint64_t y = begin; y < end; ++y) {
+                        get_row(y, row.data());
+                        filter_row(row.data(), above.data(), row_bytes, &filtered[(y - begin) * (row_bytes + 1)]);
+                        std::swap(row, above);
+                    }
+                    adlers[t] = adler32(1, filtered.data(), filtered.size());
+                    if (!filtered.empty()) {
+                        deflate_sync(filtered.data(), filtered.size(), compressed[t]);
+                    }
+                }
+                for (uint64_t t = 0; t < nthreads; ++t) {
+                    adler = adler32_combine(adler, adlers[t], lengths[t]);
+                    idat.insert(idat.end(), compressed[t].begin(), compressed[t].end());
+                }
+                write_chunk("IDAT", idat);
+                idat.clear();
+            }
+
+            // an empty fixed Huffman block ends the stream, followed by the checksum
+            idat.insert(idat.end(), {0x03, 0x00});
+            push_u32(idat, adler);
+            write_chunk("IDAT", idat);
+            write_chunk("IEND", {});
+            out.close();
+            if (!out) {
+                throw std::runtime_error("[odgi::png] error: could not write the PNG image.");
+            }
+        }
+
+    }
+}
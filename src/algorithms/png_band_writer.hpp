@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+
+/**
+ * \file png_band_writer.hpp
+ *
+ * Write a PNG image one band of rows at a time, compressing the rows of each band in parallel, so that neither the
+ * whole uncompressed image nor its compressed stream has to be held in memory
+ *
+ */
+
+namespace odgi {
+namespace png {
+
+/// Streams an 8-bit RGB PNG to a file. Each band of rows is split among the threads, which filter and deflate their
+/// rows on their own into byte-aligned blocks, as pigz does. The blocks then follow each other in one zlib stream,
+/// written as one IDAT chunk per band. odgi doesn't link zlib, and the deflate of lodepng only writes whole streams,
+/// which can't be joined, so the blocks are deflated here.
+class band_writer_t {
+public:
+    /// rows get the RGB pixels of row y, 3 * width bytes, written into them
+    typedef std::function<void(const uint64_t& y, uint8_t* row)> row_fn_t;
+
+    /// Open the file and write the header of a width×height image, throwing std::runtime_error if it can't be opened
+    band_writer_t(const std::string& filename,
+                  const uint64_t& width,
+                  const uint64_t& height,
+                  const uint64_t& nthreads);
+
+    /// Compress and write the rows of the whole image, in bands of rows_per_thread rows for each thread
+    void write(const row_fn_t& get_row,
+               const uint64_t& rows_per_thread = 0);
+
+private:
+    std::ofstream out;
+    uint64_t width = 0;
+    uint64_t height = 0;
+    uint64_t nthreads = 1;
+
+    /// write a chunk with its length and CRC
+    void write_chunk(const char* type, const std::vector<uint8_t>& data);
+};
+
+/// The adler32 checksum of data, continuing from adler
+uint32_t adler32(uint32_t adler, const uint8_t* data, const uint64_t& length);
+
+/// The adler32 checksum of two pieces of data one after the other, from the checksums of both and the length of the second
+uint32_t adler32_combine(const uint32_t& adler_a, const uint32_t& adler_b, const uint64_t& length_b);
+
+/// Deflate data into blocks that don't end the stream, each with Huffman codes made for it unless the fixed codes take
+/// fewer bits, or stored as it is if that takes fewer bits still, followed by an empty stored block that aligns them to
+/// a byte, so that they can be followed by the blocks of the data that comes next
+void deflate_sync(const uint8_t* data, const uint64_t& length, std::vector<uint8_t>& out);
+
+}
+}
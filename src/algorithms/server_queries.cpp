@@ -0,0 +1,408 @@
+#include "server_queries.hpp"
+#include "subgraph/extract.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+namespace odgi {
+namespace algorithms {
+
+/// at most this many digits always fit in 64 bits
+const static uint64_t MAX_UINT_DIGITS = 19;
+
+const static std::string NO_GRAPH = "the server was started without a graph, see -g, --graph";
+const static std::string NO_PATH_INDEX = "the server was started without a path index, see -i, --idx";
+
+bool parse_uint(const char* begin, const char* end, uint64_t& value) {
+    if (begin == end || (uint64_t)(end - begin) > MAX_UINT_DIGITS) return false;
+    value = 0;
+    for (const char* c = begin; c != end; ++c) {
+        if (*c < '0' || *c > '9') return false;
+        value = value * 10 + (*c - '0');
+    }
+    return true;
+}
+
+static bool parse_uint(const std::string& s, uint64_t& value) {
+    return parse_uint(s.data(), s.data() + s.size(), value);
+}
+
+std::vector<path_pos_query_t> parse_path_pos_queries(const std::string& body) {
+    std::vector<path_pos_query_t> queries;
+    const char* c = body.data();
+    const char* body_end = c + body.size();
+    while (c < body_end) {
+        const char* line_end = (const char*)memchr(c, '\n', body_end - c);
+        if (line_end == nullptr) line_end = body_end;
+        const char* e = line_end;
+        if (e > c && *(e - 1) == '\r') --e;
+        if (e > c) {
+            path_pos_query_t q;
+            const char* sep = e;
+            while (sep > c && *(sep - 1) != '\t' && *(sep - 1) != ' ' && *(sep - 1) != ':') --sep;
+            uint64_t pos = 0;
+            if (sep > c && parse_uint(sep, e, pos) && pos > 0) {
+                q.path.assign(c, sep - 1);
+                q.offset = pos - 1;
+                q.valid = true;
+            }
+            queries.push_back(q);
+        }
+        c = line_end + 1;
+    }
+    return queries;
+}
+
+static void json_string(std::string& out, const std::string& s) {
+    out.push_back('"');
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+static query_response_t error_response(const int& status, const std::string& message) {
+    query_response_t res;
+    res.status = status;
+    res.body = "{\"error\":";
+    json_string(res.body, message);
+    res.body += "}";
+    return res;
+}
+
+server_queries_t::server_queries_t(const graph_t* graph, const step_index_t* step_index, const xp::XP* path_index)
+    : graph(graph), step_index(step_index), path_index(path_index) {
+}
+
+bool server_queries_t::get_path(const std::string& name, query_response_t& res, path_handle_t& path) const {
+    if (!graph) {
+        res = error_response(400, NO_GRAPH);
+        return false;
+    }
+    if (name.empty() || !graph->has_path(name)) {
+        res = error_response(404, "no path " + name + " in the graph");
+        return false;
+    }
+    path = graph->get_path_handle(name);
+    return true;
+}
+
+bool server_queries_t::get_range(const graph_t::path_step_array_t& step_array,
+                                 const std::string& start_param, const std::string& end_param,
+                                 query_response_t& res,
+                                 uint64_t& start, uint64_t& end,
+                                 uint64_t& first, uint64_t& last) const {
+    const auto& offsets = step_array.offsets;
+    start = 0;
+    end = offsets.back();
+    if ((!start_param.empty() && !parse_uint(start_param, start))
+        || (!end_param.empty() && !parse_uint(end_param, end))) {
+        res = error_response(400, "start and end must be 0-based, unsigned positions");
+        return false;
+    }
+    end = std::min(end, offsets.back());
+    if (start >= end) {
+        res = error_response(400, "empty range");
+        return false;
+    }
+    first = std::upper_bound(offsets.begin(), offsets.end(), start) - offsets.begin() - 1;
+    last = std::lower_bound(offsets.begin(), offsets.end(), end) - offsets.begin();
+    return true;
+}
+
+query_response_t server_queries_t::positions(const std::string& body, const bool& to_graph, const bool& binary) const {
+    if (to_graph ? !graph : !path_index) {
+        return error_response(400, to_graph ? NO_GRAPH : NO_PATH_INDEX);
+    }
+    const std::vector<path_pos_query_t> queries = parse_path_pos_queries(body);
+    // id, offset, is_rev of each graph position, or just the pangenome position
+    const uint64_t width = to_graph ? 3 : 1;
+    std::vector<uint64_t> results(queries.size() * width, 0);
+    std::string last_path;
+    path_handle_t path;
+    bool path_known = false;
+    std::shared_ptr<const graph_t::path_step_array_t> step_array;
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        const path_pos_query_t& q = queries[i];
+        if (!q.valid) continue;
+        if (to_graph) {
+            // queries tend to come in runs on the same path
+            if (!step_array || q.path != last_path) {
+                last_path = q.path;
+                path_known = graph->has_path(q.path);
+                if (path_known) {
+                    path = graph->get_path_handle(q.path);
+                    step_array = graph->get_path_step_array(path);
+                }
+            }
+            if (!path_known || q.offset >= step_array->offsets.back()) continue;
+            const auto& offsets = step_array->offsets;
+            const uint64_t j = std::upper_bound(offsets.begin(), offsets.end(), q.offset) - offsets.begin() - 1;
+            const handle_t h = graph->get_handle_of_step(step_array->steps[j]);
+            results[i * 3] = graph->get_id(h);
+            results[i * 3 + 1] = q.offset - offsets[j];
+            results[i * 3 + 2] = graph->get_is_reverse(h);
+        } else if (path_index->has_path(q.path) && path_index->has_position(q.path, q.offset)) {
+            results[i] = path_index->get_pangenome_pos(q.path, q.offset) + 1;
+        }
+    }
+    query_response_t res;
+    if (binary) {
+        res.body.assign((const char*)results.data(), results.size() * sizeof(uint64_t));
+        res.content_type = "application/octet-stream";
+        return res;
+    }
+    res.body.reserve(results.size() * 12 + 2);
+    res.body.push_back('[');
+    for (uint64_t i = 0; i < queries.size(); ++i) {
+        if (i) res.body.push_back(',');
+        if (to_graph) {
+            res.body.push_back('[');
+            res.body += std::to_string(results[i * 3]);
+            res.body.push_back(',');
+            res.body += std::to_string(results[i * 3 + 1]);
+            res.body += results[i * 3 + 2] ? ",\"-\"]" : ",\"+\"]";
+        } else {
+            res.body += std::to_string(results[i]);
+        }
+    }
+    res.body.push_back(']');
+    return res;
+}
+
+query_response_t server_queries_t::node(const std::string& id_param, const bool& with_steps) const {
+    if (!graph) {
+        return error_response(400, NO_GRAPH);
+    }
+    uint64_t id = 0;
+    if (!parse_uint(id_param, id) || !graph->has_node(id)) {
+        return error_response(404, "no node " + id_param + " in the graph");
+    }
+    const handle_t h = graph->get_handle(id);
+    query_response_t res;
+    std::string& body = res.body;
+    body = "{\"id\":" + std::to_string(id)
+        + ",\"length\":" + std::to_string(graph->get_length(h))
+        + ",\"sequence\":\"" + graph->get_sequence(h) + "\""
+        + ",\"depth\":" + std::to_string(graph->get_step_count(h));
+    auto add_neighbours = [&](const std::string& key, const bool& go_left) {
+        body += ",\"" + key + "\":[";
+        bool first = true;
+        graph->follow_edges(h, go_left, [&](const handle_t& other) {
+            if (!first) body.push_back(',');
+            first = false;
+            body += "\"" + std::to_string(graph->get_id(other)) + (graph->get_is_reverse(other) ? "-\"" : "+\"");
+        });
+        body.push_back(']');
+    };
+    add_neighbours("left", true);
+    add_neighbours("right", false);
+    // collect the steps before looking into them, as the node is locked while we go through its steps
+    std::vector<step_handle_t> steps;
+    graph->for_each_step_on_handle(h, [&](const step_handle_t& step) { steps.push_back(step); });
+    std::vector<std::pair<uint64_t, uint64_t>> path_counts;
+    for (auto& step : steps) {
+        path_counts.push_back(std::make_pair(as_integer(graph->get_path_handle_of_step(step)), 0));
+    }
+    if (with_steps) {
+        body += ",\"steps\":[";
+        for (uint64_t i = 0; i < steps.size(); ++i) {
+            if (i) body.push_back(',');
+            body.push_back('[');
+            json_string(body, graph->get_path_name(as_path_handle(path_counts[i].first)));
+            body += "," + std::to_string(step_index->get_position(steps[i], *graph));
+            body += graph->get_is_reverse(graph->get_handle_of_step(steps[i])) ? ",\"-\"]" : ",\"+\"]";
+        }
+        body.push_back(']');
+    }
+    std::sort(path_counts.begin(), path_counts.end());
+    body += ",\"paths\":[";
+    for (uint64_t i = 0; i < path_counts.size(); ) {
+        uint64_t j = i;
+        while (j < path_counts.size() && path_counts[j].first == path_counts[i].first) ++j;
+        if (i) body.push_back(',');
+        body += "{\"name\":";
+        json_string(body, graph->get_path_name(as_path_handle(path_counts[i].first)));
+        body += ",\"count\":" + std::to_string(j - i) + "}";
+        i = j;
+    }
+    body += "]}";
+    return res;
+}
+
+query_response_t server_queries_t::path(const std::string& name, const bool& has_range,
+                                        const std::string& start_param, const std::string& end_param) const {
+    query_response_t res;
+    path_handle_t path;
+    if (!get_path(name, res, path)) return res;
+    const auto step_array = graph->get_path_step_array(path);
+    std::string& body = res.body;
+    body = "{\"name\":";
+    json_string(body, graph->get_path_name(path));
+    body += ",\"length\":" + std::to_string(step_array->offsets.back())
+        + ",\"steps\":" + std::to_string(step_array->steps.size())
+        + ",\"circular\":" + (graph->get_is_circular(path) ? "true" : "false");
+    if (has_range) {
+        uint64_t start, end, first, last;
+        if (!get_range(*step_array, start_param, end_param, res, start, end, first, last)) return res;
+        body += ",\"start\":" + std::to_string(step_array->offsets[first]) + ",\"walk\":[";
+        for (uint64_t i = first; i < last; ++i) {
+            if (i > first) body.push_back(',');
+            const handle_t h = graph->get_handle_of_step(step_array->steps[i]);
+            body += "\"" + std::to_string(graph->get_id(h)) + (graph->get_is_reverse(h) ? "-\"" : "+\"");
+        }
+        body.push_back(']');
+    }
+    body.push_back('}');
+    return res;
+}
+
+query_response_t server_queries_t::depth(const std::string& name, const std::string& start_param,
+                                         const std::string& end_param, const bool& with_nodes) const {
+    query_response_t res;
+    path_handle_t path;
+    if (!get_path(name, res, path)) return res;
+    const auto step_array = graph->get_path_step_array(path);
+    uint64_t start, end, first, last;
+    if (!get_range(*step_array, start_param, end_param, res, start, end, first, last)) return res;
+    std::string nodes;
+    uint64_t sum = 0;
+    for (uint64_t i = first; i < last; ++i) {
+        const handle_t h = graph->get_handle_of_step(step_array->steps[i]);
+        const uint64_t depth = graph->get_step_count(h);
+        const uint64_t node_start = std::max(step_array->offsets[i], start);
+        const uint64_t node_end = std::min(step_array->offsets[i + 1], end);
+        sum += depth * (node_end - node_start);
+        if (with_nodes) {
+            if (i > first) nodes.push_back(',');
+            nodes += "[" + std::to_string(graph->get_id(h)) + "," + std::to_string(depth) + "]";
+        }
+    }
+    std::stringstream depth;
+    depth << (double)sum / (double)(end - start);
+    std::string& body = res.body;
+    body = "{\"path\":";
+    json_string(body, graph->get_path_name(path));
+    body += ",\"start\":" + std::to_string(start)
+        + ",\"end\":" + std::to_string(end)
+        + ",\"depth\":" + depth.str();
+    if (with_nodes) {
+        body += ",\"nodes\":[" + nodes + "]";
+    }
+    body.push_back('}');
+    return res;
+}
+
+query_response_t server_queries_t::subgraph(const std::string& name, const std::string& start_param,
+                                            const std::string& end_param, const std::string& context_param,
+                                            const bool& as_odgi) const {
+    query_response_t res;
+    path_handle_t path;
+    if (!get_path(name, res, path)) return res;
+    const auto step_array = graph->get_path_step_array(path);
+    uint64_t start, end, first, last;
+    if (!get_range(*step_array, start_param, end_param, res, start, end, first, last)) return res;
+    uint64_t context = 0;
+    if (!context_param.empty() && !parse_uint(context_param, context)) {
+        return error_response(400, "context must be a number of steps");
+    }
+    graph_t subgraph;
+    std::vector<nid_t> ids;
+    ids.reserve(last - first);
+    for (uint64_t i = first; i < last; ++i) {
+        ids.push_back(graph->get_id(graph->get_handle_of_step(step_array->steps[i])));
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (auto& id : ids) {
+        subgraph.create_handle(graph->get_sequence(graph->get_handle(id)), id);
+    }
+    if (context) {
+        expand_subgraph_by_steps(*graph, subgraph, context, false);
+    }
+    add_connecting_edges_to_subgraph(*graph, subgraph);
+
+    // the runs of steps through the subgraph, found from its nodes rather than by walking the whole paths
+    std::vector<subpath_run_t> runs;
+    std::unordered_set<step_handle_t> visited;
+    subgraph.for_each_handle([&](const handle_t& sub_handle) {
+        std::vector<step_handle_t> steps;
+        graph->for_each_step_on_handle(graph->get_handle(subgraph.get_id(sub_handle)),
+                                       [&](const step_handle_t& step) { steps.push_back(step); });
+        for (auto& step : steps) {
+            if (visited.count(step)) continue;
+            subpath_run_t run;
+            run.path = graph->get_path_handle_of_step(step);
+            // back up to the first step of the run, stopping where a circular path comes around
+            run.first = step;
+            while (graph->has_previous_step(run.first)) {
+                const step_handle_t prev = graph->get_previous_step(run.first);
+                if (prev == step || !subgraph.has_node(graph->get_id(graph->get_handle_of_step(prev)))) break;
+                run.first = prev;
+            }
+            run.last = run.first;
+            run.step_count = 1;
+            uint64_t length = graph->get_length(graph->get_handle_of_step(run.first));
+            visited.insert(run.first);
+            while (graph->has_next_step(run.last)) {
+                const step_handle_t next = graph->get_next_step(run.last);
+                if (next == run.first || !subgraph.has_node(graph->get_id(graph->get_handle_of_step(next)))) break;
+                run.last = next;
+                ++run.step_count;
+                length += graph->get_length(graph->get_handle_of_step(next));
+                visited.insert(next);
+            }
+            run.start = step_index->get_position(run.first, *graph);
+            run.end = run.start + length;
+            const auto run_step_array = graph->get_path_step_array(run.path);
+            run.first_index = std::upper_bound(run_step_array->offsets.begin(), run_step_array->offsets.end(),
+                                               run.start) - run_step_array->offsets.begin() - 1;
+            runs.push_back(run);
+        }
+    });
+    std::sort(runs.begin(), runs.end(), [](const subpath_run_t& a, const subpath_run_t& b) {
+        return std::make_pair(as_integer(a.path), a.start) < std::make_pair(as_integer(b.path), b.start);
+    });
+    add_subpath_runs_to_subgraph(*graph, runs, subgraph);
+
+    std::stringstream out;
+    if (as_odgi) {
+        subgraph.serialize(out);
+        res.content_type = "application/octet-stream";
+    } else {
+        subgraph.to_gfa(out);
+        res.content_type = "text/plain";
+    }
+    res.body = out.str();
+    return res;
+}
+
+query_response_t server_queries_t::pangenome_position(const std::string& path_name, const std::string& position) const {
+    uint64_t nuc_pos = 0;
+    size_t pan_pos = 0;
+    if (path_index && parse_uint(position, nuc_pos) && nuc_pos > 0) {
+        const size_t nuc_pos_0 = nuc_pos - 1;
+        if (path_index->has_path(path_name)) {
+            if (path_index->has_position(path_name, nuc_pos_0)) {
+                pan_pos = path_index->get_pangenome_pos(path_name, nuc_pos_0) + 1;
+            }
+        }
+    }
+    query_response_t res;
+    res.body = std::to_string(pan_pos);
+    res.content_type = "text/plain";
+    return res;
+}
+
+}
+}
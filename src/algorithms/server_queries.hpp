@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * \file server_queries.hpp
+ *
+ * The queries that odgi server answers, without the HTTP layer: each one takes the parameters of a request as strings
+ * and gives the status and body of the response, so that they can be answered and tested without a running server.
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "odgi.hpp"
+#include "xp.hpp"
+#include "stepindex.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+/// Parse an unsigned decimal number of at most 19 digits, so that it always fits in 64 bits.
+/// Returns false if [begin, end) isn't one.
+bool parse_uint(const char* begin, const char* end, uint64_t& value);
+
+/// A 1-based path position, given as PATH<TAB>POS, PATH POS or PATH:POS, as its path and 0-based offset
+struct path_pos_query_t {
+    std::string path;
+    uint64_t offset = 0;
+    /// false if the line isn't a path position
+    bool valid = false;
+};
+
+/// Split a request body into one path position per non-empty line, at the last separator of the line, as path names
+/// may contain colons
+std::vector<path_pos_query_t> parse_path_pos_queries(const std::string& body);
+
+/// The answer to a query
+struct query_response_t {
+    int status = 200;
+    std::string body;
+    std::string content_type = "application/json";
+};
+
+class server_queries_t {
+public:
+    /// The graph and its step index answer all queries but the pangenome positions, which the path index answers.
+    /// Either may be null if the server was started without them, and the queries that need them give a 400.
+    server_queries_t(const graph_t* graph, const step_index_t* step_index, const xp::XP* path_index);
+
+    /// 1-based path positions, one per line of the body, as 1-based pangenome positions (needs the path index) or as
+    /// graph positions, in a JSON array in the order of the queries, or as little-endian 64-bit integers if binary.
+    /// Unknown positions give 0.
+    query_response_t positions(const std::string& body, const bool& to_graph, const bool& binary) const;
+
+    /// A node, its neighbours, and the paths that step on it, with the positions of their steps if with_steps
+    query_response_t node(const std::string& id, const bool& with_steps) const;
+
+    /// A path, its length in bp and steps, and if has_range the nodes it walks through in the 0-based, half-open range
+    /// [start, end), where an empty start or end stands for the start or end of the path
+    query_response_t path(const std::string& name, const bool& has_range,
+                          const std::string& start, const std::string& end) const;
+
+    /// The mean depth over a 0-based, half-open range of a path, as odgi depth -r computes it, and if with_nodes the
+    /// depth of each node in the range
+    query_response_t depth(const std::string& name, const std::string& start, const std::string& end,
+                           const bool& with_nodes) const;
+
+    /// The subgraph of a 0-based, half-open range of a path, as odgi extract -r builds it, with all the paths through
+    /// it as subpaths, expanded by context steps, as GFA or, if as_odgi, in ODGI format
+    query_response_t subgraph(const std::string& name, const std::string& start, const std::string& end,
+                              const std::string& context, const bool& as_odgi) const;
+
+    /// The 1-based pangenome position of a 1-based path position as plain text, or 0 if there is none
+    query_response_t pangenome_position(const std::string& path_name, const std::string& position) const;
+
+private:
+    const graph_t* graph;
+    const step_index_t* step_index;
+    const xp::XP* path_index;
+
+    /// the path of the given name, or false with the error in res
+    bool get_path(const std::string& name, query_response_t& res, path_handle_t& path) const;
+
+    /// the 0-based, half-open range given by start and end, clipped to the path, and the indexes of its first and one
+    /// past its last step in the step array of the path, or false with the error in res
+    bool get_range(const graph_t::path_step_array_t& step_array,
+                   const std::string& start_param, const std::string& end_param,
+                   query_response_t& res,
+                   uint64_t& start, uint64_t& end,
+                   uint64_t& first, uint64_t& last) const;
+};
+
+}
+}
@@ -1,9 +1,18 @@
 #include "stepindex.hpp"
 #include "progress.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
 
 namespace odgi {
 namespace algorithms {
 
+/// Written after the magic value, for indexes that carry the graph hash and the sampled steps of each path
+const static std::string STEP_INDEX_VERSION = "v2";
+
 step_index_t::step_index_t() {
 	step_mphf = new boophf_step_t();
 }
@@ -64,14 +73,18 @@ step_index_t::step_index_t(const PathHandleGraph& graph,
 		building_progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
 				paths.size(), "[odgi::algorithms::stepindex] Building Progress:");
 	}
+	// the sampled steps of each path in path order, for lookups by position
+	std::vector<std::vector<std::pair<step_handle_t, uint64_t>>> samples(path_len.size());
 #pragma omp parallel for schedule(dynamic,1)
     for (auto& path : paths) {
         uint64_t offset = 0;
+        auto& path_samples = samples[as_integer(path) - 1];
         graph.for_each_step_in_path(
             path, [&](const step_handle_t& step) {
 				// sampling
 				if (sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(step)), sample_rate)) {
 					pos[step_mphf->lookup(step)] = offset;
+					path_samples.push_back(std::make_pair(step, offset));
 				}
 				offset += graph.get_length(graph.get_handle_of_step(step));
 				});
@@ -86,6 +99,25 @@ step_index_t::step_index_t(const PathHandleGraph& graph,
 	if (progress) {
 		building_progress_meter->finish();
 	}
+	path_sample_begin.resize(samples.size() + 1);
+	uint64_t sample_count = 0;
+	for (uint64_t i = 0; i < samples.size(); ++i) {
+		path_sample_begin[i] = sample_count;
+		sample_count += samples[i].size();
+	}
+	path_sample_begin[samples.size()] = sample_count;
+	sample_step.resize(2 * sample_count);
+	sample_pos.resize(sample_count);
+#pragma omp parallel for schedule(dynamic,1)
+	for (uint64_t i = 0; i < samples.size(); ++i) {
+		uint64_t j = path_sample_begin[i];
+		for (auto& s : samples[i]) {
+			sample_step[2 * j] = as_integers(s.first)[0];
+			sample_step[2 * j + 1] = as_integers(s.first)[1];
+			sample_pos[j] = s.second;
+			++j;
+		}
+	}
 }
 
 const uint64_t step_index_t::get_position(const step_handle_t& step, const PathHandleGraph& graph) const {
@@ -119,6 +151,36 @@ const uint64_t step_index_t::get_path_len(const path_handle_t& path) const {
 	return path_len[as_integer(path) - 1];
 }
 
+std::pair<step_handle_t, uint64_t> step_index_t::get_step_at_position(const path_handle_t& path,
+																	  const uint64_t& offset,
+																	  const PathHandleGraph& graph) const {
+	const uint64_t i = as_integer(path) - 1;
+	if (offset >= path_len[i]) {
+		return std::make_pair(graph.path_end(path), path_len[i]);
+	}
+	// start from the last sampled step at or before the offset, or from the start of the path
+	step_handle_t step = graph.path_begin(path);
+	uint64_t walked = 0;
+	if (i + 1 < path_sample_begin.size()) {
+		auto begin = sample_pos.begin() + path_sample_begin[i];
+		auto end = sample_pos.begin() + path_sample_begin[i + 1];
+		auto s = std::upper_bound(begin, end, offset);
+		if (s != begin) {
+			const uint64_t j = (s - sample_pos.begin()) - 1;
+			as_integers(step)[0] = sample_step[2 * j];
+			as_integers(step)[1] = sample_step[2 * j + 1];
+			walked = sample_pos[j];
+		}
+	}
+	uint64_t length = graph.get_length(graph.get_handle_of_step(step));
+	while (walked + length <= offset) {
+		walked += length;
+		step = graph.get_next_step(step);
+		length = graph.get_length(graph.get_handle_of_step(step));
+	}
+	return std::make_pair(step, walked);
+}
+
 void step_index_t::save(const std::string& name) const {
 	std::ofstream stpidx_out(name);
 	serialize_members(stpidx_out);
@@ -142,14 +204,21 @@ size_t step_index_t::serialize_and_measure(std::ostream &out, sdsl::structure_tr
 
 	// Do the magic number
 	std::string sample_rate = std::to_string(this->sample_rate);
-	out << "STEP" << sample_rate << "INDEX";
+	out << "STEP" << sample_rate << "INDEX" << STEP_INDEX_VERSION;
 	written += 9;
 	written += sample_rate.length();
+	written += STEP_INDEX_VERSION.length();
+	// GRAPH CONTENT HASH
+	written += sdsl::write_member(graph_hash, out, child, "graph_hash");
 
 	// POSITION STUFF
 	written += pos.serialize(out, child, "path_position_map");
 	// PATH LENGTH STUFF
 	written += path_len.serialize(out, child, "path_length_map");
+	// SAMPLED STEPS BY PATH
+	written += path_sample_begin.serialize(out, child, "path_sample_begin");
+	written += sample_step.serialize(out, child, "sample_step");
+	written += sample_pos.serialize(out, child, "sample_pos");
 
 	sdsl::structure_tree::add_size(child, written);
 	return written;
@@ -197,9 +266,29 @@ void step_index_t::load_sdsl(std::istream &in) {
 	delete[] step_buffer;
 	delete[] index_buffer;
 
+	// indexes without a version after the magic value start right away with the bit length of pos,
+	// a multiple of 64 whose first byte can never be the 'v' of the version
+	bool has_samples = false;
+	if (in.peek() == 'v') {
+		std::string version(STEP_INDEX_VERSION.length(), ' ');
+		in.read(&version[0], version.length());
+		if (version != STEP_INDEX_VERSION) {
+			throw std::runtime_error("[odgi::algorithms::stepindex] error: SDSL step index file has unknown version " + version + ".");
+		}
+		sdsl::read_member(graph_hash, in);
+		has_samples = true;
+	} else {
+		graph_hash = 0;
+	}
+
 	try {
 		pos.load(in);
 		path_len.load(in);
+		if (has_samples) {
+			path_sample_begin.load(in);
+			sample_step.load(in);
+			sample_pos.load(in);
+		}
 	} catch (const std::runtime_error &e) {
 		// Pass XGFormatErrors through
 		throw e;
@@ -218,6 +307,95 @@ step_index_t::~step_index_t(void) {
     delete step_mphf;
 }
 
+/// Final mix of murmur3, spreading every input bit over the whole word
+static inline uint64_t fmix64(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+static uint64_t hash_bytes(const char* data, const uint64_t& len, uint64_t h) {
+	const uint64_t words = len / 8;
+	for (uint64_t i = 0; i < words; ++i) {
+		uint64_t w;
+		memcpy(&w, data + i * 8, 8);
+		h = fmix64(h ^ w) + 0x9e3779b97f4a7c15ULL;
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, data + words * 8, len - words * 8);
+	return fmix64(h ^ tail ^ (len << 56));
+}
+
+uint64_t graph_file_hash(const std::string& graph_file) {
+	int fd = open(graph_file.c_str(), O_RDONLY);
+	if (fd == -1) {
+		std::cerr << "[odgi::algorithms::stepindex] error: could not open " << graph_file << " for reading." << std::endl;
+		exit(1);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return 0;
+	}
+	const uint64_t size = st.st_size;
+	uint64_t h = fmix64(size);
+	h = fmix64(h ^ (uint64_t)st.st_mtim.tv_sec) + 0x9e3779b97f4a7c15ULL;
+	h = fmix64(h ^ (uint64_t)st.st_mtim.tv_nsec) + 0x9e3779b97f4a7c15ULL;
+	// the header holds the graph's counts and the trailer its path metadata, so reading just these
+	// catches rewrites that keep the size and the modification time, without reading the whole file
+	const uint64_t digest_size = 1 << 20;
+	std::vector<char> buffer(std::min(size, digest_size));
+	for (const uint64_t begin : {(uint64_t)0, size - buffer.size()}) {
+		if (buffer.empty()) break;
+		uint64_t read = 0;
+		while (read < buffer.size()) {
+			const ssize_t r = pread(fd, buffer.data() + read, buffer.size() - read, begin + read);
+			if (r <= 0) {
+				close(fd);
+				return 0;
+			}
+			read += r;
+		}
+		h = hash_bytes(buffer.data(), buffer.size(), h);
+	}
+	close(fd);
+	// 0 marks an index without a graph hash
+	return h == 0 ? 1 : h;
+}
+
+std::string step_index_sidecar_name(const std::string& graph_file) {
+	return graph_file + ".stpidx";
+}
+
+bool load_step_index_sidecar(step_index_t& step_index,
+							 const std::string& graph_file,
+							 const bool progress) {
+	// a graph converted on the fly from GFA needn't have the same step handles each time, so only ODGI files qualify
+	if (graph_file.empty() || graph_file == "-"
+		|| (graph_file.size() >= 3 && graph_file.substr(graph_file.size() - 3) == "gfa")) {
+		return false;
+	}
+	const std::string sidecar = step_index_sidecar_name(graph_file);
+	if (!std::filesystem::exists(sidecar)) {
+		return false;
+	}
+	step_index.load(sidecar);
+	if (step_index.graph_hash == 0 || step_index.graph_hash != graph_file_hash(graph_file)) {
+		if (progress) {
+			std::cerr << "[odgi::algorithms::stepindex] warning: ignoring " << sidecar
+					  << " as it was not built from the current contents of " << graph_file << "." << std::endl;
+		}
+		return false;
+	}
+	if (progress) {
+		std::cerr << "[odgi::algorithms::stepindex] loaded the step index " << sidecar << "." << std::endl;
+	}
+	return true;
+}
+
 
 // path step index
 
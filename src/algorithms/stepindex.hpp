@@ -61,6 +61,10 @@ struct step_index_t {
 
     const uint64_t get_position(const step_handle_t& step, const PathHandleGraph& graph) const;
 	const uint64_t get_path_len(const path_handle_t& path) const;
+	/// The step covering the given offset of the path and the offset at which that step starts,
+	/// found from the nearest sampled step before it. Returns path_end if the offset is past the end of the path.
+	std::pair<step_handle_t, uint64_t> get_step_at_position(const path_handle_t& path, const uint64_t& offset,
+															const PathHandleGraph& graph) const;
 	void save(const std::string& name) const;
 	void load(const std::string& name);
     // map from step to position in its path
@@ -68,6 +72,13 @@ struct step_index_t {
 	sdsl::int_vector<64> pos;
 	sdsl::int_vector<64> path_len;
 	uint64_t sample_rate;
+	/// Hash of the contents of the graph file the index was built from, 0 if unknown
+	uint64_t graph_hash = 0;
+	/// The sampled steps of each path in path order: those of path i are at [path_sample_begin[i], path_sample_begin[i+1])
+	/// in sample_pos, and at twice that in sample_step, which holds the two words of each step handle
+	sdsl::int_vector<64> path_sample_begin;
+	sdsl::int_vector<64> sample_step;
+	sdsl::int_vector<64> sample_pos;
 private:
 	/// the assumptions is that the magic number will be STEPsampling_rateINDEX, where the sampling rate encodes the actual
 	/// sampling rate of the index
@@ -86,6 +97,19 @@ private:
 	void deserialize_members(std::istream &in);
 };
 
+/// Hash the size, the modification time and the first and last MiB of a graph file, tying a saved
+/// step index to the graph file it was built from without reading all of it
+uint64_t graph_file_hash(const std::string& graph_file);
+
+/// Name of the step index saved next to a graph file, which is where odgi stepindex writes it by default
+std::string step_index_sidecar_name(const std::string& graph_file);
+
+/// Load the step index saved next to the graph file, if there is one and it was built from this exact file.
+/// Returns true if the index was loaded.
+bool load_step_index_sidecar(step_index_t& step_index,
+							 const std::string& graph_file,
+							 const bool progress);
+
 // index of a single path's steps designed for efficient iteration
 // over steps on a single handle
 // in practice
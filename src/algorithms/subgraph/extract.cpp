@@ -1,4 +1,5 @@
 #include "extract.hpp"
+#include "IITree.h"
 
 namespace odgi {
     namespace algorithms {
@@ -36,11 +37,15 @@ namespace odgi {
             for (auto& source_path : taken_source_paths) {
                 const path_handle_t path_handle = component.get_path_handle(source.get_path_name(source_path));
 
+                std::vector<handle_t> handles;
+                handles.reserve(source.get_step_count(source_path));
                 for (handle_t handle : source.scan_path(source_path)) {
-                    component.append_step(path_handle, component.get_handle(source.get_id(handle),
-                                                                                source.get_is_reverse(handle)));
+                    handles.push_back(component.get_handle(source.get_id(handle),
+                                                           source.get_is_reverse(handle)));
                 }
+                component.append_steps_buffered(path_handle, handles);
             }
+            component.merge_step_buffers();
         }
 
         // Create a subpath name
@@ -144,21 +149,22 @@ namespace odgi {
                     );
 
                     uint64_t walked = 0;
+                    std::vector<handle_t> handles;
                     source.for_each_step_in_path(source_path_handle, [&](const step_handle_t &step) {
                         if (range_rank < subpath_ranges[path_rank].size()) {
                             const handle_t source_handle = source.get_handle_of_step(step);
 
                             if (walked >= subpath_ranges[path_rank][range_rank].first &&
                                 walked <= subpath_ranges[path_rank][range_rank].second) {
-                                subgraph.append_step(
-                                        subpath_handle,
-                                        subgraph.get_handle(source.get_id(source_handle),
-                                                            source.get_is_reverse(source_handle))
-                                );
+                                handles.push_back(subgraph.get_handle(source.get_id(source_handle),
+                                                                      source.get_is_reverse(source_handle)));
                             }
 
                             walked += source.get_length(source_handle);
                             if (walked >= subpath_ranges[path_rank][range_rank].second) {
+                                // the subpath is complete
+                                subgraph.append_steps(subpath_handle, handles);
+                                handles.clear();
                                 ++range_rank;
                                 if (range_rank < subpath_ranges[path_rank].size()) {
                                     subpath_handle = subgraph.get_path_handle(
@@ -196,6 +202,188 @@ namespace odgi {
                     });
         }
 
+        std::vector<std::vector<handle_t>> collect_path_ranges(const graph_t &source, std::vector<path_range_t> &path_ranges,
+                                                               const uint64_t num_threads,
+                                                               const std::string &progress_message) {
+            const bool show_progress = !progress_message.empty();
+
+            // the ranges of each path
+            std::vector<std::vector<uint64_t>> ranges_of_path(source.get_path_count() + 1);
+            for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+                ranges_of_path[as_integer(path_ranges[i].begin.path)].push_back(i);
+            }
+            std::vector<path_handle_t> paths;
+            for (uint64_t i = 0; i < ranges_of_path.size(); ++i) {
+                if (!ranges_of_path[i].empty()) {
+                    paths.push_back(as_path_handle(i));
+                }
+            }
+
+            std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+            if (show_progress) {
+                progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(paths.size(), progress_message);
+            }
+
+            std::vector<std::vector<handle_t>> range_handles(path_ranges.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t j = 0; j < paths.size(); ++j) {
+                const path_handle_t path_handle = paths[j];
+                const std::vector<uint64_t> &ranges = ranges_of_path[as_integer(path_handle)];
+
+                IITree<uint64_t, uint64_t> tree;
+                uint64_t max_end = 0;
+                for (auto &i : ranges) {
+                    tree.add(path_ranges[i].begin.offset, path_ranges[i].end.offset, i);
+                    max_end = std::max(max_end, path_ranges[i].end.offset);
+                }
+                tree.index();
+
+                // a range ends at the end of the first step that reaches its end, or at the end of the path
+                std::vector<uint64_t> by_end = ranges;
+                std::sort(by_end.begin(), by_end.end(), [&](const uint64_t &a, const uint64_t &b) {
+                    return path_ranges[a].end.offset < path_ranges[b].end.offset;
+                });
+                std::vector<uint64_t> new_start(ranges.size(), 0);
+                std::vector<uint64_t> new_end(ranges.size(), 0);
+                auto rank_of = [&](const uint64_t &i) {
+                    return std::lower_bound(ranges.begin(), ranges.end(), i) - ranges.begin();
+                };
+                uint64_t ended = 0;
+
+                std::vector<size_t> overlaps;
+                uint64_t walked = 0;
+                const auto path_end = source.path_end(path_handle);
+                for (step_handle_t cur_step = source.path_begin(path_handle);
+                     cur_step != path_end && walked < max_end; cur_step = source.get_next_step(cur_step)) {
+                    for (; ended < by_end.size() && path_ranges[by_end[ended]].end.offset <= walked; ++ended) {
+                        new_end[rank_of(by_end[ended])] = walked;
+                    }
+                    const handle_t cur_handle = source.get_handle_of_step(cur_step);
+                    const uint64_t begin = walked;
+                    walked += source.get_length(cur_handle);
+                    tree.overlap(begin, walked, overlaps);
+                    for (auto &k : overlaps) {
+                        const uint64_t i = tree.data(k);
+                        if (range_handles[i].empty()) {
+                            new_start[rank_of(i)] = begin;
+                        }
+                        range_handles[i].push_back(cur_handle);
+                    }
+                }
+                for (; ended < by_end.size(); ++ended) {
+                    new_end[rank_of(by_end[ended])] = walked;
+                }
+
+                // Extend path range to entirely include the first and the last node of the range.
+                // This is important to path names with the correct path ranges.
+                for (uint64_t k = 0; k < ranges.size(); ++k) {
+                    path_ranges[ranges[k]].begin.offset = new_start[k];
+                    path_ranges[ranges[k]].end.offset = new_end[k];
+                }
+
+                if (show_progress) {
+                    progress->increment(1);
+                }
+            }
+
+            if (show_progress) {
+                progress->finish();
+            }
+
+            return range_handles;
+        }
+
+        std::vector<std::vector<subpath_run_t>> find_subpath_runs(const graph_t &source,
+                                                                  const std::vector<path_handle_t> &source_paths,
+                                                                  const std::vector<std::vector<nid_t>> &node_sets,
+                                                                  const std::vector<path_handle_t> &excluded_paths,
+                                                                  const uint64_t num_threads) {
+            // the subgraphs each node is in, as offsets into sets_of_node
+            const nid_t shift = source.min_node_id();
+            std::vector<uint64_t> node_begin(source.get_node_count() + 2, 0);
+            for (auto &node_set : node_sets) {
+                for (auto &id : node_set) {
+                    ++node_begin[id - shift + 2];
+                }
+            }
+            for (uint64_t i = 2; i < node_begin.size(); ++i) {
+                node_begin[i] += node_begin[i - 1];
+            }
+            std::vector<uint64_t> sets_of_node(node_begin.back());
+            for (uint64_t s = 0; s < node_sets.size(); ++s) {
+                for (auto &id : node_sets[s]) {
+                    sets_of_node[node_begin[id - shift + 1]++] = s;
+                }
+            }
+
+            // the runs of each path, with the subgraph they belong to
+            std::vector<std::vector<std::pair<uint64_t, subpath_run_t>>> path_runs(source_paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
+                const path_handle_t path_handle = source_paths[path_rank];
+                auto &runs = path_runs[path_rank];
+                // the last run of each subgraph in runs
+                ska::flat_hash_map<uint64_t, uint64_t> last_run;
+                uint64_t walked = 0;
+                uint64_t index = 0;
+                source.for_each_step_in_path(path_handle, [&](const step_handle_t &step) {
+                    const handle_t h = source.get_handle_of_step(step);
+                    const uint64_t length = source.get_length(h);
+                    const uint64_t node_rank = source.get_id(h) - shift;
+                    for (uint64_t k = node_begin[node_rank]; k < node_begin[node_rank + 1]; ++k) {
+                        const uint64_t s = sets_of_node[k];
+                        if (!excluded_paths.empty() && excluded_paths[s] == path_handle) {
+                            continue;
+                        }
+                        auto f = last_run.find(s);
+                        if (f != last_run.end()) {
+                            subpath_run_t &run = runs[f->second].second;
+                            if (run.first_index + run.step_count == index) {
+                                run.end = walked + length;
+                                run.last = step;
+                                ++run.step_count;
+                                continue;
+                            }
+                        }
+                        last_run[s] = runs.size();
+                        runs.push_back({s, {path_handle, walked, walked + length, step, step, index, 1}});
+                    }
+                    walked += length;
+                    ++index;
+                });
+            }
+
+            std::vector<std::vector<subpath_run_t>> set_runs(node_sets.size());
+            for (auto &runs : path_runs) {
+                for (auto &run : runs) {
+                    set_runs[run.first].push_back(run.second);
+                }
+            }
+            return set_runs;
+        }
+
+        void add_subpath_runs_to_subgraph(const graph_t &source, const std::vector<subpath_run_t> &runs,
+                                          graph_t &subgraph) {
+            std::vector<path_handle_t> subpaths;
+            subpaths.reserve(runs.size());
+            for (auto &run : runs) {
+                subpaths.push_back(create_subpath(subgraph, make_path_name(source.get_path_name(run.path), run.start, run.end),
+                                                  source.get_is_circular(run.path)));
+            }
+            for (uint64_t i = 0; i < runs.size(); ++i) {
+                std::vector<handle_t> handles;
+                handles.reserve(runs[i].step_count);
+                for (step_handle_t step = runs[i].first; ; step = source.get_next_step(step)) {
+                    const handle_t h = source.get_handle_of_step(step);
+                    handles.push_back(subgraph.get_handle(source.get_id(h), source.get_is_reverse(h)));
+                    if (step == runs[i].last) {
+                        break;
+                    }
+                }
+                subgraph.append_steps(subpaths[i], handles);
+            }
+        }
+
         void for_handle_in_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                       const std::function<void(const handle_t&)>& lambda) {
             uint64_t walked = 0;
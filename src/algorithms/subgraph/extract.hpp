@@ -31,6 +31,39 @@ namespace odgi {
         void extract_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                 graph_t &subgraph);
 
+        /// collect the handles of the steps that overlap each path range, in path order, with one walk along each path
+        /// for all of its ranges, which are looked up in an interval tree; each range is extended to the ends of its
+        /// first and last node, as the extraction does not cut nodes
+        std::vector<std::vector<handle_t>> collect_path_ranges(const graph_t &source, std::vector<path_range_t> &path_ranges,
+                                                               const uint64_t num_threads,
+                                                               const std::string &progress_message = "");
+
+        /// a maximal run of consecutive steps of a path whose nodes are all in a subgraph
+        struct subpath_run_t {
+            path_handle_t path;
+            /// the nucleotide range of the run in its path
+            uint64_t start;
+            uint64_t end;
+            step_handle_t first;
+            step_handle_t last;
+            /// the index of the first step in the path, and the number of steps
+            uint64_t first_index;
+            uint64_t step_count;
+        };
+
+        /// find the runs of the source paths through many subgraphs at once, given as the node ids of each subgraph,
+        /// with one walk along each path for all of them; the runs of each subgraph come in the order of source_paths
+        /// and then of their position. If excluded_paths isn't empty, it holds for each subgraph a path to leave out.
+        std::vector<std::vector<subpath_run_t>> find_subpath_runs(const graph_t &source,
+                                                                  const std::vector<path_handle_t> &source_paths,
+                                                                  const std::vector<std::vector<nid_t>> &node_sets,
+                                                                  const std::vector<path_handle_t> &excluded_paths,
+                                                                  const uint64_t num_threads);
+
+        /// add the runs of the source paths to the subgraph as subpaths, as add_subpaths_to_subgraph does
+        void add_subpath_runs_to_subgraph(const graph_t &source, const std::vector<subpath_run_t> &runs,
+                                          graph_t &subgraph);
+
         void for_handle_in_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                       const std::function<void(const handle_t&)>& lambda);
 
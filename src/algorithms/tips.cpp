@@ -20,7 +20,8 @@ namespace odgi {
 					   ska::flat_hash_set<std::string>& not_visited_set,
 					   const uint64_t& n_best_mappings,
 					   const uint64_t& walking_dist,
-					   const bool& report_additional_jaccards) {
+					   const bool& report_additional_jaccards,
+					   const uint64_t& sketch_size) {
 
 			const std::string target_path = graph.get_path_name(target_path_t);
 
@@ -38,81 +39,133 @@ namespace odgi {
 						paths.size(), progress_message);
 			}
 
+			/// first walk each path to where it hits the target path
+			struct tip_hit_t {
+				step_handle_t step;
+				std::vector<step_handle_t> target_step_handles;
+				bool hit = false;
+			};
+			std::vector<tip_hit_t> hits(paths.size());
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-			for (auto path : paths) {
+			for (uint64_t p = 0; p < paths.size(); ++p) {
+				const path_handle_t& path = paths[p];
 				// prevent self tips
 				if (path == target_path_t) {
 					continue;
 				}
-				std::string query_path_name = graph.get_path_name(path);
-				bool tip_reached_target = false;
 				// collecting tips
 				step_handle_t cur_step = get_path_end(path);
 				handle_t cur_h = graph.get_handle_of_step(cur_step);
-				while (!tip_reached_target) {
+				while (true) {
 					// did we already hit the given reference path?
 					if (target_handles[number_bool_packing::unpack_number(cur_h)]) {
-						std::vector<step_handle_t> target_step_handles;
+						auto& hit = hits[p];
+						hit.hit = true;
+						hit.step = cur_step;
 						graph.for_each_step_on_handle(
 								cur_h,
 								[&](const step_handle_t& s) {
 									/// we can do these expensive iterations here, because we only have to do it once for each walk
 									if (graph.get_path_handle_of_step(s) == target_path_t) {
 										// collect only the steps for the given target
-										target_step_handles.push_back(s);
+										hit.target_step_handles.push_back(s);
 									}
 								});
-
-						std::vector<step_jaccard_t> target_jaccard_indices = jaccard_indices_from_step_handles(graph,
-																											   walking_dist,
-																											   cur_step,
-																											   target_step_handles);
-						uint64_t i = 0;
-
-						// report other jaccards as a csv list in the BED
-						std::vector<double> additional_jaccards_to_report;
-						uint64_t start_index = 0 + n_best_mappings;
-						if (!report_additional_jaccards) {
-							start_index = target_jaccard_indices.size();
-						}
-						/// do we even have indices left for reporting?
-						if (!(start_index >= target_jaccard_indices.size())) {
-							for (uint64_t n = start_index; n < target_jaccard_indices.size(); n++) {
-								additional_jaccards_to_report.push_back(target_jaccard_indices[n].jaccard);
-							}
-						}
-						/// only report the Nth final steps
-						for (auto& target_jaccard_index : target_jaccard_indices) {
-							if (i == n_best_mappings) {
-								break;
-							}
-							step_handle_t final_target_step = target_jaccard_index.step;
-							double final_target_jaccard = target_jaccard_index.jaccard;
-
-							uint64_t target_min_pos = step_index.get_position(final_target_step, graph); // 0-based starting position in BED
-							uint64_t target_max_pos = target_min_pos + graph.get_length(graph.get_handle_of_step(final_target_step)); // 1-based ending position in BED
-
-							/// add BED record to queue of the BED writer
-							bed_writer_thread.append(target_path, target_min_pos, target_max_pos,
-													 query_path_name, step_index.get_position(cur_step, graph),
-													 final_target_jaccard, walk_from_front, additional_jaccards_to_report);
-							i++;
-						}
-						tip_reached_target = true;
+						break;
 					}
 					if (has_step(cur_step)) {
 						cur_step = get_step(cur_step);
 						cur_h = graph.get_handle_of_step(cur_step);
 					} else {
 						// did we iterate over all steps and we did not hit the query path?
-						tip_reached_target = true;
 #pragma omp critical (not_visited_set)
-						not_visited_set.insert(query_path_name);
+						not_visited_set.insert(graph.get_path_name(path));
 						// do we still want this?
 //						if (progress) {
 //#pragma omp critical (cout)
 //							std::cerr << "[odgi::tips::walk_tips] warning: For target path '" << query_path_name << "' there was no hit!" << std::endl;
 //						}
+						break;
+					}
+				}
+			}
+
+			/// then sketch the window of each target step that was hit once, as many paths hit the same steps in deep graphs
+			auto step_less = [](const step_handle_t& a, const step_handle_t& b) {
+				return std::make_pair(as_integers(a)[0], as_integers(a)[1]) < std::make_pair(as_integers(b)[0], as_integers(b)[1]);
+			};
+			std::vector<step_handle_t> sketched_steps;
+			std::vector<walk_sketch_t> sketches;
+			if (sketch_size) {
+				for (auto& hit : hits) {
+					sketched_steps.insert(sketched_steps.end(), hit.target_step_handles.begin(), hit.target_step_handles.end());
+				}
+				std::sort(sketched_steps.begin(), sketched_steps.end(), step_less);
+				sketched_steps.erase(std::unique(sketched_steps.begin(), sketched_steps.end()), sketched_steps.end());
+				sketches.resize(sketched_steps.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+				for (uint64_t i = 0; i < sketched_steps.size(); ++i) {
+					sketches[i] = sketch_walk_window(graph, walking_dist, sketched_steps[i], sketch_size);
+				}
+			}
+			// verify the best estimates exactly, including all the ones we report
+			const uint64_t n_verify = std::max(4 * n_best_mappings, (uint64_t)16);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+			for (uint64_t p = 0; p < paths.size(); ++p) {
+				auto& hit = hits[p];
+				if (hit.hit) {
+					const std::string query_path_name = graph.get_path_name(paths[p]);
+					const step_handle_t& cur_step = hit.step;
+					std::vector<step_jaccard_t> target_jaccard_indices;
+					if (sketch_size) {
+						std::vector<const walk_sketch_t*> target_sketches;
+						target_sketches.reserve(hit.target_step_handles.size());
+						for (auto& target_step : hit.target_step_handles) {
+							const uint64_t i = std::lower_bound(sketched_steps.begin(), sketched_steps.end(), target_step, step_less)
+											   - sketched_steps.begin();
+							target_sketches.push_back(&sketches[i]);
+						}
+						const walk_sketch_t query_sketch = sketch_walk_window(graph, walking_dist, cur_step, sketch_size);
+						target_jaccard_indices = jaccard_indices_from_sketches(graph, walking_dist, cur_step, query_sketch,
+																			   hit.target_step_handles, target_sketches,
+																			   sketch_size, n_verify);
+					} else {
+						target_jaccard_indices = jaccard_indices_from_step_handles(graph,
+																				   walking_dist,
+																				   cur_step,
+																				   hit.target_step_handles);
+					}
+					uint64_t i = 0;
+
+					// report other jaccards as a csv list in the BED
+					std::vector<double> additional_jaccards_to_report;
+					uint64_t start_index = 0 + n_best_mappings;
+					if (!report_additional_jaccards) {
+						start_index = target_jaccard_indices.size();
+					}
+					/// do we even have indices left for reporting?
+					if (!(start_index >= target_jaccard_indices.size())) {
+						for (uint64_t n = start_index; n < target_jaccard_indices.size(); n++) {
+							additional_jaccards_to_report.push_back(target_jaccard_indices[n].jaccard);
+						}
+					}
+					/// only report the Nth final steps
+					for (auto& target_jaccard_index : target_jaccard_indices) {
+						if (i == n_best_mappings) {
+							break;
+						}
+						step_handle_t final_target_step = target_jaccard_index.step;
+						double final_target_jaccard = target_jaccard_index.jaccard;
+
+						uint64_t target_min_pos = step_index.get_position(final_target_step, graph); // 0-based starting position in BED
+						uint64_t target_max_pos = target_min_pos + graph.get_length(graph.get_handle_of_step(final_target_step)); // 1-based ending position in BED
+
+						/// add BED record to queue of the BED writer
+						bed_writer_thread.append(target_path, target_min_pos, target_max_pos,
+												 query_path_name, step_index.get_position(cur_step, graph),
+												 final_target_jaccard, walk_from_front, additional_jaccards_to_report);
+						i++;
 					}
 				}
 				if (progress) {
@@ -29,6 +29,9 @@ namespace odgi {
 		/// #jaccard: The jaccard index of the query and target path around the region of the step where the query hit the target.
 		/// #walk_from_front: If 1 we walked from the head of the target path. Else we walked from the tail and it is 0.
 		/// add_jaccards: The additional jaccards of candidate reference step(s). Comma-separated.
+		/// With a sketch_size, the jaccard indices are estimated from bottom-k sketches of the windows of the steps, and the
+		/// best estimates and those that could tie them are computed exactly. The reported mappings are then those of the
+		/// exact computation unless an estimate is off by more than its expected error. The additional jaccards stay estimates.
 		void walk_tips(const graph_t& graph,
 				 const std::vector<path_handle_t>& paths,
 				 const path_handle_t& target_path_t,
@@ -44,6 +47,7 @@ namespace odgi {
 				 ska::flat_hash_set<std::string>& not_visited_set,
 				 const uint64_t& n_best_mappings,
 				 const uint64_t& walking_dist,
-				 const bool& report_additional_jaccards);
+				 const bool& report_additional_jaccards,
+				 const uint64_t& sketch_size);
 	}
 }
@@ -24,145 +24,340 @@ std::map<char, uint64_t> gfa_line_counts(const char* filename) {
     return counts;
 }
 
+std::vector<gfa_chunk_t> gfa_chunks(const char* buf, const size_t& size, const uint64_t& n_chunks) {
+    std::vector<gfa_chunk_t> chunks;
+    const char* begin = buf;
+    const char* buf_end = buf + size;
+    for (uint64_t i = 1; i <= n_chunks && begin < buf_end; ++i) {
+        const char* end = buf_end;
+        if (i < n_chunks) {
+            const char* target = buf + size * i / n_chunks;
+            if (target <= begin) continue;
+            const char* newline = (const char*)std::memchr(target, '\n', buf_end - target);
+            end = (newline == nullptr ? buf_end : newline + 1);
+        }
+        chunks.push_back({begin, end});
+        begin = end;
+    }
+    return chunks;
+}
+
+void gfa_parse_error(const char* line, const char* end, const std::string& problem) {
+    std::cerr << std::endl // pad
+              << "[odgi::gfa_to_handle] " << problem << " in GFA line '"
+              << std::string(line, std::min(end, line + 128)) << "'" << std::endl;
+    exit(1);
+}
+
+void gfa_parse_errors_t::record(const char* line, const char* end, const std::string& problem) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (first_line == nullptr || line < first_line) {
+        first_line = line;
+        first_end = end;
+        first_problem = problem;
+    }
+    failed.store(true, std::memory_order_relaxed);
+}
+
+void gfa_parse_errors_t::exit_if_any(void) const {
+    if (any()) {
+        gfa_parse_error(first_line, first_end, first_problem);
+    }
+}
+
+/// The per-chunk results of the first scan over the file
+struct gfa_scan_t {
+    uint64_t node_count = 0;
+    uint64_t edge_count = 0;
+    uint64_t min_id = std::numeric_limits<uint64_t>::max();
+    uint64_t max_id = 0;
+    // P and W lines in file order
+    std::vector<std::pair<const char*, const char*>> path_lines;
+};
+
+/// A path and the line that describes its steps
+struct gfa_path_record_t {
+    handlegraph::path_handle_t path;
+    const char* line;
+    const char* end;
+};
+
+/// Build the PanSN path name sample#hap#seqid[:start-end] for a W line
+std::string gfa_walk_name(const char* line, const char* end) {
+    const char* sample = next_gfa_field(line, end);
+    const char* hap = next_gfa_field(sample, end);
+    const char* seq_id = next_gfa_field(hap, end);
+    const char* seq_start = next_gfa_field(seq_id, end);
+    const char* seq_end = next_gfa_field(seq_start, end);
+    std::string name = std::string(sample, gfa_field_end(sample, end))
+        + "#" + std::string(hap, gfa_field_end(hap, end))
+        + "#" + std::string(seq_id, gfa_field_end(seq_id, end));
+    std::string start(seq_start, gfa_field_end(seq_start, end));
+    std::string stop(seq_end, gfa_field_end(seq_end, end));
+    if (!start.empty() && start != "*" && !stop.empty() && stop != "*") {
+        name += ":" + start + "-" + stop;
+    }
+    return name;
+}
+
+std::string gfa_path_name(const char* line, const char* end) {
+    if (*line == 'P') {
+        const char* name = next_gfa_field(line, end);
+        return std::string(name, gfa_field_end(name, end));
+    } else {
+        return gfa_walk_name(line, end);
+    }
+}
+
+bool for_each_gfa_path_step(const char* line, const char* end,
+                            const std::function<void(const uint64_t&, const bool&)>& func) {
+    if (*line == 'P') {
+        // P name 1+,2-,3+ overlaps
+        const char* p = next_gfa_field(next_gfa_field(line, end), end);
+        const char* steps_end = gfa_field_end(p, end);
+        while (p < steps_end) {
+            uint64_t id = 0;
+            if (!parse_gfa_uint(p, steps_end, id) || p == steps_end
+                || (*p != '+' && *p != '-')) {
+                return false;
+            }
+            func(id, *p == '-');
+            ++p; // orientation
+            if (p < steps_end && *p == ',') ++p;
+        }
+    } else {
+        // W sample hap seq_id start end >1<2>3
+        const char* p = line;
+        for (uint8_t f = 0; f < 6; ++f) {
+            p = next_gfa_field(p, end);
+        }
+        const char* walk_end = gfa_field_end(p, end);
+        while (p < walk_end) {
+            const bool is_rev = (*p == '<');
+            if (*p != '<' && *p != '>') {
+                return false;
+            }
+            ++p;
+            uint64_t id = 0;
+            if (!parse_gfa_uint(p, walk_end, id)) {
+                return false;
+            }
+            func(id, is_rev);
+        }
+    }
+    return true;
+}
+
 void gfa_to_handle(const string& gfa_filename,
-                   handlegraph::MutablePathMutableHandleGraph* graph,
+                   odgi::graph_t* graph,
                    bool compact_ids,
                    uint64_t n_threads,
                    bool progress) {
 
     n_threads = (n_threads == 0 ? 1 : n_threads);
-    char* filename = (char*) gfa_filename.c_str();
-    //std::cerr << "filename is " << filename << std::endl;
-    gfak::GFAKluge gg;
-    uint64_t i = 0;
+    int gfa_fd = -1;
+    char* gfa_buf = nullptr;
+    size_t gfa_filesize = gfak::mmap_open(gfa_filename, gfa_buf, gfa_fd);
+    if (gfa_fd == -1) {
+        std::cerr << "[odgi::gfa_to_handle] error: couldn't open GFA file " << gfa_filename << "." << std::endl;
+        exit(1);
+    }
+    // several chunks per thread to balance uneven line lengths
+    const std::vector<gfa_chunk_t> chunks = gfa_chunks(gfa_buf, gfa_filesize, n_threads * 16);
+
+    // the threads can't bail out of the parallel loops, so they record what they can't parse, and we bail out after
+    gfa_parse_errors_t errors;
+
+    // in parallel scan over the file to count nodes and edges, find the id range, and find the paths
+    std::vector<gfa_scan_t> scans(chunks.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+    for (uint64_t c = 0; c < chunks.size(); ++c) {
+        auto& scan = scans[c];
+        for_each_gfa_line(chunks[c], [&](const char* line, const char* end) {
+            switch (*line) {
+            case 'S': {
+                const char* p = next_gfa_field(line, end);
+                uint64_t id = 0;
+                if (!parse_gfa_uint(p, end, id) || id == 0 || (p < end && *p != '\t')) {
+                    errors.record(line, end, "id parsing failure");
+                    break;
+                }
+                scan.min_id = std::min(scan.min_id, id);
+                scan.max_id = std::max(scan.max_id, id);
+                ++scan.node_count;
+                break;
+            }
+            case 'L':
+                ++scan.edge_count;
+                break;
+            case 'P':
+            case 'W':
+                scan.path_lines.push_back(std::make_pair(line, end));
+                break;
+            default:
+                break;
+            }
+        });
+    }
+    errors.exit_if_any();
     uint64_t min_id = std::numeric_limits<uint64_t>::max();
-    uint64_t max_id = std::numeric_limits<uint64_t>::min();
-    std::map<char, uint64_t> line_counts;
-    // in parallel scan over the file to count edges and sequences
-    {
-        std::thread x(
-            [&]() {
-                gg.for_each_sequence_line_in_file(
-                    filename,
-                    [&](gfak::sequence_elem s) {
-                        uint64_t id = stol(s.name);
-                        min_id = std::min(min_id, id);
-                        max_id = std::max(max_id, id);
-                    });
-            });
-        line_counts = gfa_line_counts(filename);
-        x.join();
-    }
-    uint64_t id_increment = (compact_ids ? min_id - 1 : 0);
-    uint64_t node_count = line_counts['S'];
-    uint64_t edge_count = line_counts['L'];
-    uint64_t path_count = line_counts['P'];
-    // build the nodes
-    {
+    uint64_t max_id = 0;
+    uint64_t node_count = 0;
+    uint64_t edge_count = 0;
+    uint64_t path_count = 0;
+    for (auto& scan : scans) {
+        min_id = std::min(min_id, scan.min_id);
+        max_id = std::max(max_id, scan.max_id);
+        node_count += scan.node_count;
+        edge_count += scan.edge_count;
+        path_count += scan.path_lines.size();
+    }
+    uint64_t id_increment = (compact_ids && node_count ? min_id - 1 : 0);
+    // true if an id of the file is that of one of its S lines, once the nodes are built
+    auto has_segment = [&](const uint64_t& id) {
+        return id > id_increment && id <= max_id && graph->has_node(id - id_increment);
+    };
+
+    // build the nodes straight into the pre-sized node storage
+    std::atomic<uint64_t> duplicate_id(0);
+    if (node_count > 0) {
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 node_count, "[odgi::gfa_to_handle] building nodes:");
         }
-        gg.for_each_sequence_line_in_file(
-            filename,
-            [&](const gfak::sequence_elem& s) {
-                uint64_t id = stol(s.name);
-                graph->create_handle(s.sequence, id - id_increment);
-                if (progress) progress_meter->increment(1);
+        graph->create_handles(
+            max_id - id_increment,
+            [&](const std::function<bool(const nid_t&, const std::string_view&)>& create) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+                for (uint64_t c = 0; c < chunks.size(); ++c) {
+                    if (errors.any()) continue;
+                    uint64_t created = 0;
+                    for_each_gfa_line(chunks[c], [&](const char* line, const char* end) {
+                        if (*line != 'S') return;
+                        const char* p = next_gfa_field(line, end);
+                        uint64_t id = 0;
+                        parse_gfa_uint(p, end, id); // validated in the scan
+                        const char* seq = next_gfa_field(p, end);
+                        const char* seq_end = gfa_field_end(seq, end);
+                        if (seq == seq_end) {
+                            errors.record(line, end, "empty sequence");
+                            return;
+                        }
+                        if (!create(id - id_increment, std::string_view(seq, seq_end - seq))) {
+                            duplicate_id.store(id);
+                        }
+                        ++created;
+                    });
+                    if (progress) progress_meter->increment(created);
+                }
             });
         if (progress) {
             progress_meter->finish();
         }
     }
+    errors.exit_if_any();
+    if (duplicate_id.load() != 0) {
+        gfak::mmap_close(gfa_buf, gfa_fd, gfa_filesize);
+        throw std::runtime_error("[odgi::gfa_to_handle] error: segment id " + std::to_string(duplicate_id.load())
+                                 + " is given by more than one S line in " + gfa_filename + ".");
+    }
 
-    {
+    // build the edges, node locks make create_edge safe to call concurrently
+    if (edge_count > 0) {
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 edge_count, "[odgi::gfa_to_handle] building edges:");
         }
-        gg.for_each_edge_line_in_file(
-            filename,
-            [&](const gfak::edge_elem& e) {
-                if (e.source_name.empty()) return;
-                handlegraph::handle_t a = graph->get_handle(stol(e.source_name) - id_increment, !e.source_orientation_forward);
-                handlegraph::handle_t b = graph->get_handle(stol(e.sink_name) - id_increment, !e.sink_orientation_forward);
-                graph->create_edge(a, b);
-                if (progress) progress_meter->increment(1);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+        for (uint64_t c = 0; c < chunks.size(); ++c) {
+            if (errors.any()) continue;
+            uint64_t created = 0;
+            for_each_gfa_line(chunks[c], [&](const char* line, const char* end) {
+                if (*line != 'L') return;
+                const char* p = next_gfa_field(line, end);
+                uint64_t from = 0;
+                uint64_t to = 0;
+                if (!parse_gfa_uint(p, end, from)) {
+                    errors.record(line, end, "id parsing failure");
+                    return;
+                }
+                p = next_gfa_field(p, end);
+                const bool from_rev = (p < end && *p == '-');
+                p = next_gfa_field(p, end);
+                if (!parse_gfa_uint(p, end, to)) {
+                    errors.record(line, end, "id parsing failure");
+                    return;
+                }
+                p = next_gfa_field(p, end);
+                const bool to_rev = (p < end && *p == '-');
+                if (!has_segment(from) || !has_segment(to)) {
+                    errors.record(line, end, "edge to a missing node");
+                    return;
+                }
+                graph->create_edge(graph->get_handle(from - id_increment, from_rev),
+                                   graph->get_handle(to - id_increment, to_rev));
+                ++created;
             });
+            if (progress) progress_meter->increment(created);
+        }
         if (progress) {
             progress_meter->finish();
         }
     }
+    errors.exit_if_any();
 
     if (path_count > 0) {
+        // create the path handles in file order so that path ids are stable
+        std::vector<gfa_path_record_t> path_records;
+        path_records.reserve(path_count);
+        for (auto& scan : scans) {
+            for (auto& l : scan.path_lines) {
+                path_records.push_back({graph->create_path_handle(gfa_path_name(l.first, l.second)),
+                                        l.first, l.second});
+            }
+        }
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 path_count, "[odgi::gfa_to_handle] building paths:");
         }
-        gfa_path_queue_t path_queue;
-        std::mutex logging_mutex;
-        std::atomic<bool> work_todo{};
-        uint64_t idx = 0;
-        auto worker =
-            [&](uint64_t tid) {
-                while (work_todo.load()) {
-                    path_elem_t * p;
-                    if (path_queue.try_pop(p)) {
-                        uint64_t i = 0;
-                        for (auto& s : p->gfak.segment_names) {
-                            uint64_t id = 0;
-                            try {
-                                id = std::stoull(s) - id_increment;
-                            } catch (...) {
-                                std::cerr << std::endl // pad
-                                          << "[odgi::gfa_to_handle] id parsing failure for path "
-                                          << graph->get_path_name(p->path)
-                                          << " attempting to parse node id from '" << s << "'" << std::endl;
-                                throw;
-                            }
-                            graph->append_step(p->path,
-                                               graph->get_handle(id,
-                                                                 // in gfak, true == +
-                                                                 !p->gfak.orientations[i++]));
-                        }
-                        delete p;
-                        if (progress) progress_meter->increment(1);
-                    } else {
-                        std::this_thread::sleep_for(std::chrono::nanoseconds(1));
-                    }
+        // each path is built by one thread, writing its steps to the node step buffers without locking
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+        for (uint64_t i = 0; i < path_records.size(); ++i) {
+            if (errors.any()) continue;
+            const auto& record = path_records[i];
+            std::vector<handle_t> handles;
+            bool missing = false;
+            const bool parsed = for_each_gfa_path_step(record.line, record.end, [&](const uint64_t& id, const bool& is_rev) {
+                if (!has_segment(id)) {
+                    missing = true;
+                } else if (!missing) {
+                    handles.push_back(graph->get_handle(id - id_increment, is_rev));
                 }
-            };
-
-        std::vector<std::thread> workers;
-        workers.reserve(n_threads);
-        work_todo.store(true);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers.emplace_back(worker, t);
-        }
-
-        gg.for_each_path_line_in_file(
-            filename,
-            [&](const gfak::path_elem& path) {
-                handlegraph::path_handle_t p_h = graph->create_path_handle(path.name);
-                path_elem_t* p = new path_elem_t({p_h, path});
-                path_queue.push(p);
             });
-
-        while (!path_queue.was_empty()) {
-            std::this_thread::sleep_for(std::chrono::nanoseconds(1));
-        }
-        work_todo.store(false);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers[t].join();
+            if (!parsed || missing) {
+                const std::string name = gfa_path_name(record.line, record.end);
+                errors.record(record.line, record.end, parsed ? "step on a missing node in path " + name
+                                                              : "step parsing failure for path " + name);
+                continue;
+            }
+            graph->append_steps_buffered(record.path, handles);
+            if (progress) progress_meter->increment(1);
         }
+        errors.exit_if_any();
+        graph->merge_step_buffers();
         if (progress) {
             progress_meter->finish();
+            std::cerr << "[odgi::gfa_to_handle] node lock contention: "
+                      << node_lock_stats.contended.load() << " contended acquisitions, "
+                      << node_lock_stats.yields.load() << " yields" << std::endl;
         }
     }
 
+    gfak::mmap_close(gfa_buf, gfa_fd, gfa_filesize);
+
     if (compact_ids) {
         graph->optimize();
     }
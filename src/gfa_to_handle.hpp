@@ -10,29 +10,107 @@
 #include "gfakluge.hpp"
 #include <iostream>
 #include <limits>
+#include <cstring>
 #include <handlegraph/mutable_path_mutable_handle_graph.hpp>
 #include <atomic>
-#include <thread>
-#include <mutex>
 #include <functional>
-#include "atomic_queue.h"
+#include <mutex>
+#include "odgi.hpp"
 #include "progress.hpp"
 
 namespace odgi {
 
-struct path_elem_t {
-    handlegraph::path_handle_t path;
-    gfak::path_elem gfak;
+/// A range of whole lines in a memory mapped GFA file
+struct gfa_chunk_t {
+    const char* begin;
+    const char* end;
 };
 
-typedef atomic_queue::AtomicQueue<path_elem_t*, 2 << 10> gfa_path_queue_t;
-
 std::map<char, uint64_t> gfa_line_counts(const char* filename);
 
+/// Split the buffer into at most n_chunks ranges that start at line starts and end after a newline
+std::vector<gfa_chunk_t> gfa_chunks(const char* buf, const size_t& size, const uint64_t& n_chunks);
+
+/// Call func with the bounds of each non-empty line in the chunk, without the trailing newline
+template<typename Func>
+void for_each_gfa_line(const gfa_chunk_t& chunk, const Func& func) {
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* newline = (const char*)std::memchr(line, '\n', chunk.end - line);
+        const char* line_end = (newline == nullptr ? chunk.end : newline);
+        const char* content_end = line_end;
+        if (content_end > line && *(content_end - 1) == '\r') {
+            --content_end;
+        }
+        if (content_end > line) {
+            func(line, content_end);
+        }
+        line = line_end + 1;
+    }
+}
+
+/// Return the start of the field after the one at p, or end if there is none
+inline const char* next_gfa_field(const char* p, const char* end) {
+    const char* tab = (const char*)std::memchr(p, '\t', end - p);
+    return (tab == nullptr ? end : tab + 1);
+}
+
+/// Return the end of the field starting at p
+inline const char* gfa_field_end(const char* p, const char* end) {
+    const char* tab = (const char*)std::memchr(p, '\t', end - p);
+    return (tab == nullptr ? end : tab);
+}
+
+/// Parse an unsigned decimal integer at p, advancing p past it. Returns false if there are no digits,
+/// or more than the 19 that always fit in 64 bits.
+inline bool parse_gfa_uint(const char*& p, const char* end, uint64_t& value) {
+    const char* start = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return p != start && p - start <= 19;
+}
+
+/// Report a line we cannot parse and bail out
+void gfa_parse_error(const char* line, const char* end, const std::string& problem);
+
+/// The problems found while parsing lines on several threads, which can't bail out themselves: the one on the
+/// earliest of the lines recorded is reported with gfa_parse_error once the threads are done
+class gfa_parse_errors_t {
+public:
+    /// Record a problem with a line
+    void record(const char* line, const char* end, const std::string& problem);
+    /// true if a problem was recorded, so that the threads can skip the rest of their work
+    bool any(void) const { return failed.load(std::memory_order_relaxed); }
+    /// The earliest line with a problem, or nullptr if there is none, and its problem
+    const char* line(void) const { return first_line; }
+    const std::string& problem(void) const { return first_problem; }
+    /// Report the problem on the earliest line and bail out, if there is one
+    void exit_if_any(void) const;
+private:
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    const char* first_line = nullptr;
+    const char* first_end = nullptr;
+    std::string first_problem;
+};
+
+/// Return the name of the path described by a P line, or the PanSN name sample#hap#seqid[:start-end] of a W line
+std::string gfa_path_name(const char* line, const char* end);
+
+/// Call func(id, is_rev) for each step of a P or W line, in path order.
+/// Returns false, with the steps up to there given to func, if a step can't be parsed.
+bool for_each_gfa_path_step(const char* line, const char* end,
+                            const std::function<void(const uint64_t&, const bool&)>& func);
+
 /// Fills a handle graph with an instantiation of a sequence graph from a GFA file.
 /// Handle graph must be empty when passed into function.
+/// S, L, P and W lines are parsed on all threads from a memory mapping of the file.
+/// Throws std::runtime_error if a segment id is given by more than one S line.
 void gfa_to_handle(const string& gfa_filename,
-                   handlegraph::MutablePathMutableHandleGraph* graph,
+                   odgi::graph_t* graph,
                    bool compact_ids,
                    uint64_t n_threads,
                    bool show_progress);
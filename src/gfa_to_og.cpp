@@ -0,0 +1,453 @@
+#include "gfa_to_og.hpp"
+#include <arpa/inet.h>
+#include <sstream>
+
+namespace odgi {
+
+gfa_id_set_t::gfa_id_set_t(const uint64_t& max_id) {
+    bits.resize(max_id / 64 + 1, 0);
+}
+
+void gfa_id_set_t::insert(const uint64_t& id) {
+    bits[id / 64] |= (uint64_t)1 << (id % 64);
+}
+
+bool gfa_id_set_t::contains(const uint64_t& id) const {
+    return id / 64 < bits.size() && (bits[id / 64] >> (id % 64)) & 1;
+}
+
+void gfa_id_set_t::index(void) {
+    word_ranks.resize(bits.size());
+    uint64_t rank = 0;
+    for (uint64_t i = 0; i < bits.size(); ++i) {
+        word_ranks[i] = rank;
+        rank += __builtin_popcountll(bits[i]);
+    }
+}
+
+uint64_t gfa_id_set_t::rank(const uint64_t& id) const {
+    const uint64_t word = id / 64;
+    const uint64_t bit = id % 64;
+    const uint64_t mask = (bit == 63 ? ~(uint64_t)0 : ((uint64_t)1 << (bit + 1)) - 1);
+    return word_ranks[word] + __builtin_popcountll(bits[word] & mask);
+}
+
+/// Bail out with an error about the graph being built
+void gfa_to_og_error(const std::string& problem) {
+    std::cerr << std::endl // pad
+              << "[odgi::gfa_to_og] error: " << problem << std::endl;
+    exit(1);
+}
+
+// multimap values, the all zero tuple is the null value and never occurs as a record
+// S: node id -> (offset of the sequence in the GFA, sequence length)
+typedef std::tuple<uint64_t, uint64_t> gfa_seq_record_t;
+// L: node id -> (other id, other rev, to curr, on rev) as the node itself stores it
+typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> gfa_edge_record_t;
+// P/W: node id -> (step ordinal, path id, is rev), the ordinal orders the steps of all paths
+typedef std::tuple<uint64_t, uint64_t, uint64_t> gfa_step_record_t;
+// step ordinal -> (node id, rank of the step on the node, is rev)
+typedef std::tuple<uint64_t, uint64_t, uint64_t> gfa_step_rank_t;
+// node id -> (rank, path id, step flags, prev id, prev rank, next id, next rank)
+typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> gfa_step_link_t;
+
+const uint64_t GFA_STEP_REV = 1;
+const uint64_t GFA_STEP_START = 2;
+const uint64_t GFA_STEP_END = 4;
+
+/// An edge and its reverse complement are the same edge, keep the orientation of it that sorts first
+void gfa_canonical_edge(uint64_t& from, bool& from_rev, uint64_t& to, bool& to_rev) {
+    if (std::make_tuple(to, !to_rev, from, !from_rev) < std::make_tuple(from, from_rev, to, to_rev)) {
+        std::swap(from, to);
+        std::swap(from_rev, to_rev);
+        from_rev = !from_rev;
+        to_rev = !to_rev;
+    }
+}
+
+/// The first and last steps and the length of a path
+struct gfa_path_extent_t {
+    std::string name;
+    uint64_t first_ordinal = 0;
+    uint64_t length = 0;
+    step_handle_t first;
+    step_handle_t last;
+};
+
+void gfa_to_og(const std::string& gfa_filename,
+               const std::string& og_filename,
+               bool compact_ids,
+               uint64_t n_threads,
+               uint64_t memory_budget,
+               bool progress) {
+
+    n_threads = (n_threads == 0 ? 1 : n_threads);
+    memory_budget = std::max(memory_budget, (uint64_t)1);
+    int gfa_fd = -1;
+    char* gfa_buf = nullptr;
+    size_t gfa_filesize = gfak::mmap_open(gfa_filename, gfa_buf, gfa_fd);
+    if (gfa_fd == -1) {
+        gfa_to_og_error("couldn't open GFA file " + gfa_filename + ".");
+    }
+    std::ofstream out(og_filename.c_str(), std::ios::binary);
+    if (!out) {
+        gfa_to_og_error("couldn't open " + og_filename + " for writing.");
+    }
+    const std::vector<gfa_chunk_t> chunks = gfa_chunks(gfa_buf, gfa_filesize, n_threads * 16);
+
+    // find the id range in parallel so that we can size the id set
+    uint64_t max_id = 0;
+    gfa_parse_errors_t errors;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads) reduction(max:max_id)
+    for (uint64_t c = 0; c < chunks.size(); ++c) {
+        if (errors.any()) continue;
+        for_each_gfa_line(chunks[c], [&](const char* line, const char* end) {
+            if (*line != 'S') return;
+            const char* p = next_gfa_field(line, end);
+            uint64_t id = 0;
+            if (!parse_gfa_uint(p, end, id) || id == 0 || (p < end && *p != '\t')) {
+                errors.record(line, end, "id parsing failure");
+                return;
+            }
+            max_id = std::max(max_id, id);
+        });
+    }
+    errors.exit_if_any();
+
+    const std::string base = xp::temp_file::create("odgi-build");
+    const std::string seq_idx = base + ".seq.mm";
+    const std::string edge_idx = base + ".edge.mm";
+    const std::string step_idx = base + ".step.mm";
+    const std::string rank_idx = base + ".rank.mm";
+    const std::string link_idx = base + ".link.mm";
+
+    // spill the records in one pass over the file, in file order so that path ids and step ordinals are stable
+    gfa_id_set_t ids(max_id);
+    uint64_t min_id = std::numeric_limits<uint64_t>::max();
+    uint64_t edge_side_count = 0;
+    uint64_t step_count = 0;
+    std::vector<gfa_path_extent_t> paths;
+    mmmulti::map<uint64_t, gfa_seq_record_t> seq_mm(seq_idx, std::make_tuple(0, 0));
+    mmmulti::map<uint64_t, gfa_edge_record_t> edge_mm(edge_idx, std::make_tuple(0, 0, 0, 0));
+    mmmulti::map<uint64_t, gfa_step_record_t> step_mm(step_idx, std::make_tuple(0, 0, 0));
+    seq_mm.open_writer();
+    edge_mm.open_writer();
+    step_mm.open_writer();
+    {
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                gfa_filesize, "[odgi::gfa_to_og] spilling records:");
+        }
+        for (auto& chunk : chunks) {
+            for_each_gfa_line(chunk, [&](const char* line, const char* end) {
+                switch (*line) {
+                case 'S': {
+                    const char* p = next_gfa_field(line, end);
+                    uint64_t id = 0;
+                    parse_gfa_uint(p, end, id); // validated in the scan
+                    const char* seq = next_gfa_field(p, end);
+                    const char* seq_end = gfa_field_end(seq, end);
+                    if (seq == seq_end) {
+                        gfa_parse_error(line, end, "empty sequence");
+                    }
+                    if (ids.contains(id)) {
+                        gfa_parse_error(line, end, "duplicate node id");
+                    }
+                    ids.insert(id);
+                    min_id = std::min(min_id, id);
+                    seq_mm.append(id, std::make_tuple(seq - gfa_buf, seq_end - seq));
+                    break;
+                }
+                case 'L': {
+                    const char* p = next_gfa_field(line, end);
+                    uint64_t from = 0;
+                    uint64_t to = 0;
+                    if (!parse_gfa_uint(p, end, from)) {
+                        gfa_parse_error(line, end, "id parsing failure");
+                    }
+                    p = next_gfa_field(p, end);
+                    bool from_rev = (p < end && *p == '-');
+                    p = next_gfa_field(p, end);
+                    if (!parse_gfa_uint(p, end, to)) {
+                        gfa_parse_error(line, end, "id parsing failure");
+                    }
+                    p = next_gfa_field(p, end);
+                    bool to_rev = (p < end && *p == '-');
+                    if (from == 0 || from > max_id || to == 0 || to > max_id) {
+                        gfa_parse_error(line, end, "edge to a missing node");
+                    }
+                    ++edge_side_count;
+                    // each side records the edge as create_edge would, duplicates are removed on assembly
+                    gfa_canonical_edge(from, from_rev, to, to_rev);
+                    edge_mm.append(from, std::make_tuple(to, to_rev, false, from_rev));
+                    if (from != to) {
+                        edge_mm.append(to, std::make_tuple(from, from_rev, true, to_rev));
+                    }
+                    break;
+                }
+                case 'P':
+                case 'W': {
+                    paths.emplace_back();
+                    auto& path = paths.back();
+                    path.name = gfa_path_name(line, end);
+                    path.first_ordinal = step_count + 1;
+                    const uint64_t path_id = paths.size();
+                    const bool parsed = for_each_gfa_path_step(line, end, [&](const uint64_t& id, const bool& is_rev) {
+                        if (id == 0 || id > max_id) {
+                            gfa_parse_error(line, end, "step on a missing node in path " + path.name);
+                        }
+                        step_mm.append(id, std::make_tuple(++step_count, path_id, is_rev));
+                    });
+                    if (!parsed) {
+                        gfa_parse_error(line, end, "step parsing failure for path " + path.name);
+                    }
+                    path.length = step_count + 1 - path.first_ordinal;
+                    break;
+                }
+                default:
+                    break;
+                }
+            });
+            if (progress) progress_meter->increment(chunk.end - chunk.begin);
+        }
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
+    ids.index();
+    const uint64_t present_count = (max_id ? ids.rank(max_id) : 0);
+    // the id each node gets in the output graph
+    auto out_id = [&](const uint64_t& id) {
+        return compact_ids ? ids.rank(id) : id;
+    };
+    auto check_id = [&](const uint64_t& id, const std::string& what) {
+        if (!ids.contains(id)) {
+            gfa_to_og_error(what + " refers to node " + std::to_string(id) + ", which has no S line.");
+        }
+    };
+
+    if (progress) {
+        std::cerr << "[odgi::gfa_to_og] sorting " << present_count << " nodes and "
+                  << step_count << " steps" << std::endl;
+    }
+    // empty maps are never indexed nor queried
+    const bool has_nodes = present_count > 0;
+    const bool has_edges = edge_side_count > 0;
+    const bool has_steps = step_count > 0;
+    if (has_nodes) seq_mm.index(n_threads, max_id + 1);
+    if (has_edges) edge_mm.index(n_threads, max_id + 1);
+    if (has_steps) step_mm.index(n_threads, max_id + 1);
+
+    // the steps on a node are ranked in path order, find the rank of every step
+    mmmulti::map<uint64_t, gfa_step_rank_t> rank_mm(rank_idx, std::make_tuple(0, 0, 0));
+    rank_mm.open_writer();
+    if (has_steps) {
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                max_id, "[odgi::gfa_to_og] ranking steps:");
+        }
+        for (uint64_t id = 1; id <= max_id; ++id) {
+            uint64_t rank = 0;
+            step_mm.for_values_of(id, [&](const gfa_step_record_t& step) {
+                rank_mm.append(std::get<0>(step), std::make_tuple(id, rank++, std::get<2>(step)));
+            });
+            if (rank > 0) {
+                check_id(id, "a path");
+            }
+            if (progress) progress_meter->increment(1);
+        }
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
+    std::remove(step_idx.c_str());
+    if (has_steps) rank_mm.index(n_threads, step_count + 1);
+
+    // walk each path to link its steps, and spill the links back onto the nodes
+    mmmulti::map<uint64_t, gfa_step_link_t> link_mm(link_idx, std::make_tuple(0, 0, 0, 0, 0, 0, 0));
+    link_mm.open_writer();
+    {
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                step_count, "[odgi::gfa_to_og] linking steps:");
+        }
+        auto step_at = [&](const uint64_t& ordinal) {
+            gfa_step_rank_t step;
+            rank_mm.for_values_of(ordinal, [&](const gfa_step_rank_t& s) { step = s; });
+            return step;
+        };
+        auto step_handle = [&](const gfa_step_rank_t& step) {
+            step_handle_t h;
+            as_integers(h)[0] = as_integer(number_bool_packing::pack(out_id(std::get<0>(step)) - 1, std::get<2>(step)));
+            as_integers(h)[1] = std::get<1>(step);
+            return h;
+        };
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            auto& path = paths[i];
+            as_integers(path.first)[0] = 0;
+            as_integers(path.first)[1] = 0;
+            path.last = path.first;
+            if (path.length == 0) continue;
+            gfa_step_rank_t prev;
+            gfa_step_rank_t curr = step_at(path.first_ordinal);
+            gfa_step_rank_t next;
+            path.first = step_handle(curr);
+            for (uint64_t j = 0; j < path.length; ++j) {
+                const bool is_start = (j == 0);
+                const bool is_end = (j + 1 == path.length);
+                if (!is_end) {
+                    next = step_at(path.first_ordinal + j + 1);
+                }
+                link_mm.append(std::get<0>(curr),
+                               std::make_tuple(std::get<1>(curr), i + 1,
+                                               (std::get<2>(curr) ? GFA_STEP_REV : 0)
+                                               | (is_start ? GFA_STEP_START : 0) | (is_end ? GFA_STEP_END : 0),
+                                               is_start ? 0 : std::get<0>(prev), is_start ? 0 : std::get<1>(prev),
+                                               is_end ? 0 : std::get<0>(next), is_end ? 0 : std::get<1>(next)));
+                if (is_end) {
+                    path.last = step_handle(curr);
+                }
+                prev = curr;
+                curr = next;
+            }
+            if (progress) progress_meter->increment(path.length);
+        }
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
+    std::remove(rank_idx.c_str());
+    if (has_steps) link_mm.index(n_threads, max_id + 1);
+
+    // write the header, the edge count is patched in once the edges have been deduplicated
+    const uint64_t node_count = compact_ids ? present_count : max_id;
+    const nid_t out_max_id = present_count ? out_id(max_id) : 0;
+    const nid_t out_min_id = present_count ? out_id(min_id) : 0;
+    uint64_t edge_count = 0;
+    const uint64_t path_count = paths.size();
+    const nid_t id_increment = 0;
+    uint32_t magic_number = htonl(ODGI_MAGIC_NUMBER);
+    out.write((char*)&magic_number,sizeof(magic_number));
+    out.write((char*)&out_max_id,sizeof(out_max_id));
+    out.write((char*)&out_min_id,sizeof(out_min_id));
+    out.write((char*)&node_count,sizeof(node_count));
+    const auto edge_count_pos = out.tellp();
+    out.write((char*)&edge_count,sizeof(edge_count));
+    out.write((char*)&path_count,sizeof(path_count)); // path count
+    out.write((char*)&path_count,sizeof(path_count)); // next path handle
+    out.write((char*)&id_increment,sizeof(id_increment));
+
+    // assemble and write the node records, sizing each block from the bytes per id of the last one
+    {
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                max_id, "[odgi::gfa_to_og] writing nodes:");
+        }
+        node_t empty_node;
+        std::vector<std::string> runs(n_threads);
+        std::vector<std::vector<uint64_t>> run_offsets(n_threads);
+        std::vector<uint64_t> self_edges(n_threads);
+        std::vector<uint64_t> edge_sides(n_threads);
+        uint64_t block_ids = std::min((uint64_t)4096, ODGI_NODE_BLOCK_SIZE);
+        for (uint64_t block_begin = 1; block_begin <= max_id; ) {
+            const uint64_t block_end = std::min(max_id + 1, block_begin + block_ids);
+            const uint64_t span = block_end - block_begin;
+#pragma omp parallel for schedule(static, 1) num_threads(n_threads)
+            for (uint64_t t = 0; t < n_threads; ++t) {
+                const uint64_t begin = block_begin + span * t / n_threads;
+                const uint64_t end = block_begin + span * (t + 1) / n_threads;
+                std::ostringstream run;
+                run_offsets[t].clear();
+                std::vector<gfa_edge_record_t> edges;
+                for (uint64_t id = begin; id < end; ++id) {
+                    if (!ids.contains(id)) {
+                        if (!compact_ids) {
+                            // a gap in the id space is stored as a deleted node
+                            run_offsets[t].push_back(run.tellp());
+                            empty_node.serialize(run);
+                        }
+                        continue;
+                    }
+                    node_t node;
+                    node.set_id(out_id(id));
+                    seq_mm.for_values_of(id, [&](const gfa_seq_record_t& seq) {
+                        node.set_sequence(std::string(gfa_buf + std::get<0>(seq), std::get<1>(seq)));
+                    });
+                    edges.clear();
+                    if (has_edges) edge_mm.for_values_of(id, [&](const gfa_edge_record_t& edge) {
+                        edges.push_back(edge);
+                    });
+                    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+                    for (auto& edge : edges) {
+                        const uint64_t other_id = std::get<0>(edge);
+                        check_id(other_id, "an edge");
+                        node.add_edge(out_id(other_id), std::get<1>(edge), std::get<2>(edge), std::get<3>(edge));
+                        if (other_id == id) {
+                            ++self_edges[t];
+                        } else {
+                            ++edge_sides[t];
+                        }
+                    }
+                    // the links come sorted by their rank on the node
+                    if (has_steps) link_mm.for_values_of(id, [&](const gfa_step_link_t& link) {
+                        const uint64_t flags = std::get<2>(link);
+                        const bool is_start = flags & GFA_STEP_START;
+                        const bool is_end = flags & GFA_STEP_END;
+                        node.add_path_step(std::get<1>(link), flags & GFA_STEP_REV,
+                                           is_start, is_end,
+                                           is_start ? 0 : out_id(std::get<3>(link)), std::get<4>(link),
+                                           is_end ? 0 : out_id(std::get<5>(link)), std::get<6>(link));
+                    });
+                    run_offsets[t].push_back(run.tellp());
+                    node.serialize(run);
+                }
+                runs[t] = run.str();
+            }
+            uint64_t block_bytes = 0;
+            for (auto& run : runs) {
+                block_bytes += run.size();
+            }
+            graph_t::write_node_block(out, runs, run_offsets);
+            if (progress) progress_meter->increment(span);
+            block_begin = block_end;
+            block_ids = std::max((uint64_t)1,
+                                 std::min(ODGI_NODE_BLOCK_SIZE,
+                                          block_bytes ? memory_budget * span / block_bytes : ODGI_NODE_BLOCK_SIZE));
+        }
+        // every other edge has been seen from both of its sides
+        uint64_t sides = 0;
+        for (uint64_t t = 0; t < n_threads; ++t) {
+            edge_count += self_edges[t];
+            sides += edge_sides[t];
+        }
+        edge_count += sides / 2;
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
+
+    // the path metadata trailer
+    for (auto& path : paths) {
+        out.write((char*)&path.length,sizeof(path.length));
+        out.write((char*)&path.first,sizeof(path.first));
+        out.write((char*)&path.last,sizeof(path.last));
+        size_t k = path.name.size();
+        out.write((char*)&k,sizeof(k));
+        out.write((char*)path.name.c_str(),path.name.size());
+    }
+    out.seekp(edge_count_pos);
+    out.write((char*)&edge_count,sizeof(edge_count));
+    out.close();
+
+    gfak::mmap_close(gfa_buf, gfa_fd, gfa_filesize);
+    std::remove(seq_idx.c_str());
+    std::remove(edge_idx.c_str());
+    std::remove(link_idx.c_str());
+    xp::temp_file::remove(base);
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * \file gfa_to_og.hpp
+ *
+ * Contains a method to convert a GFA file into a serialized ODGI graph in external memory
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "gfa_to_handle.hpp"
+#include "odgi.hpp"
+#include "progress.hpp"
+#include "algorithms/xp.hpp"
+
+namespace odgi {
+
+/// Node ids seen in a GFA, with the rank of each present id so that the id space can be compacted
+class gfa_id_set_t {
+public:
+    gfa_id_set_t(const uint64_t& max_id);
+    void insert(const uint64_t& id);
+    bool contains(const uint64_t& id) const;
+    /// Prepare rank queries, call once all ids are inserted
+    void index(void);
+    /// Number of present ids in [1, id]
+    uint64_t rank(const uint64_t& id) const;
+private:
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> word_ranks;
+};
+
+/// Write the ODGI graph described by a GFA file to og_filename without loading it into memory.
+/// Nodes, edges and path steps are spilled to sorted multimaps in the temporary directory,
+/// the steps are linked there, and the node records are then assembled and written block by block,
+/// holding roughly memory_budget bytes of encoded records at a time.
+void gfa_to_og(const std::string& gfa_filename,
+               const std::string& og_filename,
+               bool compact_ids,
+               uint64_t n_threads,
+               uint64_t memory_budget,
+               bool progress);
+
+}
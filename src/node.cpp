@@ -1,13 +1,127 @@
 #include "node.hpp"
+#include <algorithm>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace odgi {
 
+node_lock_stats_t node_lock_stats = { {0}, {0} };
+
+/// Longest run of pauses between checks of a held lock before we start yielding
+const static uint64_t NODE_LOCK_MAX_SPINS = 1 << 10;
+
+void node_t::wait_for_lock(void) {
+    node_lock_stats.contended.fetch_add(1, std::memory_order_relaxed);
+    uint64_t spins = 1;
+    while (true) {
+        // wait on plain loads, so that waiting threads share the cache line instead of bouncing it
+        while (lock.load(std::memory_order_relaxed)) {
+            if (spins < NODE_LOCK_MAX_SPINS) {
+                for (uint64_t i = 0; i < spins; ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+                    _mm_pause();
+#endif
+                }
+                spins <<= 1;
+            } else {
+                node_lock_stats.yields.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+        if (!lock.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+struct node_t::buffered_steps_t {
+    uint64_t first_rank;
+    std::vector<step_t> steps;
+    buffered_steps_t* next;
+};
+
+struct node_t::step_buffer_t {
+    /// the next rank to hand out
+    std::atomic<uint64_t> next_rank;
+    /// a lock free stack of the written runs of steps
+    std::atomic<buffered_steps_t*> head;
+};
+
+uint64_t node_t::reserve_path_steps(const uint64_t& count) {
+    step_buffer_t* buffer = step_buffer.load(std::memory_order_acquire);
+    if (buffer == nullptr) {
+        // set up once per node, ranks continue from the steps already in the node
+        get_lock();
+        buffer = step_buffer.load(std::memory_order_relaxed);
+        if (buffer == nullptr) {
+            buffer = new step_buffer_t();
+            buffer->next_rank.store(path_count());
+            buffer->head.store(nullptr);
+            step_buffer.store(buffer, std::memory_order_release);
+        }
+        clear_lock();
+    }
+    return buffer->next_rank.fetch_add(count, std::memory_order_relaxed);
+}
+
+void node_t::buffer_path_steps(const uint64_t& first_rank, std::vector<step_t>&& steps) {
+    step_buffer_t* buffer = step_buffer.load(std::memory_order_acquire);
+    assert(buffer != nullptr);
+    buffered_steps_t* b = new buffered_steps_t{first_rank, std::move(steps),
+                                               buffer->head.load(std::memory_order_relaxed)};
+    while (!buffer->head.compare_exchange_weak(b->next, b,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        // b->next was reloaded by the failed exchange
+    }
+}
+
+bool node_t::has_buffered_steps(void) const {
+    return step_buffer.load(std::memory_order_acquire) != nullptr;
+}
+
+void node_t::discard_step_buffer(void) {
+    step_buffer_t* buffer = step_buffer.exchange(nullptr, std::memory_order_acquire);
+    if (buffer == nullptr) return;
+    buffered_steps_t* b = buffer->head.load();
+    while (b != nullptr) {
+        buffered_steps_t* next = b->next;
+        delete b;
+        b = next;
+    }
+    delete buffer;
+}
+
+void node_t::merge_step_buffer(void) {
+    step_buffer_t* buffer = step_buffer.exchange(nullptr, std::memory_order_acquire);
+    if (buffer == nullptr) return;
+    std::vector<buffered_steps_t*> runs;
+    for (buffered_steps_t* b = buffer->head.load(); b != nullptr; b = b->next) {
+        runs.push_back(b);
+    }
+    std::sort(runs.begin(), runs.end(),
+              [](const buffered_steps_t* a, const buffered_steps_t* b) {
+                  return a->first_rank < b->first_rank;
+              });
+    for (auto& b : runs) {
+        // every reserved rank must have been written
+        assert(b->first_rank == path_count());
+        for (auto& step : b->steps) {
+            add_path_step(step);
+        }
+        delete b;
+    }
+    delete buffer;
+}
+
 uint64_t node_t::sequence_size() const {
     return sequence.size();
 }
 
-void node_t::set_sequence(const std::string& seq) {
-    sequence = seq;
+void node_t::set_sequence(const std::string_view& seq) {
+    sequence.assign(seq);
 }
 
 void node_t::set_id(const uint64_t& new_id) {
@@ -18,7 +132,11 @@ const uint64_t& node_t::get_id() const {
     return id;
 }
 
-const std::string& node_t::get_sequence() const {
+std::string node_t::get_sequence() const {
+    return sequence.str();
+}
+
+const packed_sequence_t& node_t::get_packed_sequence() const {
     return sequence;
 }
 
@@ -308,26 +426,29 @@ node_t::node_t() {
     //paths = dyn::hacked_vector(0,4);
 }
 
+node_t::~node_t() {
+    discard_step_buffer();
+}
+
 void node_t::clear() {
-    sequence.clear(); // not sure this works
+    sequence.clear();
     clear_encoding();
     clear_edges();
     clear_paths();
 }
 
 void node_t::clear_edges() {
-    dyn::hacked_vector null_iv;
-    edges = null_iv;
+    // assigning a temporary releases the old buffer, which copying an empty vector would keep
+    edges = dyn::hacked_vector();
 }
 
 void node_t::clear_paths() {
-    dyn::hacked_vector null_iv;
-    paths = null_iv;
+    discard_step_buffer();
+    paths = dyn::hacked_vector();
 }
 
 void node_t::clear_encoding() {
-    dyn::hacked_vector null_iv;
-    decoding = null_iv;
+    decoding = dyn::hacked_vector();
 }
 
 void node_t::copy(const node_t& other) {
@@ -345,7 +466,7 @@ void node_t::apply_ordering(
     // flip the node sequence if needed
     bool flip = to_flip(id);
     if (flip) {
-        reverse_complement_in_place(sequence);
+        sequence.reverse_complement_in_place();
     }
     // rewrite the encoding (affects path storage)
     std::vector<uint64_t> dec_v;
@@ -419,10 +540,12 @@ void node_t::apply_path_ordering(
 
 uint64_t node_t::serialize(std::ostream& out) const {
     uint64_t written = 0;
+    // the sequence is stored unpacked, so the format doesn't depend on the in-memory encoding
     size_t seq_size = sequence.size();
     out.write((char*)&seq_size, sizeof(size_t));
     written += sizeof(size_t);
-    out.write((char*)sequence.c_str(), seq_size*sizeof(char));
+    const std::string seq = sequence.str();
+    out.write((char*)seq.c_str(), seq_size*sizeof(char));
     written += seq_size*sizeof(char);
     out.write((char*)&id, sizeof(id));
     written += sizeof(id);
@@ -435,8 +558,9 @@ uint64_t node_t::serialize(std::ostream& out) const {
 void node_t::load(std::istream& in) {
     size_t len = 0;
     in.read((char*)&len, sizeof(size_t));
-    sequence.resize(len);
-    in.read((char*)sequence.c_str(), len*sizeof(uint8_t));
+    std::string seq(len, 'N');
+    in.read((char*)seq.c_str(), len*sizeof(uint8_t));
+    sequence.assign(seq);
     in.read((char*)&id, sizeof(id));
     edges.load(in);
     decoding.load(in); 
@@ -445,7 +569,7 @@ void node_t::load(std::istream& in) {
 }
 
 void node_t::display() const {
-    std::cerr << "seq " << sequence << " "
+    std::cerr << "seq " << sequence.str() << " "
               << "edge_count " << edge_count() << " "
               << "path_count " << path_count();
     std::cerr << " | ";
@@ -475,4 +599,56 @@ void node_t::display() const {
     std::cerr << std::endl;
 }
 
+node_t* node_arena_t::allocate(void) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!free_records.empty()) {
+        node_t* node = free_records.back();
+        free_records.pop_back();
+        return node;
+    }
+    if (next_record == slab_end) {
+        slabs.emplace_back(new node_t[SLAB_SIZE]);
+        next_record = slabs.back().get();
+        slab_end = next_record + SLAB_SIZE;
+        record_count += SLAB_SIZE;
+    }
+    return next_record++;
+}
+
+node_t* node_arena_t::allocate_run(const uint64_t& count) {
+    if (count == 0) return nullptr;
+    std::lock_guard<std::mutex> guard(mutex);
+    slabs.emplace_back(new node_t[count]);
+    record_count += count;
+    return slabs.back().get();
+}
+
+void node_arena_t::release(node_t* node) {
+    node->clear();
+    node->set_id(0);
+    std::lock_guard<std::mutex> guard(mutex);
+    free_records.push_back(node);
+}
+
+void node_arena_t::clear(void) {
+    std::lock_guard<std::mutex> guard(mutex);
+    slabs.clear();
+    free_records.clear();
+    next_record = nullptr;
+    slab_end = nullptr;
+    record_count = 0;
+}
+
+void node_arena_t::swap(node_arena_t& other) {
+    slabs.swap(other.slabs);
+    free_records.swap(other.free_records);
+    std::swap(next_record, other.next_record);
+    std::swap(slab_end, other.slab_end);
+    std::swap(record_count, other.record_count);
+}
+
+uint64_t node_arena_t::capacity(void) const {
+    return record_count;
+}
+
 }
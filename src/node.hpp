@@ -10,10 +10,13 @@
 #include <cstring>
 #include <cassert>
 #include <atomic>
+#include <memory>
+#include <mutex>
 // #include "bmap.hpp"
 #include "dynamic.hpp"
 #include "varint.hpp"
 #include "dna.hpp"
+#include "packed_sequence.hpp"
 
 namespace odgi {
 
@@ -22,11 +25,20 @@ using namespace handlegraph;
 const uint8_t EDGE_RECORD_LENGTH = 2;
 const uint8_t PATH_RECORD_LENGTH = 6;
 
+/// Counters of contention on node locks, shared by all nodes
+struct node_lock_stats_t {
+    /// lock acquisitions that found the lock already held
+    std::atomic<uint64_t> contended;
+    /// times a waiting thread gave up its time slice
+    std::atomic<uint64_t> yields;
+};
+extern node_lock_stats_t node_lock_stats;
+
 /// A node object with the sequence, its edge lists, and paths
 class node_t {
     uint64_t id = 0;
-    std::atomic_flag lock = ATOMIC_FLAG_INIT;
-    std::string sequence;
+    std::atomic<bool> lock = false;
+    packed_sequence_t sequence;
     dyn::hacked_vector edges;
     dyn::hacked_vector decoding;
     dyn::hacked_vector paths;
@@ -83,15 +95,25 @@ class node_t {
         }
     };
     
+    /// Spin with backoff and then yield until the lock is ours
+    void wait_for_lock(void);
+    /// Steps written without the node lock, waiting to be merged into paths
+    struct buffered_steps_t;
+    struct step_buffer_t;
+    std::atomic<step_buffer_t*> step_buffer = nullptr;
+    void discard_step_buffer(void);
+
 public:
     node_t(void); // constructor
+    ~node_t(void);
     // locking methods
     inline void get_lock(void) {
-        while (lock.test_and_set(std::memory_order_acquire))  // acquire lock
-            ; // spin
+        if (lock.exchange(true, std::memory_order_acquire)) {
+            wait_for_lock();
+        }
     }
     inline void clear_lock(void) {
-        lock.clear(std::memory_order_release);
+        lock.store(false, std::memory_order_release);
     }
     inline const uint64_t edge_count(void) const { return edges.size()/EDGE_RECORD_LENGTH; }
     inline const uint64_t path_count(void) const { return paths.size()/PATH_RECORD_LENGTH; }
@@ -110,8 +132,9 @@ public:
     uint64_t decode(const uint64_t& idx) const;
 
     uint64_t sequence_size(void) const;
-    const std::string& get_sequence(void) const;
-    void set_sequence(const std::string& seq);
+    std::string get_sequence(void) const;
+    const packed_sequence_t& get_packed_sequence(void) const;
+    void set_sequence(const std::string_view& seq);
     const uint64_t& get_id(void) const;
     void set_id(const uint64_t& new_id);
     void for_each_edge(const std::function<bool(uint64_t other_id,
@@ -131,6 +154,16 @@ public:
                        const uint64_t& prev_id, const uint64_t& prev_rank,
                        const uint64_t& next_id, const uint64_t& next_rank);
     void add_path_step(const node_t::step_t& step);
+    /// Reserve the ranks of count new steps without taking the node lock, returning the first.
+    /// Reserved steps are written with buffer_path_steps and only become part of the node's paths
+    /// in merge_step_buffer, so reservations must not be mixed with add_path_step until then.
+    uint64_t reserve_path_steps(const uint64_t& count);
+    /// Write the steps for a reserved run of ranks to the node's step buffer, lock free
+    void buffer_path_steps(const uint64_t& first_rank, std::vector<step_t>&& steps);
+    /// Whether there are buffered steps waiting to be merged
+    bool has_buffered_steps(void) const;
+    /// Move the buffered steps into the node's paths in rank order, not thread safe
+    void merge_step_buffer(void);
     const step_t get_path_step(const uint64_t& rank) const;
     const std::vector<step_t> get_path_steps(void) const;
     void set_path_step(const uint64_t& rank, const uint64_t& path_id, const bool& is_rev,
@@ -181,4 +214,29 @@ public:
 
 };
 
+/// Slab storage for node records, so that nodes created together sit next to each other in memory.
+/// Records never move once allocated. Released records are cleared and handed out again.
+class node_arena_t {
+    const static uint64_t SLAB_SIZE = 1024;
+    std::vector<std::unique_ptr<node_t[]>> slabs;
+    std::vector<node_t*> free_records;
+    node_t* next_record = nullptr;
+    node_t* slab_end = nullptr;
+    uint64_t record_count = 0;
+    std::mutex mutex;
+public:
+    /// Allocate a single record, thread safe
+    node_t* allocate(void);
+    /// Allocate count adjacent records, thread safe
+    node_t* allocate_run(const uint64_t& count);
+    /// Clear the record and keep it for reuse, thread safe
+    void release(node_t* node);
+    /// Free every record
+    void clear(void);
+    /// Exchange the records of two arenas, not thread safe
+    void swap(node_arena_t& other);
+    /// Number of records held, live or released
+    uint64_t capacity(void) const;
+};
+
 }
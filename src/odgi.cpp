@@ -3,6 +3,15 @@
 //
 
 #include "odgi.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
 
 namespace odgi {
 
@@ -73,9 +82,76 @@ size_t graph_t::get_length(const handle_t& handle) const {
 std::string graph_t::get_sequence(const handle_t& handle) const {
     auto& node = get_node_ref(handle);
     node.get_lock();
-    auto seq = node.get_sequence();
+    const auto& packed = node.get_packed_sequence();
+    // decoded straight into the requested orientation
+    std::string seq = (get_is_reverse(handle)
+                       ? packed.reverse_complement(0, packed.size())
+                       : packed.str());
     node.clear_lock();
-    return (get_is_reverse(handle) ? reverse_complement(seq) : seq);
+    return seq;
+}
+
+/// Get the base at the given offset in the handle's local forward orientation.
+char graph_t::get_base(const handle_t& handle, size_t index) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const auto& packed = node.get_packed_sequence();
+    char c = (get_is_reverse(handle)
+              ? reverse_complement(packed.at(packed.size() - index - 1))
+              : packed.at(index));
+    node.clear_lock();
+    return c;
+}
+
+/// Get a substring of the sequence in the handle's local forward orientation, without decoding the rest of it.
+std::string graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const auto& packed = node.get_packed_sequence();
+    index = std::min(index, (size_t)packed.size());
+    size = std::min(size, (size_t)packed.size() - index);
+    std::string seq = (get_is_reverse(handle)
+                       ? packed.reverse_complement(packed.size() - index - size, size)
+                       : packed.substr(index, size));
+    node.clear_lock();
+    return seq;
+}
+
+void graph_t::count_bases(const handle_t& handle, uint64_t* counts) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const auto& packed = node.get_packed_sequence();
+    packed.count_bases(0, packed.size(), counts);
+    node.clear_lock();
+}
+
+void graph_t::get_sequence(const handle_t& handle, std::string& seq) const {
+    seq.clear();
+    append_subsequence(handle, 0, get_length(handle), seq);
+}
+
+size_t graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size, char* out) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const auto& packed = node.get_packed_sequence();
+    index = std::min(index, (size_t)packed.size());
+    size = std::min(size, (size_t)packed.size() - index);
+    if (get_is_reverse(handle)) {
+        packed.decode_reverse_complement(packed.size() - index - size, size, out);
+    } else {
+        packed.decode(index, size, out);
+    }
+    node.clear_lock();
+    return size;
+}
+
+size_t graph_t::append_subsequence(const handle_t& handle, size_t index, size_t size, std::string& seq) const {
+    size_t length = get_length(handle);
+    index = std::min(index, length);
+    size = std::min(size, length - index);
+    size_t prev_size = seq.size();
+    seq.resize(prev_size + size);
+    return get_subsequence(handle, index, size, &seq[prev_size]);
 }
 
 /// Loop over all the handles to next/previous (right/left) nodes. Passes
@@ -478,6 +554,13 @@ bool graph_t::is_empty(const path_handle_t& path_handle) const {
 void graph_t::for_each_step_in_path(const path_handle_t& path, const std::function<void(const step_handle_t&)>& iteratee) const {
     auto& p = path_metadata(path);
     if (is_empty(path)) return;
+    if (_use_path_step_arrays) {
+        auto step_array = get_path_step_array(path);
+        for (auto& step : step_array->steps) {
+            iteratee(step);
+        }
+        return;
+    }
     step_handle_t step = path_begin(path);
     step_handle_t end_step = path_back(path);
     bool keep_going = true;
@@ -492,6 +575,70 @@ void graph_t::for_each_step_in_path(const path_handle_t& path, const std::functi
     } while (keep_going);
 }
 
+std::shared_ptr<const graph_t::path_step_array_t> graph_t::get_path_step_array(const path_handle_t& path) const {
+    auto& p = get_path_metadata(path);
+    // holding the path lock means concurrent walkers of the same path share one build
+    p.get_lock();
+    std::shared_ptr<const path_step_array_t> step_array = p.step_array;
+    const uint64_t epoch = _step_epoch.load();
+    const uint64_t length = p.length.load();
+    const step_handle_t first = p.first.load();
+    const step_handle_t last = p.last.load();
+    if (!step_array
+        || step_array->epoch != epoch
+        || step_array->length != length
+        || step_array->first != first
+        || step_array->last != last) {
+        auto built = std::make_shared<path_step_array_t>();
+        built->epoch = epoch;
+        built->length = length;
+        built->first = first;
+        built->last = last;
+        built->steps.reserve(length);
+        built->offsets.reserve(length + 1);
+        uint64_t offset = 0;
+        if (length) {
+            // the same walk as for_each_step_in_path, which stops at the last step of circular paths
+            step_handle_t step = first;
+            while (true) {
+                built->steps.push_back(step);
+                built->offsets.push_back(offset);
+                offset += get_length(get_handle_of_step(step));
+                if (step == last || !has_next_step(step)) break;
+                step = get_next_step(step);
+            }
+        }
+        built->offsets.push_back(offset);
+        p.step_array = built;
+        step_array = built;
+    }
+    p.clear_lock();
+    return step_array;
+}
+
+void graph_t::set_path_step_arrays(bool use_step_arrays) {
+    _use_path_step_arrays = use_step_arrays;
+}
+
+step_handle_t graph_t::get_step_at_index(const path_handle_t& path, uint64_t index) const {
+    auto step_array = get_path_step_array(path);
+    if (index >= step_array->steps.size()) {
+        return path_end(path);
+    }
+    return step_array->steps[index];
+}
+
+step_handle_t graph_t::get_step_at_position(const path_handle_t& path, uint64_t position) const {
+    auto step_array = get_path_step_array(path);
+    const auto& offsets = step_array->offsets;
+    if (position >= offsets.back()) {
+        return path_end(path);
+    }
+    // the last step starting at or before the position
+    uint64_t index = std::upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin() - 1;
+    return step_array->steps[index];
+}
+
 /// Create a new node with the given sequence and return the handle.
 handle_t graph_t::create_handle(const std::string& sequence) {
     // get first deleted node to recycle
@@ -534,13 +681,55 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
         assert(deleted_nodes.count(id));
         deleted_nodes.erase(id);
     }
-    n = new node_t();
+    n = node_arena.allocate();
     auto& node = *n;
     node.set_id(id);
     node.set_sequence(sequence);
     return number_bool_packing::pack(handle_rank, 0);
 }
 
+void graph_t::create_handles(const nid_t& max_id,
+                             const std::function<void(const std::function<bool(const nid_t&, const std::string_view&)>&)>& fill) {
+    if ((uint64_t)max_id > node_v.size()) {
+        node_v.resize((uint64_t)max_id, nullptr);
+    }
+    // lay the records out in rank order, the ones that are not filled are recycled afterwards
+    node_t* run = node_arena.allocate_run(max_id);
+    fill([&](const nid_t& id, const std::string_view& sequence) {
+        assert(sequence.size());
+        assert(id > 0 && id <= max_id);
+        // claim the slot atomically, so that only one of several records with the same id is kept
+        node_t* expected = nullptr;
+        if (!__atomic_compare_exchange_n(&node_v[(uint64_t)id-1], &expected, &run[id-1],
+                                         false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        node_t* n = &run[id-1];
+        n->set_id(id);
+        n->set_sequence(sequence);
+        return true;
+    });
+    for (uint64_t i = 0; i < (uint64_t)max_id; ++i) {
+        if (node_v[i] != &run[i]) {
+            node_arena.release(&run[i]);
+        }
+    }
+    // rebuild the open node slots and the id range from the filled storage
+    deleted_nodes.clear();
+    _min_node_id = 0;
+    _max_node_id = 0;
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) {
+            deleted_nodes.insert(i+1);
+        } else {
+            if (!_min_node_id) {
+                _min_node_id = i+1;
+            }
+            _max_node_id = i+1;
+        }
+    }
+}
+
 /// Remove the node belonging to the given handle and all of its edges.
 /// Does not update any stored paths.
 /// Invalidates the destroyed handle.
@@ -548,6 +737,7 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
 /// May **NOT** be called during parallel for_each_handle iteration.
 /// May **NOT** be called on the node from which edges are being followed during follow_edges.
 void graph_t::destroy_handle(const handle_t& handle) {
+    invalidate_path_step_arrays();
     handle_t fwd_handle = get_is_reverse(handle) ? flip(handle) : handle;
     uint64_t id = get_id(handle);
     if (!has_node(id)) return; // deleted already
@@ -568,7 +758,7 @@ void graph_t::destroy_handle(const handle_t& handle) {
     }
     // clear the node storage
     auto& node = node_v[number_bool_packing::unpack_number(handle)];
-    delete node;
+    node_arena.release(node);
     // remove from the graph
     node = nullptr;
     // add the index to our list of open node slots
@@ -625,7 +815,6 @@ void graph_t::create_edge(const handle_t& left_h, const handle_t& right_h) {
                            get_is_reverse(right_h),
                            false,
                            get_is_reverse(left_h));
-        left_node.clear_lock();
         // only insert the second side if it's on a different node
         if (left_rank != right_rank) {
             right_node.add_edge(get_id(left_h),
@@ -684,15 +873,14 @@ void graph_t::destroy_edge(const handle_t& left_h, const handle_t& right_h) {
 
 /// Remove all nodes and edges. Does not update any stored paths.
 void graph_t::clear() {
+    invalidate_path_step_arrays();
     suc_bv null_bv;
     _max_node_id = 0;
     _min_node_id = 0;
     _edge_count = 0;
     deleted_nodes.clear();
-    for (auto& n : node_v) {
-        delete n;
-    }
     node_v.clear();
+    node_arena.clear();
     for_each_path_handle(
         [&](const path_handle_t& p) {
             // remove from both hash tables
@@ -706,6 +894,7 @@ void graph_t::clear() {
 }
 
 void graph_t::clear_paths() {
+    invalidate_path_step_arrays();
     for_each_handle(
         [&](const handle_t& handle) {
             node_t& node = get_node_ref(handle);
@@ -782,6 +971,7 @@ void graph_t::reassign_node_ids(const std::function<nid_t(const nid_t&)>& get_ne
 /// Reorder the graph's internal structure to match that given.
 /// Optionally compact the id space of the graph to match the ordering, from 1->|ordering|.
 bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact_ids) {
+    invalidate_path_step_arrays();
     // get mapping from old to new id
     // if we're given an empty order, just compact the ids based on our ordering
     const std::vector<handle_t>* order;
@@ -894,11 +1084,50 @@ bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact
     }
     node_v = new_node_v;
     deleted_nodes.clear();
+    compact_node_storage();
 
     return true;
 }
 
+void graph_t::compact_node_storage(void) {
+    // count the live records in each thread's range of ranks to find where its copies go
+    const uint64_t n_threads = std::max(_num_threads, (uint64_t)1);
+    const uint64_t node_count = node_v.size();
+    std::vector<uint64_t> run_begin(n_threads + 1, 0);
+#pragma omp parallel for schedule(static, 1) num_threads(n_threads)
+    for (uint64_t t = 0; t < n_threads; ++t) {
+        const uint64_t begin = node_count * t / n_threads;
+        const uint64_t end = node_count * (t + 1) / n_threads;
+        for (uint64_t i = begin; i < end; ++i) {
+            run_begin[t + 1] += (node_v[i] != nullptr);
+        }
+    }
+    for (uint64_t t = 0; t < n_threads; ++t) {
+        run_begin[t + 1] += run_begin[t];
+    }
+    node_arena_t compacted;
+    node_t* run = compacted.allocate_run(run_begin[n_threads]);
+#pragma omp parallel for schedule(static, 1) num_threads(n_threads)
+    for (uint64_t t = 0; t < n_threads; ++t) {
+        const uint64_t begin = node_count * t / n_threads;
+        const uint64_t end = node_count * (t + 1) / n_threads;
+        uint64_t j = run_begin[t];
+        for (uint64_t i = begin; i < end; ++i) {
+            if (node_v[i] != nullptr) {
+                // copying reallocates the sequence, edge and step buffers in rank order too,
+                // and freeing the old ones right away keeps the peak near one copy of the payloads
+                run[j].copy(*node_v[i]);
+                node_v[i]->clear();
+                node_v[i] = &run[j++];
+            }
+        }
+    }
+    // the old records, now empty, go away with the arena we swapped out
+    node_arena.swap(compacted);
+}
+
 void graph_t::apply_path_ordering(const std::vector<path_handle_t>& order) {
+    invalidate_path_step_arrays();
     std::vector<path_handle_t> curr_to_new(order.size());
     {
         uint64_t i = 0;
@@ -952,6 +1181,7 @@ void graph_t::apply_path_ordering(const std::vector<path_handle_t>& order) {
 handle_t graph_t::apply_orientation(const handle_t& handle) {
     // do nothing if we're already in the right orientation
     if (!get_is_reverse(handle)) return handle;
+    invalidate_path_step_arrays();
     handle_t fwd_handle = flip(handle);
     handle_t rev_handle = handle;
     // store edges
@@ -1024,6 +1254,7 @@ handle_t graph_t::apply_orientation(const handle_t& handle) {
 }
 
 void graph_t::set_handle_sequence(const handle_t& handle, const std::string& seq) {
+    invalidate_path_step_arrays();
     assert(seq.size());
     auto& node = get_node_ref(handle);
     node.get_lock();
@@ -1039,6 +1270,7 @@ void graph_t::set_handle_sequence(const handle_t& handle, const std::string& seq
 /// passed in.
 /// Updates stored paths.
 std::vector<handle_t> graph_t::divide_handle(const handle_t& handle, const std::vector<size_t>& offsets) {
+    invalidate_path_step_arrays();
     // convert the offsets to the forward strand, if needed
     std::vector<uint64_t> fwd_offsets = { 0 };
     uint64_t length = get_length(handle);
@@ -1136,6 +1368,7 @@ std::vector<handle_t> graph_t::divide_handle(const handle_t& handle, const std::
 }
 
 handle_t graph_t::combine_handles(const std::vector<handle_t>& handles) {
+    invalidate_path_step_arrays();
     std::string seq;
     for (auto& handle : handles) {
         seq.append(get_sequence(handle));
@@ -1194,6 +1427,7 @@ handle_t graph_t::combine_handles(const std::vector<handle_t>& handles) {
  * Destroy the given path. Invalidates handles to the path and its node steps.
  */
 void graph_t::destroy_path(const path_handle_t& path) {
+    invalidate_path_step_arrays();
     // select everything with that handle in the path_handle_wt
     std::vector<step_handle_t> path_v;
     for_each_step_in_path(path, [this,&path_v](const step_handle_t& step) {
@@ -1277,6 +1511,7 @@ void graph_t::link_steps(const step_handle_t& from, const step_handle_t& to) {
 }
 
 void graph_t::destroy_step(const step_handle_t& step_handle) {
+    invalidate_path_step_arrays();
     // erase reference to this step
     bool has_prev = has_previous_step(step_handle);
     bool has_next = has_next_step(step_handle);
@@ -1340,6 +1575,172 @@ step_handle_t graph_t::append_step(const path_handle_t& path, const handle_t& to
     return new_step;
 }
 
+void graph_t::append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append) {
+    if (to_append.empty()) {
+        return;
+    }
+    const uint64_t path_id = as_integer(path);
+    const uint64_t n_steps = to_append.size();
+    // group the steps by node, keeping path order within each node
+    std::vector<std::pair<uint64_t, uint64_t>> by_node(n_steps);
+    for (uint64_t i = 0; i < n_steps; ++i) {
+        by_node[i] = std::make_pair(number_bool_packing::unpack_number(to_append[i]), i);
+    }
+    std::sort(by_node.begin(), by_node.end());
+    // calls f(node, begin, end) for each run of steps on the same node in by_node
+    auto for_each_node_run = [&](const std::function<void(node_t&, uint64_t, uint64_t)>& f) {
+        for (uint64_t i = 0; i < n_steps; ) {
+            uint64_t j = i + 1;
+            while (j < n_steps && by_node[j].first == by_node[i].first) ++j;
+            node_t& node = get_node_ref(to_append[by_node[i].second]);
+            node.get_lock();
+            f(node, i, j);
+            node.clear_lock();
+            i = j;
+        }
+    };
+    // reserve the step records on each node, which gives us the rank of every step
+    std::vector<uint64_t> step_rank(n_steps);
+    for_each_node_run([&](node_t& node, uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                step_rank[by_node[i].second] = node.path_count();
+                node.add_path_step(path_id, get_is_reverse(to_append[by_node[i].second]),
+                                   true, true, 0, 0, 0, 0);
+            }
+        });
+    // link the steps to each other and to the existing end of the path
+    auto& p = get_path_metadata(path);
+    bool has_prev = p.length > 0;
+    step_handle_t prev_last = p.last.load();
+    handle_t prev_handle = get_handle_of_step(prev_last);
+    for_each_node_run([&](node_t& node, uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                const uint64_t k = by_node[i].second;
+                node_t::step_t step;
+                step.path_id = path_id;
+                step.is_rev = get_is_reverse(to_append[k]);
+                step.is_start = k == 0 && !has_prev;
+                step.is_end = k + 1 == n_steps;
+                if (k > 0) {
+                    step.prev_id = get_id(to_append[k-1]);
+                    step.prev_rank = step_rank[k-1];
+                } else if (has_prev) {
+                    step.prev_id = get_id(prev_handle);
+                    step.prev_rank = as_integers(prev_last)[1];
+                } else {
+                    step.prev_id = 0;
+                    step.prev_rank = 0;
+                }
+                if (k + 1 < n_steps) {
+                    step.next_id = get_id(to_append[k+1]);
+                    step.next_rank = step_rank[k+1];
+                } else {
+                    step.next_id = 0;
+                    step.next_rank = 0;
+                }
+                node.set_path_step(step_rank[k], step);
+            }
+        });
+    step_handle_t first_step, last_step;
+    as_integers(first_step)[0] = as_integer(to_append.front());
+    as_integers(first_step)[1] = step_rank.front();
+    as_integers(last_step)[0] = as_integer(to_append.back());
+    as_integers(last_step)[1] = step_rank.back();
+    if (has_prev) {
+        node_t& prev_node = get_node_ref(prev_handle);
+        const uint64_t& prev_rank = as_integers(prev_last)[1];
+        prev_node.get_lock();
+        prev_node.set_step_next_id(prev_rank, get_id(to_append.front()));
+        prev_node.set_step_next_rank(prev_rank, step_rank.front());
+        prev_node.set_step_is_end(prev_rank, false);
+        prev_node.clear_lock();
+    } else {
+        p.first.store(first_step);
+    }
+    p.last.store(last_step);
+    p.length += n_steps;
+}
+
+void graph_t::append_steps_buffered(const path_handle_t& path, const std::vector<handle_t>& to_append) {
+    auto& p = get_path_metadata(path);
+    if (p.length > 0) {
+        std::cerr << "[odgi::graph_t] error: buffered steps can only be appended to an empty path, but "
+                  << p.name << " already has " << p.length << " steps" << std::endl;
+        exit(1);
+    }
+    if (to_append.empty()) {
+        return;
+    }
+    const uint64_t path_id = as_integer(path);
+    const uint64_t n_steps = to_append.size();
+    // group the steps by node, so that each node gets one reservation and one buffered run per path
+    std::vector<std::pair<uint64_t, uint64_t>> by_node(n_steps);
+    for (uint64_t i = 0; i < n_steps; ++i) {
+        by_node[i] = std::make_pair(number_bool_packing::unpack_number(to_append[i]), i);
+    }
+    std::sort(by_node.begin(), by_node.end());
+    std::vector<std::pair<uint64_t, uint64_t>> node_runs;
+    for (uint64_t i = 0; i < n_steps; ) {
+        uint64_t j = i + 1;
+        while (j < n_steps && by_node[j].first == by_node[i].first) ++j;
+        node_runs.push_back(std::make_pair(i, j));
+        i = j;
+    }
+    std::vector<uint64_t> step_rank(n_steps);
+    for (auto& run : node_runs) {
+        node_t& node = get_node_ref(to_append[by_node[run.first].second]);
+        uint64_t rank = node.reserve_path_steps(run.second - run.first);
+        for (uint64_t i = run.first; i < run.second; ++i) {
+            step_rank[by_node[i].second] = rank++;
+        }
+    }
+    for (auto& run : node_runs) {
+        std::vector<node_t::step_t> steps;
+        steps.reserve(run.second - run.first);
+        for (uint64_t i = run.first; i < run.second; ++i) {
+            const uint64_t k = by_node[i].second;
+            node_t::step_t step;
+            step.path_id = path_id;
+            step.is_rev = get_is_reverse(to_append[k]);
+            step.is_start = k == 0;
+            step.is_end = k + 1 == n_steps;
+            step.prev_id = k > 0 ? get_id(to_append[k-1]) : 0;
+            step.prev_rank = k > 0 ? step_rank[k-1] : 0;
+            step.next_id = k + 1 < n_steps ? get_id(to_append[k+1]) : 0;
+            step.next_rank = k + 1 < n_steps ? step_rank[k+1] : 0;
+            steps.push_back(step);
+        }
+        node_t& node = get_node_ref(to_append[by_node[run.first].second]);
+        node.buffer_path_steps(step_rank[by_node[run.first].second], std::move(steps));
+    }
+    step_handle_t first_step, last_step;
+    as_integers(first_step)[0] = as_integer(to_append.front());
+    as_integers(first_step)[1] = step_rank.front();
+    as_integers(last_step)[0] = as_integer(to_append.back());
+    as_integers(last_step)[1] = step_rank.back();
+    p.first.store(first_step);
+    p.last.store(last_step);
+    p.length.store(n_steps);
+}
+
+void graph_t::merge_step_buffers(void) {
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        node_t* node = node_v[i];
+        if (node != nullptr && node->has_buffered_steps()) {
+            node->merge_step_buffer();
+        }
+    }
+}
+
+path_handle_t graph_t::create_path_from_handles(const std::string& name,
+                                                const std::vector<handle_t>& handles,
+                                                bool is_circular) {
+    path_handle_t path = create_path_handle(name, is_circular);
+    append_steps(path, handles);
+    return path;
+}
+
 /// helper to handle the case where we remove an step from a given path
 /// on a node that has other steps from the same path, thus invalidating the
 /// ranks used to refer to it
@@ -1394,6 +1795,7 @@ step_handle_t graph_t::set_step(const step_handle_t& step_handle, const handle_t
 std::pair<step_handle_t, step_handle_t> graph_t::rewrite_segment(const step_handle_t& segment_begin,
                                                                  const step_handle_t& segment_end,
                                                                  const std::vector<handle_t>& new_segment) {
+    invalidate_path_step_arrays();
     // collect the steps to replace
     std::vector<step_handle_t> steps;
     //std::string old_seq, new_seq;
@@ -1597,61 +1999,269 @@ void graph_t::to_gfa(std::ostream& out, const bool& emit_node_annotation) const
 }
 
 uint32_t graph_t::get_magic_number() const {
-    return 1988148666ul; // TODO update me
+    return ODGI_MAGIC_NUMBER;
 }
 
+/// A read-only stream buffer over a contiguous region of memory, such as a file mapping
+class memory_streambuf : public std::streambuf {
+public:
+    memory_streambuf(const char* begin, const char* end) {
+        setg((char*)begin, (char*)begin, (char*)end);
+    }
+    /// the current read position
+    const char* position(void) const {
+        return gptr();
+    }
+    /// the number of bytes left to read
+    uint64_t remaining(void) const {
+        return egptr() - gptr();
+    }
+    /// advance the read position without copying out the skipped bytes
+    void skip(const uint64_t& n) {
+        setg(eback(), gptr() + std::min(n, remaining()), egptr());
+    }
+};
+
+/// Unmaps and closes a read-only file mapping when it goes out of scope
+class file_mapping_guard {
+public:
+    file_mapping_guard(int fd, void* mapping, uint64_t size) : fd(fd), mapping(mapping), size(size) { }
+    ~file_mapping_guard(void) {
+        if (mapping != MAP_FAILED) munmap(mapping, size);
+        if (fd != -1) close(fd);
+    }
+    file_mapping_guard(const file_mapping_guard&) = delete;
+    file_mapping_guard& operator=(const file_mapping_guard&) = delete;
+private:
+    int fd;
+    void* mapping;
+    uint64_t size;
+};
+
 void graph_t::serialize_members(std::ostream& out) const {
-    //rebuild_id_handle_mapping();
-    uint64_t written = 0;
     out.write((char*)&_max_node_id,sizeof(_max_node_id));
-    written += sizeof(_max_node_id);
     out.write((char*)&_min_node_id,sizeof(_min_node_id));
-    written += sizeof(_min_node_id);
     uint64_t node_count = node_v.size();
     out.write((char*)&node_count,sizeof(node_count));
-    written += sizeof(node_count);
     out.write((char*)&_edge_count,sizeof(_edge_count));
-    written += sizeof(_edge_count);
     out.write((char*)&_path_count,sizeof(_path_count));
-    written += sizeof(_path_count);
     out.write((char*)&_path_handle_next,sizeof(_path_handle_next));
-    written += sizeof(_path_handle_next);
     out.write((char*)&_id_increment,sizeof(_id_increment));
-    written += sizeof(_id_increment);
-    //assert(node_count == node_v.size());
-    // hack
-    // todo big mess, middle of removal of deleted node bv
-    node_t empty_node;
-    for (auto& node : node_v) {
-        // check if node is null
-        if (node == nullptr) {
-            written += empty_node.serialize(out);
-        } else {
-            written += node->serialize(out);
-        }
-    }
+    serialize_node_blocks(out);
     // there are _path_count of these to write
     uint64_t j = 0;
     for_each_path_handle(
         [&](const path_handle_t& path) {
             auto& m = path_metadata(path);
             out.write((char*)&m.length,sizeof(m.length));
-            written += sizeof(m.length);
             out.write((char*)&m.first,sizeof(m.first));
-            written += sizeof(m.first);
             out.write((char*)&m.last,sizeof(m.last));
-            written += sizeof(m.last);
             size_t k = m.name.size();
             out.write((char*)&k,sizeof(k));
-            written += sizeof(k);
             out.write((char*)m.name.c_str(),m.name.size());
-            written += k;
             ++j;
         });
     assert(j == _path_count);
 }
 
+/// Each block is written as its record count, its size in bytes, the byte offset of every
+/// record within the block, and then the records themselves in node rank order.
+/// Deleted nodes are stored as empty records, which are the only ones with id == 0.
+void graph_t::serialize_node_blocks(std::ostream& out) const {
+    const uint64_t node_count = node_v.size();
+    const uint64_t n_threads = std::max(_num_threads, (uint64_t)1);
+    node_t empty_node;
+    std::vector<std::string> runs(n_threads);
+    std::vector<std::vector<uint64_t>> run_offsets(n_threads);
+    for (uint64_t block_begin = 0; block_begin < node_count; block_begin += ODGI_NODE_BLOCK_SIZE) {
+        const uint64_t block_nodes = std::min(ODGI_NODE_BLOCK_SIZE, node_count - block_begin);
+        // each thread encodes a contiguous run of the records in the block
+#pragma omp parallel for schedule(static, 1) num_threads(n_threads)
+        for (uint64_t t = 0; t < n_threads; ++t) {
+            const uint64_t begin = block_nodes * t / n_threads;
+            const uint64_t end = block_nodes * (t + 1) / n_threads;
+            std::ostringstream run;
+            run_offsets[t].clear();
+            for (uint64_t i = begin; i < end; ++i) {
+                run_offsets[t].push_back(run.tellp());
+                const node_t* node = node_v[block_begin + i];
+                (node == nullptr ? empty_node : *node).serialize(run);
+            }
+            runs[t] = run.str();
+        }
+        write_node_block(out, runs, run_offsets);
+    }
+}
+
+void graph_t::write_node_block(std::ostream& out,
+                               const std::vector<std::string>& runs,
+                               const std::vector<std::vector<uint64_t>>& run_offsets) {
+    uint64_t block_nodes = 0;
+    uint64_t block_bytes = 0;
+    std::vector<uint64_t> offsets;
+    for (uint64_t t = 0; t < runs.size(); ++t) {
+        // rebase the record offsets onto the start of the block
+        for (auto& offset : run_offsets[t]) {
+            offsets.push_back(block_bytes + offset);
+        }
+        block_nodes += run_offsets[t].size();
+        block_bytes += runs[t].size();
+    }
+    if (block_nodes == 0) return;
+    out.write((char*)&block_nodes,sizeof(block_nodes));
+    out.write((char*)&block_bytes,sizeof(block_bytes));
+    out.write((char*)offsets.data(),block_nodes*sizeof(uint64_t));
+    for (auto& run : runs) {
+        out.write(run.data(), run.size());
+    }
+}
+
+void graph_t::deserialize(std::istream& in) {
+    uint32_t magic_number = 0;
+    in.read((char*)&magic_number,sizeof(magic_number));
+    magic_number = ntohl(magic_number);
+    if (magic_number == ODGI_MAGIC_NUMBER) {
+        deserialize_members(in);
+    } else if (magic_number == ODGI_LEGACY_MAGIC_NUMBER) {
+        deserialize_legacy_members(in);
+    } else {
+        throw std::runtime_error("error: Serialized object does not appear to match deserialization type.");
+    }
+}
+
+void graph_t::deserialize(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("error: Could not open " + filename + " for reading.");
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        // not mappable (e.g. a pipe), so stream it instead
+        close(fd);
+        std::ifstream f(filename.c_str(), std::ios::binary);
+        deserialize(f);
+        return;
+    }
+    // released even if a corrupt file makes deserialization throw
+    file_mapping_guard guard(fd, mapping, st.st_size);
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+    memory_streambuf buf((const char*)mapping, (const char*)mapping + st.st_size);
+    std::istream in(&buf);
+    deserialize(in);
+}
+
 void graph_t::deserialize_members(std::istream& in) {
+    in.read((char*)&_max_node_id,sizeof(_max_node_id));
+    in.read((char*)&_min_node_id,sizeof(_min_node_id));
+    uint64_t node_count = 0;
+    in.read((char*)&node_count,sizeof(node_count));
+    in.read((char*)&_edge_count,sizeof(_edge_count));
+    in.read((char*)&_path_count,sizeof(_path_count));
+    in.read((char*)&_path_handle_next,sizeof(_path_handle_next));
+    in.read((char*)&_id_increment,sizeof(_id_increment));
+    deserialize_node_blocks(in, node_count);
+    deserialize_path_metadata(in);
+}
+
+void graph_t::deserialize_node_blocks(std::istream& in, const uint64_t& node_count) {
+    const uint64_t n_threads = std::max(_num_threads, (uint64_t)1);
+    // when reading from memory we decode the records in place rather than copying the block out
+    auto* mapped = dynamic_cast<memory_streambuf*>(in.rdbuf());
+    std::vector<uint64_t> offsets;
+    std::vector<char> buffer;
+    uint64_t loaded = 0;
+    while (loaded < node_count) {
+        uint64_t block_nodes = 0;
+        uint64_t block_bytes = 0;
+        in.read((char*)&block_nodes,sizeof(block_nodes));
+        in.read((char*)&block_bytes,sizeof(block_bytes));
+        if (!in) {
+            break;
+        }
+        if (block_nodes == 0 || block_nodes > ODGI_NODE_BLOCK_SIZE || block_nodes > node_count - loaded) {
+            throw std::runtime_error("error: Serialized graph has a corrupt node block.");
+        }
+        offsets.resize(block_nodes);
+        in.read((char*)offsets.data(),block_nodes*sizeof(uint64_t));
+        if (!in) {
+            break;
+        }
+        // records are written in order, each one taking at least one byte
+        for (uint64_t i = 0; i < block_nodes; ++i) {
+            if (offsets[i] >= block_bytes || (i > 0 && offsets[i] <= offsets[i - 1])) {
+                throw std::runtime_error("error: Serialized graph has a corrupt node block.");
+            }
+        }
+        const char* block = nullptr;
+        if (mapped != nullptr) {
+            if (block_bytes > mapped->remaining()) {
+                break;
+            }
+            block = mapped->position();
+            mapped->skip(block_bytes);
+        } else {
+            // grow the buffer as the bytes arrive, so a corrupt size cannot allocate more than the stream holds
+            const uint64_t chunk = 1 << 26;
+            buffer.clear();
+            while (buffer.size() < block_bytes && in) {
+                const uint64_t have = buffer.size();
+                buffer.resize(have + std::min(chunk, block_bytes - have));
+                in.read(buffer.data() + have, buffer.size() - have);
+            }
+            if (!in) {
+                break;
+            }
+            block = buffer.data();
+        }
+        // node_v grows block by block, so a corrupt node count cannot allocate more than the blocks we read
+        node_v.resize(loaded + block_nodes, nullptr);
+        // each block's records are laid out together in rank order
+        node_t* run = node_arena.allocate_run(block_nodes);
+        std::atomic<bool> corrupt(false);
+#pragma omp parallel for schedule(static, 1) num_threads(n_threads)
+        for (uint64_t t = 0; t < n_threads; ++t) {
+            const uint64_t begin = block_nodes * t / n_threads;
+            const uint64_t end = block_nodes * (t + 1) / n_threads;
+            if (begin == end) continue;
+            // the records of a thread's run are contiguous, so one stream reads them all
+            memory_streambuf buf(block + offsets[begin], block + block_bytes);
+            std::istream records(&buf);
+            try {
+                for (uint64_t i = begin; i < end; ++i) {
+                    node_t* node = &run[i];
+                    node->load(records);
+                    // an empty record marks a deleted node
+                    node_v[loaded + i] = (node->get_id() == 0 ? nullptr : node);
+                }
+            } catch (const std::exception&) {
+                corrupt.store(true);
+            }
+            if (!records) {
+                corrupt.store(true);
+            }
+        }
+        if (corrupt.load()) {
+            throw std::runtime_error("error: Serialized graph has a corrupt node record.");
+        }
+        for (uint64_t i = 0; i < block_nodes; ++i) {
+            if (node_v[loaded + i] == nullptr) {
+                deleted_nodes.insert(loaded + i + 1);
+                node_arena.release(&run[i]);
+            }
+        }
+        loaded += block_nodes;
+    }
+    if (loaded != node_count) {
+        throw std::runtime_error("error: Serialized graph is truncated: read "
+                                 + std::to_string(loaded) + " of " + std::to_string(node_count) + " nodes.");
+    }
+}
+
+void graph_t::deserialize_legacy_members(std::istream& in) {
     in.read((char*)&_max_node_id,sizeof(_max_node_id));
     in.read((char*)&_min_node_id,sizeof(_min_node_id));
     uint64_t node_count = node_v.size();
@@ -1661,19 +2271,24 @@ void graph_t::deserialize_members(std::istream& in) {
     in.read((char*)&_path_handle_next,sizeof(_path_handle_next));
     in.read((char*)&_id_increment,sizeof(_id_increment));
     node_v.resize(node_count,nullptr);
+    node_t* run = node_arena.allocate_run(node_count);
     for (size_t i = 0; i < node_count; ++i) {
-        node_v[i] = new node_t;
+        node_v[i] = &run[i];
         auto& node = node_v[i];
         node->load(in);
         if (node->get_id() == 0) {
             // detect which nodes are deleted
             // these must be the only ones with id == 0
             // they have been stored as empty node records
-            delete node;
+            node_arena.release(node);
             node = nullptr;
             deleted_nodes.insert(i+1);
         }
     }
+    deserialize_path_metadata(in);
+}
+
+void graph_t::deserialize_path_metadata(std::istream& in) {
     for (size_t j = 0; j < _path_count; ++j) {
         path_metadata_t* _p = new path_metadata_t();
         auto& m = *_p;
@@ -1708,11 +2323,15 @@ void graph_t::copy(const graph_t& other) {
     _path_count.store(other._path_count);
     _path_handle_next.store(other._path_handle_next);
     _id_increment.store(other._id_increment);
-    node_v.resize(other.node_v.size());
+    node_v.resize(other.node_v.size(), nullptr);
+    node_t* run = node_arena.allocate_run(other.node_v.size());
     for (size_t i = 0; i < other.node_v.size(); ++i) {
-        node_v[i] = new node_t;
-        auto* node = node_v[i];
-        node->copy(other.get_node_cref(as_handle(i)));
+        if (other.node_v[i] == nullptr) {
+            node_arena.release(&run[i]);
+            continue;
+        }
+        node_v[i] = &run[i];
+        node_v[i]->copy(*other.node_v[i]);
     }
     deleted_nodes = other.deleted_nodes;
     // copy the path metadata
@@ -13,6 +13,7 @@
 #include <vector>
 #include <utility>
 #include <functional>
+#include <string_view>
 #include <thread>
 #include <handlegraph/types.hpp>
 #include <handlegraph/iteratee.hpp>
@@ -35,6 +36,7 @@
 #include <omp.h>
 #include "atomic_bitvector.hpp"
 #include <mutex>
+#include <memory>
 
 namespace odgi {
 
@@ -43,6 +45,18 @@ using namespace handlegraph;
 // Resolve ambiguous nid_t typedef by putting it in our namespace.
 using nid_t = handlegraph::nid_t;
 
+/// Magic number of the original serialization, which streams node records one by one
+const uint32_t ODGI_LEGACY_MAGIC_NUMBER = 1988148666ul;
+
+/// Magic number of the current serialization, which stores node records in indexed blocks
+const uint32_t ODGI_MAGIC_NUMBER = 1988148667ul;
+
+/// Number of node records per block in the serialized node section
+const uint64_t ODGI_NODE_BLOCK_SIZE = 1 << 18;
+
+/// Number of bases decoded at a time when iterating over a node sequence
+const uint64_t ODGI_BASE_WINDOW = 256;
+
 class graph_t : public MutablePathDeletableHandleGraph, public SerializableHandleGraph, public RankedHandleGraph {
 
 public:
@@ -84,6 +98,50 @@ public:
     /// Get the sequence of a node, presented in the handle's local forward orientation.
     std::string get_sequence(const handle_t& handle) const;
 
+    /// Returns one base of a handle's sequence, in the orientation of the handle.
+    char get_base(const handle_t& handle, size_t index) const;
+
+    /// Returns a substring of a handle's sequence, in the orientation of the handle.
+    /// If the indicated substring would extend beyond the end of the handle's sequence,
+    /// the return value is truncated to the sequence's end.
+    std::string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+    /// Add the number of times each character occurs in the node's forward sequence to counts,
+    /// which is indexed by character and must have 256 entries
+    void count_bases(const handle_t& handle, uint64_t* counts) const;
+
+    /// Get the sequence of a node in the handle's local forward orientation into seq,
+    /// reusing its buffer instead of allocating a new string.
+    void get_sequence(const handle_t& handle, std::string& seq) const;
+
+    /// Write up to size bases of the handle's sequence, starting at index and in the orientation
+    /// of the handle, to out. Returns the number of bases written, which is truncated at the
+    /// end of the sequence.
+    size_t get_subsequence(const handle_t& handle, size_t index, size_t size, char* out) const;
+
+    /// Append up to size bases of the handle's sequence, starting at index and in the orientation
+    /// of the handle, to seq. Returns the number of bases appended.
+    size_t append_subsequence(const handle_t& handle, size_t index, size_t size, std::string& seq) const;
+
+    /// Call iteratee on each base of the handle's sequence, in the orientation of the handle,
+    /// without materializing the sequence. The iteratee returns false to stop iterating.
+    /// Returns true if we finished and false if we stopped early.
+    template<typename Iteratee>
+    bool for_each_base(const handle_t& handle, const Iteratee& iteratee) const {
+        // decoded a window at a time so the node lock is not held while the iteratee runs
+        char buffer[ODGI_BASE_WINDOW];
+        size_t length = get_length(handle);
+        for (size_t i = 0; i < length; i += ODGI_BASE_WINDOW) {
+            size_t n = get_subsequence(handle, i, ODGI_BASE_WINDOW, buffer);
+            for (size_t j = 0; j < n; ++j) {
+                if (!iteratee(buffer[j])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
 protected:
     /// Loop over all the handles to next/previous (right/left) nodes. Passes
     /// them to a callback which returns false to stop iterating and true to
@@ -246,6 +304,32 @@ public:
     /// Loop over all the steps along a path, from first through last
     void for_each_step_in_path(const path_handle_t& path, const std::function<void(const step_handle_t&)>& iteratee) const;
 
+    /// The steps of a path laid out contiguously, with the offset of each step in the path.
+    /// offsets has one more entry than steps, holding the length of the path.
+    struct path_step_array_t {
+        std::vector<step_handle_t> steps;
+        std::vector<uint64_t> offsets;
+        /// the state of the graph and path the array was built from
+        uint64_t epoch;
+        uint64_t length;
+        step_handle_t first;
+        step_handle_t last;
+    };
+
+    /// Get the step array of the path, building it if it is missing or the graph has changed since it was built
+    std::shared_ptr<const path_step_array_t> get_path_step_array(const path_handle_t& path) const;
+
+    /// Walk paths in for_each_step_in_path through their step arrays, which are built on first use.
+    /// This trades memory for linear scans when whole paths are walked more than once.
+    void set_path_step_arrays(bool use_step_arrays);
+
+    /// Returns the step at the given 0-based index along the path
+    step_handle_t get_step_at_index(const path_handle_t& path, uint64_t index) const;
+
+    /// Returns the step covering the given 0-based base offset of the path, or path_end if the
+    /// offset is past the end of the path
+    step_handle_t get_step_at_position(const path_handle_t& path, uint64_t position) const;
+
     /// Returns true if the path is circular
     bool get_is_circular(const path_handle_t& path_handle) const;
 
@@ -258,6 +342,13 @@ public:
     /// Create a new node with the given id and sequence, then return the handle.
     handle_t create_handle(const std::string& sequence, const nid_t& id);
 
+    /// Create many nodes at once. Node storage is sized for ids up to max_id in one step, then
+    /// fill is handed a function that creates the node with a given id and sequence. That function
+    /// may be called concurrently from many threads. It returns false, creating nothing, if the id
+    /// is already in the graph, so that callers can report duplicate ids.
+    void create_handles(const nid_t& max_id,
+                        const std::function<void(const std::function<bool(const nid_t&, const std::string_view&)>&)>& fill);
+
     /// Remove the node belonging to the given handle and all of its edges.
     /// Does not update any stored paths.
     /// Invalidates the destroyed handle.
@@ -384,6 +475,31 @@ public:
      */
     step_handle_t append_step(const path_handle_t& path, const handle_t& to_append);
 
+    /**
+     * Append visits to the given nodes, in order, to the given path. The steps are
+     * created and linked node by node rather than along the path, so each node record
+     * is locked twice however many times the path visits it. Handles to prior steps on
+     * the path, and to other paths, remain valid.
+     */
+    void append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append);
+
+    /**
+     * Fill an empty path with visits to the given nodes, in order, without taking node locks.
+     * Each step reserves its rank on the node atomically and is written to the node's step
+     * buffer, so paths through the same nodes can be built from many threads at once.
+     * The buffered steps are not part of the graph until merge_step_buffers is called, which
+     * must happen before the paths or the nodes are read or changed in any other way.
+     */
+    void append_steps_buffered(const path_handle_t& path, const std::vector<handle_t>& to_append);
+
+    /// Move the steps written by append_steps_buffered into their nodes
+    void merge_step_buffers(void);
+
+    /// Create a path with the given name that visits the given nodes in order.
+    path_handle_t create_path_from_handles(const std::string& name,
+                                           const std::vector<handle_t>& handles,
+                                           bool is_circular = false);
+
     /**
      * Insert a visit to a node to the given path between the given steps.
      * Returns a handle to the new step on the path which is appended.
@@ -414,6 +530,24 @@ public:
     /// Load
     void deserialize_members(std::istream& in);
 
+    /// Load a graph written in the original, sequential node record format
+    void deserialize_legacy_members(std::istream& in);
+
+    /// Load a graph in the current or the legacy format, dispatching on the magic number
+    void deserialize(std::istream& in);
+
+    /// Load a graph from a file, decoding its node blocks in parallel. This is not a memory mapped graph: every node
+    /// is decoded into the graph's own mutable records, so memory use and load time grow with the graph. The file
+    /// is only read through a mapping when possible, so that blocks are decoded without being copied out first,
+    /// and the mapping is released once loading is done.
+    void deserialize(const std::string& filename);
+
+    /// Write one block of the node record format from consecutive runs of encoded records,
+    /// given with the offset of each record within its run
+    static void write_node_block(std::ostream& out,
+                                 const std::vector<std::string>& runs,
+                                 const std::vector<std::vector<uint64_t>>& run_offsets);
+
     void set_number_of_threads(uint64_t num_threads);
 
     uint64_t get_number_of_threads();
@@ -431,6 +565,8 @@ public:
     // TODO use it in create_handle and friends
     std::atomic_flag node_lock = ATOMIC_FLAG_INIT;
     std::vector<node_t*> node_v; // not threadsafe
+    /// Backing storage of the node records, kept in rank order by compact_node_storage
+    node_arena_t node_arena;
     node_t& get_node_ref(const handle_t& handle) const;
     const node_t& get_node_cref(const handle_t& handle) const;
     /// Mark deleted nodes here for translating graph ids into internal ranks
@@ -441,6 +577,12 @@ public:
     std::atomic<nid_t> _min_node_id = 0;
     std::atomic<nid_t> _id_increment = 0;
     uint64_t _num_threads = 1;
+    /// whether whole path walks go through the path step arrays
+    bool _use_path_step_arrays = false;
+    /// bumped by every change that can move, renumber or resize steps in place, invalidating the path step arrays;
+    /// appends and prepends are detected from the path length and ends instead
+    std::atomic<uint64_t> _step_epoch = 0;
+    inline void invalidate_path_step_arrays(void) { ++_step_epoch; }
 
     inline void canonicalize_edge(handle_t& left, handle_t& right) const {
         if (number_bool_packing::unpack_bit(left) && number_bool_packing::unpack_bit(right)
@@ -459,6 +601,8 @@ public:
         std::string name;
         std::atomic<bool> is_circular;
         std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        /// built on demand under the lock, see get_path_step_array
+        std::shared_ptr<const path_step_array_t> step_array;
         inline void get_lock(void) {
             while (lock.test_and_set(std::memory_order_acquire))  // acquire lock
                 ; // spin
@@ -521,6 +665,19 @@ public:
     /// get the backing node rank for a given node id
     uint64_t get_node_rank(const nid_t& node_id) const;
 
+    /// Copy the live node records into one run in rank order, freeing each old record's buffers
+    /// as soon as it is copied. Called by apply_ordering, so optimize() leaves the nodes contiguous.
+    void compact_node_storage(void);
+
+    /// Write the node records as blocks of independently decodable records
+    void serialize_node_blocks(std::ostream& out) const;
+
+    /// Read the node records written by serialize_node_blocks, decoding each block in parallel
+    void deserialize_node_blocks(std::istream& in, const uint64_t& node_count);
+
+    /// Read the path metadata trailer shared by all serialization formats
+    void deserialize_path_metadata(std::istream& in);
+
 };
 
 //const static uint64_t path_begin_marker = std::numeric_limits<uint64_t>::max();
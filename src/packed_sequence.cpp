@@ -0,0 +1,357 @@
+#include "packed_sequence.hpp"
+#include "dna.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace odgi {
+
+/// Two bit codes of the bases we pack in either case, 4 marks a base that is kept as an exception
+static const uint8_t base_code[256] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
+
+static const char code_base[4] = {'A', 'C', 'G', 'T'};
+static const char code_base_rc[4] = {'T', 'G', 'C', 'A'};
+static const uint64_t low_bits = 0x5555555555555555ull;
+/// Setting this bit turns an uppercase letter into its lowercase one
+static const char lowercase_bit = 0x20;
+
+inline bool is_lowercase(const char& c) {
+    return c >= 'a' && c <= 'z';
+}
+
+/// Index of the first of the n sorted and disjoint runs that ends after pos, where each run is two words:
+/// its start, shifted left by shift bits, and its length
+static uint64_t first_run(const uint64_t* runs, const uint64_t& n, const uint8_t& shift, const uint64_t& pos) {
+    uint64_t lo = 0;
+    uint64_t hi = n;
+    while (lo < hi) {
+        const uint64_t mid = (lo + hi) / 2;
+        if ((runs[2*mid] >> shift) + runs[2*mid+1] <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/// Call func(run, begin, end) for each run of first_run that overlaps the len bases from pos, with the overlap
+template<typename Func>
+inline void for_each_run_in(const uint64_t* runs, const uint64_t& n, const uint8_t& shift,
+                            const uint64_t& pos, const uint64_t& len, const Func& func) {
+    for (uint64_t r = first_run(runs, n, shift, pos); r < n && (runs[2*r] >> shift) < pos + len; ++r) {
+        const uint64_t run_begin = std::max(runs[2*r] >> shift, pos);
+        const uint64_t run_end = std::min((runs[2*r] >> shift) + runs[2*r+1], pos + len);
+        if (run_begin < run_end) {
+            func(r, run_begin, run_end);
+        }
+    }
+}
+
+packed_sequence_t::packed_sequence_t(const packed_sequence_t& other) {
+    *this = other;
+}
+
+packed_sequence_t::packed_sequence_t(packed_sequence_t&& other) noexcept {
+    *this = std::move(other);
+}
+
+packed_sequence_t& packed_sequence_t::operator=(const packed_sequence_t& other) {
+    if (this == &other) return *this;
+    clear();
+    length = other.length;
+    n_exceptions = other.n_exceptions;
+    n_lower = other.n_lower;
+    if (other.is_inline()) {
+        data.word = other.data.word;
+    } else {
+        const uint64_t n = buffer_words();
+        data.words = new uint64_t[n];
+        std::memcpy(data.words, other.data.words, n * sizeof(uint64_t));
+    }
+    return *this;
+}
+
+packed_sequence_t& packed_sequence_t::operator=(packed_sequence_t&& other) noexcept {
+    if (this == &other) return *this;
+    clear();
+    length = other.length;
+    n_exceptions = other.n_exceptions;
+    n_lower = other.n_lower;
+    data = other.data;
+    other.length = 0;
+    other.n_exceptions = 0;
+    other.n_lower = 0;
+    other.data.word = 0;
+    return *this;
+}
+
+packed_sequence_t::~packed_sequence_t(void) {
+    clear();
+}
+
+void packed_sequence_t::clear(void) {
+    if (!is_inline()) {
+        delete[] data.words;
+    }
+    length = 0;
+    n_exceptions = 0;
+    n_lower = 0;
+    data.word = 0;
+}
+
+void packed_sequence_t::assign(const std::string_view& seq) {
+    clear();
+    uint64_t exception_runs = 0;
+    uint64_t lower_runs = 0;
+    for (uint64_t i = 0; i < seq.size(); ++i) {
+        if (base_code[(uint8_t)seq[i]] == 4 && (i == 0 || seq[i-1] != seq[i])) {
+            ++exception_runs;
+        }
+        if (is_lowercase(seq[i]) && (i == 0 || !is_lowercase(seq[i-1]))) {
+            ++lower_runs;
+        }
+    }
+    if (exception_runs > std::numeric_limits<uint32_t>::max() || lower_runs > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("[odgi::packed_sequence_t] error: a sequence of " + std::to_string(seq.size())
+                                 + " bases has more than 2^32 runs of exceptions or lowercase bases.");
+    }
+    length = seq.size();
+    n_exceptions = exception_runs;
+    n_lower = lower_runs;
+    uint64_t* words = &data.word;
+    if (!is_inline()) {
+        const uint64_t n = buffer_words();
+        data.words = new uint64_t[n];
+        std::memset(data.words, 0, n * sizeof(uint64_t));
+        words = data.words;
+    }
+    uint64_t* runs = words + word_count();
+    uint64_t* lower = runs + 2 * n_exceptions;
+    for (uint64_t i = 0; i < length; ++i) {
+        const uint8_t code = base_code[(uint8_t)seq[i]];
+        if (code == 4) {
+            // exception bases are packed as A and restored as they are on decoding
+            if (i == 0 || seq[i-1] != seq[i]) {
+                runs[0] = (i << 8) | (uint8_t)seq[i];
+                runs[1] = 0;
+                runs += 2;
+            }
+            ++*(runs - 1);
+        } else {
+            words[i / 32] |= (uint64_t)code << (2 * (i % 32));
+        }
+        if (is_lowercase(seq[i])) {
+            if (i == 0 || !is_lowercase(seq[i-1])) {
+                lower[0] = i;
+                lower[1] = 0;
+                lower += 2;
+            }
+            ++*(lower - 1);
+        }
+    }
+}
+
+uint64_t packed_sequence_t::window(const uint64_t& pos) const {
+    const uint64_t* words = packed();
+    const uint64_t k = pos / 32;
+    const uint64_t shift = 2 * (pos % 32);
+    if (k >= word_count()) return 0;
+    uint64_t v = words[k] >> shift;
+    if (shift && k + 1 < word_count()) {
+        v |= words[k + 1] << (64 - shift);
+    }
+    return v;
+}
+
+char packed_sequence_t::at(const uint64_t& pos) const {
+    char c;
+    decode(pos, 1, &c);
+    return c;
+}
+
+std::string packed_sequence_t::str(void) const {
+    return substr(0, length);
+}
+
+std::string packed_sequence_t::substr(const uint64_t& pos, const uint64_t& len) const {
+    std::string seq(len, 'N');
+    decode(pos, len, &seq[0]);
+    return seq;
+}
+
+std::string packed_sequence_t::reverse_complement(const uint64_t& pos, const uint64_t& len) const {
+    std::string seq(len, 'N');
+    decode_reverse_complement(pos, len, &seq[0]);
+    return seq;
+}
+
+#ifdef __SSSE3__
+/// Expand 16 packed bases into characters using a nibble lookup table. Each byte is copied to
+/// four lanes and masked down to one base, which sits at bits 0-1, 2-3, 4-5 or 6-7 of its lane.
+/// Folding the high nibble onto the low one maps these to 0-3 or 0, 4, 8, 12, which the table
+/// resolves to the same base.
+inline __m128i decode_16_bases(const uint32_t& bits, const __m128i& table) {
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+    const __m128i lane_mask = _mm_setr_epi8(0x03, 0x0c, 0x30, (char)0xc0, 0x03, 0x0c, 0x30, (char)0xc0,
+                                            0x03, 0x0c, 0x30, (char)0xc0, 0x03, 0x0c, 0x30, (char)0xc0);
+    __m128i v = _mm_and_si128(_mm_shuffle_epi8(_mm_cvtsi32_si128(bits), spread), lane_mask);
+    v = _mm_and_si128(_mm_or_si128(v, _mm_srli_epi16(v, 4)), _mm_set1_epi8(0x0f));
+    return _mm_shuffle_epi8(table, v);
+}
+
+inline __m128i base_table(const char* bases) {
+    return _mm_setr_epi8(bases[0], bases[1], bases[2], bases[3], bases[1], 0, 0, 0,
+                         bases[2], 0, 0, 0, bases[3], 0, 0, 0);
+}
+#endif
+
+void packed_sequence_t::decode(const uint64_t& pos, const uint64_t& len, char* out) const {
+    uint64_t i = 0;
+#ifdef __SSSE3__
+    const __m128i table = base_table(code_base);
+    for ( ; i + 32 <= len; i += 32) {
+        const uint64_t v = window(pos + i);
+        _mm_storeu_si128((__m128i*)(out + i), decode_16_bases((uint32_t)v, table));
+        _mm_storeu_si128((__m128i*)(out + i + 16), decode_16_bases((uint32_t)(v >> 32), table));
+    }
+#endif
+    for ( ; i < len; i += 32) {
+        uint64_t v = window(pos + i);
+        const uint64_t n = std::min((uint64_t)32, len - i);
+        for (uint64_t k = 0; k < n; ++k, v >>= 2) {
+            out[i + k] = code_base[v & 3];
+        }
+    }
+    // the lowercase runs also cover the lowercase exceptions, which are then written as they are
+    if (n_lower) {
+        for_each_run_in(lowercase_runs(), n_lower, 0, pos, len,
+                        [&](const uint64_t&, const uint64_t& run_begin, const uint64_t& run_end) {
+                            for (uint64_t p = run_begin; p < run_end; ++p) {
+                                out[p - pos] |= lowercase_bit;
+                            }
+                        });
+    }
+    if (n_exceptions) {
+        const uint64_t* runs = exceptions();
+        for_each_run_in(runs, n_exceptions, 8, pos, len,
+                        [&](const uint64_t& r, const uint64_t& run_begin, const uint64_t& run_end) {
+                            std::memset(out + (run_begin - pos), (char)(runs[2*r] & 0xff), run_end - run_begin);
+                        });
+    }
+}
+
+void packed_sequence_t::decode_reverse_complement(const uint64_t& pos, const uint64_t& len, char* out) const {
+    // out[j] is the complement of the base at pos + len - 1 - j
+    uint64_t j = 0;
+#ifdef __SSSE3__
+    const __m128i table = base_table(code_base_rc);
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for ( ; j + 32 <= len; j += 32) {
+        const uint64_t v = window(pos + len - j - 32);
+        _mm_storeu_si128((__m128i*)(out + j),
+                         _mm_shuffle_epi8(decode_16_bases((uint32_t)(v >> 32), table), reverse));
+        _mm_storeu_si128((__m128i*)(out + j + 16),
+                         _mm_shuffle_epi8(decode_16_bases((uint32_t)v, table), reverse));
+    }
+#endif
+    for ( ; j < len; j += 32) {
+        const uint64_t n = std::min((uint64_t)32, len - j);
+        uint64_t v = window(pos + len - j - n);
+        for (uint64_t k = 0; k < n; ++k, v >>= 2) {
+            out[j + n - 1 - k] = code_base_rc[v & 3];
+        }
+    }
+    // the complements of lowercase A, C, G and T are lowercase, and the exceptions are complemented as they are
+    if (n_lower) {
+        for_each_run_in(lowercase_runs(), n_lower, 0, pos, len,
+                        [&](const uint64_t&, const uint64_t& run_begin, const uint64_t& run_end) {
+                            for (uint64_t p = run_begin; p < run_end; ++p) {
+                                out[pos + len - 1 - p] |= lowercase_bit;
+                            }
+                        });
+    }
+    if (n_exceptions) {
+        const uint64_t* runs = exceptions();
+        for_each_run_in(runs, n_exceptions, 8, pos, len,
+                        [&](const uint64_t& r, const uint64_t& run_begin, const uint64_t& run_end) {
+                            const char c = odgi::reverse_complement((char)(runs[2*r] & 0xff));
+                            std::memset(out + (pos + len - run_end), c, run_end - run_begin);
+                        });
+    }
+}
+
+void packed_sequence_t::reverse_complement_in_place(void) {
+    assign(reverse_complement(0, length));
+}
+
+void packed_sequence_t::count_codes(const uint64_t& pos, const uint64_t& len,
+                                    uint64_t& c, uint64_t& g, uint64_t& t) const {
+    // count the two bit codes a word at a time: C has the low bit set, G the high bit, T both
+    c = g = t = 0;
+    for (uint64_t i = 0; i < len; i += 32) {
+        const uint64_t n = std::min((uint64_t)32, len - i);
+        const uint64_t v = window(pos + i);
+        const uint64_t valid = (n == 32 ? low_bits : low_bits & (((uint64_t)1 << (2 * n)) - 1));
+        const uint64_t lo = v & valid;
+        const uint64_t hi = (v >> 1) & valid;
+        const uint64_t both = __builtin_popcountll(lo & hi);
+        t += both;
+        c += __builtin_popcountll(lo) - both;
+        g += __builtin_popcountll(hi) - both;
+    }
+}
+
+void packed_sequence_t::count_bases(const uint64_t& pos, const uint64_t& len, uint64_t* counts) const {
+    uint64_t c, g, t;
+    count_codes(pos, len, c, g, t);
+    counts['A'] += len - c - g - t;
+    counts['C'] += c;
+    counts['G'] += g;
+    counts['T'] += t;
+    // move the lowercase bases over to their own counts
+    if (n_lower) {
+        for_each_run_in(lowercase_runs(), n_lower, 0, pos, len,
+                        [&](const uint64_t&, const uint64_t& run_begin, const uint64_t& run_end) {
+                            uint64_t lc, lg, lt;
+                            count_codes(run_begin, run_end - run_begin, lc, lg, lt);
+                            const uint64_t la = run_end - run_begin - lc - lg - lt;
+                            counts['A'] -= la;
+                            counts['C'] -= lc;
+                            counts['G'] -= lg;
+                            counts['T'] -= lt;
+                            counts['a'] += la;
+                            counts['c'] += lc;
+                            counts['g'] += lg;
+                            counts['t'] += lt;
+                        });
+    }
+    // exceptions were packed as A, and counted as a if they are lowercase, as they then lie in a lowercase run
+    if (n_exceptions) {
+        const uint64_t* runs = exceptions();
+        for_each_run_in(runs, n_exceptions, 8, pos, len,
+                        [&](const uint64_t& r, const uint64_t& run_begin, const uint64_t& run_end) {
+                            const char base = (char)(runs[2*r] & 0xff);
+                            counts[is_lowercase(base) ? 'a' : 'A'] -= run_end - run_begin;
+                            counts[(uint8_t)base] += run_end - run_begin;
+                        });
+    }
+}
+
+uint64_t packed_sequence_t::heap_bytes(void) const {
+    return is_inline() ? 0 : buffer_words() * sizeof(uint64_t);
+}
+
+}
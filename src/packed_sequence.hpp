@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * \file packed_sequence.hpp
+ *
+ * Node sequence storage at two bits per base, with the bases that are not A, C, G or T in either case
+ * (N runs, IUPAC codes, gaps) kept as a list of exception runs, and the lowercase (soft masked)
+ * stretches as a list of case runs
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace odgi {
+
+class packed_sequence_t {
+public:
+    packed_sequence_t(void) = default;
+    packed_sequence_t(const packed_sequence_t& other);
+    packed_sequence_t(packed_sequence_t&& other) noexcept;
+    packed_sequence_t& operator=(const packed_sequence_t& other);
+    packed_sequence_t& operator=(packed_sequence_t&& other) noexcept;
+    ~packed_sequence_t(void);
+
+    /// Replace the stored sequence
+    void assign(const std::string_view& seq);
+    /// Drop the stored sequence and free its memory
+    void clear(void);
+
+    inline uint64_t size(void) const { return length; }
+    inline bool empty(void) const { return length == 0; }
+    /// Number of exception runs, which hold the bases that are not A, C, G or T in either case
+    inline uint64_t exception_count(void) const { return n_exceptions; }
+    /// Number of runs of lowercase bases
+    inline uint64_t lowercase_count(void) const { return n_lower; }
+
+    /// The base at pos
+    char at(const uint64_t& pos) const;
+    /// The whole sequence
+    std::string str(void) const;
+    /// The len bases from pos
+    std::string substr(const uint64_t& pos, const uint64_t& len) const;
+    /// The reverse complement of the len bases from pos
+    std::string reverse_complement(const uint64_t& pos, const uint64_t& len) const;
+
+    /// Write the len bases from pos to out
+    void decode(const uint64_t& pos, const uint64_t& len, char* out) const;
+    /// Write the reverse complement of the len bases from pos to out
+    void decode_reverse_complement(const uint64_t& pos, const uint64_t& len, char* out) const;
+    /// Replace the sequence by its reverse complement
+    void reverse_complement_in_place(void);
+
+    /// Add the number of times each character occurs in the len bases from pos to counts,
+    /// which is indexed by character and must have 256 entries
+    void count_bases(const uint64_t& pos, const uint64_t& len, uint64_t* counts) const;
+
+    /// Bytes allocated outside of the object itself
+    uint64_t heap_bytes(void) const;
+
+private:
+    /// Sequences of up to this many bases without exceptions are stored inline
+    const static uint64_t INLINE_BASES = 32;
+    uint64_t length = 0;
+    /// Run counts are 32 bits so that the object stays three words, which limits a sequence to 2^32 runs of each kind
+    uint32_t n_exceptions = 0;
+    uint32_t n_lower = 0;
+    /// Either the packed bases themselves or, when stored out of line, a buffer holding
+    /// the packed words, then two words per exception run: (pos << 8 | base) and the run length,
+    /// then two words per lowercase run: its pos and length
+    union {
+        uint64_t word;
+        uint64_t* words;
+    } data = {0};
+
+    inline bool is_inline(void) const { return length <= INLINE_BASES && n_exceptions == 0 && n_lower == 0; }
+    inline uint64_t word_count(void) const { return (length + 31) / 32; }
+    inline const uint64_t* packed(void) const { return is_inline() ? &data.word : data.words; }
+    inline const uint64_t* exceptions(void) const { return data.words + word_count(); }
+    inline const uint64_t* lowercase_runs(void) const { return exceptions() + 2 * n_exceptions; }
+    inline uint64_t buffer_words(void) const { return word_count() + 2 * ((uint64_t)n_exceptions + n_lower); }
+    /// The next 32 packed bases from pos, zero padded past the end of the sequence
+    uint64_t window(const uint64_t& pos) const;
+    /// Count the packed C, G and T codes of the len bases from pos
+    void count_codes(const uint64_t& pos, const uint64_t& len, uint64_t& c, uint64_t& g, uint64_t& t) const;
+};
+
+}
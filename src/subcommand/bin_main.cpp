@@ -3,6 +3,8 @@
 #include "args.hxx"
 #include "algorithms/bin_path_info.hpp"
 #include "algorithms/bin_path_depth.hpp"
+#include "algorithms/bin_summary.hpp"
+#include "algorithms/stepindex.hpp"
 #include "gfa_to_handle.hpp"
 #include "utils.hpp"
 
@@ -47,6 +49,15 @@ int main_bin(int argc, char** argv) {
                                                           " Such links solely connecting a path from left to right may not be"
                                                           "relevant to understand a path's traveral through the bins. Therfore,"
                                                           " when this option is set, the gap-links are left out saving disk space.", {'g', "no-gap-links"});
+    args::Group summary_opts(parser, "[ Bin Summary Options ]");
+    args::ValueFlag<std::string> summary_file(summary_opts, "FILE", "Answer the TSV output from the multi-resolution binned summary in this *FILE*, "
+                                                                    "without loading the graph, if it was built from the current contents of the input graph. "
+                                                                    "Otherwise, build the summary, write it to *FILE*, and answer from it. "
+                                                                    "The bin width must be a multiple of the base bin width of the summary. "
+                                                                    "The first and last nucleotide of a path in a bin are then the lowest and highest, "
+                                                                    "switched if most of its bases in the bin are inverted.", {"summary"});
+    args::ValueFlag<uint64_t> summary_base_width(summary_opts, "bp", "The bin width of the finest level of a summary built with --summary "
+                                                                      "(default: 100, or the bin width if it isn't a multiple of 100).", {"summary-base-width"});
     args::Group haplo_blocker_opts(parser, "[ HaploBlocker Options ]");
     args::Flag haplo_blocker(haplo_blocker_opts, "haplo-blocker", "Write a TSV to stdout formatted in a "
                                                                   "way ready for HaploBlocker: Each row corresponds to a node. "
@@ -84,10 +95,47 @@ int main_bin(int argc, char** argv) {
 
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
+    const std::string infile = args::get(dg_in_file);
+    const bool use_summary = !args::get(summary_file).empty() && !haplo_blocker;
+    if (use_summary) {
+        if (infile == "-") {
+            std::cerr << "[odgi::bin] error: --summary requires the graph to be read from a file, to tie the summary to it." << std::endl;
+            return 1;
+        }
+        if (args::get(output_json)) {
+            std::cerr << "[odgi::bin] error: --summary answers the TSV output, which -j/--json replaces." << std::endl;
+            return 1;
+        }
+        if (summary_base_width && args::get(summary_base_width) == 0) {
+            std::cerr << "[odgi::bin] error: the base bin width of the summary must be greater than 0." << std::endl;
+            return 1;
+        }
+    }
+
+    // the summary can stand in for the graph if it was built from it at a fitting bin width
+    algorithms::bin_summary_t summary;
+    bool summary_loaded = false;
+    if (use_summary) {
+        try {
+            summary_loaded = algorithms::load_bin_summary(summary, args::get(summary_file), infile, args::get(progress));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        const uint64_t width = args::get(bin_width) ? args::get(bin_width)
+                : (args::get(num_bins) ? summary.pangenome_length / args::get(num_bins) : 0);
+        if (summary_loaded && (width == 0 || width % summary.base_width != 0)) {
+            if (args::get(progress)) {
+                std::cerr << "[odgi::bin] rebuilding the summary in " << args::get(summary_file) << ", as its base bin width "
+                          << summary.base_width << " doesn't divide the bin width " << width << "." << std::endl;
+            }
+            summary_loaded = false;
+        }
+    }
+
 	graph_t graph;
     assert(argc > 0);
-    if (!args::get(dg_in_file).empty()) {
-        std::string infile = args::get(dg_in_file);
+    if (!summary_loaded && !infile.empty()) {
         if (infile == "-") {
             graph.deserialize(std::cin);
         } else {
@@ -267,10 +315,64 @@ int main_bin(int argc, char** argv) {
                       << "mean.pos" << "\t"
                       << "first.nucl" << "\t"
                       << "last.nucl" << std::endl;
-            algorithms::bin_path_info(graph, (args::get(aggregate_delim) ? args::get(path_delim) : ""),
-                                      write_header_tsv,write_tsv, write_seq_noop,
-                                      args::get(num_bins), args::get(bin_width), args::get(drop_gap_links),
-                                      args::get(progress));
+            if (use_summary) {
+                // the bin width as bin_path_info gets it
+                uint64_t width = args::get(bin_width);
+                if (!summary_loaded) {
+                    uint64_t len = 0;
+                    graph.for_each_handle([&](const handle_t& h) {
+                        len += graph.get_length(h);
+                    });
+                    if (!width) {
+                        width = len / args::get(num_bins);
+                    }
+                    const uint64_t base_width = args::get(summary_base_width) ? args::get(summary_base_width)
+                            : (width && width % 100 == 0 ? 100 : width);
+                    if (base_width == 0) {
+                        std::cerr << "[odgi::bin] error: the bin width must be greater than 0." << std::endl;
+                        return 1;
+                    }
+                    try {
+                        summary.build(graph, base_width, num_threads, args::get(progress));
+                        summary.graph_hash = algorithms::graph_file_hash(infile);
+                        summary.save(args::get(summary_file));
+                    } catch (const std::exception& e) {
+                        std::cerr << e.what() << std::endl;
+                        return 1;
+                    }
+                } else if (!width) {
+                    width = summary.pangenome_length / args::get(num_bins);
+                }
+                if (width == 0 || width % summary.base_width != 0) {
+                    std::cerr << "[odgi::bin] error: the bin width " << width << " is not a multiple of the base bin width "
+                              << summary.base_width << " of the summary in " << args::get(summary_file) << "." << std::endl;
+                    return 1;
+                }
+                for (uint64_t i = 0; i < summary.path_names.size(); ++i) {
+                    const std::string& path_name = summary.path_names[i];
+                    const std::string name_prefix = get_path_prefix(path_name);
+                    const std::string name_suffix = get_path_suffix(path_name);
+                    const uint64_t path_length = summary.path_lengths[i];
+                    summary.for_each_bin(i, width, [&](const algorithms::bin_summary_entry_t& entry) {
+                        const algorithms::bin_summary_means_t means = entry.means(width, path_length);
+                        const bool inverted = entry.inverted * 2 > entry.depth;
+                        std::cout << path_name << "\t"
+                                  << name_prefix << "\t"
+                                  << name_suffix << "\t"
+                                  << entry.bin + 1 << "\t"
+                                  << means.depth << "\t"
+                                  << means.inverted << "\t"
+                                  << means.position << "\t"
+                                  << (inverted ? entry.last : entry.first) << "\t"
+                                  << (inverted ? entry.first : entry.last) << std::endl;
+                    });
+                }
+            } else {
+                algorithms::bin_path_info(graph, (args::get(aggregate_delim) ? args::get(path_delim) : ""),
+                                          write_header_tsv,write_tsv, write_seq_noop,
+                                          args::get(num_bins), args::get(bin_width), args::get(drop_gap_links),
+                                          args::get(progress));
+            }
         }
     }
     return 0;
@@ -1,6 +1,7 @@
 #include "subcommand.hpp"
 #include "odgi.hpp"
 #include "gfa_to_handle.hpp"
+#include "gfa_to_og.hpp"
 #include "args.hxx"
 #include <cstdio>
 #include <algorithm>
@@ -31,6 +32,11 @@ int main_build(int argc, char** argv) {
     args::Flag toposort(graph_sorting, "sort", "Apply a general topological sort to the graph and order the node ids"
                                         "  accordingly. A bidirected adaptation of Kahn’s topological sort (1962)"
                                         "  is used, which can handle components with no heads or tails. Here, both heads and tails are taken into account.", {'s', "sort"});
+    args::Group external_build(parser, "[ External Memory Build ]");
+    args::ValueFlag<uint64_t> memory_budget(external_build, "N", "Build the graph in external memory, writing it straight to the output file."
+                                                             " Nodes, edges and path steps are sorted on disk and at most about *N* megabytes"
+                                                             " of node records are held in memory at a time.", {'M', "memory-budget"});
+    args::ValueFlag<std::string> tmp_base(external_build, "PATH", "Directory for temporary files (default: the current working directory).", {'C', "temp-dir"});
     args::Group threading(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
     args::Group processing_information(parser, "[ Processing Information ]");
@@ -67,6 +73,33 @@ int main_build(int argc, char** argv) {
         std::cerr << "[odgi::build] error: please specify an output file to store the graph via -o=[FILE], --out=[FILE]." << std::endl;
         return 1;
     }
+    if (memory_budget) {
+        const std::string gfa_filename = args::get(gfa_file);
+        const std::string outfile = args::get(dg_out_file);
+        if (!std::filesystem::exists(gfa_filename)) {
+            std::cerr << "[odgi::build] error: the given file \"" << gfa_filename << "\" does not exist. Please specify an existing input file via -g=[FILE], --gfa=[FILE]." << std::endl;
+            return 1;
+        }
+        if (outfile == "-") {
+            std::cerr << "[odgi::build] error: an external memory build writes the graph in place and needs an output file, not stdout." << std::endl;
+            return 1;
+        }
+        if (args::get(toposort) || args::get(debug)) {
+            std::cerr << "[odgi::build] error: -s, --sort and -d, --debug need the graph in memory and cannot be combined with -M, --memory-budget." << std::endl;
+            return 1;
+        }
+        if (tmp_base) {
+            xp::temp_file::set_dir(args::get(tmp_base));
+        } else {
+            char cwd[512];
+            getcwd(cwd, sizeof(cwd));
+            xp::temp_file::set_dir(std::string(cwd));
+        }
+        gfa_to_og(gfa_filename, outfile, args::get(optimize), args::get(nthreads),
+                  args::get(memory_budget) * 1024 * 1024, args::get(progress));
+        return 0;
+    }
+
     {
         const std::string gfa_filename = args::get(gfa_file);
         if (!std::filesystem::exists(gfa_filename)) {
@@ -74,7 +107,12 @@ int main_build(int argc, char** argv) {
             return 1;
         }
         if (!gfa_filename.empty()) {
-            gfa_to_handle(gfa_filename, &graph, args::get(optimize), args::get(nthreads), args::get(progress));
+            try {
+                gfa_to_handle(gfa_filename, &graph, args::get(optimize), args::get(nthreads), args::get(progress));
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
         }
     }
 
@@ -357,16 +357,13 @@ int main_degree(int argc, char** argv) {
 
 	auto get_graph_pos = [](const odgi::graph_t &graph,
 							const path_pos_t &pos) {
-		const auto path_end = graph.path_end(pos.path);
-		uint64_t walked = 0;
-		for (step_handle_t s = graph.path_begin(pos.path);
-			 s != path_end; s = graph.get_next_step(s)) {
-			handle_t h = graph.get_handle_of_step(s);
-			uint64_t node_length = graph.get_length(h);
-			if (walked + node_length > pos.offset) {
-				return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-			}
-			walked += node_length;
+		// binary search in the path's step array, which is built once and shared by all the queries on the path
+		const auto step_array = graph.get_path_step_array(pos.path);
+		const auto& offsets = step_array->offsets;
+		if (pos.offset < offsets.back()) {
+			const uint64_t i = std::upper_bound(offsets.begin(), offsets.end(), pos.offset) - offsets.begin() - 1;
+			handle_t h = graph.get_handle_of_step(step_array->steps[i]);
+			return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - offsets[i]);
 		}
 
 #pragma omp critical (cout)
@@ -7,6 +7,7 @@
 #include "algorithms/depth.hpp"
 #include "algorithms/path_length.hpp"
 #include <omp.h>
+#include <mutex>
 
 #include "src/algorithms/subgraph/extract.hpp"
 
@@ -70,6 +71,15 @@ namespace odgi {
                                    "Provide a summary of the depth distribution in the graph, in a tab-delimited format it prints to stdout: node.count, graph.length, step.count, path.length, mean.node.depth (step.count/node.count), and mean.graph.depth (path.length/graph.length).",
                                    {'S', "summarize"});
 
+        args::Flag _bedgraph(depth_opts, "bedgraph",
+                             "Write the depth along each path as a bedGraph of runs of equal depth (path, start, end, depth) to stdout, "
+                             "in one pass over the paths. Only the paths given with -r/--path or -R/--paths are written, otherwise all paths.",
+                             {'B', "bedgraph"});
+        args::ValueFlag<uint64_t> _bedgraph_window(depth_opts, "N",
+                                                   "With -B/--bedgraph, write the mean depth of windows of N bp along each path instead, "
+                                                   "merging adjacent windows with the same mean depth.",
+                                                   {"bedgraph-window"});
+
         args::ValueFlag<std::string> _windows_in(depth_opts, "LEN:MIN:MAX:TIPS",
                                                 "Print to stdout a BED file of path intervals where the depth is between MIN and MAX, "
                                                 "merging regions not separated by more than LEN bp."
@@ -236,7 +246,29 @@ namespace odgi {
             }
         };
 
-        if (summarize_depth) {
+        std::vector<path_handle_t> bedgraph_paths;
+        if (_bedgraph) {
+            auto add_bedgraph_path = [&](const std::string& name) {
+                if (!graph.has_path(name)) {
+                    std::cerr << "[odgi::depth] error: path " << name << " not found in graph" << std::endl;
+                    exit(1);
+                }
+                bedgraph_paths.push_back(graph.get_path_handle(name));
+            };
+            if (path_name) {
+                add_bedgraph_path(args::get(path_name));
+            } else if (path_file) {
+                std::ifstream refs(args::get(path_file));
+                std::string line;
+                while (std::getline(refs, line)) {
+                    if (!line.empty()) {
+                        add_bedgraph_path(line);
+                    }
+                }
+            } else {
+                graph.for_each_path_handle([&](const path_handle_t &path) { bedgraph_paths.push_back(path); });
+            }
+        } else if (summarize_depth) {
             // we do nothing here, we iterate over the handles in the graph later
         } else if (graph_depth_table) {
             graph.for_each_handle([&](const handle_t &h) {
@@ -364,16 +396,13 @@ namespace odgi {
 
         auto get_graph_pos = [](const odgi::graph_t &graph,
                                 const path_pos_t &pos) {
-            const auto path_end = graph.path_end(pos.path);
-            uint64_t walked = 0;
-            for (step_handle_t s = graph.path_begin(pos.path);
-                 s != path_end; s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                uint64_t node_length = graph.get_length(h);
-                if (walked + node_length > pos.offset) {
-                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-                }
-                walked += node_length;
+            // binary search in the path's step array, which is built once and shared by all the queries on the path
+            const auto step_array = graph.get_path_step_array(pos.path);
+            const auto& offsets = step_array->offsets;
+            if (pos.offset < offsets.back()) {
+                const uint64_t i = std::upper_bound(offsets.begin(), offsets.end(), pos.offset) - offsets.begin() - 1;
+                handle_t h = graph.get_handle_of_step(step_array->steps[i]);
+                return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - offsets[i]);
             }
 
 #pragma omp critical (cout)
@@ -465,6 +494,47 @@ namespace odgi {
                            }, num_threads);
         }
 
+        if (_bedgraph) {
+            // the lines of a path are written out together, so that the paths of different threads don't interleave.
+            // A thread collects the lines of its path until they reach chunk_size, and then holds on to the output
+            // until the path is done, writing its lines in chunks, so memory stays bounded however long the paths are.
+            const uint64_t window_size = _bedgraph_window ? args::get(_bedgraph_window) : 0;
+            const uint64_t chunk_size = 1 << 20;
+            struct path_lines_t {
+                std::string buffer;
+                std::unique_lock<std::mutex> output;
+            };
+            std::mutex output_mutex;
+            std::vector<path_lines_t> path_lines(num_threads);
+            for (auto& lines : path_lines) {
+                lines.output = std::unique_lock<std::mutex>(output_mutex, std::defer_lock);
+            }
+            auto write = [&](path_lines_t& lines) {
+                if (!lines.output.owns_lock()) {
+                    lines.output.lock();
+                }
+                std::cout << lines.buffer;
+                lines.buffer.clear();
+            };
+            algorithms::for_each_path_depth_run(
+                graph, bedgraph_paths, _subset_paths ? paths_to_consider : std::vector<bool>(), window_size, num_threads,
+                [&](const path_handle_t& path, const uint64_t& start, const uint64_t& end, const double& depth) {
+                    auto& lines = path_lines[omp_get_thread_num()];
+                    std::stringstream line;
+                    line << graph.get_path_name(path) << "\t" << start << "\t" << end << "\t" << depth << "\n";
+                    lines.buffer += line.str();
+                    if (lines.buffer.size() >= chunk_size) {
+                        write(lines);
+                    }
+                },
+                [&](const path_handle_t& path) {
+                    auto& lines = path_lines[omp_get_thread_num()];
+                    write(lines);
+                    lines.output.unlock();
+                });
+            std::cout.flush();
+        }
+
         if (summarize_depth) {
             std::cout << "#node.count\tgraph.length\tstep.count\tpath.length\tmean.node.depth\tmean.graph.depth" << std::endl;
             std::atomic<uint64_t> step_count; step_count.store(0);
@@ -36,6 +36,7 @@ int main_draw(int argc, char **argv) {
     args::ValueFlag<std::string> tsv_out_file(files_io_opts, "FILE", "Write the TSV layout plus displayed annotations to this FILE.", {'T', "tsv"});
     args::ValueFlag<std::string> svg_out_file(files_io_opts, "FILE", "Write an SVG rendering to this FILE.", {'s', "svg"});
     args::ValueFlag<std::string> png_out_file(files_io_opts, "FILE", "Write a rasterized PNG rendering to this FILE.", {'p', "png"});
+    args::ValueFlag<std::string> tiles_out_dir(files_io_opts, "DIR", "Write the rasterized rendering as a pyramid of PNG tiles to DIR/z/x/y.png, zoom level z 0 holding the whole layout in a single tile, and describe the pyramid in DIR/tiles.json.", {"tiles"});
     args::ValueFlag<std::string> xp_in_file(files_io_opts, "FILE", "Load the path index from this FILE.", {'X', "path-index"});
     args::Group visualizations_opts(parser, "[ Visualization Options ]");
     args::ValueFlag<uint64_t> png_height(visualizations_opts, "FILE", "Height of PNG rendering (default: 1000).", {'H', "png-height"});
@@ -45,6 +46,8 @@ int main_draw(int argc, char **argv) {
     args::ValueFlag<double> render_border(visualizations_opts, "N", "Image border (in approximate bp) (default 100.0).", {'B', "border"});
     args::ValueFlag<double> png_line_width(visualizations_opts, "N", "Line width (in approximate bp) (default 0.0).", {'w', "line-width"});
     //args::ValueFlag<double> png_line_overlay(parser, "N", "line width (in approximate bp) (default 10.0)", {'O', "line-overlay"});
+    args::ValueFlag<uint64_t> tile_size(visualizations_opts, "N", "Width and height of the PNG tiles in pixels (default: 256).", {"tile-size"});
+    args::ValueFlag<uint64_t> tile_max_zoom(visualizations_opts, "N", "Render the PNG tiles down to zoom level N at most (default: the level at which a pixel covers a base pair).", {"tile-max-zoom"});
     args::ValueFlag<double> png_path_line_spacing(visualizations_opts, "N", "Spacing between path lines in PNG layout (in approximate bp) (default 0.0).", {'S', "path-line-spacing"});
     args::ValueFlag<std::string> _path_bed_file(visualizations_opts, "FILE",
                                                 "Color the nodes based on the input annotation in the given BED FILE. "
@@ -87,13 +90,18 @@ int main_draw(int argc, char **argv) {
 		return 1;
 	}
 
-    if (!tsv_out_file && !svg_out_file && !png_out_file) {
+    if (!tsv_out_file && !svg_out_file && !png_out_file && !tiles_out_dir) {
         std::cerr
-            << "[odgi::draw] error: please specify an output file to where to store the layout via -p/--png=[FILE], -s/--svg=[FILE], -T/--tsv=[FILE]"
+            << "[odgi::draw] error: please specify an output file to where to store the layout via -p/--png=[FILE], -s/--svg=[FILE], -T/--tsv=[FILE], --tiles=[DIR]"
             << std::endl;
         return 1;
     }
 
+    if (tile_size && args::get(tile_size) == 0) {
+        std::cerr << "[odgi::draw] error: please specify a tile size greater than 0 via --tile-size=[N]." << std::endl;
+        return 1;
+    }
+
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
 	graph_t graph;
@@ -227,6 +235,15 @@ int main_draw(int argc, char **argv) {
         std::vector<double> Y = layout.get_Y();
         algorithms::draw_png(outfile, X, Y, graph, 1.0, border_bp, 0, _png_height, _png_line_width, _png_path_line_spacing, _color_paths, node_id_to_color);
     }
+
+    if (tiles_out_dir) {
+        std::vector<double> X = layout.get_X();
+        std::vector<double> Y = layout.get_Y();
+        algorithms::draw_png_tiles(args::get(tiles_out_dir), X, Y, graph, 1.0, border_bp,
+                                   tile_size ? args::get(tile_size) : 256, tile_max_zoom ? args::get(tile_max_zoom) : std::numeric_limits<uint64_t>::max(),
+                                   _png_line_width, _png_path_line_spacing, _color_paths, node_id_to_color,
+                                   num_threads, args::get(progress));
+    }
     
     return 0;
 }
@@ -410,7 +410,114 @@ namespace odgi {
 
         omp_set_num_threads((int) num_threads);
 
-        auto prep_graph = [&shift](
+        // Create the subpaths of the path ranges in the subgraph, from the handles collected for them
+        auto add_path_range_subpaths = [](
+                const graph_t &source, graph_t &subgraph,
+                const std::vector<odgi::path_range_t> &path_ranges, const std::vector<std::vector<handle_t>> &range_handles,
+                const uint64_t num_threads) {
+            // Create subpaths
+            std::vector<path_handle_t> subpaths_from_path_ranges;
+            subpaths_from_path_ranges.reserve(path_ranges.size());
+
+            for (auto &path_range : path_ranges) {
+                const std::string path_name = source.get_path_name(path_range.begin.path);
+
+                subpaths_from_path_ranges.push_back(
+                        // The function assumes that every path is new and unique
+                        odgi::algorithms::create_subpath(
+                            subgraph,
+                            odgi::algorithms::make_path_name(path_name, path_range.begin.offset, path_range.end.offset),
+                            source.get_is_circular(path_range.begin.path)
+                    )
+                );
+            }
+
+            // Fill subpaths in parallel
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t i = 0; i < subpaths_from_path_ranges.size(); ++i) {
+                const path_handle_t subpath_handle = subpaths_from_path_ranges[i];
+
+                std::vector<handle_t> handles;
+                handles.reserve(range_handles[i].size());
+                for (auto &handle : range_handles[i]) {
+                    handles.push_back(subgraph.get_handle(source.get_id(handle),
+                                                          source.get_is_reverse(handle)));
+                }
+                subgraph.append_steps(subpath_handle, handles);
+            }
+        };
+
+        // Fix the edges the subpaths walk but the subgraph lacks, and remove empty subpaths
+        auto finish_subgraph = [](graph_t &subgraph, const uint64_t num_threads, const bool show_progress, const bool optimize) {
+            std::vector<path_handle_t> subpaths;
+            subpaths.reserve(subgraph.get_path_count());
+            subgraph.for_each_path_handle([&](const path_handle_t& path) {
+                subpaths.push_back(path);
+            });
+
+            std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_checking;
+            if (show_progress) {
+                progress_checking = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                        subpaths.size(), "[odgi::extract] checking missing edges and empty subpaths");
+            }
+
+            ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (auto path: subpaths) {
+                handle_t last;
+                const step_handle_t begin_step = subgraph.path_begin(path);
+                subgraph.for_each_step_in_path(path, [&](const step_handle_t &step) {
+                    handle_t h = subgraph.get_handle_of_step(step);
+                    if (step != begin_step && !subgraph.has_edge(last, h)) {
+#pragma omp critical (edges_to_create)
+                        edges_to_create.insert({last, h});
+                    }
+                    last = h;
+                });
+
+                if (show_progress) {
+                    progress_checking->increment(1);
+                }
+            }
+
+            if (show_progress) {
+                progress_checking->finish();
+            }
+
+            // remove empty subpaths
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (auto path: subpaths) {
+                if (subgraph.is_empty(path)) {
+#pragma omp critical (subgraph)
+                    subgraph.destroy_path(path);
+                }
+            }
+
+            if (show_progress && subgraph.get_path_count() < subpaths.size()) {
+                std::cerr << "[odgi::extract] removed " << (subpaths.size() - subgraph.get_path_count()) << " empty subpath(s)." << std::endl;
+            }
+
+            subpaths.clear();
+
+            // add missing edges
+            for (auto edge: edges_to_create) {
+                subgraph.create_edge(edge.first, edge.second);
+            }
+
+            if (show_progress && edges_to_create.size() > 0) {
+                std::cerr << "[odgi::extract] fixed " << edges_to_create.size() << " edge(s)" << std::endl;
+            }
+
+            // This should not be necessary, if the extraction works correctly
+            // subgraph.remove_orphan_edges();
+
+            if (optimize) {
+                subgraph.optimize();
+            }
+        };
+
+        auto prep_graph = [&shift, &add_path_range_subpaths, &finish_subgraph](
                              graph_t &source, std::vector<path_handle_t>* source_paths,
                              const std::vector<path_handle_t>& lace_paths, graph_t &subgraph,
                              std::vector<odgi::path_range_t> path_ranges, std::vector<std::pair<uint64_t, uint64_t>> pangenomic_ranges,
@@ -462,52 +569,21 @@ namespace odgi {
             }
 
             // Collect handles in path/pangenomic ranges (it is assumed they were already inverted outside, if needed)
+            std::vector<std::vector<handle_t>> range_handles;
             {
-                std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
-                if (show_progress) {
-                    progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                            path_ranges.size(), "[odgi::extract] extracting path ranges");
-                }
+                // The extraction does not cut nodes, so the input path ranges are extended
+                // if their ranges (start, end) fall in the middle of the nodes.
+                range_handles = algorithms::collect_path_ranges(source, path_ranges, num_threads, show_progress
+                                                                                                  ? "[odgi::extract] extracting path ranges"
+                                                                                                  : "");
 
                 atomicbitvector::atomic_bv_t keep_bv(source.get_node_count()+1);
 
 #pragma omp parallel for schedule(dynamic,1)
-                for (auto &path_range : path_ranges) {
-                    const path_handle_t path_handle = path_range.begin.path;
-                    if (show_progress) {
-                        progress->increment(1);
+                for (uint64_t i = 0; i < range_handles.size(); ++i) {
+                    for (auto &h : range_handles[i]) {
+                        keep_bv.set(source.get_id(h) - shift);
                     }
-
-                    // The extraction does not cut nodes, so the input path ranges have to be
-                    // extended if their ranges (start, end) fall in the middle of the nodes.
-                    bool first = true;
-                    uint64_t new_start = 0;
-                    uint64_t new_end = 0;
-                    
-                    const uint64_t start = path_range.begin.offset;
-                    const uint64_t end = path_range.end.offset;
-
-                    uint64_t walked = 0;
-                    const auto path_end = source.path_end(path_handle);
-                    for (step_handle_t cur_step = source.path_begin(path_handle);
-                        cur_step != path_end && walked < end; cur_step = source.get_next_step(cur_step)) {
-                        const handle_t cur_handle = source.get_handle_of_step(cur_step);
-                        walked += source.get_length(cur_handle);
-                        if (walked > start) {
-                            keep_bv.set(source.get_id(cur_handle) - shift);
-
-                            if (first) {
-                                first = false;
-                                new_start = walked - source.get_length(cur_handle);
-                            }
-                        }
-                    }
-                    new_end = walked;
-
-                    // Extend path range to entirely include the first and the last node of the range.
-                    // Thi is important to path names with the correct path ranges.
-                    path_range.begin.offset = new_start;
-                    path_range.end.offset = new_end;
                 }
                 if (!pangenomic_ranges.empty()) {
                     uint64_t pos = 0;
@@ -529,10 +605,6 @@ namespace odgi {
                     subgraph.create_handle(source.get_sequence(h),
                                            id_shifted + shift);
                 }
-
-                if (show_progress) {
-                    progress->finish();
-                }
             }
 
             // Check if there are nodes in the subgraph, to avoid min_node_id == max_node_id == 0
@@ -647,43 +719,8 @@ namespace odgi {
                 }
             }
 
-            // ----------------------------------------------------------------------------------
             // Insert the subpaths corresponding to the path ranges (if any)
-            // Create subpaths
-            std::vector<path_handle_t> subpaths_from_path_ranges;
-            subpaths_from_path_ranges.reserve(path_ranges.size());
-
-            for (auto &path_range : path_ranges) {
-                const std::string path_name = source.get_path_name(path_range.begin.path);
-
-                subpaths_from_path_ranges.push_back(
-                        // The function assumes that every path is new and unique
-                        odgi::algorithms::create_subpath(
-                            subgraph,
-                            odgi::algorithms::make_path_name(path_name, path_range.begin.offset, path_range.end.offset),
-                            source.get_is_circular(path_range.begin.path)
-                    )
-                );
-            }
-
-            // Fill subpaths in parallel
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (uint64_t i = 0; i < subpaths_from_path_ranges.size(); ++i) {
-                auto path_range = path_ranges[i];
-                const path_handle_t path_handle = path_range.begin.path;
-                const path_handle_t subpath_handle = subpaths_from_path_ranges[i];
-
-                algorithms::for_handle_in_path_range(
-                        source, path_handle, path_range.begin.offset, path_range.end.offset,
-                        [&](const handle_t& handle) {
-                            subgraph.append_step(
-                                    subpath_handle,
-                                    subgraph.get_handle(source.get_id(handle),
-                                                        source.get_is_reverse(handle))
-                            );
-                        });
-            }
-            // ----------------------------------------------------------------------------------
+            add_path_range_subpaths(source, subgraph, path_ranges, range_handles, num_threads);
 
             // rewrite lace paths so that skipped regions are represented as new nodes that we then add to our subgraph
             if (!lace_paths.empty()) {
@@ -703,88 +740,141 @@ namespace odgi {
             algorithms::add_subpaths_to_subgraph(source, *source_paths, subgraph, num_threads,
                                                  show_progress ? "[odgi::extract] adding subpaths" : "");
 
-            std::vector<path_handle_t> subpaths;
-            subpaths.reserve(subgraph.get_path_count());
-            subgraph.for_each_path_handle([&](const path_handle_t& path) {
-                subpaths.push_back(path);
-            });
+            finish_subgraph(subgraph, num_threads, show_progress, optimize);
+        };
 
-            std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_checking;
-            if (show_progress) {
-                progress_checking = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                        subpaths.size(), "[odgi::extract] checking missing edges and empty subpaths");
+        auto check_and_create_handle = [&](const graph_t &source, graph_t &subgraph, const nid_t node_id) {
+            if (graph.has_node(node_id)) {
+                if (!subgraph.has_node(node_id)){
+                    const handle_t cur_handle = graph.get_handle(node_id);
+                    subgraph.create_handle(
+                            source.get_sequence(source.get_is_reverse(cur_handle) ? source.flip(cur_handle) : cur_handle),
+                            node_id);
+                }
+            } else {
+                std::cerr << "[odgi::extract] warning, cannot find node " << node_id << std::endl;
             }
+        };
 
-            ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
-
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (auto path: subpaths) {
-                handle_t last;
-                const step_handle_t begin_step = subgraph.path_begin(path);
-                subgraph.for_each_step_in_path(path, [&](const step_handle_t &step) {
-                    handle_t h = subgraph.get_handle_of_step(step);
-                    if (step != begin_step && !subgraph.has_edge(last, h)) {
-#pragma omp critical (edges_to_create)
-                        edges_to_create.insert({last, h});
+        if (_split_subgraphs && lace_paths.empty()) {
+            // All subgraphs are extracted together: the path ranges are collected with one walk along each path, and
+            // so are the subpaths of the other paths through all the subgraphs. Then the subgraphs are built and
+            // written in parallel, each as if its path range had been extracted on its own.
+            // The files are named after the given path ranges, the subpaths after the ranges extended to their nodes
+            std::vector<odgi::path_range_t> extended_ranges = *path_ranges;
+            const std::vector<std::vector<handle_t>> range_handles = algorithms::collect_path_ranges(
+                    graph, extended_ranges, num_threads, show_progress ? "[odgi::extract] extracting path ranges" : "");
+
+            // The nodes of each subgraph, in the order they are added to it, and the path of its range,
+            // which is left out of the subpaths added to it
+            std::vector<std::vector<nid_t>> node_sets(path_ranges->size());
+            std::vector<path_handle_t> range_paths(path_ranges->size());
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t i = 0; i < path_ranges->size(); ++i) {
+                range_paths[i] = (*path_ranges)[i].begin.path;
+                auto &node_set = node_sets[i];
+                for (auto &h : range_handles[i]) {
+                    node_set.push_back(graph.get_id(h));
+                }
+                std::sort(node_set.begin(), node_set.end());
+                node_set.erase(std::unique(node_set.begin(), node_set.end()), node_set.end());
+
+                if (_full_range && !node_set.empty()) {
+                    // Take the start and end node of this and fill things in
+                    const std::vector<nid_t> in_ranges = node_set;
+                    for (nid_t id = in_ranges.front(); id <= in_ranges.back(); ++id) {
+                        if (!std::binary_search(in_ranges.begin(), in_ranges.end(), id)) {
+                            node_set.push_back(id);
+                        }
                     }
-                    last = h;
-                });
-
-                if (show_progress) {
-                    progress_checking->increment(1);
                 }
             }
 
-            if (show_progress) {
-                progress_checking->finish();
-            }
+            std::vector<std::vector<algorithms::subpath_run_t>> runs = algorithms::find_subpath_runs(
+                    graph, paths, node_sets, range_paths, num_threads);
 
-            // remove empty subpaths
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (auto path: subpaths) {
-                if (subgraph.is_empty(path)) {
-#pragma omp critical (subgraph)
-                    subgraph.destroy_path(path);
-                }
-            }
+            if (max_dist_subpaths > 0) {
+                // Iterate multiple times to merge subpaths which became mergeable during the first iteration where new nodes were added
+                for (uint8_t iteration = 0; iteration < num_iterations; ++iteration) {
+                    std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+                    if (show_progress) {
+                        progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                                node_sets.size(), "[odgi::extract] merge subpaths closer than " + std::to_string(max_dist_subpaths) + " bps - iteration " +
+                                                  std::to_string(iteration + 1) + " (max " + std::to_string(num_iterations) + ")");
+                    }
 
-            if (show_progress && subgraph.get_path_count() < subpaths.size()) {
-                std::cerr << "[odgi::extract] removed " << (subpaths.size() - subgraph.get_path_count()) << " empty subpath(s)." << std::endl;
-            }
+                    std::atomic<bool> merged(false);
+#pragma omp parallel for schedule(dynamic,1)
+                    for (uint64_t i = 0; i < node_sets.size(); ++i) {
+                        // Restore the short subpaths between two runs of the same path by adding their handles
+                        ska::flat_hash_set<nid_t> added;
+                        for (uint64_t k = 1; k < runs[i].size(); ++k) {
+                            const auto &prev = runs[i][k - 1];
+                            const auto &next = runs[i][k];
+                            if (prev.path == next.path && next.start - prev.end <= max_dist_subpaths) {
+                                for (step_handle_t step = graph.get_next_step(prev.last); step != next.first; step = graph.get_next_step(step)) {
+                                    const nid_t id = graph.get_id(graph.get_handle_of_step(step));
+                                    // To avoid adding multiple times the same node
+                                    if (added.insert(id).second) {
+                                        node_sets[i].push_back(id);
+                                    }
+                                }
+                            }
+                        }
+                        if (!added.empty()) {
+                            merged.store(true);
+                        }
 
-            subpaths.clear();
+                        if (show_progress) {
+                            progress->increment(1);
+                        }
+                    }
 
-            // add missing edges
-            for (auto edge: edges_to_create) {
-                subgraph.create_edge(edge.first, edge.second);
+                    if (show_progress) {
+                        progress->finish();
+                    }
+
+                    if (!merged.load()) {
+                        break; // Nothing mergeable, do not waste time in further iterations
+                    }
+
+                    runs = algorithms::find_subpath_runs(graph, paths, node_sets, range_paths, num_threads);
+                }
             }
 
-            if (show_progress && edges_to_create.size() > 0) {
-                std::cerr << "[odgi::extract] fixed " << edges_to_create.size() << " edge(s)" << std::endl;
+            std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+            if (show_progress) {
+                progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                        path_ranges->size(), "[odgi::extract] writing " + std::to_string(path_ranges->size()) + " subgraphs");
             }
 
-            // This should not be necessary, if the extraction works correctly
-            // subgraph.remove_orphan_edges();
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t i = 0; i < path_ranges->size(); ++i) {
+                const auto &path_range = (*path_ranges)[i];
+                graph_t subgraph;
+                for (auto &id : node_sets[i]) {
+                    subgraph.create_handle(graph.get_sequence(graph.get_handle(id)), id);
+                }
+                add_path_range_subpaths(graph, subgraph, {extended_ranges[i]}, {range_handles[i]}, 1);
+                algorithms::add_connecting_edges_to_subgraph(graph, subgraph);
+                algorithms::add_subpath_runs_to_subgraph(graph, runs[i], subgraph);
+                finish_subgraph(subgraph, 1, false, optimize);
 
-            if (optimize) {
-                subgraph.optimize();
-            }
-        };
+                const string filename = graph.get_path_name(path_range.begin.path) + ":" + to_string(path_range.begin.offset) + "-" + to_string(path_range.end.offset) + ".og";
+                ofstream f(filename);
+                subgraph.serialize(f);
+                f.close();
 
-        auto check_and_create_handle = [&](const graph_t &source, graph_t &subgraph, const nid_t node_id) {
-            if (graph.has_node(node_id)) {
-                if (!subgraph.has_node(node_id)){
-                    const handle_t cur_handle = graph.get_handle(node_id);
-                    subgraph.create_handle(
-                            source.get_sequence(source.get_is_reverse(cur_handle) ? source.flip(cur_handle) : cur_handle),
-                            node_id);
+                if (show_progress) {
+                    progress->increment(1);
                 }
-            } else {
-                std::cerr << "[odgi::extract] warning, cannot find node " << node_id << std::endl;
             }
-        };
 
-        if (_split_subgraphs) {
+            if (show_progress) {
+                progress->finish();
+            }
+        } else if (_split_subgraphs) {
+            // Lace paths are embedded into the source graph, so its subgraphs are extracted one at a time
             for (auto &path_range : *path_ranges) {
                 graph_t subgraph;
 
@@ -796,8 +886,10 @@ namespace odgi {
                               << path_range.end.offset << std::endl;
                 }
 
+                // Each subgraph gets the subpaths of all paths but the one of its range
+                std::vector<path_handle_t> source_paths = paths;
                 prep_graph(
-                    graph, &paths,
+                    graph, &source_paths,
                     lace_paths, subgraph,
                     {path_range}, *pangenomic_ranges,
                     context_steps, context_bases, _full_range, false,
@@ -186,7 +186,7 @@ int main_heaps(int argc, char **argv) {
         }
     };
 
-    algorithms::for_each_heap_permutation(graph, path_groups, intervals, n_permutations, min_node_depth, handle_output);
+    algorithms::for_each_heap_permutation(graph, path_groups, intervals, n_permutations, min_node_depth, num_threads, handle_output);
 
     return 0;
 }
@@ -73,11 +73,27 @@ int main_layout(int argc, char **argv) {
                                                {'k', "path-sgd-zipf-space"});
     args::ValueFlag<uint64_t> p_sgd_zipf_space_max(pg_sgd_opts, "N", "The maximum space size N of the Zipfian distribution beyond which quantization occurs (default: 1000).", {'I', "path-sgd-zipf-space-max"});
     args::ValueFlag<uint64_t> p_sgd_zipf_space_quantization_step(pg_sgd_opts, "N", "The size of the quantization step N when the maximum space size of the Zipfian distribution is exceeded (default: 100).", {'l', "path-sgd-zipf-space-quantization-step"});
-    /*
-    args::ValueFlag<std::string> p_sgd_seed(parser, "STRING",
-                                            "set the seed for the deterministic 1-threaded path guided linear 1D SGD model (default: pangenomic!)",
+    args::Flag p_sgd_deterministic(pg_sgd_opts, "path-sgd-deterministic",
+                                   "Run the path guided 2D SGD deterministically with any number of threads. Each iteration draws its terms from random streams of the seed and applies them in blocks of nodes that no two threads update at the same time, so the layout only depends on the seed.",
+                                   {"path-sgd-deterministic"});
+    args::Flag p_sgd_multilevel(pg_sgd_opts, "path-sgd-multilevel",
+                                "Run the path guided 2D SGD on a hierarchy of coarser graphs first, whose nodes merge pairs of nodes that follow each other in the paths. The coarsest level gets the full learning schedule and each finer level only refines the layout of the level above it, which gets large graphs into shape in fewer term updates.",
+                                {"path-sgd-multilevel"});
+    args::ValueFlag<std::string> p_sgd_seed(pg_sgd_opts, "STRING",
+                                            "Set the seed for the deterministic path guided 2D SGD model (default: pangenomic!).",
                                             {'q', "path-sgd-seed"});
-    */
+    args::ValueFlag<uint64_t> p_sgd_plateau(pg_sgd_opts, "N",
+                                            "Once the stress of the layout, estimated on a fixed sample of path step pairs, hasn't improved in N iterations, skip ahead in the path guided 2D SGD to half the learning rate, and stop once it is down to 1 (default: 0, never).",
+                                            {"path-sgd-plateau"});
+    args::ValueFlag<double> p_sgd_plateau_tolerance(pg_sgd_opts, "N",
+                                                    "The relative decrease of the stress below which an iteration doesn't count as an improvement for --path-sgd-plateau (default: 0.001).",
+                                                    {"path-sgd-plateau-tolerance"});
+    args::ValueFlag<std::string> p_sgd_checkpoint(pg_sgd_opts, "FILE",
+                                                  "Write the layout and the state of its learning schedule to FILE every --path-sgd-checkpoint-interval iterations. If FILE exists, resume the layout from it, which with --path-sgd-deterministic gives the same layout as an uninterrupted run.",
+                                                  {"path-sgd-checkpoint"});
+    args::ValueFlag<uint64_t> p_sgd_checkpoint_interval(pg_sgd_opts, "N",
+                                                        "Write a checkpoint every N iterations (default: 1).",
+                                                        {"path-sgd-checkpoint-interval"});
     args::ValueFlag<std::string> p_sgd_snapshot(pg_sgd_opts, "STRING",
                                                 "Set the prefix to which each snapshot layout of a path guided 2D SGD iteration should be written to (default: NONE).",
                                                 {'u', "path-sgd-snapshot"});
@@ -169,12 +185,11 @@ int main_layout(int argc, char **argv) {
               return max_path_step_count;
           };
     // default parameters
-    /* We don't do this, yet.
     std::string path_sgd_seed;
     if (p_sgd_seed) {
-        if (num_threads > 1) {
+        if (!p_sgd_deterministic) {
             std::cerr
-                << "[odgi::layout] error: please only specify a seed for the path guided 2D linear SGD when using 1 thread."
+                << "[odgi::layout] error: please only specify a seed for the path guided 2D linear SGD when using --path-sgd-deterministic."
                 << std::endl;
             return 1;
         }
@@ -182,7 +197,6 @@ int main_layout(int argc, char **argv) {
     } else {
         path_sgd_seed = "pangenomic!";
     }
-    */
     if (p_sgd_min_term_updates_paths && p_sgd_min_term_updates_num_nodes) {
         std::cerr
             << "[odgi::layout] error: there can only be one argument provided for the minimum number of term updates in the path guided 1D SGD."
@@ -264,7 +278,8 @@ int main_layout(int argc, char **argv) {
     std::vector<std::atomic<double>> graph_Y(graph.get_node_count() * 2);  // Graph's Y coordinates for node+ and node-
 
     std::random_device dev;
-    std::mt19937 rng(dev());
+    // a deterministic layout also starts from the same noise
+    std::mt19937 rng(p_sgd_deterministic ? (std::mt19937::result_type)algorithms::sgd_seed(path_sgd_seed) : dev());
     std::uniform_real_distribution<double> uniform_noise(0, sqrt(graph.get_node_count() * 2));
     std::normal_distribution<double> gaussian_noise(0,  sqrt(graph.get_node_count() * 2));
     uint64_t total_length = 0;
@@ -324,6 +339,41 @@ int main_layout(int argc, char **argv) {
           //std::cerr << pos << ": " << graph_X[pos] << "," << graph_Y[pos] << " ------ " << graph_X[pos + 1] << "," << graph_Y[pos + 1] << std::endl;
       });
 
+    algorithms::path_sgd_convergence_t path_sgd_convergence;
+    path_sgd_convergence.plateau_iterations = p_sgd_plateau ? args::get(p_sgd_plateau) : 0;
+    if (p_sgd_plateau_tolerance) {
+        path_sgd_convergence.plateau_tolerance = args::get(p_sgd_plateau_tolerance);
+    }
+    if (p_sgd_checkpoint) {
+        path_sgd_convergence.checkpoint = args::get(p_sgd_checkpoint);
+        path_sgd_convergence.checkpoint_interval = p_sgd_checkpoint_interval ? std::max(args::get(p_sgd_checkpoint_interval), (uint64_t)1) : 1;
+        // a checkpoint of an earlier run replaces the initial layout
+        bool checkpoint_deterministic = false;
+        uint64_t checkpoint_seed = 0;
+        try {
+            path_sgd_convergence.resume = algorithms::path_sgd_read_checkpoint(path_sgd_convergence.checkpoint,
+                                                                              path_sgd_convergence.resume_state,
+                                                                              checkpoint_deterministic, checkpoint_seed,
+                                                                              graph_X, graph_Y);
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (path_sgd_convergence.resume) {
+            if (checkpoint_deterministic != args::get(p_sgd_deterministic)
+                || (checkpoint_deterministic && checkpoint_seed != algorithms::sgd_seed(path_sgd_seed))) {
+                std::cerr << "[odgi::layout] error: the checkpoint " << path_sgd_convergence.checkpoint
+                          << " was written by a run with a different --path-sgd-deterministic or -q, --path-sgd-seed." << std::endl;
+                return 1;
+            }
+            if (show_progress) {
+                std::cerr << "[odgi::layout] resuming from checkpoint " << path_sgd_convergence.checkpoint
+                          << " at iteration " << path_sgd_convergence.resume_state.iteration
+                          << " of " << path_sgd_convergence.resume_state.iter_max << std::endl;
+            }
+        }
+    }
+
     //double max_x = 0;
     algorithms::path_linear_sgd_layout(
         graph,
@@ -344,6 +394,10 @@ int main_layout(int argc, char **argv) {
         show_progress,
         snapshot,
         snapshot_prefix,
+        args::get(p_sgd_deterministic),
+        args::get(p_sgd_multilevel),
+        path_sgd_seed,
+        path_sgd_convergence,
         graph_X,
         graph_Y
         );
@@ -8,6 +8,7 @@
 #include "split.hpp"
 #include "subgraph/region.hpp"
 #include "IITree.h"
+#include "algorithms/path_membership.hpp"
 
 namespace odgi {
 
@@ -262,6 +263,27 @@ int main_pav(int argc, char **argv) {
     if (show_progress) {
         operation_progress->finish();
     }
+    // Which groups cross which nodes, instead of going through the steps of each node of each range
+    std::vector<uint64_t> path_group;
+    if (group_paths) {
+        graph.for_each_path_handle([&](const path_handle_t& path_handle) {
+            const uint64_t p = as_integer(path_handle);
+            if (p >= path_group.size()) {
+                path_group.resize(p + 1, algorithms::path_membership_t::no_group);
+            }
+            // Paths that do not belong to any group are left out
+            auto f = path_2_group.find(path_handle);
+            if (f != path_2_group.end()) {
+                path_group[p] = group_2_index[f->second];
+            }
+        });
+    } else {
+        path_group = algorithms::path_membership_t::one_group_per_path(graph);
+    }
+    const algorithms::path_membership_t membership(graph, path_group,
+                                                   group_paths ? group_2_index.size() : graph.get_path_count(),
+                                                   num_threads);
+
     const bool emit_matrix_else_table = args::get(_matrix_output);
 
     // Emit the PAV matrix
@@ -333,23 +355,12 @@ int main_pav(int argc, char **argv) {
             const auto& node_id = tree.data(node_id_info);
             const auto& handle = graph.get_handle(node_id);
 
-            // Get paths that cross the node
-            unordered_set<uint64_t> group_ranks_on_node_handle;
-            graph.for_each_step_on_handle(handle, [&](const step_handle_t &source_step) {
-                const auto& path_handle = graph.get_path_handle_of_step(source_step);
-                // Check if the paths are grouped and there are paths that do not belong to any group
-                if (!group_paths || path_2_group.find(path_handle) != path_2_group.end()) {
-                    const uint64_t group_rank = group_paths ?
-                            group_2_index[path_2_group[path_handle]] :
-                            as_integer(path_handle) - 1;
-                    group_ranks_on_node_handle.insert(group_rank);
-                }
-            });
-
-            const uint64_t len_handle = graph.get_length(handle);
-            for (const auto& group_rank: group_ranks_on_node_handle) {
+            // Get the groups of the paths that cross the node
+            const uint64_t row = algorithms::path_membership_t::rank_of(handle);
+            const uint64_t len_handle = membership.length(row);
+            membership.for_each_group(row, [&](const uint64_t& group_rank) {
                 len_unique_nodes_in_range_for_each_group[group_rank] += len_handle;
-            }
+            });
 
             len_unique_nodes_in_range += len_handle;
         }
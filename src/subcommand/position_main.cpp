@@ -6,6 +6,7 @@
 #include "subgraph/region.hpp"
 #include "algorithms/bfs.hpp"
 #include "algorithms/path_jaccard.hpp"
+#include <numeric>
 #include <omp.h>
 #include "utils.hpp"
 #include "picosha2.h"
@@ -463,76 +464,95 @@ int main_position(int argc, char** argv) {
         lift_path_set_target.insert(as_integer(path));
     }
 
-    auto get_graph_pos =
+    // the positions are looked up in blocks of this many, each one across all threads, and written in input order
+    const uint64_t query_block_size = 1 << 20;
+
+    // turn path positions into graph positions, along with their steps; sorting them by path and offset lets us walk
+    // each path once for all of its positions
+    auto get_graph_positions =
         [](const odgi::graph_t& graph,
-           const path_pos_t& pos,
-           step_handle_t& step) {
-            auto path_end = graph.path_end(pos.path);
-            uint64_t walked = 0;
-            for (step_handle_t s = graph.path_begin(pos.path);
-                 s != path_end; s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                uint64_t node_length = graph.get_length(h);
-                if (walked + node_length - 1 >= pos.offset) {
-                	step = s;
-                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
+           const std::vector<path_pos_t>& path_positions,
+           std::vector<pos_t>& positions,
+           std::vector<step_handle_t>& steps) {
+            positions.assign(path_positions.size(), make_pos_t(0, false, 0));
+            steps.resize(path_positions.size());
+            std::vector<uint64_t> order(path_positions.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](const uint64_t& a, const uint64_t& b) {
+                const uint64_t path_a = as_integer(path_positions[a].path);
+                const uint64_t path_b = as_integer(path_positions[b].path);
+                return path_a < path_b || (path_a == path_b && path_positions[a].offset < path_positions[b].offset);
+            });
+            std::vector<uint64_t> path_begin;
+            for (uint64_t i = 0; i < order.size(); ++i) {
+                if (i == 0 || as_integer(path_positions[order[i]].path) != as_integer(path_positions[order[i - 1]].path)) {
+                    path_begin.push_back(i);
                 }
-                walked += node_length;
             }
+            path_begin.push_back(order.size());
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t j = 0; j < path_begin.size() - 1; ++j) {
+                uint64_t i = path_begin[j];
+                const uint64_t end = path_begin[j + 1];
+                const path_handle_t path = path_positions[order[i]].path;
+                const auto path_end = graph.path_end(path);
+                uint64_t walked = 0;
+                for (step_handle_t s = graph.path_begin(path);
+                     s != path_end && i < end; s = graph.get_next_step(s)) {
+                    handle_t h = graph.get_handle_of_step(s);
+                    uint64_t node_length = graph.get_length(h);
+                    for (; i < end && walked + node_length - 1 >= path_positions[order[i]].offset; ++i) {
+                        positions[order[i]] = make_pos_t(graph.get_id(h), graph.get_is_reverse(h), path_positions[order[i]].offset - walked);
+                        steps[order[i]] = s;
+                    }
+                    walked += node_length;
+                }
+                for (; i < end; ++i) {
 #pragma omp critical (cout)
-            std::cerr << "[odgi::position] warning: position " << graph.get_path_name(pos.path) << ":" << pos.offset << " outside of path. Walked " << walked << std::endl;
-            return make_pos_t(0, false, 0);
+                    std::cerr << "[odgi::position] warning: position " << graph.get_path_name(path) << ":" << path_positions[order[i]].offset << " outside of path. Walked " << walked << std::endl;
+                }
+            }
         };
 
-	auto get_graph_node_ids_annotation =
-			[](const odgi::graph_t& graph,
-			   const path_range_t& path_range) {
-				auto path_end = graph.path_end(path_range.begin.path);
-				std::unordered_map<uint64_t , std::set<std::string>> node_annotation_map;
-				uint64_t walked = 0;
-				uint64_t path_pos_start = path_range.begin.offset;
-				uint64_t path_pos_end = path_range.end.offset;
-				for (step_handle_t s = graph.path_begin(path_range.begin.path);
-					 s != path_end; s = graph.get_next_step(s)) {
-					handle_t h = graph.get_handle_of_step(s);
-					uint64_t nid = graph.get_id(h);
-					uint64_t node_length = graph.get_length(h);
-					uint64_t local_min_pos = walked;
-					uint64_t local_max_pos = local_min_pos + node_length - 1;
-					if ((path_pos_start >= local_min_pos && path_pos_start <= local_max_pos)
-						|| (path_pos_end <= local_max_pos && path_pos_end >= local_min_pos)
-						|| (path_pos_start <= local_min_pos && path_pos_end >= local_max_pos)) {
-						// TODO add to our hashmap of node_id -> hash_set of annotation
-						if (node_annotation_map.count(nid) == 0) {
-							std::set<std::string> anno_set;
-							anno_set.insert(path_range.data);
-							node_annotation_map[nid] = anno_set;
-							// we just blindly at the value again
-						} else {
-							std::set<std::string> anno_set = node_annotation_map[nid];
-							anno_set.insert(path_range.data);
-						}
-					} else if (local_min_pos > path_pos_end) {
-						// we can return here, nothing more to do
-						return node_annotation_map;
-					}
-					walked += node_length;
-				}
-				return node_annotation_map;
-			};
-
-    auto get_offset_in_path =
+    // get the offsets of the given steps in their paths, walking each path once, up to the last of its steps
+    auto get_offsets_in_paths =
         [](const odgi::graph_t& graph,
-           const path_handle_t& path, const step_handle_t& target) {
-            auto path_end = graph.path_end(path);
-            uint64_t walked = 0;
-            step_handle_t s = graph.path_begin(path);
-            for ( ;  s != target; s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                walked += graph.get_length(h);
-            }
-            assert(s != path_end);
-            return walked;
+           const std::vector<step_handle_t>& steps,
+           std::vector<uint64_t>& offsets) {
+            offsets.assign(steps.size(), 0);
+            // (path, step, index in steps), sorted
+            std::vector<std::tuple<uint64_t, int64_t, int64_t, uint64_t>> keys(steps.size());
+            for (uint64_t i = 0; i < steps.size(); ++i) {
+                keys[i] = std::make_tuple(as_integer(graph.get_path_handle_of_step(steps[i])),
+                                          as_integers(steps[i])[0], as_integers(steps[i])[1], i);
+            }
+            std::sort(keys.begin(), keys.end());
+            std::vector<uint64_t> path_begin;
+            for (uint64_t i = 0; i < keys.size(); ++i) {
+                if (i == 0 || std::get<0>(keys[i]) != std::get<0>(keys[i - 1])) {
+                    path_begin.push_back(i);
+                }
+            }
+            path_begin.push_back(keys.size());
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t j = 0; j < path_begin.size() - 1; ++j) {
+                const auto begin = keys.begin() + path_begin[j];
+                const auto end = keys.begin() + path_begin[j + 1];
+                const path_handle_t path = graph.get_path_handle_of_step(steps[std::get<3>(*begin)]);
+                const auto path_end = graph.path_end(path);
+                uint64_t left = end - begin;
+                uint64_t walked = 0;
+                for (step_handle_t s = graph.path_begin(path);
+                     s != path_end && left > 0; s = graph.get_next_step(s)) {
+                    auto key = std::make_tuple(std::get<0>(*begin), as_integers(s)[0], as_integers(s)[1], (uint64_t)0);
+                    for (auto it = std::lower_bound(begin, end, key);
+                         it != end && std::get<1>(*it) == std::get<1>(key) && std::get<2>(*it) == std::get<2>(key); ++it) {
+                        offsets[std::get<3>(*it)] = walked;
+                        --left;
+                    }
+                    walked += graph.get_length(graph.get_handle_of_step(s));
+                }
+            }
         };
 
 	auto set_adj_last_node =
@@ -572,69 +592,36 @@ int main_position(int argc, char** argv) {
     // TODO should we always look "backwards" when seeking the ref pos?
 
     struct lift_result_t {
-        int64_t path_offset = 0;
+        int64_t path_offset = -1;
         step_handle_t ref_hit;
         uint64_t walked_to_hit_ref = 0;
         bool is_rev_vs_ref = false;
         bool used_bidirectional = false;
     };
 
-    // get the reference path positions right where we are
-    auto get_immediate =
-        [&search_radius,&get_offset_in_path](const odgi::graph_t& graph,
-                                             const hash_set<uint64_t>& path_set,
-                                             const pos_t& pos, std::vector<lift_result_t>& lifts) {
-            // unpacking our args
-            handle_t h = graph.get_handle(id(pos), is_rev(pos));
-            graph.for_each_step_on_handle(
-                h, [&](const step_handle_t& s) {
-                       auto p = graph.get_path_handle_of_step(s);
-                       if (path_set.count(as_integer(p))) {
-                           // are we reverse against the reference
-                           bool rev_vs_ref = graph.get_is_reverse(graph.get_handle_of_step(s)) != graph.get_is_reverse(h);
-                           int adj_node = 0;
-                           if (rev_vs_ref) {
-                               // and if the path orientation is the same as our traversal orientation
-                               // then we need to add the remaining distance from our original offset to the end of node
-                               // to the final path position offset
-                               adj_node = graph.get_length(h) - offset(pos);
-                           } else {
-                               // otherwise if the original path is in the same orientation
-                               // then we add the original forward offset to the ref path offset
-                               adj_node = offset(pos);
-                           }
-                           lifts.emplace_back();
-                           auto& lift = lifts.back();
-                           lift.ref_hit = s;
-                           lift.path_offset = get_offset_in_path(graph, p, lift.ref_hit) + adj_node;
-                           lift.walked_to_hit_ref = 0;
-                           lift.is_rev_vs_ref = rev_vs_ref;
-                       }
-                   });
-            return lifts.size() > 0;
-        };
+    // where the search from a handle hits the paths; it doesn't depend on the offset in the node, so all positions on
+    // the same handle share it
+    struct bfs_hit_t {
+        bool found = false;
+        step_handle_t ref_hit;
+        uint64_t walked_to_hit_ref = 0;
+        uint64_t d_bfs = 0;
+        handle_t h_bfs;
+        bool used_bidirectional = false;
+        /// how many steps of the path of ref_hit are on h_bfs
+        uint64_t candidates = 0;
+    };
 
-    auto get_position =
-        [&search_radius,&get_offset_in_path,&walking_dist,&set_adj_last_node](const odgi::graph_t& graph,
-                                             const hash_set<uint64_t>& path_set,
-                                             const pos_t& pos, lift_result_t& lift,
-                                             const step_handle_t target_step_handle,
-                                             const bool path_jaccard) {
-            // unpacking our args
-            int64_t& path_offset = lift.path_offset;
-            step_handle_t& ref_hit = lift.ref_hit;
-            uint64_t& walked_to_hit_ref = lift.walked_to_hit_ref;
-            bool& rev_vs_ref = lift.is_rev_vs_ref;
-            bool& used_bidirectional = lift.used_bidirectional;
-            handle_t start_handle = graph.get_handle(id(pos), is_rev(pos));
+    auto find_hit =
+        [&search_radius](const odgi::graph_t& graph,
+                         const hash_set<uint64_t>& path_set,
+                         const handle_t& start_handle) {
+            bfs_hit_t result;
             bool found_hit = false;
-            uint64_t adj_last_node = 0;
             hash_set<uint64_t> seen;
-            uint64_t d_bfs;
-            handle_t h_bfs;
             for (auto try_bidirectional : { false, true }) {
                 if (try_bidirectional) {
-					used_bidirectional = true;
+					result.used_bidirectional = true;
 					seen.erase(as_integer(graph.flip(start_handle)));
                 }
                 odgi::algorithms::bfs(
@@ -647,17 +634,15 @@ int main_position(int argc, char** argv) {
                             h, [&](const step_handle_t& s) {
                                    auto p = graph.get_path_handle_of_step(s);
                                    if (!got_hit && path_set.count(as_integer(p))) {
-                                       //std::cerr << "thought I got a hit" << std::endl;
                                        got_hit = true;
                                        hit = s;
-                                       walked_to_hit_ref += l; // how far we came to get to this node
-									   d_bfs = d; // we need this for the path jaccard calculations
-									   h_bfs = h;
-									   set_adj_last_node(graph, s, h, used_bidirectional, d, pos, rev_vs_ref, adj_last_node);
+                                       result.walked_to_hit_ref += l; // how far we came to get to this node
+                                       result.d_bfs = d; // we need this for the path jaccard calculations
+                                       result.h_bfs = h;
                                    }
                                });
                         if (got_hit) {
-                            ref_hit = hit;
+                            result.ref_hit = hit;
                             found_hit = true;
                         }
                     },
@@ -666,43 +651,226 @@ int main_position(int argc, char** argv) {
                     [&found_hit](void) { return found_hit; },
                     { graph.flip(start_handle) },
                     { },
-                    used_bidirectional,
+                    result.used_bidirectional,
                     0,
                     search_radius);
                 if (found_hit) break; // if we got a hit, don't go bidirectional
             }
+            result.found = found_hit;
             if (found_hit) {
-            	if (path_jaccard) {
-					std::vector<step_handle_t> query_step_handles;
-					path_handle_t ref_hit_path = graph.get_path_handle_of_step(ref_hit);
-					graph.for_each_step_on_handle(
-							h_bfs,
-							[&](const step_handle_t& s) {
-								/// we can do these expensive iterations here, because we only have to do it once for each walk
-								if (graph.get_path_handle_of_step(s) == ref_hit_path) {
-									// collect only the steps for the given target
-									query_step_handles.push_back(s);
-								}
-							});
-					// iterate over the node to get the list of canditate query step handles
-					std::vector<algorithms::step_jaccard_t> target_jaccard_indices = algorithms::jaccard_indices_from_step_handles(graph,
-																																   walking_dist,
-																																   target_step_handle,
-																																   query_step_handles);
-					ref_hit = target_jaccard_indices[0].step;
-					set_adj_last_node(graph, ref_hit, h_bfs, used_bidirectional, d_bfs, pos, rev_vs_ref, adj_last_node);
-				}
+                const path_handle_t ref_hit_path = graph.get_path_handle_of_step(result.ref_hit);
+                graph.for_each_step_on_handle(
+                        result.h_bfs,
+                        [&](const step_handle_t& s) {
+                            result.candidates += graph.get_path_handle_of_step(s) == ref_hit_path;
+                        });
+            }
+            return result;
+        };
 
-				path_handle_t p = graph.get_path_handle_of_step(ref_hit);
-				// TODO ORIENTATION
-				path_offset = get_offset_in_path(graph, p, ref_hit) + adj_last_node;
-                return true;
-            } else {
-                path_offset = -1;
-                return false;
+    // find the nearest positions in the paths of path_set for a batch of graph positions; a path_offset of -1 means
+    // that there is none within the search radius
+    auto get_positions =
+        [&find_hit,&get_offsets_in_paths,&walking_dist,&set_adj_last_node](const odgi::graph_t& graph,
+                                                                           const hash_set<uint64_t>& path_set,
+                                                                           const std::vector<pos_t>& positions,
+                                                                           const std::vector<step_handle_t>& target_step_handles,
+                                                                           const bool path_jaccard,
+                                                                           std::vector<lift_result_t>& lifts) {
+            // search once from each handle we start from
+            std::vector<uint64_t> handles;
+            for (auto& pos : positions) {
+                if (id(pos)) {
+                    handles.push_back(as_integer(graph.get_handle(id(pos), is_rev(pos))));
+                }
+            }
+            std::sort(handles.begin(), handles.end());
+            handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+            std::vector<bfs_hit_t> hits(handles.size());
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t k = 0; k < handles.size(); ++k) {
+                hits[k] = find_hit(graph, path_set, as_handle(handles[k]));
+            }
+            lifts.assign(positions.size(), lift_result_t());
+            std::vector<uint64_t> hit_of(positions.size(), 0);
+            // the path jaccard only depends on the step we come from and where the search ended, so we compute it
+            // once for each (step, handle, path) of the hits that have more than one step of their path to choose from
+            typedef std::tuple<int64_t, int64_t, uint64_t, uint64_t> jaccard_key_t;
+            std::vector<jaccard_key_t> jaccard_keys;
+            for (uint64_t i = 0; i < positions.size(); ++i) {
+                const pos_t& pos = positions[i];
+                if (!id(pos)) {
+                    continue;
+                }
+                const uint64_t h = as_integer(graph.get_handle(id(pos), is_rev(pos)));
+                hit_of[i] = std::lower_bound(handles.begin(), handles.end(), h) - handles.begin();
+                const bfs_hit_t& hit = hits[hit_of[i]];
+                if (!hit.found) {
+                    continue;
+                }
+                lift_result_t& lift = lifts[i];
+                lift.ref_hit = hit.ref_hit;
+                lift.walked_to_hit_ref = hit.walked_to_hit_ref;
+                lift.used_bidirectional = hit.used_bidirectional;
+                lift.path_offset = 0;
+                if (path_jaccard && hit.candidates > 1) {
+                    jaccard_keys.emplace_back(as_integers(target_step_handles[i])[0], as_integers(target_step_handles[i])[1],
+                                              as_integer(hit.h_bfs), as_integer(graph.get_path_handle_of_step(hit.ref_hit)));
+                }
+            }
+            std::sort(jaccard_keys.begin(), jaccard_keys.end());
+            jaccard_keys.erase(std::unique(jaccard_keys.begin(), jaccard_keys.end()), jaccard_keys.end());
+            std::vector<step_handle_t> jaccard_steps(jaccard_keys.size());
+#pragma omp parallel for schedule(dynamic,1)
+            for (uint64_t k = 0; k < jaccard_keys.size(); ++k) {
+                const jaccard_key_t& key = jaccard_keys[k];
+                step_handle_t cur_step;
+                as_integers(cur_step)[0] = std::get<0>(key);
+                as_integers(cur_step)[1] = std::get<1>(key);
+                const path_handle_t ref_hit_path = as_path_handle(std::get<3>(key));
+                std::vector<step_handle_t> query_step_handles;
+                graph.for_each_step_on_handle(
+                        as_handle(std::get<2>(key)),
+                        [&](const step_handle_t& s) {
+                            if (graph.get_path_handle_of_step(s) == ref_hit_path) {
+                                // collect only the steps for the given target
+                                query_step_handles.push_back(s);
+                            }
+                        });
+                std::vector<algorithms::step_jaccard_t> target_jaccard_indices = algorithms::jaccard_indices_from_step_handles(graph,
+                                                                                                                           walking_dist,
+                                                                                                                           cur_step,
+                                                                                                                           query_step_handles);
+                jaccard_steps[k] = target_jaccard_indices[0].step;
+            }
+            std::vector<uint64_t> adj_last_nodes(positions.size(), 0);
+#pragma omp parallel for schedule(dynamic,64)
+            for (uint64_t i = 0; i < positions.size(); ++i) {
+                lift_result_t& lift = lifts[i];
+                if (lift.path_offset < 0) {
+                    continue;
+                }
+                const bfs_hit_t& hit = hits[hit_of[i]];
+                // with a single candidate step, it is the one the jaccard indices would pick
+                if (path_jaccard && hit.candidates > 1) {
+                    const jaccard_key_t key(as_integers(target_step_handles[i])[0], as_integers(target_step_handles[i])[1],
+                                            as_integer(hit.h_bfs), as_integer(graph.get_path_handle_of_step(hit.ref_hit)));
+                    lift.ref_hit = jaccard_steps[std::lower_bound(jaccard_keys.begin(), jaccard_keys.end(), key) - jaccard_keys.begin()];
+                }
+                set_adj_last_node(graph, lift.ref_hit, hit.h_bfs, hit.used_bidirectional, hit.d_bfs, positions[i], lift.is_rev_vs_ref, adj_last_nodes[i]);
+            }
+            // TODO ORIENTATION
+            std::vector<step_handle_t> hit_steps;
+            std::vector<uint64_t> hit_positions;
+            for (uint64_t i = 0; i < lifts.size(); ++i) {
+                if (lifts[i].path_offset >= 0) {
+                    hit_steps.push_back(lifts[i].ref_hit);
+                    hit_positions.push_back(i);
+                }
+            }
+            std::vector<uint64_t> offsets;
+            get_offsets_in_paths(graph, hit_steps, offsets);
+            for (uint64_t k = 0; k < hit_positions.size(); ++k) {
+                lifts[hit_positions[k]].path_offset = offsets[k] + adj_last_nodes[hit_positions[k]];
+            }
+        };
+
+    // get the reference path positions right where we are, for a batch of graph positions
+    auto get_immediates =
+        [&get_offsets_in_paths](const odgi::graph_t& graph,
+                                const hash_set<uint64_t>& path_set,
+                                const std::vector<pos_t>& positions,
+                                std::vector<std::vector<lift_result_t>>& lifts) {
+            lifts.assign(positions.size(), {});
+#pragma omp parallel for schedule(dynamic,64)
+            for (uint64_t i = 0; i < positions.size(); ++i) {
+                const pos_t& pos = positions[i];
+                if (!id(pos)) {
+                    continue;
+                }
+                // unpacking our args
+                handle_t h = graph.get_handle(id(pos), is_rev(pos));
+                graph.for_each_step_on_handle(
+                    h, [&](const step_handle_t& s) {
+                           auto p = graph.get_path_handle_of_step(s);
+                           if (path_set.count(as_integer(p))) {
+                               // are we reverse against the reference
+                               bool rev_vs_ref = graph.get_is_reverse(graph.get_handle_of_step(s)) != graph.get_is_reverse(h);
+                               int adj_node = 0;
+                               if (rev_vs_ref) {
+                                   // and if the path orientation is the same as our traversal orientation
+                                   // then we need to add the remaining distance from our original offset to the end of node
+                                   // to the final path position offset
+                                   adj_node = graph.get_length(h) - offset(pos);
+                               } else {
+                                   // otherwise if the original path is in the same orientation
+                                   // then we add the original forward offset to the ref path offset
+                                   adj_node = offset(pos);
+                               }
+                               lifts[i].emplace_back();
+                               auto& lift = lifts[i].back();
+                               lift.ref_hit = s;
+                               lift.path_offset = adj_node;
+                               lift.walked_to_hit_ref = 0;
+                               lift.is_rev_vs_ref = rev_vs_ref;
+                           }
+                       });
+            }
+            std::vector<step_handle_t> hit_steps;
+            for (auto& position_lifts : lifts) {
+                for (auto& lift : position_lifts) {
+                    hit_steps.push_back(lift.ref_hit);
+                }
+            }
+            std::vector<uint64_t> offsets;
+            get_offsets_in_paths(graph, hit_steps, offsets);
+            uint64_t k = 0;
+            for (auto& position_lifts : lifts) {
+                for (auto& lift : position_lifts) {
+                    lift.path_offset += offsets[k++];
+                }
+            }
+        };
+
+    // the lift paths of the source graph in the target graph
+    hash_map<uint64_t, path_handle_t> lift_path_in_target;
+    for (uint64_t i = 0; i < lift_paths_source.size(); ++i) {
+        lift_path_in_target[as_integer(lift_paths_source[i])] = lift_paths_target[i];
+    }
+
+    // translate graph positions in the source graph into the target graph, via their nearest positions in the lift
+    // paths; the ones that can't be lifted become empty
+    auto lift_into_target =
+        [&](std::vector<pos_t>& positions,
+            std::vector<step_handle_t>& steps,
+            const bool path_jaccard) {
+            std::vector<lift_result_t> source_results;
+            get_positions(source_graph, lift_path_set_source, positions, steps, path_jaccard, source_results);
+            std::vector<path_pos_t> target_path_positions;
+            std::vector<uint64_t> lifted;
+            for (uint64_t i = 0; i < positions.size(); ++i) {
+                if (source_results[i].path_offset >= 0) {
+                    target_path_positions.push_back(
+                            { lift_path_in_target[as_integer(source_graph.get_path_handle_of_step(source_results[i].ref_hit))],
+                              (uint64_t)source_results[i].path_offset,
+                              source_results[i].is_rev_vs_ref });
+                    lifted.push_back(i);
+                }
+            }
+            std::vector<pos_t> target_positions;
+            std::vector<step_handle_t> target_steps;
+            get_graph_positions(target_graph, target_path_positions, target_positions, target_steps);
+            positions.assign(positions.size(), make_pos_t(0, false, 0)); // couldn't lift
+            for (uint64_t k = 0; k < lifted.size(); ++k) {
+                positions[lifted[k]] = target_positions[k];
+                steps[lifted[k]] = target_steps[k];
             }
         };
 
+    auto graph_pos_str = [](const pos_t& pos) {
+        return std::to_string(id(pos)) + "," + std::to_string(offset(pos)) + "," + (is_rev(pos) ? "-" : "+");
+    };
+
     if (graph_positions.size()) {
         if (lifting) {
             std::cout << "#source.graph.pos\ttarget.graph.pos\t";
@@ -721,213 +889,213 @@ int main_position(int argc, char** argv) {
         	}
         }
     }
-    // for each position that we want to look up
-#pragma omp parallel for schedule(dynamic,1)
-    for (auto& _pos : graph_positions) {
+    // for each block of positions that we want to look up
+    for (uint64_t block_begin = 0; block_begin < graph_positions.size(); block_begin += query_block_size) {
+        const uint64_t block_end = std::min((uint64_t)graph_positions.size(), block_begin + query_block_size);
         // go to the graph
         // do a little BFS, bounded by our limit
         // now, if we found our hit, print
         // optionally, we will translate from a source graph into a target graph
-        lift_result_t source_result;
-        //bool ok = false;
-        pos_t pos;
-        // empty step handle
-		step_handle_t step_handle_graph_pos;
+        std::vector<pos_t> positions(graph_positions.begin() + block_begin, graph_positions.begin() + block_end);
+        std::vector<step_handle_t> steps(positions.size());
         if (lifting) {
-            if (get_position(source_graph, lift_path_set_source, _pos, source_result, step_handle_graph_pos, false)) {
-                pos = get_graph_pos(target_graph,
-                                    { target_graph.get_path_handle(
-                                            source_graph.get_path_name(
-                                                source_graph.get_path_handle_of_step(
-                                                    source_result.ref_hit))),
-                                      (uint64_t)source_result.path_offset,
-                                      source_result.is_rev_vs_ref },
-                                      step_handle_graph_pos);
-            } else {
-                pos = make_pos_t(0,false,0); // couldn't lift
-            }
-        } else {
-            pos = _pos;
+            lift_into_target(positions, steps, false);
         }
-        //= (lifting ? ok = get_position(source_graph, lay_path_set
-        lift_result_t result;
-        std::vector<lift_result_t> result_v;
-        if (id(pos) && give_graph_pos) {
-            // force graph position in target
-#pragma omp critical (cout)
-            {
-                if (lifting) {
-                    std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
-                }
-                std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
-                          << "\t" << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << std::endl;
+        std::vector<std::vector<lift_result_t>> immediates;
+        std::vector<lift_result_t> results;
+        if (!give_graph_pos) {
+            if (args::get(all_immediate)) {
+                get_immediates(target_graph, ref_path_set, positions, immediates);
             }
-        } else if (args::get(all_immediate) && get_immediate(target_graph, ref_path_set, pos, result_v)) {
-            bool ref_is_rev = false;
-            for (auto& result : result_v) {
-                path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
-                {
-                    if (lifting) {
-                        std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
-                    }
-                    std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
-                              << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
-                              << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
+            // the positions without immediate hits fall back to the search
+            std::vector<pos_t> searched = positions;
+            for (uint64_t i = 0; i < immediates.size(); ++i) {
+                if (!immediates[i].empty()) {
+                    searched[i] = make_pos_t(0, false, 0);
                 }
             }
-        } else if (get_position(target_graph, ref_path_set, pos, result, step_handle_graph_pos, false)) {
-            bool ref_is_rev = false;
-            path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
-            {
-                if (lifting) {
-                    std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
+            get_positions(target_graph, ref_path_set, searched, steps, false, results);
+        }
+        std::vector<std::string> lines(positions.size());
+#pragma omp parallel for schedule(dynamic,64)
+        for (uint64_t i = 0; i < positions.size(); ++i) {
+            const pos_t& _pos = graph_positions[block_begin + i];
+            const pos_t& pos = positions[i];
+            if (!id(pos)) {
+                continue;
+            }
+            const std::string source_pos = lifting ? graph_pos_str(_pos) + "\t" : "";
+            std::string& line = lines[i];
+            if (give_graph_pos) {
+                // force graph position in target
+                line = source_pos + graph_pos_str(pos) + "\t" + "\t" + graph_pos_str(pos) + "\n";
+            } else {
+                bool ref_is_rev = false;
+                for (auto& result : (immediates.empty() || immediates[i].empty() ? std::vector<lift_result_t>(results[i].path_offset >= 0, results[i]) : immediates[i])) {
+                    path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
+                    line += source_pos + graph_pos_str(pos) + "\t"
+                            + target_graph.get_path_name(p) + "," + std::to_string(result.path_offset) + "," + (ref_is_rev ? "-" : "+") + "\t"
+                            + std::to_string(result.walked_to_hit_ref) + "\t" + (result.is_rev_vs_ref ? "-" : "+") + "\n";
                 }
-                std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
-                          << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
-                          << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
             }
         }
+        for (auto& line : lines) {
+            std::cout << line;
+        }
     }
 
-#pragma omp parallel for schedule(dynamic,1)
-    for (auto& path_pos : path_positions) {
+    // the header comes with the first record, so that nothing is printed if none of the positions can be found
+    bool path_header_written = false;
+    for (uint64_t block_begin = 0; block_begin < path_positions.size(); block_begin += query_block_size) {
+        const uint64_t block_end = std::min((uint64_t)path_positions.size(), block_begin + query_block_size);
         // TODO we need a better input format
-        pos_t pos;
-		step_handle_t step_handle_graph_pos;
+        const std::vector<path_pos_t> block(path_positions.begin() + block_begin, path_positions.begin() + block_end);
+        std::vector<pos_t> positions;
+        std::vector<step_handle_t> steps;
         // handle the lift into the target graph
         if (lifting) {
-            lift_result_t source_result;
-            pos_t _pos = get_graph_pos(source_graph, path_pos, step_handle_graph_pos);
-            if (id(_pos) && get_position(source_graph, lift_path_set_source, _pos, source_result, step_handle_graph_pos, true)) {
-                pos = get_graph_pos(target_graph,
-                                    { target_graph.get_path_handle(
-                                            source_graph.get_path_name(
-                                                source_graph.get_path_handle_of_step(
-                                                    source_result.ref_hit))),
-                                      (uint64_t)source_result.path_offset,
-                                      source_result.is_rev_vs_ref },
-                                      step_handle_graph_pos);
-            } else {
-                pos = make_pos_t(0,false,0); // couldn't lift
-            }
-
+            get_graph_positions(source_graph, block, positions, steps);
+            lift_into_target(positions, steps, true);
         } else {
-            //path_pos = _path_pos;
-            pos = get_graph_pos(target_graph, path_pos, step_handle_graph_pos);
+            get_graph_positions(target_graph, block, positions, steps);
+        }
+        std::vector<lift_result_t> results;
+        if (!give_graph_pos) {
+            get_positions(target_graph, ref_path_set, positions, steps, true, results);
         }
-        lift_result_t result;
-        //std::cerr << "Got graph pos " << id(pos) << std::endl;
-        if (id(pos)) {
+        std::vector<std::string> lines(positions.size());
+#pragma omp parallel for schedule(dynamic,64)
+        for (uint64_t i = 0; i < positions.size(); ++i) {
+            const path_pos_t& path_pos = block[i];
+            const pos_t& pos = positions[i];
+            if (!id(pos) || (!give_graph_pos && results[i].path_offset < 0)) {
+                continue;
+            }
+            const std::string source_pos = (lifting ? source_graph.get_path_name(path_pos.path) : target_graph.get_path_name(path_pos.path))
+                    + "," + std::to_string(path_pos.offset) + "," + (path_pos.is_rev ? "-" : "+");
             if (give_graph_pos) {
-#pragma omp critical (cout)
-                std::cout << "#source.path.pos\ttarget.graph.pos" << std::endl
-                          << (lifting ? source_graph.get_path_name(path_pos.path) : target_graph.get_path_name(path_pos.path))
-                          << "," << path_pos.offset << "," << (path_pos.is_rev ? "-" : "+")
-                          << "\t" << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << std::endl;
-            } else if (get_position(target_graph, ref_path_set, pos, result, step_handle_graph_pos, true)) {
+                lines[i] = source_pos + "\t" + graph_pos_str(pos) + "\n";
+            } else {
                 bool ref_is_rev = false;
+                const lift_result_t& result = results[i];
                 path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
-                std::cout << "#source.path.pos\ttarget.path.pos\tdist.to.ref\tstrand.vs.ref" << std::endl
-                          << (lifting ? source_graph.get_path_name(path_pos.path) : target_graph.get_path_name(path_pos.path)) << ","
-                          << path_pos.offset << "," << (path_pos.is_rev ? "-" : "+") << "\t"
-                          << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
-                          << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
+                lines[i] = source_pos + "\t"
+                        + target_graph.get_path_name(p) + "," + std::to_string(result.path_offset) + "," + (ref_is_rev ? "-" : "+") + "\t"
+                        + std::to_string(result.walked_to_hit_ref) + "\t" + (result.is_rev_vs_ref ? "-" : "+") + "\n";
+            }
+        }
+        for (auto& line : lines) {
+            if (!path_header_written && !line.empty()) {
+                if (give_graph_pos) {
+                    std::cout << "#source.path.pos\ttarget.graph.pos" << std::endl;
+                } else {
+                    std::cout << "#source.path.pos\ttarget.path.pos\tdist.to.ref\tstrand.vs.ref" << std::endl;
+                }
+                path_header_written = true;
             }
+            std::cout << line;
         }
     }
 
-	std::vector<std::unordered_map<uint64_t , std::set<std::string>>> node_annotation_maps;
-
+	std::map<uint64_t , std::set<std::string>> final_node_annotation_map;
+	if (gff_input) {
+		// the ranges are in the paths of the target graph, so there is nothing to lift
+		// the nodes that each range overlaps, found by a binary search in the offsets of the steps of its path
+		std::vector<uint64_t> range_paths;
+		for (auto& path_range : path_ranges) {
+			range_paths.push_back(as_integer(path_range.begin.path));
+		}
+		std::sort(range_paths.begin(), range_paths.end());
+		range_paths.erase(std::unique(range_paths.begin(), range_paths.end()), range_paths.end());
+		// the offset and node of each step in the paths
+		std::vector<std::vector<std::pair<uint64_t, uint64_t>>> path_steps(range_paths.size());
 #pragma omp parallel for schedule(dynamic,1)
-    for (auto& path_range : path_ranges) {
-		pos_t pos_begin, pos_end;
+		for (uint64_t j = 0; j < range_paths.size(); ++j) {
+			uint64_t walked = 0;
+			target_graph.for_each_step_in_path(as_path_handle(range_paths[j]), [&](const step_handle_t& s) {
+				handle_t h = target_graph.get_handle_of_step(s);
+				path_steps[j].emplace_back(walked, target_graph.get_id(h));
+				walked += target_graph.get_length(h);
+			});
+		}
+		std::vector<std::vector<uint64_t>> range_nodes(path_ranges.size());
+#pragma omp parallel for schedule(dynamic,64)
+		for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+			const path_range_t& path_range = path_ranges[i];
+			const auto& steps = path_steps[std::lower_bound(range_paths.begin(), range_paths.end(), as_integer(path_range.begin.path)) - range_paths.begin()];
+			// the step holding the start of the range
+			auto it = std::upper_bound(steps.begin(), steps.end(), std::make_pair(path_range.begin.offset, std::numeric_limits<uint64_t>::max()));
+			if (it != steps.begin()) {
+				--it;
+			}
+			for (; it != steps.end() && it->first <= path_range.end.offset; ++it) {
+				range_nodes[i].push_back(it->second);
+			}
+		}
+		for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+			for (auto& nid : range_nodes[i]) {
+				final_node_annotation_map[nid].insert(path_ranges[i].data);
+			}
+		}
+	}
+
+    for (uint64_t block_begin = 0; block_begin < path_ranges.size() && !gff_input; block_begin += query_block_size) {
+        const uint64_t block_end = std::min((uint64_t)path_ranges.size(), block_begin + query_block_size);
+        const uint64_t n = block_end - block_begin;
+        // the begins of the ranges, followed by their ends
+        std::vector<path_pos_t> block(2 * n);
+        for (uint64_t i = 0; i < n; ++i) {
+            block[i] = path_ranges[block_begin + i].begin;
+            block[n + i] = path_ranges[block_begin + i].end;
+        }
+        std::vector<pos_t> positions;
+        std::vector<step_handle_t> steps;
         // handle the lift into the target graph
-		step_handle_t step_handle_graph_pos_begin;
-		step_handle_t step_handle_graph_pos_end;
         if (lifting) {
-            lift_result_t source_begin_result, source_end_result;
-            pos_t _pos_begin = get_graph_pos(source_graph, path_range.begin, step_handle_graph_pos_begin);
-            pos_t _pos_end = get_graph_pos(source_graph, path_range.end, step_handle_graph_pos_end);
-            if (id(_pos_begin) && get_position(source_graph, lift_path_set_source, _pos_begin, source_begin_result, step_handle_graph_pos_begin, true)
-                && id(_pos_end) && get_position(source_graph, lift_path_set_source, _pos_end, source_end_result, step_handle_graph_pos_end, true)) {
-                pos_begin = get_graph_pos(target_graph,
-                                          { target_graph.get_path_handle(
-                                                  source_graph.get_path_name(
-                                                      source_graph.get_path_handle_of_step(
-                                                          source_begin_result.ref_hit))),
-                                            (uint64_t)source_begin_result.path_offset,
-                                            source_begin_result.is_rev_vs_ref },
-										  step_handle_graph_pos_begin);
-                pos_end = get_graph_pos(target_graph,
-                                        { target_graph.get_path_handle(
-                                                source_graph.get_path_name(
-                                                    source_graph.get_path_handle_of_step(
-                                                        source_end_result.ref_hit))),
-                                          (uint64_t)source_end_result.path_offset,
-                                          source_end_result.is_rev_vs_ref },
-										step_handle_graph_pos_end);
-            } else {
-                pos_begin = make_pos_t(0,false,0); // couldn't lift
-                pos_end = make_pos_t(0,false,0); // couldn't lift
-            }
+            get_graph_positions(source_graph, block, positions, steps);
+            lift_into_target(positions, steps, true);
         } else {
-            //path_pos = _path_pos;
-			if (gff_input) {
-				std::unordered_map<uint64_t , std::set<std::string>> node_annotation_map = get_graph_node_ids_annotation(target_graph, path_range);
-#pragma omp critical (node_annotation_maps)
-				node_annotation_maps.push_back(node_annotation_map);
-			} else {
-				pos_begin = get_graph_pos(target_graph, path_range.begin, step_handle_graph_pos_begin);
-				pos_end = get_graph_pos(target_graph, path_range.end, step_handle_graph_pos_end);
-			}
+            get_graph_positions(target_graph, block, positions, steps);
         }
-        if (id(pos_begin) && id(pos_end) && !gff_input) {
-            lift_result_t lift_begin;
-            lift_result_t lift_end;
+        std::vector<lift_result_t> results;
+        if (!give_graph_pos) {
+            get_positions(target_graph, ref_path_set, positions, steps, true, results);
+        }
+        std::vector<std::string> lines(n);
+#pragma omp parallel for schedule(dynamic,64)
+        for (uint64_t i = 0; i < n; ++i) {
+            const path_range_t& path_range = path_ranges[block_begin + i];
+            const pos_t& pos_begin = positions[i];
+            const pos_t& pos_end = positions[n + i];
+            if (!id(pos_begin) || !id(pos_end)) {
+                continue;
+            }
             // TODO add a GAF-style path to the record to say where the BED range walks in the graph
             // TODO optionally list out the nodes in this particular range (e.g. those within it in our sort order)
             if (give_graph_pos) {
-#pragma omp critical (cout)
-                std::cout << path_range.data << "\t"
-                          << id(pos_begin) << "," << offset(pos_begin) << "," << (is_rev(pos_begin)?"-":"+") << "\t"
-                          << id(pos_end) << "," << offset(pos_end) << "," << (is_rev(pos_end)?"-":"+") << std::endl;
-            } else if (get_position(target_graph, ref_path_set, pos_begin, lift_begin, step_handle_graph_pos_begin, true)
-                       && get_position(target_graph, ref_path_set, pos_end, lift_end, step_handle_graph_pos_end, true)) {
-                bool ref_is_rev = false;
+                lines[i] = path_range.data + "\t" + graph_pos_str(pos_begin) + "\t" + graph_pos_str(pos_end) + "\n";
+            } else if (results[i].path_offset >= 0 && results[n + i].path_offset >= 0) {
+                const lift_result_t& lift_begin = results[i];
+                const lift_result_t& lift_end = results[n + i];
                 path_handle_t p_begin = target_graph.get_path_handle_of_step(lift_begin.ref_hit);
                 path_handle_t p_end = target_graph.get_path_handle_of_step(lift_end.ref_hit);
                 // XXX TODO assert these to be equal......
-#pragma omp critical (cout)
-                std::cout << path_range.data << "\t"
-                          << target_graph.get_path_name(p_begin) << ","
-                          << lift_begin.path_offset << ","
-                          << (lift_begin.is_rev_vs_ref ? "-" : "+") << "\t"
-                          << target_graph.get_path_name(p_end) << ","
-                          << lift_end.path_offset << ","
-                          << (lift_end.is_rev_vs_ref ? "-" : "+") << "\t"
-                          << (lift_begin.is_rev_vs_ref ^ path_range.is_rev ? "-" : "+") << std::endl;
-                    //<< walked_to_hit_ref << "\t" << (is_rev_vs_ref ? "-" : "+") << std::endl;
+                lines[i] = path_range.data + "\t"
+                        + target_graph.get_path_name(p_begin) + ","
+                        + std::to_string(lift_begin.path_offset) + ","
+                        + (lift_begin.is_rev_vs_ref ? "-" : "+") + "\t"
+                        + target_graph.get_path_name(p_end) + ","
+                        + std::to_string(lift_end.path_offset) + ","
+                        + (lift_end.is_rev_vs_ref ? "-" : "+") + "\t"
+                        + (lift_begin.is_rev_vs_ref ^ path_range.is_rev ? "-" : "+") + "\n";
             }
         }
+        for (auto& line : lines) {
+            std::cout << line;
+        }
     }
 	if (gff_input) {
-		//  clean up duplicates
-		std::map<uint64_t , std::set<std::string>> final_node_annotation_map;
 		std::cout << "NODE_ID,ANNOTATION,COLOR" << std::endl;
-		for (auto& node_annotation_map : node_annotation_maps) {
-			for (auto& elem : node_annotation_map) {
-				if (final_node_annotation_map.count(elem.first) == 0) {
-					final_node_annotation_map[elem.first] = elem.second;
-				} else {
-					for (auto& anno : elem.second) {
-						final_node_annotation_map[elem.first].insert(anno);
-					}
-				}
-			}
-		}
 		std::string prev_anno = "";
 		std::set<std::string> prev_set;
 		uint64_t prev_node_id = -1;
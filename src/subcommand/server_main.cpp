@@ -1,8 +1,14 @@
 #include "subcommand.hpp"
 #include "args.hxx"
+#include "odgi.hpp"
+#include "utils.hpp"
 #include "algorithms/xp.hpp"
+#include "algorithms/stepindex.hpp"
+#include "algorithms/server_queries.hpp"
 #include <httplib.h>
 #include <filesystem>
+#include <mutex>
+#include <omp.h>
 
 namespace odgi {
 
@@ -19,12 +25,20 @@ namespace odgi {
         argv[0] = (char*)prog_name.c_str();
         --argc;
 
-        args::ArgumentParser parser("Start a basic HTTP server with a given path index file to go from *path:position* to *pangenome:position* very efficiently.");
+        args::ArgumentParser parser("Start an HTTP server answering read-only queries on a graph: batches of *path:position* to *pangenome:position* or graph positions, nodes, paths, depth and subgraphs of path ranges.");
         args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
-        args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*.", {'i', "idx"});
+        args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*. It answers the *pangenome:position* queries. At least one of -i, --idx or -g, --graph is required.", {'i', "idx"});
         args::ValueFlag<std::string> port(mandatory_opts, "N", "Run the server under this port.", {'p', "port"});
+        args::Group graph_opts(parser, "[ Graph Query Options ]");
+        args::ValueFlag<std::string> og_in_file(graph_opts, "FILE", "Load the succinct variation graph in ODGI (*.og*) or GFAv1 (*.gfa*) format from this *FILE*. It answers the graph position, node, path, depth and subgraph queries.", {'g', "graph"});
+        args::ValueFlag<std::string> _step_index(graph_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: use *GRAPH.stpidx* if it was built by odgi stepindex from this graph, otherwise build the step index from scratch with a sampling rate of 8).", {"step-index"});
         args::Group http_opts(parser, "[ HTTP Options ]");
         args::ValueFlag<std::string> ip_address(http_opts, "IP", "Run the server under this IP address. If not specified, *IP* will be *localhost*.", {'a', "ip"});
+        args::Flag log_requests(http_opts, "log", "Write a line for each request to stderr. Off by default, as writing it takes longer than answering most queries.", {'l', "log"});
+        args::Group threading_opts(parser, "[ Threading ]");
+        args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads answering requests, also used to load the graph and its indexes (default: the thread pool size of the HTTP library, CPPHTTPLIB_THREAD_POOL_COUNT).", {'t', "threads"});
+        args::Group processing_info_opts(parser, "[ Processing Information ]");
+        args::Flag progress(processing_info_opts, "progress", "Write the current progress of loading the graph to stderr.", {'P', "progress"});
         args::Group program_information(parser, "[ Program Information ]");
         args::HelpFlag help(program_information, "help", "Print a help message for odgi server.", {'h', "help"});
 
@@ -43,8 +57,8 @@ namespace odgi {
             return 1;
         }
 
-        if (!dg_in_file) {
-            std::cerr << "[odgi::server]: please enter a file to read the index from via -i=[FILE], --idx=[FILE]." << std::endl;
+        if (!dg_in_file && !og_in_file) {
+            std::cerr << "[odgi::server]: please enter a file to read the index from via -i=[FILE], --idx=[FILE], or a file to read the graph from via -g=[FILE], --graph=[FILE]." << std::endl;
             exit(1);
         }
 
@@ -53,76 +67,118 @@ namespace odgi {
             exit(1);
         }
 
-        XP path_index;
-		if (!std::filesystem::exists(args::get(dg_in_file))) {
-			std::cerr << "[odgi::" << "panpos" << "] error: the given file \"" << args::get(dg_in_file) << "\" does not exist. Please specify an existing input file in xp format via -i=[FILE], --idx=[FILE]." << std::endl;
-			return 1;
-		}
-        std::ifstream in;
-        in.open(args::get(dg_in_file));
-        path_index.load(in);
-        in.close();
+        // by default, as many threads as the HTTP library would answer requests with
+        const uint64_t num_threads = nthreads ? std::max(args::get(nthreads), (uint64_t)1) : (uint64_t)CPPHTTPLIB_THREAD_POOL_COUNT;
 
-        /*
-        const char* pattern = R"(/(\d+)/(\w+))";
-        std::regex regexi = std::regex(pattern);
-        std::cmatch cm;    // same as std::match_results<const char*> cm;
-        std::regex_match ("/3/test",cm,regexi);
-        std::cout << "the matches were: " << std::endl;
-        for (unsigned i=0; i<cm.size(); ++i) {
-            std::cout << "[" << cm[i] << "] " << std::endl;
+        XP path_index;
+        if (dg_in_file) {
+            if (!std::filesystem::exists(args::get(dg_in_file))) {
+                std::cerr << "[odgi::server] error: the given file \"" << args::get(dg_in_file) << "\" does not exist. Please specify an existing input file in xp format via -i=[FILE], --idx=[FILE]." << std::endl;
+                return 1;
+            }
+            std::ifstream in;
+            in.open(args::get(dg_in_file));
+            path_index.load(in);
+            in.close();
         }
-        std::cout << std::endl;
-
-        // const char* pattern1 = R"(/(\w+)/(\d+))";
-        // const char* pattern1 = R"(/([a-zA-Z]*[0-9]*)/(\d+))";
-        const char* pattern1 = R"(/(\w*.*)/(\d+))";
-        std::regex regexi1 = std::regex(pattern1);
-        std::cmatch cm1;    // same as std::match_results<const char*> cm;
-        std::regex_match ("/5-/3",cm1,regexi1); // /1741.hr2/3
-        std::cout << "the matches were: " << std::endl;
-        for (unsigned i=0; i<cm1.size(); ++i) {
-            std::cout << "[" << cm1[i] << "] " << std::endl;
+
+        graph_t graph;
+        std::unique_ptr<algorithms::step_index_t> step_index;
+        if (og_in_file) {
+            const std::string infile = args::get(og_in_file);
+            utils::handle_gfa_odgi_input(infile, "server", args::get(progress), num_threads, graph);
+            std::vector<path_handle_t> paths;
+            paths.reserve(graph.get_path_count());
+            graph.for_each_path_handle([&](const path_handle_t& path) { paths.push_back(path); });
+            step_index = std::make_unique<algorithms::step_index_t>();
+            if (_step_index) {
+                step_index->load(args::get(_step_index));
+            } else if (!algorithms::load_step_index_sidecar(*step_index, infile, args::get(progress))) {
+                step_index = std::make_unique<algorithms::step_index_t>(graph, paths, num_threads, args::get(progress), 8);
+            }
+            // build the step arrays of all paths up front, so that no query waits for one
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                graph.get_path_step_array(paths[i]);
+            }
         }
-        */
+        const bool has_graph = (bool)og_in_file;
+        const bool has_index = (bool)dg_in_file;
 
         Server svr;
+        svr.new_task_queue = [num_threads] { return new ThreadPool(num_threads); };
+        std::mutex log_mutex;
+        if (args::get(log_requests)) {
+            svr.set_logger([&](const Request& req, const Response& res) {
+                std::lock_guard<std::mutex> guard(log_mutex);
+                std::cerr << "[odgi::server] " << req.method << " " << req.path << " " << res.status
+                          << " " << res.body.size() << std::endl;
+            });
+        }
 
-        svr.Get("/hi", [](const Request& req, Response& res) {
+        auto set_headers = [](Response& res) {
             res.set_header("Access-Control-Allow-Origin", "*");
             res.set_header("Access-Control-Expose-Headers", "text/plain");
             res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
-            res.set_content("Hello World!", "text/plain");
-            std::cout << "GOT REQUEST : HELLO WORLD!" << std::endl;
-        });
+        };
 
-        svr.Get(R"(/(\w*.*)/(\d+))", [&](const Request& req, Response& res) {
-            /*
-            for (size_t i = 0; i < req.matches.size(); i++) {
-                std::cout << req.matches[i] << std::endl;
-            }
-             */
-            auto path_name = req.matches[1];
-            auto nuc_pos_1 = req.matches[2];
-            std::cout << "GOT REQUEST : path name: " << path_name << "; 1-based nucleotide position: " << nuc_pos_1 << std::endl;
-            size_t nuc_pos_0 = std::stoi(nuc_pos_1) - 1;
-            size_t pan_pos = 0;
-            if (path_index.has_path(path_name)) {
-                if (path_index.has_position(path_name, nuc_pos_0)) {
-                    pan_pos = path_index.get_pangenome_pos(path_name, nuc_pos_0) + 1;
-                }
-            }
-            std::cout << "SEND RESPONSE: pangenome position: " << pan_pos << std::endl;
-            res.set_header("Access-Control-Allow-Origin", "*");
-            res.set_header("Access-Control-Expose-Headers", "text/plain");
-            res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
-            res.set_content(std::to_string(pan_pos), "text/plain");
+        const algorithms::server_queries_t queries(has_graph ? &graph : nullptr, step_index.get(),
+                                                   has_index ? &path_index : nullptr);
+
+        auto reply = [&](Response& res, const algorithms::query_response_t& answer) {
+            res.status = answer.status;
+            set_headers(res);
+            res.set_content(answer.body, answer.content_type);
+        };
+
+        svr.Get("/hi", [&](const Request& req, Response& res) {
+            set_headers(res);
+            res.set_content("Hello World!", "text/plain");
         });
 
         svr.Get("/stop", [&](const Request& req, Response& res) {
             svr.stop();
         });
 
+        // batch translation of 1-based path positions, one per line, into 1-based pangenome positions (?to=pangenome,
+        // the default, needs -i) or graph positions (?to=graph, needs -g), returned as a JSON array in the order of
+        // the queries, or as little-endian 64-bit integers with ?format=bin; unknown positions give 0
+        svr.Post("/pos", [&](const Request& req, Response& res) {
+            reply(res, queries.positions(req.body, req.get_param_value("to") == "graph",
+                                         req.get_param_value("format") == "bin"));
+        });
+
+        // a node, its neighbours, and the paths that step on it, with the positions of their steps with ?steps=1
+        svr.Get(R"(/node/(\d+))", [&](const Request& req, Response& res) {
+            reply(res, queries.node(req.matches[1], req.get_param_value("steps") == "1"));
+        });
+
+        // a path, its length in bp and steps, and with ?start=&end= the nodes it walks through in that 0-based range
+        svr.Get("/path", [&](const Request& req, Response& res) {
+            reply(res, queries.path(req.get_param_value("path"), req.has_param("start") || req.has_param("end"),
+                                    req.get_param_value("start"), req.get_param_value("end")));
+        });
+
+        // the mean depth over a 0-based, half-open range of a path, as odgi depth -r computes it,
+        // and with ?nodes=1 the depth of each node in the range
+        svr.Get("/depth", [&](const Request& req, Response& res) {
+            reply(res, queries.depth(req.get_param_value("path"), req.get_param_value("start"),
+                                     req.get_param_value("end"), req.get_param_value("nodes") == "1"));
+        });
+
+        // the subgraph of a 0-based, half-open range of a path, as odgi extract -r builds it, with all the paths
+        // through it as subpaths, expanded by ?context= steps, as GFA or with ?format=og in ODGI format
+        svr.Get("/subgraph", [&](const Request& req, Response& res) {
+            reply(res, queries.subgraph(req.get_param_value("path"), req.get_param_value("start"),
+                                        req.get_param_value("end"), req.get_param_value("context"),
+                                        req.get_param_value("format") == "og"));
+        });
+
+        // registered last, as its pattern matches the paths of the other queries too
+        svr.Get(R"(/(\w*.*)/(\d+))", [&](const Request& req, Response& res) {
+            reply(res, queries.pangenome_position(req.matches[1], req.matches[2]));
+        });
+
         const int p = std::stoi(args::get(port));
         std::string ip;
         if (!ip_address) {
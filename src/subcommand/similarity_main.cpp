@@ -4,6 +4,8 @@
 #include "split.hpp"
 #include <omp.h>
 #include "utils.hpp"
+#include "ips4o.hpp"
+#include "algorithms/path_membership.hpp"
 
 namespace odgi {
 
@@ -158,27 +160,25 @@ args::Group threading_opts(parser, "[ Threading ]");
                 return (uint32_t)as_integer(p);
             });
 
-    std::vector<uint64_t> bp_count;
-    if (using_delim) {
-        bp_count.resize(path_groups.size());
-    } else {
-        bp_count.resize(graph.get_path_count() + 1);
-    }
-
     uint32_t path_max = 0;
     graph.for_each_path_handle(
         [&](const path_handle_t& p) {
             path_max = std::max(path_max, (uint32_t)as_integer(p));
         });
 
-    // Initialize first to avoid possible bugs later
-    for (uint32_t i = 0; i < path_max; ++i) {
-        path_handle_t p = as_path_handle(i + 1);
-        bp_count[get_path_id(p)] = 0;
-    }
+    // the group of each path, looked up without touching the hash map in the parallel loops
+    const uint32_t group_count = using_delim ? path_groups.size() : path_max + 1;
+    std::vector<uint64_t> path_group(path_max + 1, algorithms::path_membership_t::no_group);
+    graph.for_each_path_handle(
+        [&](const path_handle_t& p) {
+            path_group[as_integer(p)] = get_path_id(p);
+        });
+
+    std::vector<uint64_t> bp_count(group_count, 0);
 
 #pragma omp parallel for
     for (uint32_t i = 0; i < path_max; ++i) {
+        if (path_group[i + 1] == algorithms::path_membership_t::no_group) continue;
         path_handle_t p = as_path_handle(i + 1);
         uint64_t path_length = 0;
         graph.for_each_step_in_path(
@@ -187,44 +187,149 @@ args::Group threading_opts(parser, "[ Threading ]");
                 path_length += graph.get_length(graph.get_handle_of_step(s));
             });
 #pragma omp critical (bp_count)
-        bp_count[get_path_id(p)] += path_length;
+        bp_count[path_group[i + 1]] += path_length;
     }
 
+    // which groups step on which nodes, and how often if more than once
+    const algorithms::path_membership_t membership(graph, path_group, group_count, num_threads);
+
     const bool show_progress = args::get(progress);
     std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
     if (show_progress) {
         progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                graph.get_node_count(), "[odgi::similarity] collecting path intersection lengths");
+                membership.row_count(), "[odgi::similarity] collecting path intersection lengths");
     }
 
+    // Each thread sums the intersections of the pairs (a, b) with a <= b into its own accumulator, and the accumulators
+    // are added up at the end. If the upper triangle of the group x group matrix fits into memory once per thread,
+    // the accumulators are dense, otherwise they are hash maps.
     // ska::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t> leads to huge memory usage with deep graphs
-    ska::flat_hash_map<uint64_t, uint64_t> path_intersection_length;
-    graph.for_each_handle(
-        [&](const handle_t& h) {
-            ska::flat_hash_map<uint32_t, uint64_t> local_path_lengths;
-            size_t l = graph.get_length(h);
-            graph.for_each_step_on_handle(
-                h,
-                [&](const step_handle_t& s) {
-                    local_path_lengths[get_path_id(graph.get_path_handle_of_step(s))] += l;
-                });
-
-#pragma omp critical (path_intersection_length)
-            for (auto& p : local_path_lengths) {
-                for (auto& q : local_path_lengths) {
-                    path_intersection_length[encode_pair(p.first, q.first)] += std::min(p.second, q.second);
+    const uint64_t triangle_size = (uint64_t)group_count * (group_count + 1) / 2;
+    const uint64_t max_dense_bytes = (uint64_t)1 << 31;
+    const bool dense = triangle_size * sizeof(uint64_t) * num_threads <= max_dense_bytes;
+    // index of (a, b) in the upper triangle, rows before a hold group_count, group_count - 1, ... pairs
+    auto triangle_index = [&group_count](const uint64_t& a, const uint64_t& b) {
+        return a * group_count - a * (a - 1) / 2 + (b - a);
+    };
+    std::vector<std::vector<uint64_t>> dense_intersections(dense ? num_threads : 0);
+    std::vector<ska::flat_hash_map<uint64_t, uint64_t>> sparse_intersections(dense ? 0 : num_threads);
+    // the node length at each group on the current node, and 0 elsewhere, for the deep nodes
+    std::vector<std::vector<uint64_t>> group_lengths(dense ? num_threads : 0);
+    std::vector<std::vector<uint64_t>> local_groups(num_threads);
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> local_repeats(num_threads);
+#pragma omp parallel for schedule(static, 1)
+    for (uint64_t t = 0; t < num_threads; ++t) {
+        if (dense) {
+            dense_intersections[t].resize(triangle_size, 0);
+            group_lengths[t].resize(group_count, 0);
+        }
+    }
+
+    // A group stepping c times on a node of length l shares min(c, d) * l with a group stepping d times on it, which is
+    // l for being on the node together, and l * min(c - 1, d - 1) for the extra steps that only the repeats have.
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (uint64_t r = 0; r < membership.row_count(); ++r) {
+        const int tid = omp_get_thread_num();
+        const uint64_t l = membership.length(r);
+        auto& groups = local_groups[tid];
+        groups.clear();
+        membership.for_each_group(r, [&](const uint64_t& g) { groups.push_back(g); });
+        auto& repeats = local_repeats[tid];
+        repeats.clear();
+        membership.for_each_repeat(r, [&](const uint64_t& g, const uint64_t& extra) {
+            repeats.push_back(std::make_pair(g, extra));
+        });
+        const uint64_t n = groups.size();
+
+        if (n == 0) {
+            // nothing to add
+        } else if (!dense) {
+            auto& intersections = sparse_intersections[tid];
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint64_t j = i; j < n; ++j) {
+                    intersections[encode_pair(groups[i], groups[j])] += l;
                 }
             }
-
-            if (show_progress) {
-                progress_meter->increment(1);
+            for (uint64_t i = 0; i < repeats.size(); ++i) {
+                for (uint64_t j = i; j < repeats.size(); ++j) {
+                    intersections[encode_pair(repeats[i].first, repeats[j].first)]
+                        += l * std::min(repeats[i].second, repeats[j].second);
+                }
+            }
+        } else {
+            auto& intersections = dense_intersections[tid];
+            const uint64_t first_group = groups.front();
+            const uint64_t last_group = groups.back();
+            if (n >= 64 && 4 * n >= last_group - first_group + 1) {
+                // A deep node covering most groups in its range: spread the bits of its row over a dense vector and
+                // add each group's row in one branch-free loop the compiler can vectorize.
+                auto& lengths = group_lengths[tid];
+                for (auto& g : groups) {
+                    lengths[g] = l;
+                }
+                for (auto& g : groups) {
+                    uint64_t* row = intersections.data() + triangle_index(g, g);
+                    const uint64_t* other = lengths.data() + g;
+                    const uint64_t row_size = last_group - g + 1;
+                    for (uint64_t k = 0; k < row_size; ++k) {
+                        row[k] += other[k];
+                    }
+                }
+                for (auto& g : groups) {
+                    lengths[g] = 0;
+                }
+            } else {
+                for (uint64_t i = 0; i < n; ++i) {
+                    uint64_t* row = intersections.data() + triangle_index(groups[i], groups[i]);
+                    for (uint64_t j = i; j < n; ++j) {
+                        row[groups[j] - groups[i]] += l;
+                    }
+                }
             }
-        }, true);
+            for (uint64_t i = 0; i < repeats.size(); ++i) {
+                for (uint64_t j = i; j < repeats.size(); ++j) {
+                    intersections[triangle_index(repeats[i].first, repeats[j].first)]
+                        += l * std::min(repeats[i].second, repeats[j].second);
+                }
+            }
+        }
+
+        if (show_progress) {
+            progress_meter->increment(1);
+        }
+    }
 
     if (show_progress) {
         progress_meter->finish();
     }
 
+    // reduce the accumulators of all threads into the first one
+    if (dense) {
+        auto& intersections = dense_intersections[0];
+        const uint64_t block_size = 1 << 16;
+#pragma omp parallel for schedule(dynamic, 1)
+        for (uint64_t block = 0; block < triangle_size; block += block_size) {
+            const uint64_t block_end = std::min(block + block_size, triangle_size);
+            for (uint64_t t = 1; t < num_threads; ++t) {
+                const auto& other = dense_intersections[t];
+                for (uint64_t k = block; k < block_end; ++k) {
+                    intersections[k] += other[k];
+                }
+            }
+        }
+        for (uint64_t t = 1; t < num_threads; ++t) {
+            std::vector<uint64_t>().swap(dense_intersections[t]);
+        }
+    } else {
+        auto& intersections = sparse_intersections[0];
+        for (uint64_t t = 1; t < num_threads; ++t) {
+            for (auto& p : sparse_intersections[t]) {
+                intersections[p.first] += p.second;
+            }
+            ska::flat_hash_map<uint64_t, uint64_t>().swap(sparse_intersections[t]);
+        }
+    }
+
     /*if (using_delim) {
         std::cout << "group.a" << "\t"
                     << "group.b" << "\t"
@@ -258,12 +363,8 @@ args::Group threading_opts(parser, "[ Threading ]");
     }
 
     std::cout << std::endl;
-    for (auto& p : path_intersection_length) {
-        uint32_t id_a, id_b;
-        decode_pair(p.first, &id_a, &id_b);
-
-        auto& intersection = p.second;
 
+    auto write_pair = [&](const uint32_t& id_a, const uint32_t& id_b, const uint64_t& intersection) {
         // From https://stats.stackexchange.com/questions/58706/distance-metrics-for-binary-vectors
         const double jaccard = (double)intersection / (double)(bp_count[id_a] + bp_count[id_b] - intersection);
         const double cosine = (double)intersection / std::sqrt((double)(bp_count[id_a] * bp_count[id_b]));
@@ -284,14 +385,47 @@ args::Group threading_opts(parser, "[ Threading ]");
                       << (1.0 - dice) << "\t"
                       << (1.0 - estimated_identity) << "\t"
                       << euclidian_distance << "\t"
-                      << manhattan_distance << std::endl;
+                      << manhattan_distance << "\n";
         } else {
             std::cout << jaccard << "\t"
                       << cosine << "\t"
                       << dice << "\t"
-                      << estimated_identity << std::endl;
+                      << estimated_identity << "\n";
+        }
+    };
+
+    // write both (a, b) and (b, a) of each pair that shares sequence, ordered by a and then b
+    if (dense) {
+        const auto& intersections = dense_intersections[0];
+        for (uint32_t id_a = 0; id_a < group_count; ++id_a) {
+            for (uint32_t id_b = 0; id_b < group_count; ++id_b) {
+                const uint64_t intersection = id_a <= id_b ? intersections[triangle_index(id_a, id_b)]
+                                                           : intersections[triangle_index(id_b, id_a)];
+                if (intersection) {
+                    write_pair(id_a, id_b, intersection);
+                }
+            }
+        }
+    } else {
+        std::vector<std::pair<uint64_t, uint64_t>> pairs;
+        pairs.reserve(sparse_intersections[0].size() * 2);
+        for (auto& p : sparse_intersections[0]) {
+            uint32_t id_a, id_b;
+            decode_pair(p.first, &id_a, &id_b);
+            pairs.push_back(p);
+            if (id_a != id_b) {
+                pairs.push_back(std::make_pair(encode_pair(id_b, id_a), p.second));
+            }
+        }
+        ska::flat_hash_map<uint64_t, uint64_t>().swap(sparse_intersections[0]);
+        ips4o::parallel::sort(pairs.begin(), pairs.end(), std::less<>(), num_threads);
+        for (auto& p : pairs) {
+            uint32_t id_a, id_b;
+            decode_pair(p.first, &id_a, &id_b);
+            write_pair(id_a, id_b, p.second);
         }
     }
+    std::cout.flush();
 
     return 0;
 }
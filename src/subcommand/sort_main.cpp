@@ -86,13 +86,18 @@ int main_sort(int argc, char** argv) {
     args::ValueFlag<uint64_t> p_sgd_zipf_space_quantization_step(pg_sgd_opts, "N", "Quantization step size when the maximum space size of the Zipfian"
                                                                                    " distribution is exceeded (default: *100*).", {'l', "path-sgd-zipf-space-quantization-step"});
     args::ValueFlag<uint64_t> p_sgd_zipf_max_number_of_distributions(pg_sgd_opts, "N", "Approximate maximum number of Zipfian distributions to calculate (default: *100*).", {'y', "path-sgd-zipf-max-num-distributions"});
-    args::ValueFlag<std::string> p_sgd_seed(pg_sgd_opts, "STRING", "| Set the seed for the deterministic 1-threaded path guided linear 1D SGD model (default: *pangenomic!*).", {'q', "path-sgd-seed"});
+    args::ValueFlag<std::string> p_sgd_seed(pg_sgd_opts, "STRING", "| Set the seed for the deterministic path guided linear 1D SGD model, which is either 1-threaded or run with --path-sgd-deterministic (default: *pangenomic!*).", {'q', "path-sgd-seed"});
     args::ValueFlag<std::string> p_sgd_snapshot(pg_sgd_opts, "STRING", "Set the prefix to which each snapshot graph of a path guided 1D SGD"
                                                                        " iteration should be written to. This is turned off per default. This"
                                                                        " argument only works when *-Y, –path-sgd* was specified. Not applicable"
                                                                        " in a pipeline of sorts.", {'u', "path-sgd-snapshot"});
 	args::ValueFlag<std::string> _p_sgd_target_paths(pg_sgd_opts, "FILE", "Read the paths that should be considered as target paths (references) from this *FILE*. PG-SGD will keep the nodes of the given paths fixed. A path's rank determines it's weight for decision making and is given by its position in the given *FILE*.", {'H', "target-paths"});
 	args::ValueFlag<std::string> p_sgd_layout(pg_sgd_opts, "STRING", "write the layout of a sorted, path guided 1D SGD graph to this file, no default", {'e', "path-sgd-layout"});
+	args::Flag p_sgd_single_precision(pg_sgd_opts, "path-sgd-single-precision", "Keep the node positions of the path guided 1D SGD in single precision. This halves the memory traffic of the updates, but positions are only exact up to 16 Mbp, so it is meant for graphs whose ordering needn't be resolved to the base pair.", {"path-sgd-single-precision"});
+	args::Flag p_sgd_deterministic(pg_sgd_opts, "path-sgd-deterministic", "Run the path guided 1D SGD deterministically with any number of threads. Each iteration draws its terms from random streams of the seed and applies them in blocks of nodes that no two threads update at the same time, so the order only depends on the seed.", {"path-sgd-deterministic"});
+	args::Flag p_sgd_multilevel(pg_sgd_opts, "path-sgd-multilevel", "Run the path guided 1D SGD on a hierarchy of coarser graphs first, whose nodes merge pairs of nodes that follow each other in the paths. The coarsest level gets the full learning schedule and each finer level only refines the layout of the level above it, which gets large graphs into shape in fewer term updates. Can't be combined with -H, --target-paths.", {"path-sgd-multilevel"});
+	args::ValueFlag<uint64_t> p_sgd_plateau(pg_sgd_opts, "N", "Once the stress of the layout, estimated on a fixed sample of path step pairs, hasn't improved in *N* iterations, skip ahead in the path guided 1D SGD to half the learning rate, and stop once it is down to 1 (default: 0, never).", {"path-sgd-plateau"});
+	args::ValueFlag<double> p_sgd_plateau_tolerance(pg_sgd_opts, "N", "The relative decrease of the stress below which an iteration doesn't count as an improvement for --path-sgd-plateau (default: 0.001).", {"path-sgd-plateau-tolerance"});
 
 	/// pipeline
     args::Group pipeline_sort_opts(parser, "[ Pipeline Sorting Options ]");
@@ -200,14 +205,18 @@ int main_sort(int argc, char** argv) {
     // default parameters
     std::string path_sgd_seed;
     if (p_sgd_seed) {
-        if (num_threads > 1) {
-            std::cerr << "[odgi::sort] error: please only specify a seed for the path guided 1D linear SGD when using 1 thread." << std::endl;
+        if (num_threads > 1 && !p_sgd_deterministic) {
+            std::cerr << "[odgi::sort] error: please only specify a seed for the path guided 1D linear SGD when using 1 thread or --path-sgd-deterministic." << std::endl;
             return 1;
         }
         path_sgd_seed = args::get(p_sgd_seed);
     } else {
         path_sgd_seed = "pangenomic!";
     }
+    if (p_sgd_multilevel && _p_sgd_target_paths) {
+        std::cerr << "[odgi::sort] error: the multilevel path guided 1D SGD can't keep the nodes of target paths fixed. Please specify either --path-sgd-multilevel or -H, --target-paths." << std::endl;
+        return 1;
+    }
     if (p_sgd_min_term_updates_paths && p_sgd_min_term_updates_num_nodes) {
         std::cerr << "[odgi::sort] error: there can only be one argument provided for the minimum number of term updates in the path guided 1D SGD."
                      "Please either use -G=[N], path-sgd-min-term-updates-paths=[N] or -U=[N], path-sgd-min-term-updates-nodes=[N]." << std::endl;
@@ -312,6 +321,11 @@ int main_sort(int argc, char** argv) {
     double path_sgd_max_eta = 0; // update below
     //double path_sgd_cooling_start = 2.0; // disabled
     double path_sgd_cooling = p_sgd_cooling ? args::get(p_sgd_cooling) : 0.5;
+    algorithms::path_sgd_convergence_t path_sgd_convergence;
+    path_sgd_convergence.plateau_iterations = p_sgd_plateau ? args::get(p_sgd_plateau) : 0;
+    if (p_sgd_plateau_tolerance) {
+        path_sgd_convergence.plateau_tolerance = args::get(p_sgd_plateau_tolerance);
+    }
     // will be filled, if the user decides to write a snapshot of the graph after each sorting iteration
     std::vector<std::string> snapshots;
     const bool snapshot = p_sgd_snapshot;
@@ -471,7 +485,11 @@ int main_sort(int argc, char** argv) {
 															  p_sgd_layout,
 															  layout_out,
 															  _p_sgd_target_paths,
-															  is_ref);
+															  is_ref,
+															  args::get(p_sgd_single_precision),
+															  args::get(p_sgd_deterministic),
+															  args::get(p_sgd_multilevel),
+															  path_sgd_convergence);
 					// reset is_ref or we will break when we apply it again
                     break;
                 }
@@ -539,7 +557,11 @@ int main_sort(int argc, char** argv) {
 												  p_sgd_layout,
 												  layout_out,
 												  _p_sgd_target_paths,
-												  is_ref);
+												  is_ref,
+												  args::get(p_sgd_single_precision),
+												  args::get(p_sgd_deterministic),
+												  args::get(p_sgd_multilevel),
+												  path_sgd_convergence);
         graph.apply_ordering(order, true);
     } else if (args::get(breadth_first)) {
         graph.apply_ordering(algorithms::breadth_first_topological_order(graph, bf_chunk_size), true);
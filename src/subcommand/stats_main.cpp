@@ -277,10 +277,7 @@ int main_stats(int argc, char** argv) {
     if (args::get(base_content) || _multiqc) {
         std::vector<uint64_t> chars(256);
         graph.for_each_handle([&](const handle_t& h) {
-                std::string seq = graph.get_sequence(h);
-                for (auto c : seq) {
-                    ++chars[c];
-                }
+                graph.count_bases(h, chars.data());
             });
         for (uint64_t i = 0; i < 256; ++i) {
             if (chars[i]) {
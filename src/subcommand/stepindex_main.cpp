@@ -87,6 +87,10 @@ namespace odgi {
 		});
 
 		algorithms::step_index_t step_index(graph, paths, num_threads, progress, step_index_sample_rate);
+		if (infile != "-" && !(infile.size() >= 3 && infile.substr(infile.size() - 3) == "gfa")) {
+			// lets untangle and tips pick up the index without being told about it, as long as the graph is unchanged
+			step_index.graph_hash = algorithms::graph_file_hash(infile);
+		}
 		step_index.save(step_index_out_file);
 
 		return 0;
@@ -42,8 +42,10 @@ namespace odgi {
 		args::ValueFlag<uint64_t> _walking_dist(tips_opts, "N", "Maximum walking distance in nucleotides for one orientation when finding the best target (reference) range for each query path (default: 10000). Note: If we walked 9999 base pairs and **w, --jaccard-context** is **10000**, we will also include the next node, even if we overflow the actual limit.",
 												   {'w', "jaccard-context"});
 		args::Flag _report_additional_jaccards(tips_opts, "report_additional_jaccards", "If for a target (reference) path several matches are possible, also report the additional jaccard indices (default: false). In the resulting BED, an '.' is added, if set to 'false'.", {'j', "jaccards"});
+		args::ValueFlag<uint64_t> _sketch_size(tips_opts, "N", "Estimate the jaccard indices by comparing bottom-N sketches of the windows around the steps, which are computed once for each target (reference) step that is hit. The best estimates, and all estimates that could tie them, are computed exactly, so the reported mappings only differ from the exact ones when an estimate is far off. The additional jaccards of -j stay estimates. Try 128 on graphs with many steps per node (default: 0, compute all jaccard indices exactly).",
+												   {'k', "sketch-size"});
 		args::Group step_index_opts(parser, "[ Step Index Options ]");
-		args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: build the step index from scratch with a sampling rate of 8).",
+		args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: use *INPUT_GRAPH.stpidx* if it was built by odgi stepindex from this graph, otherwise build the step index from scratch with a sampling rate of 8).",
 												{'a', "step-index"});
 		args::Group threading(parser, "[ Threading ]");
 		args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
@@ -195,98 +197,60 @@ namespace odgi {
 			return graph.has_previous_step(step);
 		};
 
-		if (!_step_index) {
+		std::unique_ptr<algorithms::step_index_t> step_index = std::make_unique<algorithms::step_index_t>();
+		if (_step_index) {
+			step_index->load(args::get(_step_index));
+		} else if (!algorithms::load_step_index_sidecar(*step_index, infile, progress)) {
 			if (progress) {
 				std::cerr << "[odgi::tips] warning: no step index specified. Building one with a sample rate of 8. This may take additional time. "
 							 "A step index can be provided via -a, --step-index. A step index can be built using odgi stepindex." << std::endl;
 			}
-			algorithms::step_index_t step_index(graph, paths, num_threads, progress, 8);
-			for (auto target_path_t: target_paths) {
-				// make bit vector across nodes to tell us if we have a hit
-				// this is a speed up compared to iterating through all steps of a potential node for each walked step
-				std::vector<bool> target_handles;
-				target_handles.resize(graph.get_node_count(), false);
-				graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
-					handle_t h = graph.get_handle_of_step(step);
-					target_handles[number_bool_packing::unpack_number(h)] = true;
-				});
-				ska::flat_hash_set<std::string> not_visited_set;
-				/// walk from the front
-				algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, step_index, num_threads,
-									  get_path_begin,
-									  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				std::vector<path_handle_t> visitable_query_paths;
-				for (auto query_path: query_paths) {
-					if (!not_visited_set.count(graph.get_path_name(query_path))) {
-						visitable_query_paths.push_back(query_path);
-					}
-				}
-				/// walk from the back
-				algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, step_index,
-									  num_threads, get_path_back,
-									  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
-									  not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				/// let's write our paths we did not visit
-				std::string query_path = graph.get_path_name(target_path_t);
-				for (auto not_visited_path: not_visited_set) {
-					not_visited_out << query_path << "\t" << not_visited_path << std::endl;
-				}
-			}
-			bed_writer_thread.close_writer();
-			if (_not_visited_tsv) {
-				not_visited_out.close();
-			}
-		} else {
-			algorithms::step_index_t step_index;
-			step_index.load(args::get(_step_index));
-			for (auto target_path_t: target_paths) {
-				// make bit vector across nodes to tell us if we have a hit
-				// this is a speed up compared to iterating through all steps of a potential node for each walked step
-				std::vector<bool> target_handles;
-				target_handles.resize(graph.get_node_count(), false);
-				graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
-					handle_t h = graph.get_handle_of_step(step);
-					target_handles[number_bool_packing::unpack_number(h)] = true;
-				});
-				ska::flat_hash_set<std::string> not_visited_set;
-				/// walk from the front
-				algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, step_index, num_threads,
-									  get_path_begin,
-									  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				std::vector<path_handle_t> visitable_query_paths;
-				for (auto query_path: query_paths) {
-					if (!not_visited_set.count(graph.get_path_name(query_path))) {
-						visitable_query_paths.push_back(query_path);
-					}
-				}
-				/// walk from the back
-				algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, step_index,
-									  num_threads, get_path_back,
-									  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
-									  not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				/// let's write our paths we did not visit
-				std::string query_path = graph.get_path_name(target_path_t);
-				for (auto not_visited_path: not_visited_set) {
-					not_visited_out << query_path << "\t" << not_visited_path << std::endl;
+			step_index = std::make_unique<algorithms::step_index_t>(graph, paths, num_threads, progress, 8);
+		}
+		const uint64_t sketch_size = _sketch_size ? args::get(_sketch_size) : 0;
+		for (auto target_path_t: target_paths) {
+			// make bit vector across nodes to tell us if we have a hit
+			// this is a speed up compared to iterating through all steps of a potential node for each walked step
+			std::vector<bool> target_handles;
+			target_handles.resize(graph.get_node_count(), false);
+			graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
+				handle_t h = graph.get_handle_of_step(step);
+				target_handles[number_bool_packing::unpack_number(h)] = true;
+			});
+			ska::flat_hash_set<std::string> not_visited_set;
+			/// walk from the front
+			algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, *step_index, num_threads,
+								  get_path_begin,
+								  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
+								  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+								  (_walking_dist ? args::get(_walking_dist) : 10000),
+								  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false),
+								  sketch_size);
+			std::vector<path_handle_t> visitable_query_paths;
+			for (auto query_path: query_paths) {
+				if (!not_visited_set.count(graph.get_path_name(query_path))) {
+					visitable_query_paths.push_back(query_path);
 				}
 			}
-			bed_writer_thread.close_writer();
-			if (_not_visited_tsv) {
-				not_visited_out.close();
+			/// walk from the back
+			algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, *step_index,
+								  num_threads, get_path_back,
+								  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
+								  not_visited_set,
+								  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+								  (_walking_dist ? args::get(_walking_dist) : 10000),
+								  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false),
+								  sketch_size);
+			/// let's write our paths we did not visit
+			std::string query_path = graph.get_path_name(target_path_t);
+			for (auto not_visited_path: not_visited_set) {
+				not_visited_out << query_path << "\t" << not_visited_path << std::endl;
 			}
 		}
+		bed_writer_thread.close_writer();
+		if (_not_visited_tsv) {
+			not_visited_out.close();
+		}
 
 		exit(0);
 	}
@@ -62,7 +62,7 @@ int main_untangle(int argc, char **argv) {
     args::Flag make_self_dotplot(debugging_opts, "DOTPLOT", "Render a table showing the positional dotplot of the query against itself.",
                                  {'S', "self-dotplot"});
 	args::Group step_index_opts(parser, "[ Step Index Options ]");
-	args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: build the step index from scratch with a sampling rate of 8).",
+	args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: use *INPUT_GRAPH.stpidx* if it was built by odgi stepindex from this graph, otherwise build the step index from scratch with a sampling rate of 8).",
 											 {'a', "step-index"});
     args::Group threading(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(
@@ -207,48 +207,33 @@ int main_untangle(int argc, char **argv) {
             algorithms::self_dotplot(graph, query);
         }
     } else {
-		if (!_step_index) {
+		std::unique_ptr<algorithms::step_index_t> step_index = std::make_unique<algorithms::step_index_t>();
+		if (_step_index) {
+			step_index->load(args::get(_step_index));
+		} else if (!algorithms::load_step_index_sidecar(*step_index, args::get(og_in_file), progress)) {
 			if (progress) {
 				std::cerr
 						<< "[odgi::untangle] warning: no step index specified. Building one with a sample rate of 8. This may take additional time. "
 						   "A step index can be provided via -a, --step-index. A step index can be built using odgi stepindex."
 						<< std::endl;
 			}
-			algorithms::step_index_t step_index(graph, paths, num_threads, progress, 8);
-			algorithms::untangle(graph,
-								 query_paths,
-								 target_paths,
-								 args::get(merge_dist),
-								 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
-								 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-								 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
-								 (_cut_every ? args::get(_cut_every) : 0),
-                                 output_type,
-								 args::get(input_cut_points),
-								 args::get(output_cut_points),
-								 num_threads,
-								 progress,
-								 step_index,
-								 paths);
-		} else {
-			algorithms::step_index_t step_index;
-			step_index.load(args::get(_step_index));
-			algorithms::untangle(graph,
-								 query_paths,
-								 target_paths,
-								 args::get(merge_dist),
-								 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
-								 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-								 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
-								 (_cut_every ? args::get(_cut_every) : 0),
-                                 output_type,
-								 args::get(input_cut_points),
-								 args::get(output_cut_points),
-								 num_threads,
-								 progress,
-								 step_index,
-                                 paths);
+			step_index = std::make_unique<algorithms::step_index_t>(graph, paths, num_threads, progress, 8);
 		}
+		algorithms::untangle(graph,
+							 query_paths,
+							 target_paths,
+							 args::get(merge_dist),
+							 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
+							 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+							 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
+							 (_cut_every ? args::get(_cut_every) : 0),
+                             output_type,
+							 args::get(input_cut_points),
+							 args::get(output_cut_points),
+							 num_threads,
+							 progress,
+							 *step_index,
+							 paths);
     }
 
     return 0;
@@ -2,13 +2,16 @@
 #include "odgi.hpp"
 #include "args.hxx"
 #include "algorithms/bin_path_info.hpp"
+#include "algorithms/bin_summary.hpp"
 #include "algorithms/hash.hpp"
 #include "algorithms/id_ordered_paths.hpp"
 #include "lodepng.h"
 #include <limits>
+#include <omp.h>
 #include <regex>
 #include "picosha2.h"
 #include "algorithms/draw.hpp"
+#include "algorithms/png_band_writer.hpp"
 #include "utils.hpp"
 #include "colorbrewer.hpp"
 #include "split.hpp"
@@ -27,6 +30,14 @@ namespace odgi {
 
     using namespace odgi::subcommand;
 
+    /// The rows [begin, end) of the image of odgi viz, and of the path names on its left, in RGBA
+    struct viz_band_t {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        std::vector<uint8_t> image;
+        std::vector<uint8_t> path_names;
+    };
+
     // helper to get the prefix of a string
     std::string prefix(const std::string& s, const char c) {
         //std::cerr << "prefix of " << s << " by " << c << " is " << s.substr(0, s.find(c)) << std::endl;
@@ -126,6 +137,14 @@ namespace odgi {
         args::Flag no_grey_depth(bin_opts, "bool", "Use the colorbrewer palette for <0.5x and ~1x coverage bins."
                                  " By default, these bins are light and neutral grey.",
                                  {'G', "no-grey-depth"});
+        args::ValueFlag<std::string> _bin_summary(bin_opts, "FILE", "Take the mean depth, inversion rate and uncalled bases of the paths"
+                                                                     " in each bin from the summary in *FILE*, written by odgi bin --summary,"
+                                                                     " if it was built from the current contents of the input graph,"
+                                                                     " instead of computing them from the graph. This needs a bin width of"
+                                                                     " at least 16 times, or a multiple of, the base bin width of the summary;"
+                                                                     " bins that don't line up with the summary get shares of the summary bins"
+                                                                     " that straddle them.",
+                                                                     {"bin-summary"});
 
         /// Gradient mode
         args::Group grad_mode_opts(parser, "[ Gradient Mode Options ]");
@@ -149,7 +168,7 @@ namespace odgi {
 															  "-B, --colorbrewer-palette.", {'O', "compressed-mode"});
 
 		args::Group threading(parser, "[ Threading ]");
-		args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
+		args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations, including the drawing of the image and the compression of the PNG, one band of rows at a time.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
 		args::Flag _progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
         args::Group program_information(parser, "[ Program Information ]");
@@ -437,6 +456,32 @@ namespace odgi {
             _bin_width = 1;
         }
 
+        // the per-bin path statistics can come from a summary built beforehand
+        algorithms::bin_summary_t bin_summary;
+        bool use_bin_summary = false;
+        if (_binned_mode && !args::get(_bin_summary).empty()) {
+            try {
+                use_bin_summary = algorithms::load_bin_summary(bin_summary, args::get(_bin_summary), args::get(dg_in_file), args::get(_progress));
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            if (use_bin_summary && _bin_width < 16 * bin_summary.base_width
+                && !(_bin_width == std::floor(_bin_width) && (uint64_t)_bin_width % bin_summary.base_width == 0)) {
+                if (_progress) {
+                    std::cerr << "[odgi::viz] the bin width " << _bin_width << " is too fine for the base bin width "
+                              << bin_summary.base_width << " of the summary in " << args::get(_bin_summary) << "." << std::endl;
+                }
+                use_bin_summary = false;
+            }
+            if (!use_bin_summary) {
+                std::cerr << "[odgi::viz] warning: computing the bin statistics of the paths from the graph." << std::endl;
+            }
+        }
+        // the bins to draw, in bp
+        const uint64_t bin_summary_start = std::floor(pangenomic_start_pos) * _bin_width;
+        const uint64_t bin_summary_end = std::ceil((std::floor(pangenomic_end_pos) + 1) * _bin_width);
+
         /*std::cerr << "real len: " << len << std::endl;
         std::cerr << "pangenomic_start_pos: " << pangenomic_start_pos << "\npangenomic_end_pos: " << pangenomic_end_pos << std::endl;
         std::cerr << "len_to_visualize: " << len_to_visualize << std::endl;*/
@@ -643,10 +688,6 @@ namespace odgi {
 
         const uint64_t path_space = path_count * pix_per_path;
 
-        std::vector<uint8_t> image;
-        image.resize(width * (height + path_space) * 4, 255);
-
-        std::vector<uint8_t> image_path_names;
         if (!args::get(hide_path_names) && !args::get(pack_paths) && pix_per_path >= 8) {
             size_t _max_num_of_chars = std::numeric_limits<size_t>::min();
 
@@ -675,7 +716,6 @@ namespace odgi {
             char_size = min((uint16_t)((pix_per_path / 8) * 8), (uint16_t) PATH_NAMES_MAX_CHARACTER_SIZE);
 
             width_path_names = max_num_of_chars * char_size + char_size / 2;
-            image_path_names.resize(width_path_names * (height + path_space) * 4, 255);
         }
 
         if (width_path_names + width > 50000){
@@ -695,17 +735,27 @@ namespace odgi {
             path_name_prefix_separator = args::get(color_by_prefix);
         }
 
-        auto add_point = [&](const double &_x, const double &_y,
+        // the image is drawn one band of rows at a time, and pixels on the rows outside the band are dropped
+        auto set_pixel = [](std::vector<uint8_t> &img, const uint64_t &width_img, const viz_band_t &band,
+                            const uint64_t &x, const uint64_t &y,
+                            const uint8_t &_r, const uint8_t &_g, const uint8_t &_b) {
+            if (y >= band.begin && y < band.end) {
+                const uint64_t band_y = y - band.begin;
+                img[4 * width_img * band_y + 4 * x + 0] = _r;
+                img[4 * width_img * band_y + 4 * x + 1] = _g;
+                img[4 * width_img * band_y + 4 * x + 2] = _b;
+                img[4 * width_img * band_y + 4 * x + 3] = 255;
+            }
+        };
+
+        auto add_point = [&](viz_band_t &band, const double &_x, const double &_y,
                              const uint8_t &_r, const uint8_t &_g, const uint8_t &_b) {
             uint64_t x = std::min((uint64_t) std::round(_x * scale_x), width - 1);
             uint64_t y = std::min((uint64_t) std::round(_y * scale_y), height - 1) + path_space;
-            image[4 * width * y + 4 * x + 0] = _r;
-            image[4 * width * y + 4 * x + 1] = _g;
-            image[4 * width * y + 4 * x + 2] = _b;
-            image[4 * width * y + 4 * x + 3] = 255;
+            set_pixel(band.image, width, band, x, y, _r, _g, _b);
         };
 
-        auto add_edge_from_positions = [&](double a, const double b, uint8_t rgb) {
+        auto add_edge_from_positions = [&](viz_band_t &band, double a, const double b, uint8_t rgb) {
 #ifdef debug_odgi_viz
             std::cerr << "Edge displayed" << std::endl;
             std::cerr << a << " --> " << b << std::endl;
@@ -719,25 +769,25 @@ namespace odgi {
 
                 for (; i < dist; i += 1.0 / scale_y) {
                     if (a >= pangenomic_start_pos && a <= pangenomic_end_pos) {
-                        add_point(a - pangenomic_start_pos, i, rgb, rgb, rgb);
+                        add_point(band, a - pangenomic_start_pos, i, rgb, rgb, rgb);
                     }
                 }
 
                 while (a <= b) {
                     if (a >= pangenomic_start_pos && a <= pangenomic_end_pos) {
-                        add_point(a - pangenomic_start_pos, i, rgb, rgb, rgb);
+                        add_point(band, a - pangenomic_start_pos, i, rgb, rgb, rgb);
                     }
                     a += 1.0 / scale_x;
                 }
                 if (b >= pangenomic_start_pos && b <= pangenomic_end_pos) {
                     for (double j = 0.0; j < dist; j += 1.0 / scale_y) {
-                        add_point(b - pangenomic_start_pos, j, rgb, rgb, rgb);
+                        add_point(band, b - pangenomic_start_pos, j, rgb, rgb, rgb);
                     }
                 }
             }
         };
 
-        auto add_edge_from_handles = [&](const handle_t& h, const handle_t& o) {
+        auto add_edge_from_handles = [&](viz_band_t &band, const handle_t& h, const handle_t& o) {
             // map into our bins
             const uint64_t _a = position_map[number_bool_packing::unpack_number(h) + !number_bool_packing::unpack_bit(h) - shift] / _bin_width + 1;
             const uint64_t _b = position_map[number_bool_packing::unpack_number(o) + number_bool_packing::unpack_bit(o) - shift] / _bin_width + 1;
@@ -750,34 +800,35 @@ namespace odgi {
             std::cerr << "edge " << a << " --> " << b << std::endl;
 #endif
 
-            add_edge_from_positions(a, b, 0);
+            add_edge_from_positions(band, a, b, 0);
         };
 
-        {
-            std::function<bool(const handle_t)> is_a_handle_to_hide;
-			if (compress) {
+        std::function<bool(const handle_t)> is_a_handle_to_hide;
+		if (compress) {
+			is_a_handle_to_hide = [&](const handle_t &h) {
+				return false;
+			};
+		} else {
+			if (path_count < graph.get_path_count()) {
 				is_a_handle_to_hide = [&](const handle_t &h) {
-					return false;
+					return graph.for_each_step_on_handle(h, [&](const step_handle_t &step) {
+						auto path_handle = graph.get_path_handle_of_step(step);
+						if (path_layout_y[as_integer(path_handle) - 1] >= 0) {
+							return false;
+						}
+
+						return true;
+					});
 				};
 			} else {
-				if (path_count < graph.get_path_count()) {
-					is_a_handle_to_hide = [&](const handle_t &h) {
-						return graph.for_each_step_on_handle(h, [&](const step_handle_t &step) {
-							auto path_handle = graph.get_path_handle_of_step(step);
-							if (path_layout_y[as_integer(path_handle) - 1] >= 0) {
-								return false;
-							}
-
-							return true;
-						});
-					};
-				} else {
-					is_a_handle_to_hide = [&](const handle_t &h) {
-						return false;
-					};
-				}
+				is_a_handle_to_hide = [&](const handle_t &h) {
+					return false;
+				};
 			}
+		}
 
+        // the nodes and their edges, below the paths
+        auto add_nodes_and_edges = [&](viz_band_t &band) {
             /* FIXME Can we remove this?
             if (_binned_mode){
                 graph.for_each_handle([&](const handle_t &h) {
@@ -811,28 +862,28 @@ namespace odgi {
                     // make contents for the bases in the node
                     for (double i = 0.0; i < hl; i += 1.0 / scale_x) {
                         if ((p + i) >= pangenomic_start_pos && (p + i) <= pangenomic_end_pos) {
-                            add_point(p + i - pangenomic_start_pos, 0, 0, 0, 0);
+                            add_point(band, p + i - pangenomic_start_pos, 0, 0, 0, 0);
                         }
                     }
 
                     // add contacts for the edges
                     graph.follow_edges(h, false, [&](const handle_t& o) {
                         if (!is_a_handle_to_hide(o)){
-                            add_edge_from_handles(h, o);
+                            add_edge_from_handles(band, h, o);
                         }
                     });
                     graph.follow_edges(h, true, [&](const handle_t& o) {
                         if (!is_a_handle_to_hide(o)){
-                            add_edge_from_handles(o, h);
+                            add_edge_from_handles(band, o, h);
                         }
                     });
                 }
             });
-        }
+        };
 
         bool _no_path_borders = args::get(no_path_borders);
         bool _black_border = args::get(black_path_borders);
-        auto add_path_step = [&](std::vector<uint8_t> &img, uint64_t width_img,
+        auto add_path_step = [&](std::vector<uint8_t> &img, uint64_t width_img, viz_band_t &band,
                 const double &_x, const double &_y,
                 const uint8_t &_r, const uint8_t &_g, const uint8_t &_b) {
             const uint64_t x = std::min((uint64_t) std::round(_x * scale_x), width - 1);
@@ -841,40 +892,26 @@ namespace odgi {
             if (_no_path_borders || pix_per_path < 3) {
                 const uint64_t s = t + pix_per_path;
                 for ( ; y < s; ++y) {
-                    img[4 * width_img * y + 4 * x + 0] = _r;
-                    img[4 * width_img * y + 4 * x + 1] = _g;
-                    img[4 * width_img * y + 4 * x + 2] = _b;
-                    img[4 * width_img * y + 4 * x + 3] = 255;
+                    set_pixel(img, width_img, band, x, y, _r, _g, _b);
                 }
             } else {
                 const uint64_t s = t + pix_per_path - 1;
                 for ( ; y < s; ++y) {
-                    img[4 * width_img * y + 4 * x + 0] = _r;
-                    img[4 * width_img * y + 4 * x + 1] = _g;
-                    img[4 * width_img * y + 4 * x + 2] = _b;
-                    img[4 * width_img * y + 4 * x + 3] = 255;
+                    set_pixel(img, width_img, band, x, y, _r, _g, _b);
                 }
                 if (_black_border) {
-                    for ( ; y < s + 1; ++y) {
-                        img[4 * width_img * y + 4 * x + 0] = 0;
-                        img[4 * width_img * y + 4 * x + 1] = 0;
-                        img[4 * width_img * y + 4 * x + 2] = 0;
-                        img[4 * width_img * y + 4 * x + 3] = 255;
-                    }
+                    set_pixel(img, width_img, band, x, y, 0, 0, 0);
                 }
             }
         };
 
-        auto add_path_link = [&](const double &_x, const double &_y,
+        auto add_path_link = [&](viz_band_t &band, const double &_x, const double &_y,
                                  const uint8_t &_r, const uint8_t &_g, const uint8_t &_b) {
             const uint64_t x = std::min((uint64_t) std::round(_x * scale_x), width - 1);
             const uint64_t t = _y * pix_per_path + link_pix_y;
             const uint64_t s = t + pix_per_link;
             for (uint64_t y = t; y < s; ++y) {
-                image[4 * width * y + 4 * x + 0] = _r;
-                image[4 * width * y + 4 * x + 1] = _g;
-                image[4 * width * y + 4 * x + 2] = _b;
-                image[4 * width * y + 4 * x + 3] = 255;
+                set_pixel(band.image, width, band, x, y, _r, _g, _b);
             }
         };
 
@@ -912,8 +949,11 @@ namespace odgi {
         const bool _color_path_names_background = args::get(color_path_names_background);
 
 		// Compressed-Mode part starts here :)
+		// the depth of the bins over all the paths and its colors are found once, and then drawn in each band
+		std::map <uint64_t, algorithms::path_info_t> compressed_bins;
+		colorbrewer::palette_t compressed_colors;
+		std::vector<double> compressed_cuts;
 		if (compress) {
-			std::map <uint64_t, algorithms::path_info_t> bins;
 			graph.for_each_path_handle([&](const path_handle_t &path) {
 				graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
 					handle_t h = graph.get_handle_of_step(occ);
@@ -922,455 +962,502 @@ namespace odgi {
 					uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
 					for (uint64_t k = 0; k < hl; ++k) {
 						int64_t curr_bin = (p + k) / _bin_width + 1;
-						++bins[curr_bin].mean_depth;
+						++compressed_bins[curr_bin].mean_depth;
 					}
 				});
 			});
-
-			/// path name part
-
-			uint8_t path_r = 255;
-			uint8_t path_g = 255;
-			uint8_t path_b = 255;
-
-			uint64_t path_rank = 0;
-
-            const uint8_t num_of_chars = min(compressed_path_name.length(), (size_t)max_num_of_chars);
-            const bool path_name_too_long = compressed_path_name.length() > num_of_chars;
-
-            const uint8_t left_padding = max_num_of_chars - num_of_chars;
-
-			// TODO Do we want this functionality?
-			// uint8_t ratio = char_size / 8;
-			/*
-			if (_color_path_names_background) {
-				for (uint32_t x = left_padding * char_size; x <= max_num_of_chars * char_size; x++) {
-					add_path_step(image_path_names, width_path_names,
-								  (double) (x + ratio) * (1.0 / scale_x), path_layout_y[path_rank], path_r,
-								  path_g, path_b);
-				}
-			}
-			 */
-            const uint64_t base_y = path_layout_y[path_rank] * pix_per_path + pix_per_path / 2 - char_size / 2;
-
-			for (uint16_t i = 0; i < num_of_chars; i++) {
-                const uint64_t base_x = (left_padding + i) * char_size;
-
-				auto cb = (i < num_of_chars - 1 || !path_name_too_long) ? font_5x8[compressed_path_name[i]]
-																		: font_5x8_special[TRAILING_DOTS];
-
-				write_character_in_matrix(
-						image_path_names, width_path_names, cb,
-						char_size,
-						base_x, base_y,
-						0, 0, 0
-				);
+			for (auto &entry: compressed_bins) {
+				entry.second.mean_depth /= _bin_width;
 			}
-			/// end path name part
 
-			double x = 1.0;
-			colorbrewer::palette_t cov_colors;
-			std::vector<double> cov_cuts;
 			// Let the user enter the color palette
 			if (colorbrewer_palette) {
 				const auto parts = split(args::get(colorbrewer_palette), ':');
-				cov_colors = colorbrewer::get_palette(parts.front(), std::stoi(parts.back()));
+				compressed_colors = colorbrewer::get_palette(parts.front(), std::stoi(parts.back()));
 			} else {
 				// we also have a default color palette https://colorbrewer2.org/#type=diverging&scheme=RdBu&n=11
-				cov_colors = colorbrewer::get_palette("RdBu", 11);
+				compressed_colors = colorbrewer::get_palette("RdBu", 11);
 			}
 			uint64_t i = 0;
-			cov_cuts.resize(cov_colors.size());
+			compressed_cuts.resize(compressed_colors.size());
 			double depth = 0.5;
-			for (auto &color: cov_colors) {
-				cov_cuts[i++] = depth;
+			for (auto &color: compressed_colors) {
+				compressed_cuts[i++] = depth;
 				depth += 1;
 			}
+		}
+
+		// draw the rows [begin, end) of the image, and of the path names beside it, into the band
+		auto draw_band = [&](viz_band_t &band, const uint64_t &begin, const uint64_t &end) {
+			band.begin = begin;
+			band.end = end;
+			band.image.assign(4 * width * (end - begin), 255);
+			if (char_size >= 8) {
+				band.path_names.assign(4 * width_path_names * (end - begin), 255);
+			}
+			if (end > path_space) {
+				add_nodes_and_edges(band);
+			}
+
+			// only the paths with rows in the band are drawn
+			auto has_rows_in_band = [&](const uint64_t &path_y) {
+				return path_y * pix_per_path < end && (path_y + 1) * pix_per_path > begin;
+			};
+
+			if (compress) {
+				/// path name part
+
+				uint8_t path_r = 255;
+				uint8_t path_g = 255;
+				uint8_t path_b = 255;
+
+				uint64_t path_rank = 0;
+				if (!has_rows_in_band(path_layout_y[path_rank])) {
+					return;
+				}
+
+                const uint8_t num_of_chars = min(compressed_path_name.length(), (size_t)max_num_of_chars);
+                const bool path_name_too_long = compressed_path_name.length() > num_of_chars;
 
-			for (auto &entry: bins) {
-				auto &sec = entry.second;
-				auto &curr_bin = entry.first;
-				sec.mean_depth /= _bin_width;
-				// std::cerr << "MEAN DEPTH OF BIN: " << v.mean_depth << std::endl;
-				auto &mean_depth = sec.mean_depth;
-				uint64_t j = 0;
-				for (; j < cov_cuts.size(); ++j) {
-					if (mean_depth <= cov_cuts[j]) {
-						auto &v = cov_colors[j];
+                const uint8_t left_padding = max_num_of_chars - num_of_chars;
+
+				// TODO Do we want this functionality?
+				// uint8_t ratio = char_size / 8;
+				/*
+				if (_color_path_names_background) {
+					for (uint32_t x = left_padding * char_size; x <= max_num_of_chars * char_size; x++) {
+						add_path_step(band.path_names, width_path_names, band,
+									  (double) (x + ratio) * (1.0 / scale_x), path_layout_y[path_rank], path_r,
+									  path_g, path_b);
+					}
+				}
+				 */
+                const uint64_t base_y = path_layout_y[path_rank] * pix_per_path + pix_per_path / 2 - char_size / 2;
+
+				for (uint16_t i = 0; i < num_of_chars; i++) {
+                    const uint64_t base_x = (left_padding + i) * char_size;
+
+					auto cb = (i < num_of_chars - 1 || !path_name_too_long) ? font_5x8[compressed_path_name[i]]
+																			: font_5x8_special[TRAILING_DOTS];
+
+					write_character_in_matrix(
+							band.path_names, width_path_names, cb,
+							char_size,
+							base_x, base_y,
+							0, 0, 0,
+							band.begin, band.end
+					);
+				}
+				/// end path name part
+
+				double x = 1.0;
+				for (auto &entry: compressed_bins) {
+					auto &sec = entry.second;
+					auto &curr_bin = entry.first;
+					// std::cerr << "MEAN DEPTH OF BIN: " << v.mean_depth << std::endl;
+					auto &mean_depth = sec.mean_depth;
+					uint64_t j = 0;
+					for (; j < compressed_cuts.size(); ++j) {
+						if (mean_depth <= compressed_cuts[j]) {
+							auto &v = compressed_colors[j];
+							path_r = v.red;
+							path_g = v.green;
+							path_b = v.blue;
+							break;
+						}
+					}
+					// take the max color
+					if (j == compressed_cuts.size()) {
+						auto &v = compressed_colors[j - 1];
 						path_r = v.red;
 						path_g = v.green;
 						path_b = v.blue;
-						break;
 					}
+					uint64_t path_y = path_layout_y[path_rank];
+					add_path_step(band.image, width, band, curr_bin - 1 - pangenomic_start_pos, path_y,
+								  (float) path_r * x, (float) path_g * x, (float) path_b * x);
 				}
-				// take the max color
-				if (j == cov_cuts.size()) {
-					auto &v = cov_colors[j - 1];
-					path_r = v.red;
-					path_g = v.green;
-					path_b = v.blue;
-				}
-				uint64_t path_y = path_layout_y[path_rank];
-				add_path_step(image, width, curr_bin - 1 - pangenomic_start_pos, path_y,
-							  (float) path_r * x, (float) path_g * x, (float) path_b * x);
-			}
-			/// end compressed-mode
+				/// end compressed-mode
 
-			/// default case:
-		} else {
+				/// default case:
+			} else {
 
-			graph.for_each_path_handle([&](const path_handle_t &path) {
-				int64_t path_rank = get_path_idx(path);
-				//std::cerr << graph.get_path_name(path) << " -> " << path_rank << std::endl;
-				if (path_rank >= 0 && path_layout_y[path_rank] >= 0) {
-					// use a sha256 to get a few bytes that we'll use for a color
-					std::string path_name = get_path_display_name(path);
+				graph.for_each_path_handle([&](const path_handle_t &path) {
+					int64_t path_rank = get_path_idx(path);
+					//std::cerr << graph.get_path_name(path) << " -> " << path_rank << std::endl;
+					if (path_rank >= 0 && path_layout_y[path_rank] >= 0 && has_rows_in_band(path_layout_y[path_rank])) {
+						// use a sha256 to get a few bytes that we'll use for a color
+						std::string path_name = get_path_display_name(path);
 
 #ifdef debug_odgi_viz
-					std::cerr << "path_name: " << path_name << std::endl;
+						std::cerr << "path_name: " << path_name << std::endl;
 #endif
 
-					bool is_aln = true;
-					if (aln_mode) {
-						std::string::size_type n = path_name.find(aln_prefix);
-						if (n != 0) {
-							is_aln = false;
+						bool is_aln = true;
+						if (aln_mode) {
+							std::string::size_type n = path_name.find(aln_prefix);
+							if (n != 0) {
+								is_aln = false;
+							}
+						}
+						// use a sha256 to get a few bytes that we'll use for a color
+						picosha2::byte_t hashed[picosha2::k_digest_size];
+						if (color_by_prefix) {
+							std::string path_name_prefix = prefix(path_name, path_name_prefix_separator);
+							picosha2::hash256(path_name_prefix.begin(), path_name_prefix.end(), hashed,
+											  hashed + picosha2::k_digest_size);
+						} else {
+							picosha2::hash256(path_name.begin(), path_name.end(), hashed, hashed + picosha2::k_digest_size);
 						}
-					}
-					// use a sha256 to get a few bytes that we'll use for a color
-					picosha2::byte_t hashed[picosha2::k_digest_size];
-					if (color_by_prefix) {
-						std::string path_name_prefix = prefix(path_name, path_name_prefix_separator);
-						picosha2::hash256(path_name_prefix.begin(), path_name_prefix.end(), hashed,
-										  hashed + picosha2::k_digest_size);
-					} else {
-						picosha2::hash256(path_name.begin(), path_name.end(), hashed, hashed + picosha2::k_digest_size);
-					}
-
-					uint8_t path_r = hashed[24];
-					uint8_t path_g = hashed[8];
-					uint8_t path_b = hashed[16];
-					float path_r_f = (float) path_r / (float) (std::numeric_limits<uint8_t>::max());
-					float path_g_f = (float) path_g / (float) (std::numeric_limits<uint8_t>::max());
-					float path_b_f = (float) path_b / (float) (std::numeric_limits<uint8_t>::max());
-					float sum = path_r_f + path_g_f + path_b_f;
-					path_r_f /= sum;
-					path_g_f /= sum;
-					path_b_f /= sum;
-
-					// Calculate the number or steps, the reverse steps and the length of the path if any of this information
-					// is needed depending on the input arguments.
-					uint64_t steps = 0;
-					uint64_t rev = 0;
-					uint64_t path_len_to_use = 0;
-					std::map <uint64_t, algorithms::path_info_t> bins;
-					if (is_aln) {
-						if (
-								_show_strands ||
-								(_change_darkness && !_longest_path) ||
-								(_binned_mode &&
-								 (_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness ||
-								  _color_by_uncalled_bases))
-								) {
-							handle_t h;
-							uint64_t hl, p;
-							bool is_rev;
-							uint64_t num_uncalled_bases;
-							graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-								h = graph.get_handle_of_step(occ);
-								is_rev = graph.get_is_reverse(h);
-								hl = graph.get_length(h);
 
-								if (_color_by_uncalled_bases) {
-									num_uncalled_bases = 0;
-									for (auto c: graph.get_sequence(h)) {
-										if (c == 'N' || c == 'n') {
-											num_uncalled_bases++;
-										}
+						uint8_t path_r = hashed[24];
+						uint8_t path_g = hashed[8];
+						uint8_t path_b = hashed[16];
+						float path_r_f = (float) path_r / (float) (std::numeric_limits<uint8_t>::max());
+						float path_g_f = (float) path_g / (float) (std::numeric_limits<uint8_t>::max());
+						float path_b_f = (float) path_b / (float) (std::numeric_limits<uint8_t>::max());
+						float sum = path_r_f + path_g_f + path_b_f;
+						path_r_f /= sum;
+						path_g_f /= sum;
+						path_b_f /= sum;
+
+						// Calculate the number or steps, the reverse steps and the length of the path if any of this information
+						// is needed depending on the input arguments.
+						uint64_t steps = 0;
+						uint64_t rev = 0;
+						uint64_t path_len_to_use = 0;
+						std::map <uint64_t, algorithms::path_info_t> bins;
+						const int64_t bin_summary_rank = use_bin_summary ? bin_summary.get_path_rank(path_name) : -1;
+						const bool bins_from_summary = bin_summary_rank >= 0;
+						if (is_aln) {
+							if (
+									_show_strands ||
+									(_change_darkness && !_longest_path) ||
+									(_binned_mode && !bins_from_summary &&
+									 (_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness ||
+									  _color_by_uncalled_bases))
+									) {
+								handle_t h;
+								uint64_t hl, p;
+								bool is_rev;
+								uint64_t num_uncalled_bases;
+								graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+									h = graph.get_handle_of_step(occ);
+									is_rev = graph.get_is_reverse(h);
+									hl = graph.get_length(h);
+
+									if (_color_by_uncalled_bases && !bins_from_summary) {
+										num_uncalled_bases = 0;
+										graph.for_each_base(h, [&](const char& c) {
+											if (c == 'N' || c == 'n') {
+												num_uncalled_bases++;
+											}
+											return true;
+										});
 									}
-								}
 
-								if (_show_strands) {
-									++steps;
+									if (_show_strands) {
+										++steps;
 
-									rev += is_rev;
-								}
+										rev += is_rev;
+									}
 
-								if (_change_darkness && !_longest_path) {
-									path_len_to_use += hl;
-								}
+									if (_change_darkness && !_longest_path) {
+										path_len_to_use += hl;
+									}
 
-								if (_binned_mode &&
-									(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
-									p = position_map[number_bool_packing::unpack_number(h) - shift];
-									for (uint64_t k = 0; k < hl; ++k) {
-										int64_t curr_bin = (p + k) / _bin_width + 1;
+									if (bins_from_summary) {
+										// the summary has them
+									} else if (_binned_mode &&
+										(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
+										p = position_map[number_bool_packing::unpack_number(h) - shift];
+										for (uint64_t k = 0; k < hl; ++k) {
+											int64_t curr_bin = (p + k) / _bin_width + 1;
+
+											++bins[curr_bin].mean_depth;
+											if (is_rev) {
+												++bins[curr_bin].mean_inv;
+											}
+										}
+									} else if (_binned_mode && _color_by_uncalled_bases) {
+										p = position_map[number_bool_packing::unpack_number(h) - shift];
+										for (uint64_t k = 0; k < hl; ++k) {
+											int64_t curr_bin = (p + k) / _bin_width + 1;
 
-										++bins[curr_bin].mean_depth;
-										if (is_rev) {
-											++bins[curr_bin].mean_inv;
+											// Use the `mean_depth` field as 'mean_Ns`
+											bins[curr_bin].mean_depth += num_uncalled_bases;
 										}
 									}
-								} else if (_binned_mode && _color_by_uncalled_bases) {
-									p = position_map[number_bool_packing::unpack_number(h) - shift];
-									for (uint64_t k = 0; k < hl; ++k) {
-										int64_t curr_bin = (p + k) / _bin_width + 1;
+								});
 
-										// Use the `mean_depth` field as 'mean_Ns`
-										bins[curr_bin].mean_depth += num_uncalled_bases;
+								if (bins_from_summary) {
+									// the summary has them
+								} else if (_binned_mode &&
+									(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
+									for (auto &entry: bins) {
+										auto &v = entry.second;
+										v.mean_inv /= (v.mean_depth ? v.mean_depth : 1);
+										v.mean_depth /= _bin_width;
+									}
+								} else if (_binned_mode && _color_by_uncalled_bases) {
+									for (auto &entry: bins) {
+										auto &v = entry.second;
+										v.mean_depth /= _bin_width;
 									}
 								}
-							});
+							}
 
-							if (_binned_mode &&
-								(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
-								for (auto &entry: bins) {
-									auto &v = entry.second;
-									v.mean_inv /= (v.mean_depth ? v.mean_depth : 1);
-									v.mean_depth /= _bin_width;
-								}
-							} else if (_binned_mode && _color_by_uncalled_bases) {
-								for (auto &entry: bins) {
-									auto &v = entry.second;
-									v.mean_depth /= _bin_width;
-								}
+							if (bins_from_summary &&
+								(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness ||
+								 _color_by_uncalled_bases)) {
+								bin_summary.for_each_scaled_bin(bin_summary_rank, _bin_width, [&](const uint64_t &bin, const algorithms::bin_summary_stats_t &stats) {
+									auto &v = bins[bin + 1];
+									if (_color_by_uncalled_bases) {
+										// Use the `mean_depth` field as 'mean_Ns`
+										v.mean_depth = stats.uncalled / _bin_width;
+									} else {
+										v.mean_inv = stats.inverted / (stats.depth ? stats.depth : 1);
+										v.mean_depth = stats.depth / _bin_width;
+									}
+								}, bin_summary_start, bin_summary_end);
 							}
-						}
 
-						if (_change_darkness && _longest_path) {
-							path_len_to_use = longest_path_len;
-						}
+							if (_change_darkness && _longest_path) {
+								path_len_to_use = longest_path_len;
+							}
 
-						if (_show_strands) {
-							float x = path_r_f;
-							path_r_f = (x + 0.5 * 9) / 10;
-							path_g_f = (x + 0.5 * 9) / 10;
-							path_b_f = (x + 0.5 * 9) / 10;
-							// check the path orientations
-							bool is_rev = (float) rev / (float) steps > 0.5;
-							if (is_rev) {
-								path_r_f = path_r_f * 0.9;
-								path_g_f = path_g_f * 0.9;
-								path_b_f = path_b_f * 1.2;
-							} else {
-								path_b_f = path_b_f * 0.9;
-								path_g_f = path_g_f * 0.9;
-								path_r_f = path_r_f * 1.2;
+							if (_show_strands) {
+								float x = path_r_f;
+								path_r_f = (x + 0.5 * 9) / 10;
+								path_g_f = (x + 0.5 * 9) / 10;
+								path_b_f = (x + 0.5 * 9) / 10;
+								// check the path orientations
+								bool is_rev = (float) rev / (float) steps > 0.5;
+								if (is_rev) {
+									path_r_f = path_r_f * 0.9;
+									path_g_f = path_g_f * 0.9;
+									path_b_f = path_b_f * 1.2;
+								} else {
+									path_b_f = path_b_f * 0.9;
+									path_g_f = path_g_f * 0.9;
+									path_r_f = path_r_f * 1.2;
+								}
+							} else if (_change_darkness && _white_to_black) {
+								path_r = 220;
+								path_g = 220;
+								path_b = 220;
+							} else if (_color_by_mean_inversion_rate) {
+								path_r = 255;
+								path_g = 0;
+								path_b = 0;
+							} else if (_color_by_uncalled_bases) {
+								path_r = 0;
+								path_g = 255;
+								path_b = 0;
 							}
-						} else if (_change_darkness && _white_to_black) {
-							path_r = 220;
-							path_g = 220;
-							path_b = 220;
-						} else if (_color_by_mean_inversion_rate) {
-							path_r = 255;
-							path_g = 0;
-							path_b = 0;
-						} else if (_color_by_uncalled_bases) {
-							path_r = 0;
-							path_g = 255;
-							path_b = 0;
 						}
-					}
 
-					if (!(
-							is_aln && ((_change_darkness && _white_to_black) || _color_by_mean_inversion_rate ||
-									   (_binned_mode &&
-										(_color_by_mean_depth || _change_darkness || _color_by_uncalled_bases)))
-					)) {
-						// brighten the color
-						float f = std::min(1.5, 1.0 / std::max(std::max(path_r_f, path_g_f), path_b_f));
-						path_r = (uint8_t) std::round(255 * std::min(path_r_f * f, (float) 1.0));
-						path_g = (uint8_t) std::round(255 * std::min(path_g_f * f, (float) 1.0));
-						path_b = (uint8_t) std::round(255 * std::min(path_b_f * f, (float) 1.0));
-					}
+						if (!(
+								is_aln && ((_change_darkness && _white_to_black) || _color_by_mean_inversion_rate ||
+										   (_binned_mode &&
+											(_color_by_mean_depth || _change_darkness || _color_by_uncalled_bases)))
+						)) {
+							// brighten the color
+							float f = std::min(1.5, 1.0 / std::max(std::max(path_r_f, path_g_f), path_b_f));
+							path_r = (uint8_t) std::round(255 * std::min(path_r_f * f, (float) 1.0));
+							path_g = (uint8_t) std::round(255 * std::min(path_g_f * f, (float) 1.0));
+							path_b = (uint8_t) std::round(255 * std::min(path_b_f * f, (float) 1.0));
+						}
 
-					if (char_size >= 8) {
-                        const uint8_t num_of_chars = min(path_name.length(), (size_t) max_num_of_chars);
-                        const bool path_name_too_long = path_name.length() > num_of_chars;
+						if (char_size >= 8) {
+                            const uint8_t num_of_chars = min(path_name.length(), (size_t) max_num_of_chars);
+                            const bool path_name_too_long = path_name.length() > num_of_chars;
 
-                        const uint8_t ratio = char_size / 8;
-						const uint8_t left_padding = max_num_of_chars - num_of_chars;
+                            const uint8_t ratio = char_size / 8;
+							const uint8_t left_padding = max_num_of_chars - num_of_chars;
 
-						if (_color_path_names_background) {
-							for (uint32_t x = left_padding * char_size; x <= max_num_of_chars * char_size; x++) {
-								add_path_step(image_path_names, width_path_names,
-											  (double) (x + ratio) * (1.0 / scale_x), path_layout_y[path_rank], path_r,
-											  path_g, path_b);
+							if (_color_path_names_background) {
+								for (uint32_t x = left_padding * char_size; x <= max_num_of_chars * char_size; x++) {
+									add_path_step(band.path_names, width_path_names, band,
+												  (double) (x + ratio) * (1.0 / scale_x), path_layout_y[path_rank], path_r,
+												  path_g, path_b);
+								}
 							}
-						}
 
-                        const uint64_t base_y = path_layout_y[path_rank] * pix_per_path + pix_per_path / 2 - char_size / 2;
+                            const uint64_t base_y = path_layout_y[path_rank] * pix_per_path + pix_per_path / 2 - char_size / 2;
 
-						for (uint16_t i = 0; i < num_of_chars; i++) {
-							uint64_t base_x = (left_padding + i) * char_size;
+							for (uint16_t i = 0; i < num_of_chars; i++) {
+								uint64_t base_x = (left_padding + i) * char_size;
 
-							auto cb = (i < num_of_chars - 1 || !path_name_too_long) ? font_5x8[path_name[i]]
-																					: font_5x8_special[TRAILING_DOTS];
+								auto cb = (i < num_of_chars - 1 || !path_name_too_long) ? font_5x8[path_name[i]]
+																						: font_5x8_special[TRAILING_DOTS];
 
-							write_character_in_matrix(
-									image_path_names, width_path_names, cb,
-									char_size,
-									base_x, base_y,
-									0, 0, 0
-							);
+								write_character_in_matrix(
+										band.path_names, width_path_names, cb,
+										char_size,
+										base_x, base_y,
+										0, 0, 0,
+										band.begin, band.end
+								);
+							}
 						}
-					}
 
-					uint64_t curr_len = 0;
-					double x = 1.0;
-					if (_binned_mode) {
-						colorbrewer::palette_t cov_colors;
-						std::vector<double> cov_cuts;
-						if (_color_by_mean_depth) {
-							if (colorbrewer_palette) {
-								const auto parts = split(args::get(colorbrewer_palette), ':');
-								cov_colors = colorbrewer::get_palette(parts.front(), std::stoi(parts.back()));
-							} else {
-								cov_colors = colorbrewer::get_palette("Spectral", 11);
-							}
-							if (!args::get(no_grey_depth)) {
-								std::reverse(cov_colors.begin(),
-											 cov_colors.end());
-								cov_colors.push_back({128, 128, 128});
-								cov_colors.push_back({196, 196, 196});
-								std::reverse(cov_colors.begin(),
-											 cov_colors.end());
-							}
-							uint64_t i = 0;
-							cov_cuts.resize(cov_colors.size());
-							double depth = 0.5;
-							for (auto &color: cov_colors) {
-								cov_cuts[i++] = depth;
-								depth += 1;
+						uint64_t curr_len = 0;
+						double x = 1.0;
+						if (_binned_mode) {
+							colorbrewer::palette_t cov_colors;
+							std::vector<double> cov_cuts;
+							if (_color_by_mean_depth) {
+								if (colorbrewer_palette) {
+									const auto parts = split(args::get(colorbrewer_palette), ':');
+									cov_colors = colorbrewer::get_palette(parts.front(), std::stoi(parts.back()));
+								} else {
+									cov_colors = colorbrewer::get_palette("Spectral", 11);
+								}
+								if (!args::get(no_grey_depth)) {
+									std::reverse(cov_colors.begin(),
+												 cov_colors.end());
+									cov_colors.push_back({128, 128, 128});
+									cov_colors.push_back({196, 196, 196});
+									std::reverse(cov_colors.begin(),
+												 cov_colors.end());
+								}
+								uint64_t i = 0;
+								cov_cuts.resize(cov_colors.size());
+								double depth = 0.5;
+								for (auto &color: cov_colors) {
+									cov_cuts[i++] = depth;
+									depth += 1;
+								}
 							}
-						}
 
-						std::vector <std::pair<uint64_t, uint64_t>> links;
-						std::vector <uint64_t> bin_ids;
-						int64_t last_bin = 0; // flag meaning "null bin"
+							std::vector <std::pair<uint64_t, uint64_t>> links;
+							std::vector <uint64_t> bin_ids;
+							int64_t last_bin = 0; // flag meaning "null bin"
 
-						handle_t h;
-						uint64_t p, hl;
+							handle_t h;
+							uint64_t p, hl;
 
-						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-							h = graph.get_handle_of_step(occ);
-							p = position_map[number_bool_packing::unpack_number(h) - shift];
-							hl = graph.get_length(h);
+							graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+								h = graph.get_handle_of_step(occ);
+								p = position_map[number_bool_packing::unpack_number(h) - shift];
+								hl = graph.get_length(h);
 
-							// make contents for the bases in the node
+								// make contents for the bases in the node
 
-							uint64_t path_y = path_layout_y[path_rank];
-							for (uint64_t k = 0; k < hl; ++k) {
-								int64_t curr_bin = (p + k) / _bin_width + 1;
+								uint64_t path_y = path_layout_y[path_rank];
+								for (uint64_t k = 0; k < hl; ++k) {
+									int64_t curr_bin = (p + k) / _bin_width + 1;
 
-								if (curr_bin != last_bin) {
-									bin_ids.push_back(curr_bin);
+									if (curr_bin != last_bin) {
+										bin_ids.push_back(curr_bin);
 
 #ifdef debug_odgi_viz
-									std::cerr << "curr_bin: " << curr_bin << std::endl;
+										std::cerr << "curr_bin: " << curr_bin << std::endl;
 #endif
 
-									if (is_aln) {
-										if (_change_darkness) {
-											uint64_t ii = bins[curr_bin].mean_inv > 0.5 ? (hl - k) : k;
-											x = 1.0 - ((double) (curr_len + ii) / (double) (path_len_to_use)) * 0.9;
-										} else if (_color_by_mean_depth) {
-											auto &mean_depth = bins[curr_bin].mean_depth;
-											uint64_t j = 0;
-											for (; j < cov_cuts.size(); ++j) {
-												if (mean_depth <= cov_cuts[j]) {
-													auto &v = cov_colors[j];
+										if (is_aln) {
+											if (_change_darkness) {
+												uint64_t ii = bins[curr_bin].mean_inv > 0.5 ? (hl - k) : k;
+												x = 1.0 - ((double) (curr_len + ii) / (double) (path_len_to_use)) * 0.9;
+											} else if (_color_by_mean_depth) {
+												auto &mean_depth = bins[curr_bin].mean_depth;
+												uint64_t j = 0;
+												for (; j < cov_cuts.size(); ++j) {
+													if (mean_depth <= cov_cuts[j]) {
+														auto &v = cov_colors[j];
+														path_r = v.red;
+														path_g = v.green;
+														path_b = v.blue;
+														break;
+													}
+												}
+												// take the max color
+												if (j == cov_cuts.size()) {
+													auto &v = cov_colors[j - 1];
 													path_r = v.red;
 													path_g = v.green;
 													path_b = v.blue;
-													break;
 												}
+											} else if (_color_by_mean_inversion_rate) {
+												x = bins[curr_bin].mean_inv;
+											} else if (_color_by_uncalled_bases) {
+												x = bins[curr_bin].mean_depth;
 											}
-											// take the max color
-											if (j == cov_cuts.size()) {
-												auto &v = cov_colors[j - 1];
-												path_r = v.red;
-												path_g = v.green;
-												path_b = v.blue;
-											}
-										} else if (_color_by_mean_inversion_rate) {
-											x = bins[curr_bin].mean_inv;
-										} else if (_color_by_uncalled_bases) {
-											x = bins[curr_bin].mean_depth;
 										}
-									}
 
-									if (curr_bin - 1 >= pangenomic_start_pos && curr_bin - 1 <= pangenomic_end_pos) {
-										add_path_step(image, width, curr_bin - 1 - pangenomic_start_pos, path_y,
-													  (float) path_r * x, (float) path_g * x, (float) path_b * x);
+										if (curr_bin - 1 >= pangenomic_start_pos && curr_bin - 1 <= pangenomic_end_pos) {
+											add_path_step(band.image, width, band, curr_bin - 1 - pangenomic_start_pos, path_y,
+														  (float) path_r * x, (float) path_g * x, (float) path_b * x);
+										}
+
 									}
 
+									last_bin = curr_bin;
 								}
 
-								last_bin = curr_bin;
-							}
+								curr_len += hl;
+							});
 
-							curr_len += hl;
-						});
+						} else {
+							/// Loop over all the steps along a path, from first through last and draw them
+							graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+								handle_t h = graph.get_handle_of_step(occ);
+								uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+								uint64_t hl = graph.get_length(h);
+								// make contects for the bases in the node
+								uint64_t path_y = path_layout_y[path_rank];
+								for (uint64_t i = 0; i < hl; i += 1 / scale_x) {
+									if (is_aln) {
+										if (_change_darkness) {
+											uint64_t ii = graph.get_is_reverse(h) ? (hl - i) : i;
+											x = 1.0 -
+												((double) (curr_len + ii * scale_x) / (double) (path_len_to_use)) * 0.9;
+										} else if (_color_by_mean_inversion_rate) {
+											if (graph.get_is_reverse(h)) {
+												path_r = 255;
+											} else {
+												path_r = 0;
+											}
+										};
+									}
 
-					} else {
-						/// Loop over all the steps along a path, from first through last and draw them
-						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-							handle_t h = graph.get_handle_of_step(occ);
-							uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
-							uint64_t hl = graph.get_length(h);
-							// make contects for the bases in the node
-							uint64_t path_y = path_layout_y[path_rank];
-							for (uint64_t i = 0; i < hl; i += 1 / scale_x) {
-								if (is_aln) {
-									if (_change_darkness) {
-										uint64_t ii = graph.get_is_reverse(h) ? (hl - i) : i;
-										x = 1.0 -
-											((double) (curr_len + ii * scale_x) / (double) (path_len_to_use)) * 0.9;
-									} else if (_color_by_mean_inversion_rate) {
-										if (graph.get_is_reverse(h)) {
-											path_r = 255;
-										} else {
-											path_r = 0;
-										}
-									};
+									if ((p + i) >= pangenomic_start_pos && (p + i) <= pangenomic_end_pos) {
+										add_path_step(band.image, width, band, p + i - pangenomic_start_pos, path_y,
+													  (float) path_r * x, (float) path_g * x, (float) path_b * x);
+									}
 								}
 
-								if ((p + i) >= pangenomic_start_pos && (p + i) <= pangenomic_end_pos) {
-									add_path_step(image, width, p + i - pangenomic_start_pos, path_y,
-												  (float) path_r * x, (float) path_g * x, (float) path_b * x);
-								}
-							}
+								curr_len += hl;
+							});
+						}
 
-							curr_len += hl;
-						});
-					}
+						// add in a visual motif that shows the links between path pieces
+						// this is most meaningful in a linear layout
+						if (args::get(link_path_pieces)) {
+							uint64_t min_x = std::numeric_limits<uint64_t>::max();
+							uint64_t max_x = std::numeric_limits<uint64_t>::min(); // 0
 
-					// add in a visual motif that shows the links between path pieces
-					// this is most meaningful in a linear layout
-					if (args::get(link_path_pieces)) {
-						uint64_t min_x = std::numeric_limits<uint64_t>::max();
-						uint64_t max_x = std::numeric_limits<uint64_t>::min(); // 0
-
-						// In binned mode, the min/max_x values changes based on the bin width; in standard mode, _bin_width is 1, so nothing changes here
-						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-							handle_t h = graph.get_handle_of_step(occ);
-							uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
-							min_x = std::min(min_x, (uint64_t)(p / _bin_width));
-							max_x = std::max(max_x, (uint64_t)((p + graph.get_length(h)) / _bin_width));
-						});
-
-						// now touch up the range
-						uint64_t path_y = path_layout_y[path_rank];
-						for (uint64_t i = min_x; i < max_x; i += 1 / scale_x) {
-							add_path_link(i, path_y, path_r, path_g, path_b);
+							// In binned mode, the min/max_x values changes based on the bin width; in standard mode, _bin_width is 1, so nothing changes here
+							graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+								handle_t h = graph.get_handle_of_step(occ);
+								uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+								min_x = std::min(min_x, (uint64_t)(p / _bin_width));
+								max_x = std::max(max_x, (uint64_t)((p + graph.get_length(h)) / _bin_width));
+							});
+
+							// now touch up the range
+							uint64_t path_y = path_layout_y[path_rank];
+							for (uint64_t i = min_x; i < max_x; i += 1 / scale_x) {
+								add_path_link(band, i, path_y, path_r, path_g, path_b);
+							}
 						}
 					}
-				}
-				//add_point(curr_bin - 1 - pangenomic_start_pos, 0, RGB_BIN_LINKS, RGB_BIN_LINKS, RGB_BIN_LINKS);
-			});
+					//add_point(curr_bin - 1 - pangenomic_start_pos, 0, RGB_BIN_LINKS, RGB_BIN_LINKS, RGB_BIN_LINKS);
+				});
 
-		}
+			}
+		};
 
         /*
         if (args::get(drop_gap_links)) {
@@ -1381,24 +1468,42 @@ namespace odgi {
         }
         */
 
-        // trim horizontal and vertical spaces to fit
+        // the image is never held whole: each thread draws one band of rows at a time, about 4MB of them
+        const uint64_t band_rows = std::max((uint64_t) 1, ((uint64_t) 1 << 22) / (4 * (width + width_path_names)));
+        std::vector<viz_band_t> bands(num_threads);
+
+        // trim horizontal and vertical spaces to fit, drawing the bands once to find the bounds of what is drawn
         uint64_t min_x = width;
         uint64_t max_x = std::numeric_limits<uint64_t>::min(); // 0
         uint64_t min_y = height + path_space;
         uint64_t max_y = std::numeric_limits<uint64_t>::min(); // 0
-        for (uint64_t y = 0; y < height + path_space; ++y) {
-            for (uint64_t x = 0; x < width; ++x) {
-                uint8_t r = image[4 * width * y + 4 * x + 0];
-                uint8_t g = image[4 * width * y + 4 * x + 1];
-                uint8_t b = image[4 * width * y + 4 * x + 2];
-                //uint8_t a = image[4 * width * y + 4 * x + 3];
-                if (r != 255 || g != 255 || b != 255) {
-                    min_x = std::min(min_x, x);
-                    max_x = std::max(max_x, x);
-                    min_y = std::min(min_y, y);
-                    max_y = std::max(max_y, y);
+        const uint64_t num_bands = (height + path_space + band_rows - 1) / band_rows;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t k = 0; k < num_bands; ++k) {
+            viz_band_t &band = bands[omp_get_thread_num()];
+            draw_band(band, k * band_rows, std::min((k + 1) * band_rows, height + path_space));
+            uint64_t band_min_x = width;
+            uint64_t band_max_x = 0;
+            uint64_t band_min_y = height + path_space;
+            uint64_t band_max_y = 0;
+            for (uint64_t y = band.begin; y < band.end; ++y) {
+                for (uint64_t x = 0; x < width; ++x) {
+                    const uint8_t *pixel = &band.image[4 * width * (y - band.begin) + 4 * x];
+                    if (pixel[0] != 255 || pixel[1] != 255 || pixel[2] != 255) {
+                        band_min_x = std::min(band_min_x, x);
+                        band_max_x = std::max(band_max_x, x);
+                        band_min_y = std::min(band_min_y, y);
+                        band_max_y = std::max(band_max_y, y);
+                    }
                 }
             }
+#pragma omp critical (bounds)
+            {
+                min_x = std::min(min_x, band_min_x);
+                max_x = std::max(max_x, band_max_x);
+                min_y = std::min(min_y, band_min_y);
+                max_y = std::max(max_y, band_max_y);
+            }
         }
 
         // provide some default padding at the bottom, to clarify the edges
@@ -1418,21 +1523,32 @@ namespace odgi {
         std::cerr << "crop_width " << crop_width << std::endl;
         std::cerr << "crop_height " << crop_height << std::endl;*/
 
-        std::vector<uint8_t> crop;
-        crop.resize(crop_width * crop_height * 4, 255);
-        for (uint64_t y = 0; y < crop_height; ++y) {
-            for (uint64_t x = 0; x < crop_width; ++x) {
-                for (uint8_t z = 0; z < 4; z++){
-                    crop[4 * crop_width * y + 4 * x + z] = (char_size >= 8 && x < width_path_names) ?
-                            image_path_names[4 * width_path_names * (y + min_y) + 4 * x + z] :
-                            image[4 * width * (y + min_y) + 4 * (x - width_path_names + min_x) + z];
+        // the cropped rows go straight into the PNG, which is compressed in parallel one band of rows at a time;
+        // each thread draws the band its rows are in when it first asks for one of them
+        // nb: every pixel is opaque, so the PNG holds RGB only
+        try {
+            png::band_writer_t png_out(args::get(png_out_file), crop_width, crop_height, num_threads);
+            png_out.write([&](const uint64_t &crop_y, uint8_t *row) {
+                viz_band_t &band = bands[omp_get_thread_num()];
+                const uint64_t y = crop_y + min_y;
+                if (y < band.begin || y >= band.end) {
+                    // a thread first asks for the row above its own, so one more row covers all of its band_rows
+                    draw_band(band, y, std::min(y + band_rows + 1, max_y));
                 }
-            }
+                for (uint64_t x = 0; x < crop_width; ++x) {
+                    const uint8_t *pixel = (char_size >= 8 && x < width_path_names) ?
+                            &band.path_names[4 * width_path_names * (y - band.begin) + 4 * x] :
+                            &band.image[4 * width * (y - band.begin) + 4 * (x - width_path_names + min_x)];
+                    row[3 * x + 0] = pixel[0];
+                    row[3 * x + 1] = pixel[1];
+                    row[3 * x + 2] = pixel[2];
+                }
+            }, band_rows);
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
         }
 
-        const char *filename = args::get(png_out_file).c_str();
-        png::encodeOneStep(filename, crop, crop_width, crop_height);
-
         return 0;
     }
 
@@ -0,0 +1,232 @@
+/**
+ * \file
+ * unittest/bin_summary.cpp: test cases for the multi-resolution bin summary of odgi bin and odgi viz.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/bin_summary.hpp"
+#include "algorithms/bin_path_info.hpp"
+#include "algorithms/temp_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+
+		/// the entries of one path and level, field by field
+		static vector<vector<double>> entry_fields(const vector<algorithms::bin_summary_entry_t>& entries) {
+			vector<vector<double>> fields;
+			for (auto& e : entries) {
+				fields.push_back({(double)e.bin, (double)e.depth, (double)e.inverted, (double)e.uncalled,
+								  (double)e.first, (double)e.last, e.position_sum});
+			}
+			return fields;
+		}
+
+		TEST_CASE("Bin summaries report what the paths have in each bin", "[bin]") {
+
+			// 15 bp, with a node of Ns, a path that steps on a node twice, and paths on the reverse strand
+			graph_t graph;
+			handle_t n1 = graph.create_handle("ACGTA");
+			handle_t n2 = graph.create_handle("NNG");
+			handle_t n3 = graph.create_handle("TT");
+			handle_t n4 = graph.create_handle("CAGTC");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n2, n4);
+			graph.create_edge(n1, graph.flip(n3));
+			graph.create_edge(graph.flip(n3), n4);
+			graph.create_edge(n4, n1);
+
+			path_handle_t a = graph.create_path_handle("a");
+			for (auto& h : {n1, n2, n4}) {
+				graph.append_step(a, h);
+			}
+			path_handle_t b = graph.create_path_handle("b");
+			for (auto& h : {n1, graph.flip(n3), n4, n1}) {
+				graph.append_step(b, h);
+			}
+			path_handle_t c = graph.create_path_handle("c");
+			graph.append_step(c, graph.flip(n4));
+
+			algorithms::bin_summary_t summary;
+			summary.build(graph, 2, 1, false);
+			REQUIRE(summary.pangenome_length == 15);
+			REQUIRE(summary.path_names == vector<string>{"a", "b", "c"});
+			REQUIRE(summary.path_lengths == vector<uint64_t>{13, 17, 5});
+			// 2, 4, 8 and 16 bp
+			REQUIRE(summary.levels.size() == 4);
+
+			SECTION("The bins of path a at the base width") {
+				// n1 is 0-4, n2 5-7, n4 10-14 of the pangenome, and 0-4, 5-7, 8-12 of the path
+				const vector<vector<double>> expected = {
+					{0, 2, 0, 0, 1, 2, 0 + 1},
+					{1, 2, 0, 0, 3, 4, 2 + 3},
+					{2, 2, 0, 1, 5, 6, 4 + 5},
+					{3, 2, 0, 1, 7, 8, 6 + 7},
+					{5, 2, 0, 0, 9, 10, 8 + 9},
+					{6, 2, 0, 0, 11, 12, 10 + 11},
+					{7, 1, 0, 0, 13, 13, 12}
+				};
+				REQUIRE(entry_fields(summary.levels[0][0]) == expected);
+			}
+
+			SECTION("Building with several threads gives the same summary") {
+				algorithms::bin_summary_t parallel;
+				parallel.build(graph, 2, 3, false);
+				for (uint64_t l = 0; l < summary.levels.size(); ++l) {
+					for (uint64_t p = 0; p < 3; ++p) {
+						REQUIRE(entry_fields(parallel.levels[l][p]) == entry_fields(summary.levels[l][p]));
+					}
+				}
+			}
+
+			SECTION("A saved summary loads back the same") {
+				summary.graph_hash = 1234;
+				const string filename = algorithms::temp_file::create("odgi-bin-summary");
+				summary.save(filename);
+				algorithms::bin_summary_t loaded;
+				loaded.load(filename);
+				REQUIRE(loaded.graph_hash == 1234);
+				REQUIRE(loaded.pangenome_length == summary.pangenome_length);
+				REQUIRE(loaded.base_width == summary.base_width);
+				REQUIRE(loaded.path_names == summary.path_names);
+				REQUIRE(loaded.path_lengths == summary.path_lengths);
+				REQUIRE(loaded.levels.size() == summary.levels.size());
+				for (uint64_t l = 0; l < summary.levels.size(); ++l) {
+					for (uint64_t p = 0; p < 3; ++p) {
+						REQUIRE(entry_fields(loaded.levels[l][p]) == entry_fields(summary.levels[l][p]));
+					}
+				}
+				REQUIRE(loaded.get_path_rank("b") == 1);
+				REQUIRE(loaded.get_path_rank("d") == -1);
+			}
+
+			SECTION("Truncated and corrupted summaries don't load") {
+				const string filename = algorithms::temp_file::create("odgi-bin-summary");
+				summary.save(filename);
+				const uint64_t size = filesystem::file_size(filename);
+				ifstream in(filename, ios::binary);
+				string bytes(size, '\0');
+				in.read(&bytes[0], size);
+				in.close();
+				auto write_bytes = [&](const string& data) {
+					ofstream out(filename, ios::binary | ios::trunc);
+					out.write(data.data(), data.size());
+				};
+				for (uint64_t length : {(uint64_t)0, (uint64_t)12, (uint64_t)44, (uint64_t)60, size / 2, size - 1}) {
+					write_bytes(bytes.substr(0, length));
+					algorithms::bin_summary_t loaded;
+					REQUIRE_THROWS_AS(loaded.load(filename), std::runtime_error);
+				}
+				// the path count and the length of the first path name, each set far beyond the file
+				for (uint64_t offset : {(uint64_t)40, (uint64_t)48}) {
+					string corrupted = bytes;
+					for (uint64_t i = 0; i < 8; ++i) {
+						corrupted[offset + i] = (char)0x7f;
+					}
+					write_bytes(corrupted);
+					algorithms::bin_summary_t loaded;
+					REQUIRE_THROWS_AS(loaded.load(filename), std::runtime_error);
+				}
+				// the entry count of the last path in the last level, which has a single entry
+				string corrupted = bytes;
+				corrupted[size - 7 * 8 - 8 + 6] = (char)0x01;
+				write_bytes(corrupted);
+				algorithms::bin_summary_t loaded;
+				REQUIRE_THROWS_AS(loaded.load(filename), std::runtime_error);
+			}
+
+			SECTION("odgi bin reports the same means from the summary as from walking the paths") {
+				for (uint64_t width : {2, 4, 6, 8, 10, 16}) {
+					map<string, map<uint64_t, algorithms::path_info_t>> walked;
+					algorithms::bin_path_info(graph, "",
+											  [](const uint64_t&, const uint64_t&) {},
+											  [&](const string& name, const vector<pair<uint64_t, uint64_t>>&,
+												  const map<uint64_t, algorithms::path_info_t>& bins) {
+												  walked[name] = bins;
+											  },
+											  [](const uint64_t&, const string&) {},
+											  0, width);
+					for (uint64_t p = 0; p < 3; ++p) {
+						const auto& bins = walked[summary.path_names[p]];
+						uint64_t count = 0;
+						summary.for_each_bin(p, width, [&](const algorithms::bin_summary_entry_t& entry) {
+							// bin_path_info counts bins from 1
+							auto f = bins.find(entry.bin + 1);
+							REQUIRE(f != bins.end());
+							const algorithms::bin_summary_means_t means = entry.means(width, summary.path_lengths[p]);
+							REQUIRE(means.depth == Approx(f->second.mean_depth));
+							REQUIRE(means.inverted == Approx(f->second.mean_inv));
+							REQUIRE(means.position == Approx(f->second.mean_pos));
+							++count;
+						});
+						REQUIRE(count == bins.size());
+					}
+				}
+			}
+
+			SECTION("Bins are restricted to the range asked for") {
+				vector<uint64_t> bins;
+				summary.for_each_bin(1, 4, [&](const algorithms::bin_summary_entry_t& entry) {
+					bins.push_back(entry.bin);
+				}, 5, 9);
+				REQUIRE(bins == vector<uint64_t>{1, 2});
+				bins.clear();
+				summary.for_each_bin(2, 6, [&](const algorithms::bin_summary_entry_t& entry) {
+					bins.push_back(entry.bin);
+				}, 0, 12);
+				REQUIRE(bins == vector<uint64_t>{1});
+				REQUIRE_THROWS_AS(summary.for_each_bin(0, 3, [](const algorithms::bin_summary_entry_t&) {}),
+								  std::runtime_error);
+			}
+
+			SECTION("Scaled bins are exact at multiples of the base width and keep every base elsewhere") {
+				for (uint64_t p = 0; p < 3; ++p) {
+					for (uint64_t width : {2, 4, 6}) {
+						map<uint64_t, vector<double>> whole;
+						summary.for_each_bin(p, width, [&](const algorithms::bin_summary_entry_t& entry) {
+							whole[entry.bin] = {(double)entry.depth, (double)entry.inverted, (double)entry.uncalled};
+						});
+						map<uint64_t, vector<double>> scaled;
+						summary.for_each_scaled_bin(p, width, [&](const uint64_t& bin, const algorithms::bin_summary_stats_t& stats) {
+							scaled[bin] = {stats.depth, stats.inverted, stats.uncalled};
+						});
+						REQUIRE(scaled == whole);
+					}
+					for (double width : {2.5, 3.0, 7.5}) {
+						double depth = 0;
+						double inverted = 0;
+						double uncalled = 0;
+						int64_t last_bin = -1;
+						summary.for_each_scaled_bin(p, width, [&](const uint64_t& bin, const algorithms::bin_summary_stats_t& stats) {
+							REQUIRE((int64_t)bin > last_bin);
+							last_bin = bin;
+							depth += stats.depth;
+							inverted += stats.inverted;
+							uncalled += stats.uncalled;
+						});
+						double expected_inverted = 0;
+						double expected_uncalled = 0;
+						for (auto& entry : summary.levels[0][p]) {
+							expected_inverted += entry.inverted;
+							expected_uncalled += entry.uncalled;
+						}
+						REQUIRE(depth == Approx((double)summary.path_lengths[p]));
+						REQUIRE(inverted == Approx(expected_inverted));
+						REQUIRE(uncalled == Approx(expected_uncalled));
+					}
+				}
+				REQUIRE_THROWS_AS(summary.for_each_scaled_bin(0, 1.5, [](const uint64_t&, const algorithms::bin_summary_stats_t&) {}),
+								  std::runtime_error);
+			}
+		}
+	}
+}
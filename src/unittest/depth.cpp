@@ -0,0 +1,102 @@
+/**
+ * \file
+ * unittest/depth.cpp: test cases for the depth along paths.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/depth.hpp"
+
+#include <map>
+#include <tuple>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+		using namespace algorithms;
+
+		TEST_CASE("Depth runs along paths", "[depth]") {
+
+			graph_t graph;
+			handle_t n1 = graph.create_handle("AAA");
+			handle_t n2 = graph.create_handle("CC");
+			handle_t n3 = graph.create_handle("GGGG");
+			handle_t n4 = graph.create_handle("T");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n2, n3);
+			graph.create_edge(n2, n4);
+
+			path_handle_t a = graph.create_path_handle("a");
+			for (auto& h : {n1, n2, n3}) {
+				graph.append_step(a, h);
+			}
+			path_handle_t b = graph.create_path_handle("b");
+			for (auto& h : {n1, n2, n4}) {
+				graph.append_step(b, h);
+			}
+			path_handle_t c = graph.create_path_handle("c");
+			graph.append_step(c, graph.flip(n3));
+
+			typedef vector<tuple<uint64_t, uint64_t, double>> runs_t;
+			auto get_runs = [&](const vector<bool>& paths_to_consider, const uint64_t& window_size, const uint64_t& nthreads) {
+				map<string, runs_t> runs;
+				map<string, uint64_t> done;
+				algorithms::for_each_path_depth_run(
+					graph, {a, b, c}, paths_to_consider, window_size, nthreads,
+					[&](const path_handle_t& path, const uint64_t& start, const uint64_t& end, const double& depth) {
+#pragma omp critical (runs)
+						runs[graph.get_path_name(path)].push_back(make_tuple(start, end, depth));
+					},
+					[&](const path_handle_t& path) {
+#pragma omp critical (runs)
+						++done[graph.get_path_name(path)];
+					});
+				REQUIRE(done == map<string, uint64_t>{{"a", 1}, {"b", 1}, {"c", 1}});
+				return runs;
+			};
+
+			vector<bool> paths_a_and_b(as_integer(c) + 1, false);
+			paths_a_and_b[as_integer(a)] = true;
+			paths_a_and_b[as_integer(b)] = true;
+
+			SECTION("Nodes of the same depth are merged into one run") {
+				for (uint64_t nthreads : {1, 3}) {
+					auto runs = get_runs({}, 0, nthreads);
+					REQUIRE(runs["a"] == runs_t{{0, 9, 2}});
+					REQUIRE(runs["b"] == runs_t{{0, 5, 2}, {5, 6, 1}});
+					REQUIRE(runs["c"] == runs_t{{0, 4, 2}});
+				}
+			}
+
+			SECTION("Only the steps of the paths to consider count") {
+				for (uint64_t nthreads : {1, 3}) {
+					auto runs = get_runs(paths_a_and_b, 0, nthreads);
+					REQUIRE(runs["a"] == runs_t{{0, 5, 2}, {5, 9, 1}});
+					REQUIRE(runs["b"] == runs_t{{0, 5, 2}, {5, 6, 1}});
+					REQUIRE(runs["c"] == runs_t{{0, 4, 1}});
+				}
+			}
+
+			SECTION("Windows take the mean depth of their bases, and the last one is cut short") {
+				for (uint64_t nthreads : {1, 3}) {
+					auto runs = get_runs(paths_a_and_b, 4, nthreads);
+					REQUIRE(runs["a"] == runs_t{{0, 4, 2}, {4, 8, 1.25}, {8, 9, 1}});
+					REQUIRE(runs["b"] == runs_t{{0, 4, 2}, {4, 6, 1.5}});
+					REQUIRE(runs["c"] == runs_t{{0, 4, 1}});
+				}
+			}
+
+			SECTION("Equal windows are merged") {
+				for (uint64_t nthreads : {1, 3}) {
+					auto runs = get_runs({}, 2, nthreads);
+					REQUIRE(runs["a"] == runs_t{{0, 9, 2}});
+					REQUIRE(runs["b"] == runs_t{{0, 4, 2}, {4, 6, 1.5}});
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,144 @@
+/**
+ * \file
+ * unittest/draw.cpp: test cases for rendering layouts to PNG tiles.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/draw.hpp"
+#include "algorithms/temp_file.hpp"
+#include "lodepng.h"
+
+#include <omp.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+
+		/// the value of an unsigned number field in the tiles.json written by draw_png_tiles
+		static uint64_t tiles_json_field(const string& dir, const string& field) {
+			ifstream in((filesystem::path(dir) / "tiles.json").string());
+			stringstream json;
+			json << in.rdbuf();
+			const string key = "\"" + field + "\": ";
+			const size_t i = json.str().find(key);
+			REQUIRE(i != string::npos);
+			return stoull(json.str().substr(i + key.size()));
+		}
+
+		TEST_CASE("PNG tiles at the deepest zoom level stitch into the rasterized picture", "[draw]") {
+
+			// two components, with lines that cross tiles, overlap, and a node many paths step on
+			graph_t graph;
+			vector<handle_t> handles;
+			for (uint64_t i = 0; i < 8; ++i) {
+				handles.push_back(graph.create_handle(string(1 + i, 'A')));
+			}
+			for (uint64_t i = 0; i + 1 < 4; ++i) {
+				graph.create_edge(handles[i], handles[i + 1]);
+			}
+			for (uint64_t i = 4; i + 1 < 8; ++i) {
+				graph.create_edge(handles[i], handles[i + 1]);
+			}
+			for (uint64_t p = 0; p < 6; ++p) {
+				path_handle_t path = graph.create_path_handle("p" + to_string(p));
+				graph.append_step(path, handles[1]);
+				if (p % 2) {
+					graph.append_step(path, handles[2]);
+				}
+			}
+			path_handle_t q = graph.create_path_handle("q");
+			for (uint64_t i = 4; i < 8; ++i) {
+				graph.append_step(q, handles[i]);
+			}
+
+			// start and end of each node
+			const vector<vector<double>> coordinates = {
+				{0, 0, 62, 14}, {5, 14, 50, 1}, {20, 7, 21, 9}, {60, 2, 30, 13},
+				{10, 5, 40, 18}, {40, 18, 12, 6}, {25, 5, 25, 18}, {11, 12, 39, 11}
+			};
+			vector<double> X(2 * handles.size());
+			vector<double> Y(2 * handles.size());
+			for (uint64_t i = 0; i < handles.size(); ++i) {
+				const uint64_t a = 2 * number_bool_packing::unpack_number(handles[i]);
+				X[a] = coordinates[i][0];
+				Y[a] = coordinates[i][1];
+				X[a + 1] = coordinates[i][2];
+				Y[a + 1] = coordinates[i][3];
+			}
+
+			// pixels are blended in the order the lines are drawn, which rasterize only keeps with a single thread
+			const int max_threads = omp_get_max_threads();
+			omp_set_num_threads(1);
+
+			const uint64_t tile_size = 16;
+			for (bool color_paths : {false, true}) {
+				const double line_width = color_paths ? 0.5 : 3.0;
+				const double path_line_spacing = 0.5;
+				vector<algorithms::color_t> node_id_to_color;
+				const string dir = algorithms::temp_file::create("odgi-draw") + "-tiles";
+				algorithms::draw_png_tiles(dir, X, Y, graph, 1.0, 1.0, tile_size, 10,
+										   line_width, path_line_spacing, color_paths, node_id_to_color, 4, false);
+
+				// the layout is 64 units wide, so the deepest level is 2, with the layout 60 pixels wide
+				REQUIRE(tiles_json_field(dir, "max_zoom") == 2);
+				uint64_t width = tiles_json_field(dir, "width");
+				uint64_t height = tiles_json_field(dir, "height");
+				REQUIRE(width == 64);
+				REQUIRE(height == 33);
+
+				const vector<uint8_t> picture = algorithms::rasterize(X, Y, graph, 1.0, 1.0, width, height,
+																	  line_width, path_line_spacing, color_paths,
+																	  node_id_to_color);
+
+				const uint64_t tiles_x = (width + tile_size - 1) / tile_size;
+				const uint64_t tiles_y = (height + tile_size - 1) / tile_size;
+				uint64_t written = 0;
+				uint64_t drawn = 0;
+				for (uint64_t x = 0; x < tiles_x; ++x) {
+					for (uint64_t y = 0; y < tiles_y; ++y) {
+						const string filename = (filesystem::path(dir) / "2" / to_string(x)
+												 / (to_string(y) + ".png")).string();
+						vector<unsigned char> tile;
+						unsigned w = 0;
+						unsigned h = 0;
+						const bool exists = filesystem::exists(filename);
+						if (exists) {
+							REQUIRE(lodepng::decode(tile, w, h, filename) == 0);
+							REQUIRE(w == tile_size);
+							REQUIRE(h == tile_size);
+							++written;
+						}
+						for (uint64_t row = 0; row < tile_size; ++row) {
+							for (uint64_t col = 0; col < tile_size; ++col) {
+								const uint64_t px = x * tile_size + col;
+								const uint64_t py = y * tile_size + row;
+								for (uint64_t k = 0; k < 4; ++k) {
+									const uint8_t expected = (px < width && py < height)
+										? picture[4 * (py * width + px) + k] : 255;
+									// a missing tile is white
+									const uint8_t got = exists ? tile[4 * (row * tile_size + col) + k] : 255;
+									REQUIRE((int)got == (int)expected);
+								}
+								if (px < width && py < height && picture[4 * (py * width + px)] != 255) {
+									++drawn;
+								}
+							}
+						}
+					}
+				}
+				REQUIRE(written > 1);
+				REQUIRE(drawn > 0);
+				filesystem::remove_all(dir);
+			}
+			omp_set_num_threads(max_threads);
+		}
+	}
+}
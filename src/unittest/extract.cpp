@@ -111,5 +111,91 @@ namespace odgi {
 
         }
 
+        TEST_CASE("Extracting many path ranges at once", "[extracting]") {
+            graph_t graph;
+            graph.create_handle("CAAA");
+            graph.create_handle("AT");
+            graph.create_handle("GCC");
+            graph.create_handle("TA");
+            graph.create_handle("CTT");
+            graph.create_handle("TTGA");
+
+            auto path_x = graph.create_path_handle("x");
+            graph.append_step(path_x, graph.get_handle(1, true));
+            graph.append_step(path_x, graph.get_handle(3, true));
+            graph.append_step(path_x, graph.get_handle(2, true));
+            graph.append_step(path_x, graph.get_handle(5, true));
+            graph.append_step(path_x, graph.get_handle(6, true));
+
+            auto path_y = graph.create_path_handle("y");
+            graph.append_step(path_y, graph.get_handle(1, false));
+            graph.append_step(path_y, graph.get_handle(2, true));
+            graph.append_step(path_y, graph.get_handle(4, false));
+            graph.append_step(path_y, graph.get_handle(5, false));
+            graph.append_step(path_y, graph.get_handle(4, false));
+
+            auto path_z = graph.create_path_handle("z");
+            graph.append_step(path_z, graph.get_handle(1, false));
+            graph.append_step(path_z, graph.get_handle(3, false));
+            graph.append_step(path_z, graph.get_handle(3, true));
+            graph.append_step(path_z, graph.get_handle(6, false));
+
+            std::vector<path_range_t> path_ranges = {
+                    {{path_x, 4, false}, {path_x, 8, false}, false, ".", ""},
+                    {{path_y, 5, false}, {path_y, 12, false}, false, ".", ""},
+                    {{path_x, 5, false}, {path_x, 6, false}, false, ".", ""}
+            };
+            const std::vector<std::vector<handle_t>> range_handles = algorithms::collect_path_ranges(graph, path_ranges, 2);
+
+            SECTION("The ranges are collected and extended to their nodes") {
+                REQUIRE(range_handles.size() == 3);
+                REQUIRE(range_handles[0] == std::vector<handle_t>({graph.get_handle(3, true), graph.get_handle(2, true)}));
+                REQUIRE(path_ranges[0].begin.offset == 4);
+                REQUIRE(path_ranges[0].end.offset == 9);
+                REQUIRE(range_handles[1] == std::vector<handle_t>({graph.get_handle(2, true), graph.get_handle(4),
+                                                                   graph.get_handle(5), graph.get_handle(4)}));
+                REQUIRE(path_ranges[1].begin.offset == 4);
+                REQUIRE(path_ranges[1].end.offset == 13);
+                REQUIRE(range_handles[2] == std::vector<handle_t>({graph.get_handle(3, true)}));
+                REQUIRE(path_ranges[2].begin.offset == 4);
+                REQUIRE(path_ranges[2].end.offset == 7);
+            }
+
+            SECTION("The runs of the other paths are found for all subgraphs in one walk") {
+                const std::vector<path_handle_t> paths = {path_x, path_y, path_z};
+                const auto runs = algorithms::find_subpath_runs(graph, paths, {{2, 3}, {3}}, {path_x, as_path_handle(0)}, 2);
+                REQUIRE(runs.size() == 2);
+
+                REQUIRE(runs[0].size() == 2);
+                REQUIRE(runs[0][0].path == path_y);
+                REQUIRE(runs[0][0].start == 4);
+                REQUIRE(runs[0][0].end == 6);
+                REQUIRE(runs[0][0].step_count == 1);
+                REQUIRE(runs[0][1].path == path_z);
+                REQUIRE(runs[0][1].start == 4);
+                REQUIRE(runs[0][1].end == 10);
+                REQUIRE(runs[0][1].step_count == 2);
+
+                REQUIRE(runs[1].size() == 2);
+                REQUIRE(runs[1][0].path == path_x);
+                REQUIRE(runs[1][0].start == 4);
+                REQUIRE(runs[1][0].end == 7);
+                REQUIRE(runs[1][1].path == path_z);
+                REQUIRE(runs[1][1].step_count == 2);
+
+                graph_t subgraph;
+                subgraph.create_handle("AT", 2);
+                subgraph.create_handle("GCC", 3);
+                algorithms::add_subpath_runs_to_subgraph(graph, runs[0], subgraph);
+                REQUIRE(subgraph.has_path("y:4-6"));
+                REQUIRE(subgraph.has_path("z:4-10"));
+                std::string z;
+                subgraph.for_each_step_in_path(subgraph.get_path_handle("z:4-10"), [&](const step_handle_t& step) {
+                    z.append(subgraph.get_sequence(subgraph.get_handle_of_step(step)));
+                });
+                REQUIRE(z == "GCCGGC");
+            }
+        }
+
     }
 }
@@ -0,0 +1,298 @@
+/**
+ * \file
+ * unittest/gfa.cpp: test cases for building graphs from GFA.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "gfa_to_handle.hpp"
+#include "gfa_to_og.hpp"
+#include "algorithms/temp_file.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <set>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+
+		/// write the given GFA to a temporary file and return its name
+		static string write_gfa(const string& gfa) {
+			string filename = algorithms::temp_file::create("odgi-gfa");
+			ofstream out(filename, std::ios::binary);
+			out << gfa;
+			return filename;
+		}
+
+		/// the nodes, edges and paths of a graph in an order that does not depend on how it was stored
+		static string describe(const graph_t& graph) {
+			stringstream out;
+			set<string> edges;
+			graph.for_each_handle([&](const handle_t& h) {
+				out << "S\t" << graph.get_id(h) << "\t" << graph.get_sequence(h) << "\n";
+				for (bool go_left : {false, true}) {
+					graph.follow_edges(h, go_left, [&](const handle_t& o) {
+						edge_t e = go_left ? graph.edge_handle(o, h) : graph.edge_handle(h, o);
+						edges.insert(to_string(graph.get_id(e.first)) + (graph.get_is_reverse(e.first) ? "-" : "+")
+									 + "\t" + to_string(graph.get_id(e.second)) + (graph.get_is_reverse(e.second) ? "-" : "+"));
+					});
+				}
+			});
+			for (auto& e : edges) {
+				out << "L\t" << e << "\n";
+			}
+			graph.for_each_path_handle([&](const path_handle_t& p) {
+				out << "P\t" << graph.get_path_name(p) << "\t";
+				graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+					const handle_t h = graph.get_handle_of_step(s);
+					out << graph.get_id(h) << (graph.get_is_reverse(h) ? "-" : "+") << ",";
+				});
+				out << "\n";
+				// walking back checks the links to the previous steps
+				out << "back\t";
+				if (!graph.is_empty(p)) {
+					step_handle_t s = graph.path_back(p);
+					while (true) {
+						out << graph.get_id(graph.get_handle_of_step(s)) << ",";
+						if (!graph.has_previous_step(s)) break;
+						s = graph.get_previous_step(s);
+					}
+				}
+				out << "\n";
+			});
+			// the steps each node knows about
+			graph.for_each_handle([&](const handle_t& h) {
+				multiset<string> steps;
+				graph.for_each_step_on_handle(h, [&](const step_handle_t& s) {
+					steps.insert(graph.get_path_name(graph.get_path_handle_of_step(s))
+								 + (graph.get_is_reverse(graph.get_handle_of_step(s)) ? "-" : "+"));
+				});
+				out << "steps\t" << graph.get_id(h);
+				for (auto& step : steps) {
+					out << "\t" << step;
+				}
+				out << "\n";
+			});
+			out << "counts\t" << graph.get_node_count() << "\t" << graph.get_edge_count() << "\t" << graph.get_path_count() << "\n";
+			return out.str();
+		}
+
+		TEST_CASE("GFA with P and W lines and non-compact ids round trips", "[gfa]") {
+
+			const string gfa =
+				"H\tVN:Z:1.0\n"
+				"S\t5\tCAAA\n"
+				"S\t7\tG\n"
+				"S\t10\tTTA\r\n"
+				"S\t11\tC\tLN:i:1\n"
+				"L\t5\t+\t7\t+\t0M\n"
+				"L\t5\t+\t10\t-\t0M\n"
+				"L\t7\t+\t10\t+\t0M\n"
+				"L\t10\t+\t11\t+\t0M\n"
+				"P\tx\t5+,7+,10+,11+\t*\n"
+				"P\ty\t11-,10-,7-\t*\n"
+				"W\tsample\t1\tchr1\t0\t8\t>5<10\n"
+				"W\tHG\t2\tctg\t*\t*\t>7>10>11\n";
+
+			graph_t expected;
+			handle_t n5 = expected.create_handle("CAAA", 5);
+			handle_t n7 = expected.create_handle("G", 7);
+			handle_t n10 = expected.create_handle("TTA", 10);
+			handle_t n11 = expected.create_handle("C", 11);
+			expected.create_edge(n5, n7);
+			expected.create_edge(n5, expected.flip(n10));
+			expected.create_edge(n7, n10);
+			expected.create_edge(n10, n11);
+			path_handle_t x = expected.create_path_handle("x");
+			for (auto& h : {n5, n7, n10, n11}) expected.append_step(x, h);
+			path_handle_t y = expected.create_path_handle("y");
+			for (auto& h : {n11, n10, n7}) expected.append_step(y, expected.flip(h));
+			path_handle_t w1 = expected.create_path_handle("sample#1#chr1:0-8");
+			expected.append_step(w1, n5);
+			expected.append_step(w1, expected.flip(n10));
+			path_handle_t w2 = expected.create_path_handle("HG#2#ctg");
+			for (auto& h : {n7, n10, n11}) expected.append_step(w2, h);
+
+			const string filename = write_gfa(gfa);
+
+			SECTION("Ids are kept as they are, with any number of threads") {
+				for (uint64_t threads : {1, 3, 8}) {
+					graph_t graph;
+					gfa_to_handle(filename, &graph, false, threads, false);
+					REQUIRE(graph.get_node_count() == 4);
+					REQUIRE(!graph.has_node(6));
+					REQUIRE(describe(graph) == describe(expected));
+				}
+			}
+
+			SECTION("Writing the graph out as GFA and reading it back gives the same graph") {
+				graph_t graph;
+				gfa_to_handle(filename, &graph, false, 2, false);
+				stringstream written;
+				graph.to_gfa(written);
+				graph_t reread;
+				gfa_to_handle(write_gfa(written.str()), &reread, false, 2, false);
+				REQUIRE(describe(reread) == describe(graph));
+			}
+
+			SECTION("Compacted ids keep the order of the nodes") {
+				graph_t graph;
+				gfa_to_handle(filename, &graph, true, 2, false);
+				REQUIRE(graph.get_node_count() == 4);
+				REQUIRE(graph.get_sequence(graph.get_handle(1)) == "CAAA");
+				REQUIRE(graph.get_sequence(graph.get_handle(2)) == "G");
+				REQUIRE(graph.get_sequence(graph.get_handle(3)) == "TTA");
+				REQUIRE(graph.get_sequence(graph.get_handle(4)) == "C");
+				REQUIRE(graph.get_path_count() == 4);
+				REQUIRE(graph.get_step_count(graph.get_path_handle("HG#2#ctg")) == 3);
+			}
+		}
+
+		TEST_CASE("GFA spread over many chunks is parsed like a small one", "[gfa]") {
+
+			graph_t expected;
+			stringstream gfa;
+			vector<handle_t> handles;
+			for (uint64_t i = 0; i < 2000; ++i) {
+				const uint64_t id = 3 * i + 2;
+				const string seq(1 + i % 7, "ACGT"[i % 4]);
+				gfa << "S\t" << id << "\t" << seq << "\n";
+				handles.push_back(expected.create_handle(seq, id));
+			}
+			for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+				gfa << "L\t" << expected.get_id(handles[i]) << "\t+\t" << expected.get_id(handles[i + 1]) << "\t+\t0M\n";
+				expected.create_edge(handles[i], handles[i + 1]);
+			}
+			path_handle_t p = expected.create_path_handle("p");
+			gfa << "P\tp\t";
+			for (uint64_t i = 0; i < handles.size(); ++i) {
+				gfa << expected.get_id(handles[i]) << "+" << (i + 1 < handles.size() ? "," : "\t*\n");
+				expected.append_step(p, handles[i]);
+			}
+			path_handle_t w = expected.create_path_handle("s#0#c");
+			gfa << "W\ts\t0\tc\t*\t*\t";
+			for (uint64_t i = handles.size(); i-- > 0; ) {
+				gfa << "<" << expected.get_id(handles[i]);
+				expected.append_step(w, expected.flip(handles[i]));
+			}
+			gfa << "\n";
+
+			graph_t graph;
+			gfa_to_handle(write_gfa(gfa.str()), &graph, false, 8, false);
+			REQUIRE(describe(graph) == describe(expected));
+		}
+
+		TEST_CASE("GFA with a segment id on more than one S line is rejected", "[gfa]") {
+			const string gfa =
+				"S\t1\tA\n"
+				"S\t2\tC\n"
+				"S\t1\tG\n"
+				"L\t1\t+\t2\t+\t0M\n"
+				"P\tx\t1+,2+\t*\n";
+			for (uint64_t threads : {1, 4}) {
+				graph_t graph;
+				REQUIRE_THROWS_AS(gfa_to_handle(write_gfa(gfa), &graph, false, threads, false), std::runtime_error);
+			}
+		}
+
+		TEST_CASE("Steps of P and W lines are parsed up to the first that can't be", "[gfa]") {
+			auto steps_of = [](const string& line, vector<pair<uint64_t, bool>>& steps) {
+				steps.clear();
+				return for_each_gfa_path_step(line.data(), line.data() + line.size(), [&](const uint64_t& id, const bool& is_rev) {
+					steps.push_back(make_pair(id, is_rev));
+				});
+			};
+			vector<pair<uint64_t, bool>> steps;
+			REQUIRE(steps_of("P\tx\t1+,20-,3+\t*", steps));
+			REQUIRE(steps == vector<pair<uint64_t, bool>>{{1, false}, {20, true}, {3, false}});
+			REQUIRE(steps_of("W\ts\t1\tc\t0\t5\t>1<20>3", steps));
+			REQUIRE(steps == vector<pair<uint64_t, bool>>{{1, false}, {20, true}, {3, false}});
+			REQUIRE(!steps_of("P\tx\t1+,2,3+\t*", steps));
+			REQUIRE(steps == vector<pair<uint64_t, bool>>{{1, false}});
+			REQUIRE(!steps_of("P\tx\t1+,a+\t*", steps));
+			REQUIRE(!steps_of("W\ts\t1\tc\t0\t5\t>1+2", steps));
+			REQUIRE(!steps_of("W\ts\t1\tc\t0\t5\t>1<", steps));
+		}
+
+		TEST_CASE("Of the problems recorded on several threads, the one on the earliest line is kept", "[gfa]") {
+			const string gfa = "S\t1\tA\nL\t1\t+\t7\t+\t0M\nL\t8\t+\t1\t+\t0M\n";
+			const char* second = gfa.data() + gfa.find('L');
+			const char* third = gfa.data() + gfa.rfind('L');
+			gfa_parse_errors_t errors;
+			REQUIRE(!errors.any());
+#pragma omp parallel for num_threads(4)
+			for (uint64_t i = 0; i < 64; ++i) {
+				if (i % 2) {
+					errors.record(third, third + 5, "third");
+				} else if (i == 32) {
+					errors.record(second, second + 5, "second");
+				}
+			}
+			REQUIRE(errors.any());
+			REQUIRE(errors.line() == second);
+			REQUIRE(errors.problem() == "second");
+		}
+	
+
+		TEST_CASE("The external memory build writes the graph that gfa_to_handle builds", "[gfa]") {
+
+			stringstream gfa;
+			gfa << "H\tVN:Z:1.0\n";
+			// ids with gaps, edges in both orientations, self loops, and paths that revisit nodes
+			const uint64_t n = 500;
+			for (uint64_t i = 0; i < n; ++i) {
+				gfa << "S\t" << 2 * i + 3 << "\t" << string(1 + i % 5, "ACGT"[i % 4]) << "\n";
+			}
+			for (uint64_t i = 0; i + 1 < n; ++i) {
+				gfa << "L\t" << 2 * i + 3 << "\t+\t" << 2 * i + 5 << "\t+\t0M\n";
+				if (i % 7 == 0) {
+					gfa << "L\t" << 2 * i + 5 << "\t-\t" << 2 * i + 3 << "\t+\t0M\n";
+				}
+				if (i % 11 == 0) {
+					gfa << "L\t" << 2 * i + 3 << "\t+\t" << 2 * i + 3 << "\t+\t0M\n";
+				}
+			}
+			gfa << "P\tforward\t";
+			for (uint64_t i = 0; i < n; ++i) {
+				gfa << 2 * i + 3 << "+" << (i + 1 < n ? "," : "\t*\n");
+			}
+			gfa << "P\tloops\t";
+			for (uint64_t i = 0; i < n; i += 11) {
+				gfa << 2 * i + 3 << "+," << 2 * i + 3 << "+" << (i + 11 < n ? "," : "\t*\n");
+			}
+			gfa << "W\tsample\t1\tchr\t0\t100\t";
+			for (uint64_t i = 0; i < n; i += 7) {
+				gfa << ">" << 2 * i + 3 << "<" << 2 * i + 5;
+			}
+			gfa << "\n";
+			const string gfa_filename = write_gfa(gfa.str());
+
+			for (bool compact_ids : {false, true}) {
+				for (uint64_t threads : {1, 4}) {
+					graph_t built;
+					gfa_to_handle(gfa_filename, &built, compact_ids, threads, false);
+					stringstream serialized;
+					built.serialize(serialized);
+					graph_t expected;
+					expected.deserialize(serialized);
+
+					// a tiny memory budget writes many small node blocks
+					for (uint64_t memory_budget : {(uint64_t)64, (uint64_t)1 << 30}) {
+						const string og_filename = algorithms::temp_file::create("odgi-gfa-og");
+						gfa_to_og(gfa_filename, og_filename, compact_ids, threads, memory_budget, false);
+						graph_t written;
+						written.deserialize(og_filename);
+						REQUIRE(describe(written) == describe(expected));
+						REQUIRE(written.min_node_id() == expected.min_node_id());
+						REQUIRE(written.max_node_id() == expected.max_node_id());
+					}
+				}
+			}
+		}
+	}
+}
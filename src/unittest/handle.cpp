@@ -16,6 +16,9 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <random>
+#include <sstream>
+#include <fstream>
+#include "algorithms/temp_file.hpp"
 
 namespace odgi {
 namespace unittest {
@@ -2301,5 +2304,425 @@ TEST_CASE("Deletable handle graphs with mutable paths work", "[handle][packed][h
     
 }
 
+TEST_CASE("Graphs survive a serialization round trip through the block format", "[handle][serialize]") {
+
+    graph_t graph;
+    graph.set_number_of_threads(3);
+    vector<handle_t> handles;
+    for (uint64_t i = 0; i < 100; ++i) {
+        handles.push_back(graph.create_handle(string(1 + i % 5, "ACGT"[i % 4])));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    graph.create_edge(handles[10], graph.flip(handles[20]));
+    path_handle_t p1 = graph.create_path_handle("1");
+    for (uint64_t i = 0; i < 40; ++i) {
+        graph.append_step(p1, handles[i]);
+    }
+    path_handle_t p2 = graph.create_path_handle("2", true);
+    for (uint64_t i = 99; i > 60; --i) {
+        graph.append_step(p2, graph.flip(handles[i]));
+    }
+    // leave a hole in the node vector, which is stored as an empty record
+    graph.destroy_handle(handles[50]);
+
+    stringstream out;
+    graph.serialize(out);
+
+    graph_t loaded;
+    loaded.set_number_of_threads(2);
+    loaded.deserialize(out);
+
+    REQUIRE(loaded.get_node_count() == graph.get_node_count());
+    REQUIRE(loaded.get_path_count() == graph.get_path_count());
+    REQUIRE(!loaded.has_node(graph.get_id(handles[50])));
+    REQUIRE(loaded.get_is_circular(loaded.get_path_handle("2")));
+
+    stringstream expected, observed;
+    graph.to_gfa(expected);
+    loaded.to_gfa(observed);
+    REQUIRE(observed.str() == expected.str());
+}
+
+TEST_CASE("Node records are laid out in rank order after optimize", "[handle][optimize]") {
+
+    graph_t graph;
+    graph.set_number_of_threads(2);
+    vector<handle_t> handles;
+    for (uint64_t i = 0; i < 50; ++i) {
+        handles.push_back(graph.create_handle(string(1 + i % 3, "ACGT"[i % 4])));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    path_handle_t p = graph.create_path_handle("p");
+    for (uint64_t i = 0; i < handles.size(); i += 2) {
+        graph.append_step(p, handles[i]);
+    }
+    // free some slots and recycle one of them
+    for (uint64_t i = 1; i < handles.size(); i += 10) {
+        graph.destroy_handle(handles[i]);
+    }
+    handle_t recycled = graph.create_handle("GATTACA");
+    graph.create_edge(handles[0], recycled);
+
+    stringstream before;
+    graph.for_each_handle([&](const handle_t& h) {
+        before << graph.get_sequence(h) << graph.get_degree(h, false) << graph.get_degree(h, true) << graph.get_step_count(h) << ";";
+    });
+
+    graph.optimize();
+
+    stringstream after;
+    const node_t* prev = nullptr;
+    bool contiguous = true;
+    graph.for_each_handle([&](const handle_t& h) {
+        const node_t* node = &graph.get_node_ref(h);
+        contiguous &= (prev == nullptr || node == prev + 1);
+        prev = node;
+        after << graph.get_sequence(h) << graph.get_degree(h, false) << graph.get_degree(h, true) << graph.get_step_count(h) << ";";
+    });
+    REQUIRE(contiguous);
+    REQUIRE(graph.get_node_count() == 46);
+    REQUIRE(graph.get_step_count(p) == 25);
+    REQUIRE(after.str() == before.str());
+}
+
+TEST_CASE("Packed node sequences keep every base in both orientations", "[handle][sequence]") {
+
+    graph_t graph;
+    const string seq = "ACGTNNNNacgtRYACGTACGTACGTACGTACGTACGTACGT-ACGT";
+    const string rev = reverse_complement(seq);
+    handle_t h = graph.create_handle(seq);
+
+    REQUIRE(graph.get_length(h) == seq.size());
+    REQUIRE(graph.get_sequence(h) == seq);
+    REQUIRE(graph.get_sequence(graph.flip(h)) == rev);
+    REQUIRE(graph.get_subsequence(h, 3, 6) == seq.substr(3, 6));
+    REQUIRE(graph.get_subsequence(graph.flip(h), 2, 40) == rev.substr(2, 40));
+    REQUIRE(graph.get_subsequence(graph.flip(h), 40, 100) == rev.substr(40));
+    for (size_t i = 0; i < seq.size(); ++i) {
+        REQUIRE(graph.get_base(h, i) == seq[i]);
+        REQUIRE(graph.get_base(graph.flip(h), i) == rev[i]);
+    }
+
+    vector<uint64_t> counts(256);
+    graph.count_bases(h, counts.data());
+    REQUIRE(counts['A'] == 9);
+    REQUIRE(counts['N'] == 4);
+    REQUIRE(counts['a'] == 1);
+    REQUIRE(counts['-'] == 1);
+
+    h = graph.apply_orientation(graph.flip(h));
+    REQUIRE(graph.get_sequence(graph.forward(h)) == rev);
+}
+
+TEST_CASE("Soft masked node sequences keep their case in both orientations", "[handle][sequence]") {
+
+    graph_t graph;
+    // lowercase runs over several words, with lowercase and uppercase exceptions inside and next to them
+    string seq;
+    for (size_t i = 0; i < 300; ++i) {
+        const char base = "ACGT"[(i * 5 + i / 7) % 4];
+        seq.push_back((i / 40) % 2 ? base + ('a' - 'A') : base);
+    }
+    seq.replace(45, 6, "nnnnnn");
+    seq.replace(78, 4, "NNry");
+    seq.replace(120, 3, "acE");
+    seq += "acgtacgtNNNNacgt";
+    const string rev = reverse_complement(seq);
+    handle_t h = graph.create_handle(seq);
+
+    REQUIRE(graph.get_sequence(h) == seq);
+    REQUIRE(graph.get_sequence(graph.flip(h)) == rev);
+    for (size_t pos : {0, 1, 39, 40, 44, 50, 77, 81, 119, 200, 299}) {
+        for (size_t len : {1, 2, 31, 32, 33, 100}) {
+            REQUIRE(graph.get_subsequence(h, pos, len) == seq.substr(pos, len));
+            REQUIRE(graph.get_subsequence(graph.flip(h), pos, len) == rev.substr(pos, len));
+        }
+    }
+
+    vector<uint64_t> counts(256);
+    graph.count_bases(h, counts.data());
+    vector<uint64_t> expected(256);
+    for (auto& c : seq) {
+        ++expected[(uint8_t)c];
+    }
+    REQUIRE(counts == expected);
+
+    h = graph.apply_orientation(graph.flip(h));
+    REQUIRE(graph.get_sequence(graph.forward(h)) == rev);
+    REQUIRE(graph.get_sequence(graph.flip(graph.forward(h))) == seq);
+}
+
+TEST_CASE("Lowercase bases are packed like uppercase ones, with their case kept in runs", "[handle][sequence]") {
+
+    packed_sequence_t packed;
+    packed.assign(string(500, 'a') + string(500, 'c') + string(24, 'G'));
+    REQUIRE(packed.exception_count() == 0);
+    REQUIRE(packed.lowercase_count() == 1);
+    // 32 words of two bit bases and one lowercase run, where each base used to take a run of its own
+    REQUIRE(packed.heap_bytes() == (32 + 2) * sizeof(uint64_t));
+
+    packed.assign("acgtnnnnacgtNNNNACGT");
+    REQUIRE(packed.exception_count() == 2);
+    REQUIRE(packed.lowercase_count() == 1);
+    REQUIRE(packed.str() == "acgtnnnnacgtNNNNACGT");
+    REQUIRE(packed.reverse_complement(0, packed.size()) == "ACGTNNNNacgtnnnnacgt");
+}
+
+TEST_CASE("Node sequences can be read into caller buffers in either orientation", "[handle][sequence]") {
+
+    graph_t graph;
+    string seq;
+    for (size_t i = 0; i < 1000; ++i) {
+        seq.push_back("ACGTN"[(i * 7 + i / 13) % 5]);
+    }
+    const string rev = reverse_complement(seq);
+    handle_t h = graph.create_handle(seq);
+
+    for (auto handle : { h, graph.flip(h) }) {
+        const string& expected = graph.get_is_reverse(handle) ? rev : seq;
+
+        string buffer = "stale";
+        graph.get_sequence(handle, buffer);
+        REQUIRE(buffer == expected);
+
+        char out[64];
+        REQUIRE(graph.get_subsequence(handle, 100, 64, out) == 64);
+        REQUIRE(string(out, 64) == expected.substr(100, 64));
+        REQUIRE(graph.get_subsequence(handle, 980, 64, out) == 20);
+        REQUIRE(string(out, 20) == expected.substr(980));
+        REQUIRE(graph.get_subsequence(handle, 2000, 64, out) == 0);
+
+        buffer = "xy";
+        REQUIRE(graph.append_subsequence(handle, 990, 64, buffer) == 10);
+        REQUIRE(buffer == "xy" + expected.substr(990));
+
+        string walked;
+        REQUIRE(graph.for_each_base(handle, [&](const char& c) {
+                    walked.push_back(c);
+                    return true;
+                }));
+        REQUIRE(walked == expected);
+
+        walked.clear();
+        REQUIRE(!graph.for_each_base(handle, [&](const char& c) {
+                    walked.push_back(c);
+                    return walked.size() < 300;
+                }));
+        REQUIRE(walked == expected.substr(0, 300));
+    }
+}
+
+TEST_CASE("Bulk path appends match appending one step at a time", "[handle][path]") {
+
+    graph_t one, bulk;
+    for (size_t i = 0; i < 20; ++i) {
+        one.create_handle("ACGT");
+        bulk.create_handle("ACGT");
+    }
+    vector<handle_t> steps;
+    for (size_t i = 0; i < 300; ++i) {
+        // revisit nodes in both orientations, including adjacent repeats
+        steps.push_back(one.get_handle(1 + (i * 7) % 20 / (i % 3 ? 1 : 2), i % 5 == 0));
+    }
+
+    path_handle_t p = one.create_path_handle("p");
+    for (auto& h : steps) {
+        one.append_step(p, h);
+    }
+    path_handle_t q = bulk.create_path_from_handles("p", vector<handle_t>(steps.begin(), steps.begin() + 100));
+    bulk.append_steps(q, {});
+    bulk.append_steps(q, vector<handle_t>(steps.begin() + 100, steps.end()));
+
+    REQUIRE(bulk.get_step_count(q) == steps.size());
+    vector<handle_t> walked;
+    bulk.for_each_step_in_path(q, [&](const step_handle_t& s) {
+        walked.push_back(bulk.get_handle_of_step(s));
+    });
+    REQUIRE(walked == steps);
+    walked.clear();
+    for (step_handle_t s = bulk.path_back(q); ; s = bulk.get_previous_step(s)) {
+        walked.push_back(bulk.get_handle_of_step(s));
+        if (!bulk.has_previous_step(s)) break;
+    }
+    reverse(walked.begin(), walked.end());
+    REQUIRE(walked == steps);
+
+    stringstream a, b;
+    one.serialize(a);
+    bulk.serialize(b);
+    REQUIRE(a.str() == b.str());
+}
+
+TEST_CASE("Path step arrays follow the path through mutations", "[handle][path]") {
+
+    graph_t graph;
+    graph.set_path_step_arrays(true);
+    vector<handle_t> handles;
+    for (uint64_t i = 0; i < 10; ++i) {
+        handles.push_back(graph.create_handle(string(1 + i % 4, "ACGT"[i % 4])));
+    }
+    path_handle_t p = graph.create_path_handle("p");
+
+    auto check_path = [&](void) {
+        // compare against a walk of the linked steps
+        vector<step_handle_t> linked;
+        if (!graph.is_empty(p)) {
+            for (step_handle_t s = graph.path_begin(p); ; s = graph.get_next_step(s)) {
+                linked.push_back(s);
+                if (s == graph.path_back(p)) break;
+            }
+        }
+        vector<step_handle_t> walked;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+            walked.push_back(s);
+        });
+        REQUIRE(walked == linked);
+        auto step_array = graph.get_path_step_array(p);
+        REQUIRE(step_array->steps == linked);
+        uint64_t offset = 0;
+        for (uint64_t i = 0; i < linked.size(); ++i) {
+            REQUIRE(step_array->offsets[i] == offset);
+            REQUIRE(graph.get_step_at_index(p, i) == linked[i]);
+            uint64_t length = graph.get_length(graph.get_handle_of_step(linked[i]));
+            REQUIRE(graph.get_step_at_position(p, offset) == linked[i]);
+            REQUIRE(graph.get_step_at_position(p, offset + length - 1) == linked[i]);
+            offset += length;
+        }
+        REQUIRE(step_array->offsets.back() == offset);
+        REQUIRE(graph.get_step_at_position(p, offset) == graph.path_end(p));
+    };
+
+    check_path();
+    for (auto& h : handles) {
+        graph.append_step(p, h);
+    }
+    check_path();
+    graph.prepend_step(p, graph.flip(handles[2]));
+    check_path();
+    graph.append_steps(p, { handles[1], handles[1] });
+    check_path();
+    graph.divide_handle(handles[3], { 1 });
+    check_path();
+    graph.set_handle_sequence(handles[0], "ACGTACGT");
+    check_path();
+    graph.set_step(graph.get_step_at_index(p, 4), handles[7]);
+    check_path();
+    graph.optimize();
+    check_path();
+}
+
+TEST_CASE("Paths built in parallel through the node step buffers", "[handle][path]") {
+
+    graph_t graph;
+    graph.set_number_of_threads(4);
+    for (uint64_t i = 0; i < 10; ++i) {
+        graph.create_handle("ACGT");
+    }
+    // a step that is already in place before the buffered ones
+    path_handle_t before = graph.create_path_handle("before");
+    graph.append_step(before, graph.get_handle(3));
+
+    std::mt19937 rng(7);
+    vector<vector<handle_t>> walks(32);
+    vector<path_handle_t> paths;
+    for (uint64_t i = 0; i < walks.size(); ++i) {
+        for (uint64_t j = 0; j < 500; ++j) {
+            walks[i].push_back(graph.get_handle(1 + rng() % 10, rng() % 2));
+        }
+        paths.push_back(graph.create_path_handle("p" + std::to_string(i)));
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(4)
+    for (uint64_t i = 0; i < walks.size(); ++i) {
+        graph.append_steps_buffered(paths[i], walks[i]);
+    }
+    graph.merge_step_buffers();
+
+    REQUIRE(graph.get_step_count(before) == 1);
+    for (uint64_t i = 0; i < walks.size(); ++i) {
+        REQUIRE(graph.get_step_count(paths[i]) == walks[i].size());
+        vector<handle_t> walked;
+        graph.for_each_step_in_path(paths[i], [&](const step_handle_t& s) {
+            walked.push_back(graph.get_handle_of_step(s));
+        });
+        REQUIRE(walked == walks[i]);
+        walked.clear();
+        for (step_handle_t s = graph.path_back(paths[i]); ; s = graph.get_previous_step(s)) {
+            walked.push_back(graph.get_handle_of_step(s));
+            if (!graph.has_previous_step(s)) break;
+        }
+        std::reverse(walked.begin(), walked.end());
+        REQUIRE(walked == walks[i]);
+    }
+}
+
+TEST_CASE("Truncated or corrupt serialized graphs fail to load", "[handle][serialize]") {
+
+    graph_t graph;
+    vector<handle_t> handles;
+    for (uint64_t i = 0; i < 50; ++i) {
+        handles.push_back(graph.create_handle(string(1 + i % 3, "ACGT"[i % 4])));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    path_handle_t p = graph.create_path_handle("p");
+    for (auto& h : handles) {
+        graph.append_step(p, h);
+    }
+    stringstream out;
+    graph.serialize(out);
+    const string bytes = out.str();
+    // magic number, then 7 words of graph members, then the first block's record count and size
+    const uint64_t block_header = sizeof(uint32_t) + 7 * sizeof(uint64_t);
+
+    auto write_file = [](const string& content) {
+        string filename = algorithms::temp_file::create("odgi-serialize");
+        ofstream f(filename, std::ios::binary);
+        f.write(content.data(), content.size());
+        return filename;
+    };
+
+    SECTION("A file cut inside the node blocks throws, whether streamed or mapped") {
+        for (uint64_t size : {block_header + 4, block_header + 40, bytes.size() / 2}) {
+            const string cut = bytes.substr(0, size);
+            stringstream in(cut);
+            graph_t streamed;
+            REQUIRE_THROWS(streamed.deserialize(in));
+            graph_t mapped;
+            REQUIRE_THROWS(mapped.deserialize(write_file(cut)));
+        }
+    }
+
+    SECTION("A block size beyond the end of the file throws") {
+        string corrupt = bytes;
+        const uint64_t huge = std::numeric_limits<uint64_t>::max() / 2;
+        corrupt.replace(block_header + sizeof(uint64_t), sizeof(uint64_t), (const char*)&huge, sizeof(uint64_t));
+        stringstream in(corrupt);
+        graph_t streamed;
+        REQUIRE_THROWS(streamed.deserialize(in));
+        graph_t mapped;
+        REQUIRE_THROWS(mapped.deserialize(write_file(corrupt)));
+    }
+
+    SECTION("A record offset beyond the block throws") {
+        string corrupt = bytes;
+        const uint64_t huge = std::numeric_limits<uint64_t>::max() / 2;
+        corrupt.replace(block_header + 3 * sizeof(uint64_t), sizeof(uint64_t), (const char*)&huge, sizeof(uint64_t));
+        graph_t mapped;
+        REQUIRE_THROWS(mapped.deserialize(write_file(corrupt)));
+    }
+
+    SECTION("The intact file still loads from a mapping") {
+        graph_t mapped;
+        mapped.deserialize(write_file(bytes));
+        REQUIRE(mapped.get_node_count() == graph.get_node_count());
+        REQUIRE(mapped.get_step_count(mapped.get_path_handle("p")) == handles.size());
+    }
+}
+
 }
 }
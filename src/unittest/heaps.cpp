@@ -0,0 +1,164 @@
+/**
+ * \file
+ * unittest/heaps.cpp: test cases for the pangenome growth curves of odgi heaps.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/heaps.hpp"
+
+#include <algorithm>
+#include <set>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+
+		/// the curve of a permutation, found by walking the paths of its groups as odgi heaps used to
+		static vector<uint64_t> walked_curve(const graph_t& graph,
+											 const vector<vector<path_handle_t>>& path_groups,
+											 const vector<uint64_t>& permutation,
+											 const uint64_t& min_node_depth) {
+			set<nid_t> seen;
+			uint64_t seen_bp = 0;
+			vector<uint64_t> vals;
+			for (auto& j : permutation) {
+				for (auto& path : path_groups[j]) {
+					graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+						const handle_t h = graph.get_handle_of_step(step);
+						if ((min_node_depth == 0 || graph.get_step_count(h) >= min_node_depth)
+							&& seen.insert(graph.get_id(h)).second) {
+							seen_bp += graph.get_length(h);
+						}
+					});
+				}
+				vals.push_back(seen_bp);
+			}
+			return vals;
+		}
+
+		TEST_CASE("Heaps curves are those of walking the paths of the permuted groups", "[heaps]") {
+
+			graph_t graph;
+			handle_t n1 = graph.create_handle("A");
+			handle_t n2 = graph.create_handle("CC");
+			handle_t n3 = graph.create_handle("GGGG");
+			handle_t n4 = graph.create_handle("TTTTTTTT");
+			handle_t n5 = graph.create_handle("ACGTACGTACGTACGT");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n2, n3);
+			graph.create_edge(n3, n2);
+			graph.create_edge(n5, n1);
+
+			path_handle_t p1 = graph.create_path_handle("p1");
+			for (auto& h : {n1, n2}) {
+				graph.append_step(p1, h);
+			}
+			path_handle_t p2 = graph.create_path_handle("p2");
+			for (auto& h : {n2, n3, n2}) {
+				graph.append_step(p2, h);
+			}
+			path_handle_t p3 = graph.create_path_handle("p3");
+			graph.append_step(p3, n4);
+			path_handle_t p4 = graph.create_path_handle("p4");
+			for (auto& h : {n5, n1}) {
+				graph.append_step(p4, h);
+			}
+
+			// p3 is in the first two groups, and counts in both
+			const vector<vector<path_handle_t>> path_groups = {{p1, p3}, {p2, p3}, {p4}};
+			const ska::flat_hash_map<path_handle_t, vector<interval_t>> no_intervals;
+
+			for (uint64_t min_node_depth : {0, 2}) {
+				// the curves of all permutations of the three groups, which all differ when every node counts
+				set<vector<uint64_t>> expected;
+				vector<uint64_t> permutation = {0, 1, 2};
+				do {
+					expected.insert(walked_curve(graph, path_groups, permutation, min_node_depth));
+				} while (next_permutation(permutation.begin(), permutation.end()));
+				REQUIRE(expected.size() == (min_node_depth ? 3 : 6));
+
+				for (uint64_t nthreads : {1, 3}) {
+					set<vector<uint64_t>> curves;
+					uint64_t count = 0;
+					algorithms::for_each_heap_permutation(
+						graph, path_groups, no_intervals, 30, min_node_depth, nthreads,
+						[&](const vector<uint64_t>& vals, uint64_t) {
+#pragma omp critical (curves)
+							{
+								curves.insert(vals);
+								++count;
+							}
+						});
+					REQUIRE(count == 30);
+					for (auto& curve : curves) {
+						REQUIRE(expected.count(curve) == 1);
+					}
+				}
+			}
+		}
+
+		TEST_CASE("Heaps curves are the same with and without the bitsets of the groups", "[heaps]") {
+
+			// nodes of 1 to 7 bp over several words of bits, and paths stepping on different subsets of them
+			graph_t graph;
+			vector<handle_t> nodes;
+			for (uint64_t i = 0; i < 300; ++i) {
+				nodes.push_back(graph.create_handle(string(i % 7 + 1, 'A')));
+			}
+			vector<path_handle_t> paths;
+			for (uint64_t k = 0; k < 12; ++k) {
+				path_handle_t path = graph.create_path_handle("p" + to_string(k));
+				for (uint64_t i = 0; i < nodes.size(); ++i) {
+					if ((i * (k + 3)) % 11 < 3 || (i > 200 && i < 200 + k)) {
+						graph.append_step(path, nodes[i]);
+					}
+				}
+				paths.push_back(path);
+			}
+			// p0 is also in the last group
+			vector<vector<path_handle_t>> path_groups(8);
+			for (uint64_t k = 0; k < paths.size(); ++k) {
+				path_groups[k % 8].push_back(paths[k]);
+			}
+			path_groups[7].push_back(paths[0]);
+
+			ska::flat_hash_map<path_handle_t, vector<interval_t>> no_intervals;
+			ska::flat_hash_map<path_handle_t, vector<interval_t>> intervals;
+			intervals[paths[1]] = {{10, 50}, {300, 400}};
+
+			auto get_curves = [&](const ska::flat_hash_map<path_handle_t, vector<interval_t>>& path_intervals,
+								  const uint64_t& min_node_depth, const uint64_t& nthreads,
+								  const uint64_t& max_group_bitset_bytes) {
+				vector<vector<uint64_t>> curves(20);
+				algorithms::for_each_heap_permutation(
+					graph, path_groups, path_intervals, curves.size(), min_node_depth, nthreads,
+					[&](const vector<uint64_t>& vals, uint64_t i) {
+						curves[i] = vals;
+					},
+					42, max_group_bitset_bytes);
+				return curves;
+			};
+
+			for (auto* path_intervals : {&no_intervals, &intervals}) {
+				for (uint64_t min_node_depth : {0, 3}) {
+					const auto curves = get_curves(*path_intervals, min_node_depth, 1, (uint64_t)1 << 32);
+					for (auto& curve : curves) {
+						REQUIRE(curve.size() == path_groups.size());
+						REQUIRE(is_sorted(curve.begin(), curve.end()));
+						REQUIRE(curve.back() > 0);
+					}
+					// the same seed gives the same permutations on any number of threads
+					REQUIRE(get_curves(*path_intervals, min_node_depth, 3, (uint64_t)1 << 32) == curves);
+					// no room for the bitsets forces each node to be counted for the earliest group on it
+					REQUIRE(get_curves(*path_intervals, min_node_depth, 1, 0) == curves);
+					REQUIRE(get_curves(*path_intervals, min_node_depth, 3, 0) == curves);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+/**
+ * \file
+ * unittest/path_membership.cpp: test cases for the node x group matrix of path membership.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/path_membership.hpp"
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+		using namespace algorithms;
+
+		TEST_CASE("path membership matrix construction and queries.", "[path_membership]") {
+
+			graph_t graph;
+			handle_t n1 = graph.create_handle("CAA");
+			handle_t n2 = graph.create_handle("A");
+			handle_t n3 = graph.create_handle("GT");
+			handle_t n4 = graph.create_handle("T");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n1, n3);
+			graph.create_edge(n2, n3);
+			graph.create_edge(n3, n3);
+			graph.create_edge(n3, n4);
+
+			path_handle_t a = graph.create_path_handle("a");
+			graph.append_step(a, n1);
+			graph.append_step(a, n2);
+			graph.append_step(a, n3);
+			graph.append_step(a, n3);
+			graph.append_step(a, n3);
+
+			path_handle_t b = graph.create_path_handle("b");
+			graph.append_step(b, n1);
+			graph.append_step(b, n3);
+			graph.append_step(b, n3);
+			graph.append_step(b, n4);
+
+			path_handle_t c = graph.create_path_handle("c");
+			graph.append_step(c, n1);
+			graph.append_step(c, n3);
+
+			auto groups_of = [](const path_membership_t& membership, const handle_t& h) {
+				vector<uint64_t> groups;
+				membership.for_each_group(path_membership_t::rank_of(h), [&](const uint64_t& g) {
+					groups.push_back(g);
+				});
+				return groups;
+			};
+			auto repeats_of = [](const path_membership_t& membership, const handle_t& h) {
+				vector<pair<uint64_t, uint64_t>> repeats;
+				membership.for_each_repeat(path_membership_t::rank_of(h), [&](const uint64_t& g, const uint64_t& extra) {
+					repeats.push_back(make_pair(g, extra));
+				});
+				return repeats;
+			};
+
+			SECTION("One group per path.") {
+				const path_membership_t membership(graph, path_membership_t::one_group_per_path(graph), 3, 2);
+				REQUIRE(membership.row_count() == 4);
+				REQUIRE(membership.group_count() == 3);
+				REQUIRE(membership.length(path_membership_t::rank_of(n1)) == 3);
+				REQUIRE(groups_of(membership, n1) == vector<uint64_t>{0, 1, 2});
+				REQUIRE(groups_of(membership, n2) == vector<uint64_t>{0});
+				REQUIRE(groups_of(membership, n3) == vector<uint64_t>{0, 1, 2});
+				REQUIRE(groups_of(membership, n4) == vector<uint64_t>{1});
+				REQUIRE(membership.popcount(path_membership_t::rank_of(n3)) == 3);
+				REQUIRE(membership.contains(path_membership_t::rank_of(n4), 1));
+				REQUIRE(!membership.contains(path_membership_t::rank_of(n4), 0));
+				REQUIRE(!membership.contains(path_membership_t::rank_of(n4), 200));
+				REQUIRE(repeats_of(membership, n3) == vector<pair<uint64_t, uint64_t>>{{0, 2}, {1, 1}});
+				REQUIRE(!membership.has_repeats(path_membership_t::rank_of(n1)));
+				REQUIRE(membership.min_group_rank(path_membership_t::rank_of(n3), {2, 0, 1}) == 0);
+				REQUIRE(membership.min_group_rank(path_membership_t::rank_of(n2), {2, 0, 1}) == 2);
+			}
+
+			SECTION("Grouped paths, leaving one out, with groups spread over several words.") {
+				vector<uint64_t> path_group(as_integer(c) + 1, path_membership_t::no_group);
+				path_group[as_integer(a)] = 130;
+				path_group[as_integer(b)] = 5;
+				const path_membership_t membership(graph, path_group, 131, 1);
+				REQUIRE(groups_of(membership, n1) == vector<uint64_t>{5, 130});
+				REQUIRE(membership.first_word(path_membership_t::rank_of(n1)) == 0);
+				REQUIRE(membership.word_count(path_membership_t::rank_of(n1)) == 3);
+				REQUIRE(groups_of(membership, n2) == vector<uint64_t>{130});
+				REQUIRE(membership.first_word(path_membership_t::rank_of(n2)) == 2);
+				REQUIRE(membership.word_count(path_membership_t::rank_of(n2)) == 1);
+				REQUIRE(membership.contains(path_membership_t::rank_of(n2), 130));
+				REQUIRE(!membership.contains(path_membership_t::rank_of(n2), 5));
+				REQUIRE(repeats_of(membership, n3) == vector<pair<uint64_t, uint64_t>>{{5, 1}, {130, 2}});
+			}
+		}
+	}
+}
@@ -0,0 +1,153 @@
+/**
+ * \file
+ * unittest/png.cpp: test cases for writing PNG images one band of rows at a time.
+ */
+
+#include "catch.hpp"
+
+#include "algorithms/png_band_writer.hpp"
+#include "algorithms/temp_file.hpp"
+#include "lodepng.h"
+
+#include <random>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+
+		/// an image that has runs of colors to match, like the images of odgi viz, with noise in a corner
+		static void get_pixels(const uint64_t& width, const uint64_t& y, uint8_t* row) {
+			for (uint64_t x = 0; x < width; ++x) {
+				const bool noise = x < width / 3 && y % 5 == 1;
+				for (uint64_t c = 0; c < 3; ++c) {
+					row[3 * x + c] = noise ? (x * 2654435761u ^ y * 40503u ^ c * 977u) >> 7
+						: ((x / 10 + y / 3) % 5 == 0 ? (c == 0 ? 200 : 40) : 255);
+				}
+			}
+		}
+
+		TEST_CASE("adler32_combine gives the adler32 of the concatenated data", "[png]") {
+			mt19937 rng(17);
+			uniform_int_distribution<int> byte(0, 255);
+			for (uint64_t length_a : {0, 1, 5552, 70000}) {
+				for (uint64_t length_b : {0, 1, 3, 5553, 65521, 131100}) {
+					vector<uint8_t> data(length_a + length_b);
+					for (auto& d : data) {
+						d = byte(rng);
+					}
+					const uint32_t adler_a = png::adler32(1, data.data(), length_a);
+					const uint32_t adler_b = png::adler32(1, data.data() + length_a, length_b);
+					REQUIRE(png::adler32_combine(adler_a, adler_b, length_b) == png::adler32(1, data.data(), data.size()));
+					REQUIRE(png::adler32(adler_a, data.data() + length_a, length_b) == png::adler32(1, data.data(), data.size()));
+				}
+			}
+			// all 0xff is the worst case for the sums
+			vector<uint8_t> ones(200000, 0xff);
+			REQUIRE(png::adler32_combine(png::adler32(1, ones.data(), 123456), png::adler32(1, ones.data(), 200000 - 123456),
+										 200000 - 123456) == png::adler32(1, ones.data(), ones.size()));
+		}
+
+		TEST_CASE("PNG images written in bands of rows decode to the rows written", "[png]") {
+			// width, height, threads, rows per thread
+			const vector<vector<uint64_t>> shapes = {
+				{300, 200, 4, 7},    // many bands, with a last one that doesn't fill all threads
+				{13, 3, 8, 0},       // more threads than rows
+				{7, 1, 4, 1},        // a single row of an odd width
+				{1, 5, 2, 2},        // rows of a single pixel, shorter than the distance the filters look back
+				{1000, 90, 3, 0},    // enough matches and literals for several deflate blocks per thread
+				{40, 3, 4, 1},       // a band in which the last thread gets no rows
+				{12000, 1, 2, 0},    // a single row longer than the 32K deflate window
+				{12000, 5, 3, 1},    // rows longer than the window, which the up filter looks back a whole row over
+			};
+			for (auto& shape : shapes) {
+				const uint64_t width = shape[0];
+				const uint64_t height = shape[1];
+				const string filename = algorithms::temp_file::create("odgi-png");
+				{
+					png::band_writer_t writer(filename, width, height, shape[2]);
+					writer.write([&](const uint64_t& y, uint8_t* row) {
+						get_pixels(width, y, row);
+					}, shape[3]);
+				}
+				vector<unsigned char> decoded;
+				unsigned w = 0;
+				unsigned h = 0;
+				REQUIRE(lodepng::decode(decoded, w, h, filename, LCT_RGB, 8) == 0);
+				REQUIRE(w == width);
+				REQUIRE(h == height);
+				vector<uint8_t> expected(3 * width * height);
+				for (uint64_t y = 0; y < height; ++y) {
+					get_pixels(width, y, &expected[3 * width * y]);
+				}
+				REQUIRE(vector<uint8_t>(decoded.begin(), decoded.end()) == expected);
+			}
+		}
+
+		TEST_CASE("Data deflated in pieces inflates to the whole", "[png]") {
+			// the pieces are byte aligned blocks that don't end the stream, so a zlib stream is built around them here
+			vector<uint8_t> data;
+			for (uint64_t i = 0; i < 100000; ++i) {
+				data.push_back(i % 251 < 120 ? (uint8_t)(i * i >> 3) : (uint8_t)(i / 1000));
+			}
+			vector<uint8_t> stream = {0x78, 0x01};
+			uint32_t adler = 1;
+			for (uint64_t begin = 0; begin < data.size(); begin += 30000) {
+				const uint64_t length = min((uint64_t)30000, data.size() - begin);
+				png::deflate_sync(data.data() + begin, length, stream);
+				adler = png::adler32_combine(adler, png::adler32(1, data.data() + begin, length), length);
+			}
+			stream.insert(stream.end(), {0x03, 0x00});
+			for (uint8_t shift : {24, 16, 8, 0}) {
+				stream.push_back(adler >> shift);
+			}
+			vector<unsigned char> inflated;
+			REQUIRE(lodepng::zlib_decompress(inflated, stream.data(), stream.size()) == 0);
+			REQUIRE(vector<uint8_t>(inflated.begin(), inflated.end()) == data);
+		}
+
+		TEST_CASE("Empty and incompressible pieces are deflated into blocks that inflate to them", "[png]") {
+			mt19937 rng(23);
+			uniform_int_distribution<int> byte(0, 255);
+			// random bytes are stored as they are, with 5 bytes of header for each block of 16384 literals
+			vector<uint8_t> random(200000);
+			for (auto& d : random) {
+				d = byte(rng);
+			}
+			vector<uint8_t> compressible(100000);
+			for (uint64_t i = 0; i < compressible.size(); ++i) {
+				compressible[i] = i % 7;
+			}
+			const vector<pair<const uint8_t*, uint64_t>> pieces = {
+				{random.data(), 0},
+				{random.data(), random.size()},
+				{random.data(), 0},
+				{compressible.data(), compressible.size()},
+				{random.data(), 1},
+				{random.data() + 1000, 70000},
+			};
+			vector<uint8_t> data;
+			vector<uint8_t> stream = {0x78, 0x01};
+			uint32_t adler = 1;
+			for (auto& piece : pieces) {
+				const uint64_t before = stream.size();
+				png::deflate_sync(piece.first, piece.second, stream);
+				if (piece.second == 0) {
+					// only the empty stored block that ends every piece
+					REQUIRE(stream.size() - before == 5);
+				} else if (piece.first == random.data() && piece.second == random.size()) {
+					REQUIRE(stream.size() - before <= piece.second + 5 * (piece.second / 16384 + 1) + 5);
+				}
+				data.insert(data.end(), piece.first, piece.first + piece.second);
+				adler = png::adler32_combine(adler, png::adler32(1, piece.first, piece.second), piece.second);
+			}
+			stream.insert(stream.end(), {0x03, 0x00});
+			for (uint8_t shift : {24, 16, 8, 0}) {
+				stream.push_back(adler >> shift);
+			}
+			vector<unsigned char> inflated;
+			REQUIRE(lodepng::zlib_decompress(inflated, stream.data(), stream.size()) == 0);
+			REQUIRE(vector<uint8_t>(inflated.begin(), inflated.end()) == data);
+		}
+	}
+}
@@ -0,0 +1,218 @@
+/**
+ * \file
+ * unittest/server.cpp: test cases for the queries of odgi server.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/server_queries.hpp"
+
+#include <cstring>
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+
+		TEST_CASE("Numbers in server requests are parsed only if they fit in 64 bits", "[server]") {
+			auto parse = [](const string& s, uint64_t& value) {
+				return algorithms::parse_uint(s.data(), s.data() + s.size(), value);
+			};
+			uint64_t value = 0;
+			REQUIRE(parse("0", value));
+			REQUIRE(value == 0);
+			REQUIRE(parse("0042", value));
+			REQUIRE(value == 42);
+			REQUIRE(parse("9999999999999999999", value));
+			REQUIRE(value == 9999999999999999999ULL);
+			// 20 digits may not fit, even those of a number that would
+			REQUIRE(!parse("18446744073709551615", value));
+			REQUIRE(!parse("99999999999999999999", value));
+			REQUIRE(!parse("00000000000000000001", value));
+			REQUIRE(!parse("", value));
+			REQUIRE(!parse("-1", value));
+			REQUIRE(!parse("1a", value));
+			REQUIRE(!parse(" 1", value));
+		}
+
+		TEST_CASE("Path positions are split at the last separator of each line", "[server]") {
+			const auto queries = algorithms::parse_path_pos_queries(
+				"a\t1\nb 10\r\nchr1:5\nsample#1#chr1:2\n\nc\t0\nd\t\nnoposition\ne\tx\nf\t99999999999999999999");
+			REQUIRE(queries.size() == 9);
+			REQUIRE(queries[0].valid);
+			REQUIRE(queries[0].path == "a");
+			REQUIRE(queries[0].offset == 0);
+			REQUIRE(queries[1].valid);
+			REQUIRE(queries[1].path == "b");
+			REQUIRE(queries[1].offset == 9);
+			REQUIRE(queries[2].valid);
+			REQUIRE(queries[2].path == "chr1");
+			REQUIRE(queries[2].offset == 4);
+			REQUIRE(queries[3].valid);
+			REQUIRE(queries[3].path == "sample#1#chr1");
+			REQUIRE(queries[3].offset == 1);
+			// positions are 1-based, so 0 isn't one
+			for (uint64_t i = 4; i < queries.size(); ++i) {
+				REQUIRE(!queries[i].valid);
+			}
+			REQUIRE(algorithms::parse_path_pos_queries("").empty());
+			REQUIRE(algorithms::parse_path_pos_queries("a:12:3").front().path == "a:12");
+		}
+
+		TEST_CASE("The server answers queries on the graph and its paths", "[server]") {
+
+			// node 1 is 0-3 of the pangenome, node 2 4-5 and node 3 6-8
+			graph_t graph;
+			handle_t n1 = graph.create_handle("ACGT");
+			handle_t n2 = graph.create_handle("GG");
+			handle_t n3 = graph.create_handle("TTA");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n2, n3);
+			graph.create_edge(n1, graph.flip(n3));
+
+			// a is 0-3, 4-5, 6-8 and b 0-3, 4-6 on the reverse of node 3
+			path_handle_t a = graph.create_path_handle("a");
+			for (auto& h : {n1, n2, n3}) {
+				graph.append_step(a, h);
+			}
+			path_handle_t b = graph.create_path_handle("b");
+			graph.append_step(b, n1);
+			graph.append_step(b, graph.flip(n3));
+
+			const vector<path_handle_t> paths = {a, b};
+			step_index_t step_index(graph, paths, 1, false, 8);
+			xp::XP path_index;
+			path_index.from_handle_graph(graph, 1);
+			const algorithms::server_queries_t queries(&graph, &step_index, &path_index);
+
+			const string positions = "a\t1\na 5\nb:6\nc\t1\na\t10\nbad\n";
+
+			SECTION("Path positions to graph positions") {
+				auto res = queries.positions(positions, true, false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.content_type == "application/json");
+				REQUIRE(res.body == "[[1,0,\"+\"],[2,0,\"+\"],[3,1,\"-\"],[0,0,\"+\"],[0,0,\"+\"],[0,0,\"+\"]]");
+
+				res = queries.positions(positions, true, true);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.content_type == "application/octet-stream");
+				REQUIRE(res.body.size() == 6 * 3 * sizeof(uint64_t));
+				vector<uint64_t> values(6 * 3);
+				memcpy(values.data(), res.body.data(), res.body.size());
+				REQUIRE(values == vector<uint64_t>{1, 0, 0, 2, 0, 0, 3, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+			}
+
+			SECTION("Path positions to pangenome positions") {
+				auto res = queries.positions("a\t1\na 5\nb:6\nc\t1\n", false, false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "[1,5,8,0]");
+				res = queries.pangenome_position("b", "6");
+				REQUIRE(res.status == 200);
+				REQUIRE(res.content_type == "text/plain");
+				REQUIRE(res.body == "8");
+				REQUIRE(queries.pangenome_position("b", "99999999999999999999").body == "0");
+				REQUIRE(queries.pangenome_position("c", "1").body == "0");
+			}
+
+			SECTION("Nodes") {
+				auto res = queries.node("2", false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "{\"id\":2,\"length\":2,\"sequence\":\"GG\",\"depth\":1,"
+									"\"left\":[\"1+\"],\"right\":[\"3+\"],\"paths\":[{\"name\":\"a\",\"count\":1}]}");
+
+				res = queries.node("3", true);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body.find("\"depth\":2,\"left\":[\"2+\"],\"right\":[\"1-\"]") != string::npos);
+				REQUIRE(res.body.find("[\"a\",6,\"+\"]") != string::npos);
+				REQUIRE(res.body.find("[\"b\",4,\"-\"]") != string::npos);
+				REQUIRE(res.body.find("\"paths\":[{\"name\":\"a\",\"count\":1},{\"name\":\"b\",\"count\":1}]}") != string::npos);
+
+				for (const string id : {"4", "0", "x", "99999999999999999999"}) {
+					res = queries.node(id, false);
+					REQUIRE(res.status == 404);
+					REQUIRE(res.body == "{\"error\":\"no node " + id + " in the graph\"}");
+				}
+			}
+
+			SECTION("Paths and their ranges") {
+				auto res = queries.path("b", false, "", "");
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "{\"name\":\"b\",\"length\":7,\"steps\":2,\"circular\":false}");
+
+				res = queries.path("a", true, "5", "");
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "{\"name\":\"a\",\"length\":9,\"steps\":3,\"circular\":false,"
+									"\"start\":4,\"walk\":[\"2+\",\"3+\"]}");
+
+				res = queries.path("b", true, "", "100");
+				REQUIRE(res.body == "{\"name\":\"b\",\"length\":7,\"steps\":2,\"circular\":false,"
+									"\"start\":0,\"walk\":[\"1+\",\"3-\"]}");
+
+				REQUIRE(queries.path("a", true, "5", "5").status == 400);
+				REQUIRE(queries.path("a", true, "9", "").status == 400);
+				REQUIRE(queries.path("a", true, "-1", "").status == 400);
+				REQUIRE(queries.path("a", true, "", "99999999999999999999").status == 400);
+				res = queries.path("z", false, "", "");
+				REQUIRE(res.status == 404);
+				REQUIRE(res.body == "{\"error\":\"no path z in the graph\"}");
+			}
+
+			SECTION("Depth over ranges of paths") {
+				auto res = queries.depth("a", "2", "6", true);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "{\"path\":\"a\",\"start\":2,\"end\":6,\"depth\":1.5,\"nodes\":[[1,2],[2,1]]}");
+
+				res = queries.depth("b", "", "", false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body == "{\"path\":\"b\",\"start\":0,\"end\":7,\"depth\":2}");
+
+				REQUIRE(queries.depth("a", "7", "3", false).status == 400);
+				REQUIRE(queries.depth("", "", "", false).status == 404);
+			}
+
+			SECTION("Subgraphs of ranges of paths") {
+				auto res = queries.subgraph("a", "4", "6", "", false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.content_type == "text/plain");
+				REQUIRE(res.body.find("\nS\t2\tGG\n") != string::npos);
+				REQUIRE(res.body.find("\nS\t1\t") == string::npos);
+				REQUIRE(res.body.find("\nS\t3\t") == string::npos);
+
+				res = queries.subgraph("a", "4", "6", "1", false);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.body.find("\nS\t1\tACGT\n") != string::npos);
+				REQUIRE(res.body.find("\nS\t2\tGG\n") != string::npos);
+				REQUIRE(res.body.find("\nS\t3\tTTA\n") != string::npos);
+
+				res = queries.subgraph("a", "4", "6", "", true);
+				REQUIRE(res.status == 200);
+				REQUIRE(res.content_type == "application/octet-stream");
+				REQUIRE(!res.body.empty());
+
+				REQUIRE(queries.subgraph("a", "4", "6", "x", false).status == 400);
+			}
+
+			SECTION("Queries that need what the server wasn't started with are bad requests") {
+				const algorithms::server_queries_t without_index(&graph, &step_index, nullptr);
+				auto res = without_index.positions(positions, false, false);
+				REQUIRE(res.status == 400);
+				REQUIRE(res.body == "{\"error\":\"the server was started without a path index, see -i, --idx\"}");
+				REQUIRE(without_index.positions(positions, true, false).status == 200);
+				REQUIRE(without_index.pangenome_position("a", "1").body == "0");
+
+				const algorithms::server_queries_t without_graph(nullptr, nullptr, &path_index);
+				res = without_graph.positions(positions, true, false);
+				REQUIRE(res.status == 400);
+				REQUIRE(res.body == "{\"error\":\"the server was started without a graph, see -g, --graph\"}");
+				REQUIRE(without_graph.node("1", false).status == 400);
+				REQUIRE(without_graph.path("a", false, "", "").status == 400);
+				REQUIRE(without_graph.depth("a", "", "", false).status == 400);
+				REQUIRE(without_graph.subgraph("a", "", "", "", false).status == 400);
+				REQUIRE(without_graph.positions("a\t5\n", false, false).body == "[5]");
+			}
+		}
+	}
+}
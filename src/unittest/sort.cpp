@@ -14,6 +14,7 @@
 #include <random>
 #include <xp.hpp>
 #include <path_sgd.hpp>
+#include <path_sgd_multilevel.hpp>
 
 namespace odgi {
 namespace unittest {
@@ -225,7 +226,11 @@ TEST_CASE("Sorting a graph with paths 1 node long", "[sort]") {
 			false, // write 1D layout
 			"", // layout file name
 			false, // target base sorting
-			target_nodes // actual target nodes
+			target_nodes, // actual target nodes
+			false, // single precision
+			false, // deterministic
+			false, // multilevel
+			odgi::algorithms::path_sgd_convergence_t()
     );
 
     graph.apply_ordering(order, true);
@@ -254,6 +259,261 @@ TEST_CASE("Sorting a graph with paths 1 node long", "[sort]") {
     }
 }
 
+TEST_CASE("Deterministic PG-SGD gives the same layout with any number of threads", "[sort]") {
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 7, "ACGT"[i % 4])));
+    }
+    // a chain whose path visits the nodes out of their id order
+    std::vector<handle_t> chain = handles;
+    std::mt19937 rng(42);
+    std::shuffle(chain.begin(), chain.end(), rng);
+    for (uint64_t i = 1; i < chain.size(); ++i) {
+        graph.create_edge(chain[i - 1], chain[i]);
+    }
+    std::vector<path_handle_t> path_sgd_use_paths;
+    for (uint64_t p = 0; p < 3; ++p) {
+        auto path = graph.create_path_handle("x" + std::to_string(p));
+        for (auto& h : chain) {
+            graph.append_step(path, h);
+        }
+        path_sgd_use_paths.push_back(path);
+    }
+
+    xp::XP path_index;
+    path_index.from_handle_graph(graph, 1);
+
+    std::vector<bool> target_nodes;
+    std::vector<std::string> snapshots;
+    auto layout_with = [&](const uint64_t& nthreads, const std::string& seed) {
+        return odgi::algorithms::path_linear_sgd(
+                graph,
+                path_index,
+                path_sgd_use_paths,
+                30, // iter_max
+                0, // iter_with_max_learning_rate
+                10 * chain.size(), // min_term_updates
+                0, // delta
+                0.01, // eps
+                chain.size() * chain.size(), // eta_max
+                0.99, // theta
+                chain.size(), // space
+                1000, // space_max
+                100, // space_quantization_step
+                0.5, // cooling_start
+                nthreads,
+                false, // progress
+                false, // snapshot
+                snapshots,
+                false, // target base sorting
+                target_nodes,
+                false, // single precision
+                true, // deterministic
+                seed,
+                false, // multilevel
+                odgi::algorithms::path_sgd_convergence_t());
+    };
+
+    auto X_1 = layout_with(1, "pangenomic!");
+    auto X_3 = layout_with(3, "pangenomic!");
+    auto X_other = layout_with(3, "another seed");
+
+    SECTION("The layout doesn't depend on the number of threads") {
+        REQUIRE(X_1 == X_3);
+    }
+
+    SECTION("The layout depends on the seed") {
+        REQUIRE(X_1 != X_other);
+    }
+
+    SECTION("The layout follows the path") {
+        // neighbours in the path end up close to each other
+        uint64_t close = 0;
+        for (uint64_t i = 1; i < chain.size(); ++i) {
+            double d = std::abs(X_1[number_bool_packing::unpack_number(chain[i])]
+                                - X_1[number_bool_packing::unpack_number(chain[i - 1])]);
+            if (d < 20) {
+                ++close;
+            }
+        }
+        REQUIRE(close > chain.size() * 9 / 10);
+    }
+}
+
+TEST_CASE("Multilevel PG-SGD lays out a graph from its merged nodes", "[sort]") {
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 4000; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 7, "ACGT"[i % 4])));
+    }
+    std::vector<handle_t> chain = handles;
+    std::mt19937 rng(7);
+    std::shuffle(chain.begin(), chain.end(), rng);
+    for (uint64_t i = 1; i < chain.size(); ++i) {
+        graph.create_edge(chain[i - 1], chain[i]);
+    }
+    std::vector<path_handle_t> path_sgd_use_paths;
+    for (uint64_t p = 0; p < 2; ++p) {
+        auto path = graph.create_path_handle("x" + std::to_string(p));
+        for (auto& h : chain) {
+            graph.append_step(path, h);
+        }
+        path_sgd_use_paths.push_back(path);
+    }
+
+    SECTION("Each level merges the nodes that follow each other in the paths") {
+        auto steps = odgi::algorithms::path_sgd_steps(graph, 2);
+        std::vector<uint64_t> length(graph.get_node_count());
+        graph.for_each_handle([&](const handle_t& h) {
+            length[number_bool_packing::unpack_number(h)] = graph.get_length(h);
+        });
+        auto levels = odgi::algorithms::path_sgd_coarsen(steps, length, 1000, 2);
+        REQUIRE(levels.size() == 2);
+        REQUIRE(levels[0].node_count == 2000);
+        REQUIRE(levels[1].node_count == 1000);
+        uint64_t total_length = 0;
+        for (auto& l : length) {
+            total_length += l;
+        }
+        const std::vector<uint64_t>* below_length = &length;
+        for (auto& level : levels) {
+            uint64_t level_length = 0;
+            for (auto& l : level.length) {
+                level_length += l;
+            }
+            REQUIRE(level_length == total_length);
+            for (uint64_t u = 0; u < below_length->size(); ++u) {
+                REQUIRE(level.offset[u] + (*below_length)[u] <= level.length[level.parent[u]]);
+            }
+            // every path walks through each merged node once
+            REQUIRE(level.steps.step_count() == 2 * level.node_count);
+            below_length = &level.length;
+        }
+    }
+
+    xp::XP path_index;
+    path_index.from_handle_graph(graph, 1);
+
+    std::vector<bool> target_nodes;
+    std::vector<std::string> snapshots;
+    auto layout_with = [&](const uint64_t& nthreads) {
+        return odgi::algorithms::path_linear_sgd(
+                graph,
+                path_index,
+                path_sgd_use_paths,
+                30, // iter_max
+                0, // iter_with_max_learning_rate
+                10 * chain.size(), // min_term_updates
+                0, // delta
+                0.01, // eps
+                chain.size() * chain.size(), // eta_max
+                0.99, // theta
+                chain.size(), // space
+                1000, // space_max
+                100, // space_quantization_step
+                0.5, // cooling_start
+                nthreads,
+                false, // progress
+                false, // snapshot
+                snapshots,
+                false, // target base sorting
+                target_nodes,
+                false, // single precision
+                true, // deterministic
+                "pangenomic!",
+                true, // multilevel
+                odgi::algorithms::path_sgd_convergence_t());
+    };
+
+    auto X_1 = layout_with(1);
+    auto X_3 = layout_with(3);
+
+    SECTION("A deterministic multilevel layout doesn't depend on the number of threads") {
+        REQUIRE(X_1 == X_3);
+    }
+
+    SECTION("The multilevel layout follows the path") {
+        uint64_t close = 0;
+        for (uint64_t i = 1; i < chain.size(); ++i) {
+            double d = std::abs(X_1[number_bool_packing::unpack_number(chain[i])]
+                                - X_1[number_bool_packing::unpack_number(chain[i - 1])]);
+            if (d < 20) {
+                ++close;
+            }
+        }
+        REQUIRE(close > chain.size() * 9 / 10);
+    }
+}
+
+TEST_CASE("PG-SGD cools down on a stress plateau and resumes from checkpoints", "[sort]") {
+    odgi::algorithms::path_sgd_convergence_t convergence;
+    convergence.plateau_iterations = 2;
+    convergence.plateau_tolerance = 0.01;
+
+    SECTION("Only improvements beyond the tolerance reset the plateau") {
+        odgi::algorithms::path_sgd_schedule_state_t state;
+        REQUIRE(!odgi::algorithms::path_sgd_plateaued(state, 10.0, convergence));
+        REQUIRE(!odgi::algorithms::path_sgd_plateaued(state, 5.0, convergence));
+        REQUIRE(state.since_best == 0);
+        REQUIRE(!odgi::algorithms::path_sgd_plateaued(state, 4.99, convergence));
+        REQUIRE(state.since_best == 1);
+        REQUIRE(state.best_stress == 4.99);
+        REQUIRE(odgi::algorithms::path_sgd_plateaued(state, 6.0, convergence));
+        convergence.plateau_iterations = 0;
+        REQUIRE(!odgi::algorithms::path_sgd_plateaued(state, 6.0, convergence));
+    }
+
+    SECTION("A plateau skips ahead to half the learning rate, and ends the schedule at a learning rate of 1") {
+        const std::vector<double> etas = {100, 80, 60, 45, 30, 10, 2, 1, 0.5};
+        REQUIRE(odgi::algorithms::path_sgd_after_plateau(etas, 0, etas.size()) == 3);
+        REQUIRE(odgi::algorithms::path_sgd_after_plateau(etas, 3, etas.size()) == 5);
+        REQUIRE(odgi::algorithms::path_sgd_after_plateau(etas, 6, etas.size()) == 7);
+        REQUIRE(odgi::algorithms::path_sgd_after_plateau(etas, 7, etas.size()) == etas.size());
+        REQUIRE(odgi::algorithms::path_sgd_after_plateau(etas, 4, 5) == 5);
+    }
+
+    SECTION("A checkpoint gives back the state and positions it was written with") {
+        std::vector<std::atomic<double>> X(6), Y(6);
+        for (uint64_t i = 0; i < X.size(); ++i) {
+            X[i].store(i * 1.5);
+            Y[i].store(-(double)i);
+        }
+        odgi::algorithms::path_sgd_schedule_state_t state;
+        state.iteration = 7;
+        state.iter_max = 30;
+        state.iter_with_max_learning_rate = 3;
+        state.eta_max = 42.5;
+        state.best_stress = 0.25;
+        state.since_best = 1;
+        std::string checkpoint = xp::temp_file::create() + "unittest.sgdcp";
+        odgi::algorithms::path_sgd_write_checkpoint(checkpoint, state, true, 1234, X, Y);
+
+        std::vector<std::atomic<double>> X_read(6), Y_read(6);
+        odgi::algorithms::path_sgd_schedule_state_t state_read;
+        bool deterministic = false;
+        uint64_t seed = 0;
+        REQUIRE(odgi::algorithms::path_sgd_read_checkpoint(checkpoint, state_read, deterministic, seed, X_read, Y_read));
+        REQUIRE(deterministic);
+        REQUIRE(seed == 1234);
+        REQUIRE(state_read.iteration == 7);
+        REQUIRE(state_read.iter_max == 30);
+        REQUIRE(state_read.iter_with_max_learning_rate == 3);
+        REQUIRE(state_read.eta_max == 42.5);
+        REQUIRE(state_read.best_stress == 0.25);
+        REQUIRE(state_read.since_best == 1);
+        for (uint64_t i = 0; i < X.size(); ++i) {
+            REQUIRE(X_read[i].load() == X[i].load());
+            REQUIRE(Y_read[i].load() == Y[i].load());
+        }
+
+        // a layout of another graph can't resume from it
+        std::vector<std::atomic<double>> X_other(8), Y_other(8);
+        REQUIRE_THROWS(odgi::algorithms::path_sgd_read_checkpoint(checkpoint, state_read, deterministic, seed, X_other, Y_other));
+        REQUIRE(!odgi::algorithms::path_sgd_read_checkpoint(checkpoint + ".missing", state_read, deterministic, seed, X_read, Y_read));
+    }
+}
+
 TEST_CASE("Sorting the paths in a graph", "[sort]") {
     graph_t graph;
     handle_t n1 = graph.create_handle("CAAATAAG");
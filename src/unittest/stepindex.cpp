@@ -751,6 +751,57 @@ namespace odgi {
 				});
 			}
 
+			SECTION("The index finds the step covering each position of a path, also after saving and loading.") {
+				step_index_t step_index(graph, paths, 1, false, 2);
+				std::string basename = xp::temp_file::create();
+				step_index.save(basename + "unittest.stpidx");
+				step_index_t step_index_loaded;
+				step_index_loaded.load(basename + "unittest.stpidx");
+
+				for (auto& path : paths) {
+					// every base of the path maps to the step that covers it, and to that step's start
+					vector<pair<step_handle_t, uint64_t>> expected;
+					uint64_t offset = 0;
+					graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+						const uint64_t length = graph.get_length(graph.get_handle_of_step(step));
+						for (uint64_t i = 0; i < length; ++i) {
+							expected.push_back(make_pair(step, offset));
+						}
+						offset += length;
+					});
+					for (uint64_t i = 0; i < expected.size(); ++i) {
+						REQUIRE(step_index.get_step_at_position(path, i, graph) == expected[i]);
+						REQUIRE(step_index_loaded.get_step_at_position(path, i, graph) == expected[i]);
+					}
+					REQUIRE(step_index.get_step_at_position(path, offset, graph).first == graph.path_end(path));
+				}
+			}
+
+			SECTION("An index saved next to a graph file is only picked up while it matches the graph.") {
+				std::string basename = xp::temp_file::create();
+				const std::string graph_file = basename + "unittest.og";
+				{
+					ofstream out(graph_file);
+					graph.serialize(out);
+				}
+				step_index_t step_index_to_save(graph, paths, 1, false, 8);
+				step_index_to_save.graph_hash = graph_file_hash(graph_file);
+				REQUIRE(step_index_to_save.graph_hash != 0);
+				step_index_to_save.save(step_index_sidecar_name(graph_file));
+
+				step_index_t step_index_found;
+				REQUIRE(load_step_index_sidecar(step_index_found, graph_file, false));
+				REQUIRE(step_index_found.get_path_len(target) == 14);
+
+				// once the graph file changes, the index no longer describes it
+				graph.create_handle("ACGT");
+				{
+					ofstream out(graph_file);
+					graph.serialize(out);
+				}
+				step_index_t step_index_stale;
+				REQUIRE(!load_step_index_sidecar(step_index_stale, graph_file, false));
+			}
 		}
 	}
 }
@@ -0,0 +1,92 @@
+/**
+ * \file
+ * unittest/tips.cpp: test cases for the jaccard indices odgi tips ranks target steps by.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/path_jaccard.hpp"
+
+namespace odgi {
+	namespace unittest {
+
+		using namespace std;
+		using namespace handlegraph;
+		using namespace algorithms;
+
+		TEST_CASE("Sketched jaccard indices report the mappings the exact ones report", "[tips]") {
+
+			// the target runs through a cycle 40 times, so that most of its steps on b have the window of the query
+			graph_t graph;
+			handle_t x = graph.create_handle("A");
+			handle_t a = graph.create_handle("C");
+			handle_t b = graph.create_handle("G");
+			handle_t c = graph.create_handle("T");
+			handle_t y = graph.create_handle("A");
+			graph.create_edge(x, a);
+			graph.create_edge(x, c);
+			graph.create_edge(a, b);
+			graph.create_edge(b, c);
+			graph.create_edge(c, a);
+			graph.create_edge(c, y);
+			graph.create_edge(a, y);
+
+			path_handle_t target = graph.create_path_handle("target");
+			graph.append_step(target, x);
+			for (uint64_t i = 0; i < 40; ++i) {
+				graph.append_step(target, a);
+				graph.append_step(target, b);
+				graph.append_step(target, c);
+			}
+			graph.append_step(target, y);
+			path_handle_t query = graph.create_path_handle("query");
+			for (auto& h : {x, c, a, b, c, a, y}) {
+				graph.append_step(query, h);
+			}
+
+			step_handle_t query_step;
+			graph.for_each_step_in_path(query, [&](const step_handle_t& s) {
+				if (graph.get_handle_of_step(s) == b) {
+					query_step = s;
+				}
+			});
+			vector<step_handle_t> target_steps;
+			graph.for_each_step_on_handle(b, [&](const step_handle_t& s) {
+				if (graph.get_path_handle_of_step(s) == target) {
+					target_steps.push_back(s);
+				}
+			});
+			REQUIRE(target_steps.size() == 40);
+
+			const uint64_t walking_dist = 2;
+			vector<step_handle_t> exact_targets = target_steps;
+			const vector<step_jaccard_t> exact = jaccard_indices_from_step_handles(graph, walking_dist, query_step, exact_targets);
+			// more targets tie for the best jaccard index than the sketches verify at first
+			REQUIRE(count_if(exact.begin(), exact.end(), [](const step_jaccard_t& s) { return s.jaccard == 1.0; }) == 38);
+
+			for (uint64_t sketch_size : {4, 128}) {
+				vector<walk_sketch_t> sketches;
+				for (auto& s : target_steps) {
+					sketches.push_back(sketch_walk_window(graph, walking_dist, s, sketch_size));
+				}
+				vector<const walk_sketch_t*> target_sketches;
+				for (auto& sketch : sketches) {
+					target_sketches.push_back(&sketch);
+				}
+				const walk_sketch_t query_sketch = sketch_walk_window(graph, walking_dist, query_step, sketch_size);
+				vector<step_handle_t> sketched_targets = target_steps;
+				const vector<step_jaccard_t> sketched = jaccard_indices_from_sketches(graph, walking_dist, query_step, query_sketch,
+																					  sketched_targets, target_sketches,
+																					  sketch_size, 16);
+				REQUIRE(sketched.size() == exact.size());
+				// the best mapping is the one with the median rank among all that tie, as without sketches
+				REQUIRE(sketched[0].step == exact[0].step);
+				for (uint64_t i = 0; i < 38; ++i) {
+					REQUIRE(sketched[i].jaccard == exact[i].jaccard);
+				}
+			}
+		}
+	}
+}
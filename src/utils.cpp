@@ -72,12 +72,17 @@ namespace utils {
 																				   "To save time in the future, please use odgi build -i=[FILE], --idx=[FILE] -o=[FILE], --out=[FILE] "
 																				   "to generate a graph in ODGI format. Such a graph can be supplied to all ODGI subcommands. Building graph in ODGI format from given GFA." << std::endl;
 			}
-			gfa_to_handle(infile, &graph, false, num_threads, progress);
+			try {
+				gfa_to_handle(infile, &graph, false, num_threads, progress);
+			} catch (const std::runtime_error& e) {
+				std::cerr << e.what() << std::endl;
+				exit(1);
+			}
 			graph.set_number_of_threads(num_threads);
 		} else {
-			ifstream f(infile.c_str());
-			graph.deserialize(f);
-			f.close();
+			// node blocks are decoded on num_threads threads
+			graph.set_number_of_threads(num_threads);
+			graph.deserialize(infile);
 		}
 		return 0;
     }